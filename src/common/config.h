@@ -34,8 +34,23 @@ static constexpr int HEADER_PAGE_ID = 0;                                      //
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte  4KB
 static constexpr int BUFFER_POOL_SIZE = 65536;                                // size of buffer pool 256MB
 // static constexpr int BUFFER_POOL_SIZE = 262144;                                // size of buffer pool 1GB
+static constexpr int BUFFER_POOL_SHARDS = 16;                                 // number of buffer pool partitions
+static constexpr int BUFFER_POOL_MIN_CLEAN_FRAMES = 1024;                     // frames the flusher keeps clean ahead of eviction
+static constexpr int BUFFER_POOL_FLUSH_INTERVAL_MS = 50;                      // background flusher wake-up interval
+static constexpr int EVICTION_WRITE_BATCH = 16;                               // dirty pages written together when an eviction writes back
 static constexpr int LOG_BUFFER_SIZE = (1024 * PAGE_SIZE);                    // size of a log buffer in byte
+static constexpr int IO_ENGINE_THREADS = 4;                                   // worker threads of the thread-pool I/O engine
+static constexpr int IO_URING_QUEUE_DEPTH = 256;                              // submission queue depth when built with io_uring
+static constexpr int READAHEAD_MIN_PAGES = 4;                                 // initial read-ahead window of sequential scans
+static constexpr int READAHEAD_MAX_PAGES = 64;                                // read-ahead window cap (256KB)
+static constexpr double IX_BULK_LOAD_FILL_FACTOR = 0.9;                       // fill factor of nodes built by index bulk loading
+static constexpr size_t IX_BULK_LOAD_MEMORY_LIMIT = 64 << 20;                 // sort buffer of index bulk loading before spilling a run
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr size_t HASH_JOIN_MEMORY_LIMIT = 64 << 20;                    // bytes of tuples a hash join keeps in memory before partitioning
+static constexpr int HASH_JOIN_PARTITIONS = 64;                               // number of spilled partitions of a grace hash join
+static constexpr size_t NESTED_LOOP_JOIN_BLOCK_SIZE = 1 << 20;                // bytes of outer tuples a nested-loop join buffers per inner rescan
+static constexpr size_t SORT_MEMORY_LIMIT = 64 << 20;                         // bytes of tuples a sort keeps in memory per sorted run
+static constexpr size_t SORT_RUN_BUFFER_SIZE = 64 << 10;                      // bytes read ahead from each run while merging
 
 using frame_id_t = int32_t;  // frame id type, 帧页ID, 页在BufferPool中的存储单元称为帧,一帧对应一页
 using page_id_t = int32_t;   // page id type , 页ID
@@ -48,7 +63,7 @@ using timestamp_t = int32_t;  // timestamp type, used for transaction concurrenc
 // log file
 static const std::string LOG_FILE_NAME = "db.log";
 
-// replacer
+// replacer: "LRU", "CLOCK" or "2Q". LRU stays the default; the scan-resistant 2Q replacer is opt-in
 static const std::string REPLACER_TYPE = "LRU";
 
 static const std::string DB_META_NAME = "db.meta";
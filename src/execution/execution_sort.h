@@ -9,41 +9,278 @@ MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
 See the Mulan PSL v2 for more details. */
 
 #pragma once
+
+#include <algorithm>
+#include <cstdio>
+
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
 #include "index/ix.h"
 #include "system/sm.h"
 
+/**
+ * 外部归并排序，支持多个排序键，每个键分别升序或降序。
+ * 读入子算子的元组，内存中的元组超过memory_limit时排序后写入临时文件，形成一个有序段（run）。子算子读完时如果没有写出过
+ * 有序段，直接在内存中排序后输出；否则把剩余的元组也写成一个有序段，用败者树多路归并所有有序段并逐个输出。
+ * 有序段多于一次归并的路数（memory_limit / SORT_RUN_BUFFER_SIZE，至少2路）时，先逐组归并成更长的有序段。
+ * 排序键相同的元组保持子算子输出的顺序
+ */
 class SortExecutor : public AbstractExecutor {
    private:
+    // 顺序读取一个有序段，每次从临时文件读入一整块元组
+    struct RunReader {
+        FILE *file;
+        size_t len;
+        std::vector<char> buf;
+        size_t pos = 0;
+        size_t end = 0;
+
+        RunReader(FILE *file_, size_t len_)
+            : file(file_), len(len_), buf(std::max<size_t>(1, SORT_RUN_BUFFER_SIZE / len_) * len_) {}
+
+        void load() {
+            end = fread(buf.data(), 1, buf.size(), file);
+            pos = 0;
+        }
+
+        bool done() const { return pos >= end; }
+        const char *current() const { return buf.data() + pos; }
+
+        void next() {
+            pos += len;
+            if (pos >= end) {
+                load();
+            }
+        }
+    };
+
     std::unique_ptr<AbstractExecutor> prev_;
-    ColMeta cols_;                              // 框架中只支持一个键排序，需要自行修改数据结构支持多个键排序
-    size_t tuple_num;
-    bool is_desc_;
-    std::vector<size_t> used_tuple;
-    std::unique_ptr<RmRecord> current_tuple;
+    std::vector<ColMeta> keys_;         // 排序键在元组中的字段，按优先级排列
+    std::vector<bool> is_desc_;         // 每个排序键是否降序
+    size_t len_;
+    size_t memory_limit_;
+
+    std::vector<char> rows_;            // 内存中的元组
+    std::vector<size_t> order_;         // 内存中排好序的元组的下标
+    size_t pos_;                        // 在内存中排序时，当前元组在order_中的位置
+    bool in_memory_;                    // 没有写出有序段，直接输出内存中排好序的元组
+
+    std::vector<FILE *> runs_;          // 尚未归并的有序段
+    std::vector<RunReader> readers_;    // 正在归并的有序段
+    std::vector<int> tree_;             // 败者树：tree_[0]为当前最小的有序段，tree_[1..k-1]为各内部结点上的败者
 
    public:
-    SortExecutor(std::unique_ptr<AbstractExecutor> prev, TabCol sel_cols, bool is_desc) {
+    SortExecutor(std::unique_ptr<AbstractExecutor> prev, std::vector<TabCol> sel_cols, std::vector<bool> is_desc,
+                 size_t memory_limit = SORT_MEMORY_LIMIT) {
         prev_ = std::move(prev);
-        cols_ = prev_->get_col_offset(sel_cols);
-        is_desc_ = is_desc;
-        tuple_num = 0;
-        used_tuple.clear();
+        for (auto &sel_col : sel_cols) {
+            keys_.push_back(*get_col(prev_->cols(), sel_col));
+        }
+        is_desc_ = std::move(is_desc);
+        len_ = prev_->tupleLen();
+        memory_limit_ = memory_limit;
+        pos_ = 0;
+        in_memory_ = true;
     }
 
-    void beginTuple() override { 
-        
+    ~SortExecutor() override { close_runs(); }
+
+    void beginTuple() override {
+        close_runs();
+        rows_.clear();
+        order_.clear();
+        for (prev_->beginTuple(); !prev_->is_end(); prev_->nextTuple()) {
+            auto rec = prev_->Next();
+            rows_.insert(rows_.end(), rec->data, rec->data + len_);
+            if (rows_.size() >= memory_limit_) {
+                spill();
+            }
+        }
+        pos_ = 0;
+        in_memory_ = runs_.empty();
+        if (in_memory_) {
+            sort_rows();
+            return;
+        }
+        spill();
+        size_t fan_in = std::max<size_t>(2, memory_limit_ / SORT_RUN_BUFFER_SIZE);
+        while (runs_.size() > fan_in) {
+            // 每趟按顺序把相邻的fan_in个有序段归并成一个，有序段仍按元组读入的先后排列
+            std::vector<FILE *> merged;
+            for (size_t first = 0; first < runs_.size(); first += fan_in) {
+                merged.push_back(merge_runs(first, std::min(first + fan_in, runs_.size())));
+            }
+            close_runs();
+            runs_ = std::move(merged);
+        }
+        start_merge(0, runs_.size());
     }
 
     void nextTuple() override {
-        
+        if (in_memory_) {
+            pos_++;
+            return;
+        }
+        int winner = tree_[0];
+        readers_[winner].next();
+        adjust(winner);
     }
 
+    bool is_end() const override { return in_memory_ ? pos_ >= order_.size() : readers_[tree_[0]].done(); }
+
     std::unique_ptr<RmRecord> Next() override {
-        return nullptr;
+        auto rec = std::make_unique<RmRecord>(len_);
+        memcpy(rec->data, current(), len_);
+        return rec;
     }
 
     Rid &rid() override { return _abstract_rid; }
-};
\ No newline at end of file
+    size_t tupleLen() const override { return len_; }
+    std::string getType() override { return "SortExecutor"; }
+    const std::vector<ColMeta> &cols() const override { return prev_->cols(); }
+
+    size_t num_runs() const { return runs_.size(); }
+
+   private:
+    const char *current() const {
+        return in_memory_ ? rows_.data() + order_[pos_] * len_ : readers_[tree_[0]].current();
+    }
+
+    // 按排序键依次比较两个元组，降序的键取相反的比较结果
+    int compare(const char *a, const char *b) const {
+        for (size_t i = 0; i < keys_.size(); i++) {
+            auto &key = keys_[i];
+            int cmp = ix_compare(a + key.offset, b + key.offset, key.type, key.len);
+            if (cmp != 0) {
+                return is_desc_[i] ? -cmp : cmp;
+            }
+        }
+        return 0;
+    }
+
+    // 对rows_中的元组排序，只移动下标；排序键相同时按下标排序，保持读入的顺序
+    void sort_rows() {
+        order_.resize(rows_.size() / len_);
+        for (size_t i = 0; i < order_.size(); i++) {
+            order_[i] = i;
+        }
+        std::sort(order_.begin(), order_.end(), [&](size_t a, size_t b) {
+            int cmp = compare(rows_.data() + a * len_, rows_.data() + b * len_);
+            return cmp < 0 || (cmp == 0 && a < b);
+        });
+    }
+
+    static FILE *new_run() {
+        FILE *run = tmpfile();
+        if (run == nullptr) {
+            throw UnixError();
+        }
+        return run;
+    }
+
+    // 把buf写入run，写满一块时调用
+    static void write_run(FILE *run, std::vector<char> *buf) {
+        if (fwrite(buf->data(), 1, buf->size(), run) != buf->size()) {
+            throw UnixError();
+        }
+        buf->clear();
+    }
+
+    static void finish_run(FILE *run, std::vector<char> *buf) {
+        write_run(run, buf);
+        if (fflush(run) != 0) {
+            throw UnixError();
+        }
+        rewind(run);
+    }
+
+    // 将rows_排序后写入临时文件，形成一个有序段
+    void spill() {
+        if (rows_.empty()) {
+            return;
+        }
+        sort_rows();
+        FILE *run = new_run();
+        runs_.push_back(run);
+        std::vector<char> buf;
+        for (size_t idx : order_) {
+            buf.insert(buf.end(), rows_.data() + idx * len_, rows_.data() + (idx + 1) * len_);
+            if (buf.size() >= SORT_RUN_BUFFER_SIZE) {
+                write_run(run, &buf);
+            }
+        }
+        finish_run(run, &buf);
+        rows_.clear();
+        order_.clear();
+    }
+
+    // 开始归并runs_中[first, last)的有序段
+    void start_merge(size_t first, size_t last) {
+        readers_.clear();
+        for (size_t i = first; i < last; i++) {
+            readers_.emplace_back(runs_[i], len_);
+            readers_.back().load();
+        }
+        size_t k = readers_.size();
+        // 虚拟的有序段k小于所有元组，从叶子向上调整一遍之后被全部替换出败者树
+        tree_.assign(k, static_cast<int>(k));
+        for (int i = static_cast<int>(k) - 1; i >= 0; i--) {
+            adjust(i);
+        }
+    }
+
+    // 把runs_中[first, last)的有序段归并成一个新的有序段
+    FILE *merge_runs(size_t first, size_t last) {
+        start_merge(first, last);
+        FILE *run = new_run();
+        std::vector<char> buf;
+        while (!readers_[tree_[0]].done()) {
+            int winner = tree_[0];
+            buf.insert(buf.end(), readers_[winner].current(), readers_[winner].current() + len_);
+            if (buf.size() >= SORT_RUN_BUFFER_SIZE) {
+                write_run(run, &buf);
+            }
+            readers_[winner].next();
+            adjust(winner);
+        }
+        finish_run(run, &buf);
+        readers_.clear();
+        return run;
+    }
+
+    // 有序段a的当前元组是否应排在有序段b的当前元组之前：虚拟的有序段最小，读完的有序段最大，相同时序号小的在前
+    bool before(int a, int b) const {
+        int k = static_cast<int>(readers_.size());
+        if (a == k || b == k) {
+            return a == k;
+        }
+        bool a_done = readers_[a].done();
+        bool b_done = readers_[b].done();
+        if (a_done || b_done) {
+            return !a_done || (b_done && a < b);
+        }
+        int cmp = compare(readers_[a].current(), readers_[b].current());
+        return cmp < 0 || (cmp == 0 && a < b);
+    }
+
+    // 有序段s的当前元组改变后，沿s到根的路径重新比赛，败者留在结点上，胜者继续向上
+    void adjust(int s) {
+        int k = static_cast<int>(readers_.size());
+        for (int t = (s + k) / 2; t > 0; t /= 2) {
+            if (before(tree_[t], s)) {
+                std::swap(s, tree_[t]);
+            }
+        }
+        tree_[0] = s;
+    }
+
+    void close_runs() {
+        for (auto run : runs_) {
+            fclose(run);
+        }
+        runs_.clear();
+        readers_.clear();
+        tree_.clear();
+    }
+};
@@ -56,6 +56,19 @@ class DeleteExecutor : public AbstractExecutor {
             
             fh_->delete_record(rid, context_);
 
+            // 删除该记录在索引中的条目，只读索引的扫描不回表，索引中不能留下已删除的记录
+            for (auto &index : tab_.indexes)
+            {
+                std::vector<char> key(index.col_tot_len);
+                int offset = 0;
+                for (size_t j = 0; j < index.col_num; ++j)
+                {
+                    memcpy(key.data() + offset, deleted_rec.data + index.cols[j].offset, index.cols[j].len);
+                    offset += index.cols[j].len;
+                }
+                sm_manager_->delete_index_entry(tab_name_, index, key.data(), rid, context_->txn_);
+            }
+
             //lab4
             WriteRecord* write_rec = new WriteRecord(WType::DELETE_TUPLE,tab_name_,rid,deleted_rec);
             context_->txn_->append_write_record(write_rec);
@@ -0,0 +1,106 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/* 哈希索引上的等值查找：索引的每个字段都有等值条件，一次查找得到全部候选记录 */
+class HashIndexScanExecutor : public AbstractExecutor {
+   private:
+    std::string tab_name_;              // 表名称
+    TabMeta tab_;                       // 表的元数据
+    std::vector<Condition> conds_;      // 扫描条件
+    RmFileHandle *fh_;                  // 表的数据文件句柄
+    std::vector<ColMeta> cols_;         // 需要读取的字段
+    size_t len_;                        // 选取出来的一条记录的长度
+    std::vector<Condition> fed_conds_;  // 扫描条件，和conds_字段相同
+
+    std::vector<std::string> index_col_names_;  // 哈希索引包含的字段
+    IndexMeta index_meta_;                      // 哈希索引的元数据
+
+    std::vector<Rid> rids_;             // 查找得到的候选记录
+    size_t pos_;                        // 当前记录在rids_中的位置
+    Rid rid_;
+
+    SmManager *sm_manager_;
+
+   public:
+    HashIndexScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds,
+                          std::vector<std::string> index_col_names, Context *context) {
+        sm_manager_ = sm_manager;
+        context_ = context;
+        tab_name_ = std::move(tab_name);
+        tab_ = sm_manager_->db_.get_table(tab_name_);
+        conds_ = std::move(conds);
+        index_col_names_ = std::move(index_col_names);
+        index_meta_ = *(tab_.get_index_meta(index_col_names_));
+        fh_ = sm_manager_->fhs_.at(tab_name_).get();
+        cols_ = tab_.cols;
+        len_ = cols_.back().offset + cols_.back().len;
+
+        // 将左边的列调整为索引列
+        std::map<CompOp, CompOp> swap_op = {
+            {OP_EQ, OP_EQ}, {OP_NE, OP_NE}, {OP_LT, OP_GT}, {OP_GT, OP_LT}, {OP_LE, OP_GE}, {OP_GE, OP_LE},
+        };
+        for (auto &cond : conds_) {
+            if (cond.lhs_col.tab_name != tab_name_) {
+                assert(!cond.is_rhs_val && cond.rhs_col.tab_name == tab_name_);
+                std::swap(cond.lhs_col, cond.rhs_col);
+                cond.op = swap_op.at(cond.op);
+            }
+        }
+        fed_conds_ = conds_;
+    }
+
+    void beginTuple() override {
+        // 按索引字段的顺序拼接等值条件的值作为key
+        std::vector<char> key(index_meta_.col_tot_len);
+        int offset = 0;
+        for (auto &col : index_meta_.cols) {
+            auto eq_cond = std::find_if(fed_conds_.begin(), fed_conds_.end(), [&](const Condition &cond) {
+                return cond.is_rhs_val && cond.op == OP_EQ && cond.lhs_col.col_name == col.name;
+            });
+            assert(eq_cond != fed_conds_.end());
+            memcpy(key.data() + offset, eq_cond->rhs_val.raw->data, col.len);
+            offset += col.len;
+        }
+        auto ih = sm_manager_->hash_ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index_col_names_)).get();
+        rids_.clear();
+        ih->get_value(key.data(), &rids_, context_->txn_);
+        // 哈希索引中的键值对没有顺序，按记录的位置排序，使输出顺序与顺序扫描一致，并且按页面顺序访问记录
+        std::sort(rids_.begin(), rids_.end(), [](const Rid &a, const Rid &b) {
+            return a.page_no != b.page_no ? a.page_no < b.page_no : a.slot_no < b.slot_no;
+        });
+        for (pos_ = 0; pos_ < rids_.size(); pos_++) {
+            rid_ = rids_[pos_];
+            if (condCheck(fh_->get_record(rid_, context_).get(), fed_conds_, cols_)) break;
+        }
+    }
+
+    void nextTuple() override {
+        for (pos_++; pos_ < rids_.size(); pos_++) {
+            rid_ = rids_[pos_];
+            if (condCheck(fh_->get_record(rid_, context_).get(), fed_conds_, cols_)) break;
+        }
+    }
+
+    bool is_end() const override { return pos_ >= rids_.size(); }
+
+    std::unique_ptr<RmRecord> Next() override { return fh_->get_record(rid_, context_); }
+
+    Rid &rid() override { return rid_; }
+    size_t tupleLen() const override { return len_; }
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+};
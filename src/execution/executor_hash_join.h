@@ -0,0 +1,315 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <cstdio>
+#include <tuple>
+#include <unordered_map>
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * 等值连接的哈希连接。先交替读取左右子算子，先读完的一侧（元组较少）作为构建侧在内存中建立哈希表，另一侧逐条探测。
+ * 两侧都没读完时已读入的元组超过memory_limit，则改为grace hash join：按连接key的哈希值把两侧的元组分别写入
+ * 各分区的临时文件，再逐个分区在内存中连接，每个分区以元组较少的一侧作为构建侧。
+ * 输出的元组与NestedLoopJoinExecutor相同，左子算子的元组在前，右子算子的元组在后
+ */
+class HashJoinExecutor : public AbstractExecutor {
+   private:
+    // 连接的一侧：子算子、连接key字段（在该侧元组中的位置），以及读入内存的元组
+    struct Side {
+        std::unique_ptr<AbstractExecutor> child;
+        size_t len;
+        std::vector<ColMeta> keys;
+        std::vector<char> rows;           // 读入内存的元组，每个长len字节
+        std::vector<FILE *> partitions;   // grace hash join时各分区的临时文件
+
+        size_t num_rows() const { return rows.size() / len; }
+        const char *row(size_t i) const { return rows.data() + i * len; }
+    };
+
+    Side left_;
+    Side right_;
+    size_t len_;                        // join后获得的每条记录的长度
+    std::vector<ColMeta> cols_;         // join后获得的记录的字段
+    std::vector<Condition> fed_conds_;  // join条件，对连接后的元组检查全部条件
+    size_t memory_limit_;
+
+    bool build_left_;                                         // 当前以左侧作为构建侧
+    std::unordered_multimap<std::string, size_t> table_;      // 连接key -> 构建侧的元组在rows中的序号
+    std::unordered_multimap<std::string, size_t>::const_iterator match_, match_end_;
+
+    // 探测侧依次来自：内存中的元组、尚未读取的子算子（只在内存中连接时），或当前分区的临时文件（grace hash join）
+    size_t probe_pos_;
+    bool probe_child_;
+    FILE *probe_file_;
+    std::vector<char> probe_row_;
+    int partition_;  // 正在连接的分区，-1表示不分区
+
+    std::unique_ptr<RmRecord> current_;
+    bool isend;
+
+   public:
+    HashJoinExecutor(std::unique_ptr<AbstractExecutor> left, std::unique_ptr<AbstractExecutor> right,
+                     std::vector<Condition> conds, size_t memory_limit = HASH_JOIN_MEMORY_LIMIT) {
+        left_.child = std::move(left);
+        right_.child = std::move(right);
+        left_.len = left_.child->tupleLen();
+        right_.len = right_.child->tupleLen();
+        len_ = left_.len + right_.len;
+        cols_ = left_.child->cols();
+        auto right_cols = right_.child->cols();
+        for (auto &col : right_cols) {
+            col.offset += left_.len;
+        }
+        cols_.insert(cols_.end(), right_cols.begin(), right_cols.end());
+        fed_conds_ = std::move(conds);
+        memory_limit_ = memory_limit;
+
+        // 两侧字段类型和长度相同的等值条件作为连接key，按字节比较key；其余条件在连接后检查
+        for (auto &cond : fed_conds_) {
+            if (cond.is_rhs_val || cond.op != OP_EQ) {
+                continue;
+            }
+            auto lhs = find_col(left_.child->cols(), cond.lhs_col);
+            auto rhs = find_col(right_.child->cols(), cond.rhs_col);
+            if (lhs == nullptr || rhs == nullptr) {
+                lhs = find_col(left_.child->cols(), cond.rhs_col);
+                rhs = find_col(right_.child->cols(), cond.lhs_col);
+            }
+            if (lhs != nullptr && rhs != nullptr && lhs->type == rhs->type && lhs->len == rhs->len) {
+                left_.keys.push_back(*lhs);
+                right_.keys.push_back(*rhs);
+            }
+        }
+        if (left_.keys.empty()) {
+            throw InternalError("HashJoinExecutor Error: no equi-join condition");
+        }
+        probe_file_ = nullptr;
+        partition_ = -1;
+        isend = true;
+    }
+
+    ~HashJoinExecutor() override { close_partitions(); }
+
+    void beginTuple() override {
+        close_partitions();
+        left_.rows.clear();
+        right_.rows.clear();
+        table_.clear();
+        match_ = match_end_ = table_.end();
+        partition_ = -1;
+        isend = false;
+
+        left_.child->beginTuple();
+        right_.child->beginTuple();
+        while (!left_.child->is_end() && !right_.child->is_end() &&
+               left_.rows.size() + right_.rows.size() <= memory_limit_) {
+            append_child_row(&left_);
+            append_child_row(&right_);
+        }
+        if (left_.child->is_end() || right_.child->is_end()) {
+            // 先读完的一侧全部在内存中，作为构建侧
+            build_left_ = left_.child->is_end() && (!right_.child->is_end() || left_.rows.size() <= right_.rows.size());
+            build_table();
+            probe_pos_ = 0;
+            probe_child_ = true;
+        } else {
+            partition_all();
+        }
+        nextTuple();
+    }
+
+    void nextTuple() override {
+        while (!isend) {
+            while (match_ != match_end_) {
+                size_t build_idx = (match_++)->second;
+                const char *build_row = build_side().row(build_idx);
+                const char *left_row = build_left_ ? build_row : probe_row_.data();
+                const char *right_row = build_left_ ? probe_row_.data() : build_row;
+                memcpy(current_->data, left_row, left_.len);
+                memcpy(current_->data + left_.len, right_row, right_.len);
+                if (condCheck(current_.get(), fed_conds_, cols_)) {
+                    return;
+                }
+            }
+            if (next_probe_row()) {
+                std::string key = make_key(probe_row_.data(), probe_side().keys);
+                std::tie(match_, match_end_) = table_.equal_range(key);
+            } else if (!next_partition()) {
+                isend = true;
+            }
+        }
+    }
+
+    std::unique_ptr<RmRecord> Next() override { return std::make_unique<RmRecord>(*current_); }
+
+    Rid &rid() override { return _abstract_rid; }
+    bool is_end() const override { return isend; }
+    size_t tupleLen() const override { return len_; };
+    std::string getType() override { return "HashJoinExecutor"; };
+    const std::vector<ColMeta> &cols() const override { return cols_; };
+
+   private:
+    static const ColMeta *find_col(const std::vector<ColMeta> &cols, const TabCol &target) {
+        auto pos = std::find_if(cols.begin(), cols.end(), [&](const ColMeta &col) {
+            return col.tab_name == target.tab_name && col.name == target.col_name;
+        });
+        return pos == cols.end() ? nullptr : &*pos;
+    }
+
+    Side &build_side() { return build_left_ ? left_ : right_; }
+    Side &probe_side() { return build_left_ ? right_ : left_; }
+
+    /** 按连接key字段拼接元组中的值；浮点数的-0.0与0.0相等，统一为0.0 */
+    static std::string make_key(const char *row, const std::vector<ColMeta> &keys) {
+        std::string key;
+        for (auto &col : keys) {
+            if (col.type == TYPE_FLOAT && *reinterpret_cast<const float *>(row + col.offset) == 0) {
+                float zero = 0;
+                key.append(reinterpret_cast<const char *>(&zero), sizeof(float));
+            } else {
+                key.append(row + col.offset, col.len);
+            }
+        }
+        return key;
+    }
+
+    static void append_child_row(Side *side) {
+        auto rec = side->child->Next();
+        side->rows.insert(side->rows.end(), rec->data, rec->data + side->len);
+        side->child->nextTuple();
+    }
+
+    void build_table() {
+        Side &build = build_side();
+        table_.clear();
+        table_.reserve(build.num_rows());
+        for (size_t i = 0; i < build.num_rows(); i++) {
+            table_.emplace(make_key(build.row(i), build.keys), i);
+        }
+        match_ = match_end_ = table_.end();
+        probe_row_.resize(probe_side().len);
+        current_ = std::make_unique<RmRecord>(len_);
+    }
+
+    /** 取出探测侧的下一个元组放入probe_row_，探测侧已经读完时返回false */
+    bool next_probe_row() {
+        Side &probe = probe_side();
+        if (table_.empty()) {
+            return false;
+        }
+        if (probe_file_ != nullptr) {
+            return fread(probe_row_.data(), 1, probe.len, probe_file_) == probe.len;
+        }
+        if (probe_pos_ < probe.num_rows()) {
+            memcpy(probe_row_.data(), probe.row(probe_pos_++), probe.len);
+            return true;
+        }
+        if (probe_child_ && !probe.child->is_end()) {
+            auto rec = probe.child->Next();
+            memcpy(probe_row_.data(), rec->data, probe.len);
+            probe.child->nextTuple();
+            return true;
+        }
+        return false;
+    }
+
+    /** grace hash join：把两侧已读入内存的元组和尚未读取的元组全部写入分区文件 */
+    void partition_all() {
+        for (Side *side : {&left_, &right_}) {
+            side->partitions.resize(HASH_JOIN_PARTITIONS);
+            for (auto &file : side->partitions) {
+                file = tmpfile();
+                if (file == nullptr) {
+                    throw UnixError();
+                }
+            }
+            for (size_t i = 0; i < side->num_rows(); i++) {
+                write_partition(side, side->row(i));
+            }
+            side->rows.clear();
+            side->rows.shrink_to_fit();
+            for (; !side->child->is_end(); side->child->nextTuple()) {
+                write_partition(side, side->child->Next()->data);
+            }
+            for (auto file : side->partitions) {
+                if (fflush(file) != 0) {
+                    throw UnixError();
+                }
+            }
+        }
+        probe_child_ = false;
+        next_partition();
+    }
+
+    static void write_partition(Side *side, const char *row) {
+        std::string key = make_key(row, side->keys);
+        FILE *file = side->partitions[ix_hash_key(key.data(), key.size()) % HASH_JOIN_PARTITIONS];
+        if (fwrite(row, 1, side->len, file) != side->len) {
+            throw UnixError();
+        }
+    }
+
+    /**
+     * 切换到下一个非空分区：读入构建侧的分区文件并建立哈希表，探测侧改为从其分区文件读取
+     * @return 是否还有分区；只在内存中连接时没有分区，返回false
+     */
+    bool next_partition() {
+        while (partition_ + 1 < static_cast<int>(left_.partitions.size())) {
+            partition_++;
+            FILE *left_file = left_.partitions[partition_];
+            FILE *right_file = right_.partitions[partition_];
+            long left_size = file_size(left_file);
+            long right_size = file_size(right_file);
+            if (left_size == 0 || right_size == 0) {
+                continue;
+            }
+            // 同一分区中元组较少的一侧作为构建侧；数据倾斜时构建侧可能仍超过memory_limit，此时仍在内存中连接
+            build_left_ = left_size / static_cast<long>(left_.len) <= right_size / static_cast<long>(right_.len);
+            Side &build = build_side();
+            build.rows.resize(build_left_ ? left_size : right_size);
+            FILE *build_file = build.partitions[partition_];
+            if (fread(build.rows.data(), 1, build.rows.size(), build_file) != build.rows.size()) {
+                throw UnixError();
+            }
+            probe_side().rows.clear();  // 上一个分区的构建侧可能是另一侧
+            build_table();
+            probe_pos_ = 0;
+            probe_file_ = probe_side().partitions[partition_];
+            return true;
+        }
+        return false;
+    }
+
+    static long file_size(FILE *file) {
+        if (fseek(file, 0, SEEK_END) != 0) {
+            throw UnixError();
+        }
+        long size = ftell(file);
+        rewind(file);
+        return size;
+    }
+
+    void close_partitions() {
+        for (Side *side : {&left_, &right_}) {
+            for (auto file : side->partitions) {
+                fclose(file);
+            }
+            side->partitions.clear();
+        }
+        probe_file_ = nullptr;
+    }
+};
@@ -0,0 +1,154 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * 索引嵌套循环连接：内层是一张在连接字段上建有B+树索引的表，对外层子算子的每个元组，用其连接字段的值在内层的索引上
+ * 查找，只读取key相等的记录，不再扫描整个内层表。内层表上的扫描条件和全部连接条件对每条读取的记录检查。
+ * 输出的元组与NestedLoopJoinExecutor相同，左子算子的元组在前，右子算子的元组在后
+ */
+class IndexNestedLoopJoinExecutor : public AbstractExecutor {
+   private:
+    std::unique_ptr<AbstractExecutor> outer_;   // 外层子算子
+    bool inner_left_;                           // 内层表是连接的左侧
+
+    std::string tab_name_;                      // 内层表名称
+    TabMeta tab_;                               // 内层表的元数据
+    RmFileHandle *fh_;                          // 内层表的数据文件句柄
+    IxIndexHandle *ih_;                         // 内层表在连接字段上的索引
+    std::vector<Condition> inner_conds_;        // 内层表上的扫描条件
+    ColMeta outer_key_;                         // 外层元组中与索引字段等值连接的字段
+
+    size_t len_;                                // join后获得的每条记录的长度
+    std::vector<ColMeta> cols_;                 // join后获得的记录的字段
+    std::vector<Condition> fed_conds_;          // join条件
+    bool isend;
+
+    std::unique_ptr<RmRecord> outer_rec_;       // 当前外层元组
+    std::unique_ptr<IxScan> scan_;              // 当前外层元组在索引上查找的结果
+    std::unique_ptr<RmRecord> current_;         // 连接得到的元组
+
+    SmManager *sm_manager_;
+
+   public:
+    IndexNestedLoopJoinExecutor(SmManager *sm_manager, std::unique_ptr<AbstractExecutor> outer, std::string tab_name,
+                                std::vector<Condition> inner_conds, std::vector<std::string> index_col_names,
+                                std::vector<Condition> conds, bool inner_left, Context *context) {
+        sm_manager_ = sm_manager;
+        context_ = context;
+        outer_ = std::move(outer);
+        inner_left_ = inner_left;
+        tab_name_ = std::move(tab_name);
+        tab_ = sm_manager_->db_.get_table(tab_name_);
+        fh_ = sm_manager_->fhs_.at(tab_name_).get();
+        ih_ = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index_col_names)).get();
+        inner_conds_ = std::move(inner_conds);
+        fed_conds_ = std::move(conds);
+
+        size_t inner_len = tab_.cols.back().offset + tab_.cols.back().len;
+        len_ = inner_len + outer_->tupleLen();
+        std::vector<ColMeta> left_cols = inner_left_ ? tab_.cols : outer_->cols();
+        std::vector<ColMeta> right_cols = inner_left_ ? outer_->cols() : tab_.cols;
+        size_t left_len = inner_left_ ? inner_len : outer_->tupleLen();
+        for (auto &col : right_cols) {
+            col.offset += left_len;
+        }
+        cols_ = std::move(left_cols);
+        cols_.insert(cols_.end(), right_cols.begin(), right_cols.end());
+        current_ = std::make_unique<RmRecord>(len_);
+
+        // 索引只有连接字段一个字段，找到与它等值连接的外层字段
+        auto &index_col = tab_.get_index_meta(index_col_names)->cols[0];
+        const ColMeta *outer_key = nullptr;
+        for (auto &cond : fed_conds_) {
+            if (cond.is_rhs_val || cond.op != OP_EQ) {
+                continue;
+            }
+            const TabCol *other = nullptr;
+            if (cond.lhs_col.tab_name == tab_name_ && cond.lhs_col.col_name == index_col.name) {
+                other = &cond.rhs_col;
+            } else if (cond.rhs_col.tab_name == tab_name_ && cond.rhs_col.col_name == index_col.name) {
+                other = &cond.lhs_col;
+            }
+            if (other == nullptr) {
+                continue;
+            }
+            auto pos = std::find_if(outer_->cols().begin(), outer_->cols().end(), [&](const ColMeta &col) {
+                return col.tab_name == other->tab_name && col.name == other->col_name;
+            });
+            if (pos != outer_->cols().end() && pos->type == index_col.type && pos->len == index_col.len) {
+                outer_key = &*pos;
+                break;
+            }
+        }
+        if (outer_key == nullptr) {
+            throw InternalError("IndexNestedLoopJoinExecutor Error: no equi-join condition on index column " +
+                                index_col.name);
+        }
+        outer_key_ = *outer_key;
+        isend = true;
+    }
+
+    void beginTuple() override {
+        outer_->beginTuple();
+        scan_.reset();
+        isend = false;
+        find_match();
+    }
+
+    void nextTuple() override { find_match(); }
+
+    std::unique_ptr<RmRecord> Next() override { return std::make_unique<RmRecord>(*current_); }
+
+    Rid &rid() override { return _abstract_rid; }
+    bool is_end() const override { return isend; }
+    size_t tupleLen() const override { return len_; };
+    std::string getType() override { return "IndexNestedLoopJoinExecutor"; };
+    const std::vector<ColMeta> &cols() const override { return cols_; };
+
+   private:
+    // 从当前位置开始找下一个满足条件的元组，放入current_；当前外层元组的查找结果处理完时取外层的下一个元组查找
+    void find_match() {
+        while (!isend) {
+            if (scan_ != nullptr) {
+                for (; !scan_->is_end(); scan_->next()) {
+                    auto inner = fh_->get_record(scan_->rid(), context_);
+                    if (!condCheck(inner.get(), inner_conds_, tab_.cols)) {
+                        continue;
+                    }
+                    char *left = inner_left_ ? inner->data : outer_rec_->data;
+                    char *right = inner_left_ ? outer_rec_->data : inner->data;
+                    size_t left_len = inner_left_ ? len_ - outer_->tupleLen() : outer_->tupleLen();
+                    memcpy(current_->data, left, left_len);
+                    memcpy(current_->data + left_len, right, len_ - left_len);
+                    if (condCheck(current_.get(), fed_conds_, cols_)) {
+                        scan_->next();
+                        return;
+                    }
+                }
+                outer_->nextTuple();
+            }
+            if (outer_->is_end()) {
+                isend = true;
+                return;
+            }
+            outer_rec_ = outer_->Next();
+            const char *key = outer_rec_->data + outer_key_.offset;
+            scan_ = std::make_unique<IxScan>(ih_, ih_->lower_bound(key), ih_->upper_bound(key), sm_manager_->get_bpm());
+        }
+    }
+};
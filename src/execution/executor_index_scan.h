@@ -10,6 +10,7 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <limits>
 #include <set>
 
 #include "execution_defs.h"
@@ -30,15 +31,18 @@ class IndexScanExecutor : public AbstractExecutor {
 
     std::vector<std::string> index_col_names_;  // index scan涉及到的索引包含的字段
     IndexMeta index_meta_;                      // index scan涉及到的索引元数据
+    bool index_only_;                           // 只读索引：元组由key还原，cols_为索引字段，不再回表读取记录
+    bool reverse_;                              // 反向扫描索引，按key降序输出元组
 
     Rid rid_;
-    std::unique_ptr<RecScan> scan_;
+    std::unique_ptr<IxScan> scan_;
 
     SmManager *sm_manager_;
 
    public:
     IndexScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds,
-                      std::vector<std::string> index_col_names, Context *context) {
+                      std::vector<std::string> index_col_names, Context *context, bool index_only = false,
+                      bool reverse = false) {
         sm_manager_ = sm_manager;
         context_ = context;
         tab_name_ = std::move(tab_name);
@@ -48,7 +52,19 @@ class IndexScanExecutor : public AbstractExecutor {
         index_col_names_ = index_col_names;
         index_meta_ = *(tab_.get_index_meta(index_col_names_));
         fh_ = sm_manager_->fhs_.at(tab_name_).get();
-        cols_ = tab_.cols;
+        index_only_ = index_only;
+        reverse_ = reverse;
+        if (index_only_) {
+            // key按索引字段的顺序拼接，字段偏移改为在key中的偏移
+            cols_ = index_meta_.cols;
+            int offset = 0;
+            for (auto &col : cols_) {
+                col.offset = offset;
+                offset += col.len;
+            }
+        } else {
+            cols_ = tab_.cols;
+        }
         len_ = cols_.back().offset + cols_.back().len;
         
         // 将左边的列调整为索引列
@@ -73,50 +89,18 @@ class IndexScanExecutor : public AbstractExecutor {
     {
         // index is available, scan index
         auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index_col_names_)).get();
-        Iid lower = ih->leaf_begin();
-        Iid upper = ih->leaf_end();
-        for (auto &index_col : index_col_names_) 
-        {
-            for (auto &cond : fed_conds_) 
-            {
-                if (cond.is_rhs_val && cond.op != OP_NE && cond.lhs_col.col_name == index_col) //
-                {
-                    // 获得索引列的值
-                    int offset = 0;
-                    char *key = new char[index_meta_.col_tot_len]; // 拼接得到索引列的值
-                    for (size_t i = 0; i < index_meta_.col_num; ++i) 
-                    {
-                        auto &cond = fed_conds_[i];
-                        auto &col = index_meta_.cols[i];
-                        memcpy(key + offset, cond.rhs_val.raw->data, col.len);
-                        offset += col.len;
-                    }
-                    // 根据不同的条件，调整lower和upper
-                    if (cond.op == OP_EQ) {
-                        lower = ih->lower_bound(key);
-                        upper = ih->upper_bound(key);
-                    } else if (cond.op == OP_LT) {
-                        upper = ih->lower_bound(key);
-                    } else if (cond.op == OP_GT) {
-                        lower = ih->upper_bound(key);
-                    } else if (cond.op == OP_LE) {
-                        upper = ih->upper_bound(key);
-                    } else if (cond.op == OP_GE) {
-                        lower = ih->lower_bound(key);
-                    } else {
-                        throw InternalError("Unexpected field type");
-                    }
-                    break;  // only one index column is allowed
-                }
-            }
-        }
+        Iid lower, upper;
+        get_scan_range(ih, &lower, &upper);
 
-        scan_ = std::make_unique<IxScan>(ih, lower, upper, sm_manager_->get_bpm());
+        scan_ = std::make_unique<IxScan>(ih, lower, upper, sm_manager_->get_bpm(), reverse_);
+        if (index_only_) {
+            context_->lock_mgr_->lock_IS_on_table(context_->txn_, fh_->GetFd());
+        }
         // Get the first record
         while (!scan_->is_end()) 
         {
             rid_ = scan_->rid();
-            auto rec = fh_->get_record(rid_, context_);
+            auto rec = fetch_tuple();
             if(condCheck(rec.get(), fed_conds_, cols_)) break;
             scan_->next();
         }
@@ -126,7 +110,7 @@ class IndexScanExecutor : public AbstractExecutor {
         // 扫描到下一个满足条件的记录,赋rid_,中止循环
         for (scan_->next(); !scan_->is_end(); scan_->next()) {
             rid_ = scan_->rid();
-            if (condCheck(fh_->get_record(rid_, context_).get(), fed_conds_, cols_)) break;
+            if (condCheck(fetch_tuple().get(), fed_conds_, cols_)) break;
         }
     }
 
@@ -134,10 +118,125 @@ class IndexScanExecutor : public AbstractExecutor {
 
     std::unique_ptr<RmRecord> Next() override  //获取当前记录
     {
-        return fh_->get_record(rid_, context_);
+        return fetch_tuple();
     }
 
     Rid &rid() override { return rid_; }
     size_t tupleLen() const override { return len_; }
     const std::vector<ColMeta> &cols() const override { return cols_; }
+
+   private:
+    /**
+     * @description: 由扫描条件计算索引扫描的范围。按索引字段的顺序，最左前缀中有等值条件的字段取等值条件的值，
+     * 之后第一个字段取范围条件（<, <=, >, >=）中最严格的值，其余字段用该类型的最小值或最大值补齐，
+     * 得到下界key和上界key。范围只需要包含所有满足条件的记录，每条记录仍由condCheck检查全部条件
+     * @param {IxIndexHandle} *ih 索引句柄
+     * @param {Iid} *lower 扫描的起点
+     * @param {Iid} *upper 扫描的终点（不包含）
+     */
+    void get_scan_range(IxIndexHandle *ih, Iid *lower, Iid *upper) {
+        std::vector<char> lower_key(index_meta_.col_tot_len);
+        std::vector<char> upper_key(index_meta_.col_tot_len);
+        bool lower_open = false;    // 下界不包含等于下界key的记录
+        bool upper_open = false;    // 上界不包含等于上界key的记录
+        int offset = 0;
+        size_t i = 0;
+        for (; i < index_meta_.cols.size(); ++i) {
+            auto &col = index_meta_.cols[i];
+            const Condition *eq_cond = nullptr;
+            for (auto &cond : fed_conds_) {
+                if (cond.is_rhs_val && cond.op == OP_EQ && cond.lhs_col.col_name == col.name) {
+                    eq_cond = &cond;
+                    break;
+                }
+            }
+            if (eq_cond == nullptr) {
+                break;
+            }
+            memcpy(lower_key.data() + offset, eq_cond->rhs_val.raw->data, col.len);
+            memcpy(upper_key.data() + offset, eq_cond->rhs_val.raw->data, col.len);
+            offset += col.len;
+        }
+        if (i < index_meta_.cols.size()) {
+            auto &col = index_meta_.cols[i];
+            const Condition *lower_cond = nullptr;
+            const Condition *upper_cond = nullptr;
+            for (auto &cond : fed_conds_) {
+                if (!cond.is_rhs_val || cond.lhs_col.col_name != col.name) {
+                    continue;
+                }
+                const char *val = cond.rhs_val.raw->data;
+                if (cond.op == OP_GT || cond.op == OP_GE) {
+                    int cmp = lower_cond == nullptr ? 1 : ix_compare(val, lower_cond->rhs_val.raw->data, col.type, col.len);
+                    if (cmp > 0 || (cmp == 0 && cond.op == OP_GT)) {
+                        lower_cond = &cond;
+                    }
+                } else if (cond.op == OP_LT || cond.op == OP_LE) {
+                    int cmp = upper_cond == nullptr ? -1 : ix_compare(val, upper_cond->rhs_val.raw->data, col.type, col.len);
+                    if (cmp < 0 || (cmp == 0 && cond.op == OP_LT)) {
+                        upper_cond = &cond;
+                    }
+                }
+            }
+            if (lower_cond != nullptr) {
+                memcpy(lower_key.data() + offset, lower_cond->rhs_val.raw->data, col.len);
+                lower_open = lower_cond->op == OP_GT;
+            } else {
+                fill_bound(lower_key.data() + offset, col, false);
+            }
+            if (upper_cond != nullptr) {
+                memcpy(upper_key.data() + offset, upper_cond->rhs_val.raw->data, col.len);
+                upper_open = upper_cond->op == OP_LT;
+            } else {
+                fill_bound(upper_key.data() + offset, col, true);
+            }
+            offset += col.len;
+            // 开区间的下界需要越过所有等于该值的key，因此其余字段用最大值补齐；开区间的上界相反
+            for (++i; i < index_meta_.cols.size(); ++i) {
+                auto &rest_col = index_meta_.cols[i];
+                fill_bound(lower_key.data() + offset, rest_col, lower_open);
+                fill_bound(upper_key.data() + offset, rest_col, !upper_open);
+                offset += rest_col.len;
+            }
+        }
+
+        std::vector<ColType> col_types;
+        std::vector<int> col_lens;
+        for (auto &col : index_meta_.cols) {
+            col_types.push_back(col.type);
+            col_lens.push_back(col.len);
+        }
+        int cmp = ix_compare(lower_key.data(), upper_key.data(), col_types, col_lens);
+        if (cmp > 0 || (cmp == 0 && (lower_open || upper_open))) {
+            // 条件互相矛盾，没有满足条件的记录
+            *lower = *upper = ih->leaf_end();
+            return;
+        }
+        *lower = lower_open ? ih->upper_bound(lower_key.data()) : ih->lower_bound(lower_key.data());
+        *upper = upper_open ? ih->lower_bound(upper_key.data()) : ih->upper_bound(upper_key.data());
+    }
+
+    // 用字段类型的最小值或最大值填充dest，用于补齐范围扫描的key
+    static void fill_bound(char *dest, const ColMeta &col, bool is_max) {
+        if (col.type == TYPE_INT) {
+            int val = is_max ? std::numeric_limits<int>::max() : std::numeric_limits<int>::min();
+            memcpy(dest, &val, sizeof(int));
+        } else if (col.type == TYPE_FLOAT) {
+            float val = is_max ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+            memcpy(dest, &val, sizeof(float));
+        } else {
+            memset(dest, is_max ? 0xff : 0, col.len);
+        }
+    }
+
+    // 当前索引项对应的元组：只读索引时由key还原，与get_record一样对记录加共享锁，但不访问记录所在的页面
+    std::unique_ptr<RmRecord> fetch_tuple() {
+        if (!index_only_) {
+            return fh_->get_record(rid_, context_);
+        }
+        context_->lock_mgr_->lock_shared_on_record(context_->txn_, rid_, fh_->GetFd());
+        auto rec = std::make_unique<RmRecord>(len_);
+        scan_->key(rec->data);
+        return rec;
+    }
 };
\ No newline at end of file
@@ -58,7 +58,6 @@ class InsertExecutor : public AbstractExecutor {
         for(size_t i = 0; i < tab_.indexes.size(); ++i) 
         {
             auto& index = tab_.indexes[i];
-            auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
             // 为索引创建键值:
             char* key = new char[index.col_tot_len];
             int offset = 0;
@@ -68,7 +67,7 @@ class InsertExecutor : public AbstractExecutor {
                 offset += index.cols[i].len;
             }
             // 将键值插入到索引中:
-            ih->insert_entry(key, rid_, context_->txn_);
+            sm_manager_->insert_index_entry(tab_name_, index, key, rid_, context_->txn_);
         }
 
         WriteRecord* write_rec = new WriteRecord(WType::INSERT_TUPLE,tab_name_,rid_);
@@ -0,0 +1,157 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * 归并连接：两个子算子的输出分别按连接条件conds[0]中各自的字段升序排列（如按该字段的索引扫描或排序算子），
+ * 同时向前读取两侧，只缓存右侧key相同的一段元组，左侧key相同的每个元组都与这一段元组连接。
+ * 全部连接条件对连接后的元组检查。输出的元组与NestedLoopJoinExecutor相同，左子算子的元组在前，右子算子的元组在后
+ */
+class MergeJoinExecutor : public AbstractExecutor {
+   private:
+    std::unique_ptr<AbstractExecutor> left_;    // 左儿子节点，按left_key_升序
+    std::unique_ptr<AbstractExecutor> right_;   // 右儿子节点，按right_key_升序
+    ColMeta left_key_;                          // 左侧元组中的归并key字段
+    ColMeta right_key_;                         // 右侧元组中的归并key字段
+    size_t len_;                                // join后获得的每条记录的长度
+    std::vector<ColMeta> cols_;                 // join后获得的记录的字段
+    std::vector<Condition> fed_conds_;          // join条件
+    bool isend;
+
+    std::unique_ptr<RmRecord> left_rec_;        // 当前左侧元组，左侧读完时为空
+    std::unique_ptr<RmRecord> right_rec_;       // 右侧下一个尚未读入run_的元组，右侧读完时为空
+    std::vector<char> run_;                     // 右侧key与当前左侧元组相同的一段元组
+    size_t run_pos_;                            // 当前左侧元组接下来要与run_中的哪个元组连接
+    bool in_run_;                               // 当前左侧元组正在与run_连接
+    std::unique_ptr<RmRecord> current_;         // 连接得到的元组
+
+   public:
+    MergeJoinExecutor(std::unique_ptr<AbstractExecutor> left, std::unique_ptr<AbstractExecutor> right,
+                      std::vector<Condition> conds) {
+        left_ = std::move(left);
+        right_ = std::move(right);
+        len_ = left_->tupleLen() + right_->tupleLen();
+        cols_ = left_->cols();
+        auto right_cols = right_->cols();
+        for (auto &col : right_cols) {
+            col.offset += left_->tupleLen();
+        }
+        cols_.insert(cols_.end(), right_cols.begin(), right_cols.end());
+        fed_conds_ = std::move(conds);
+
+        // 第一个条件是两侧输入有序的等值条件，其字段可能在任意一侧
+        const ColMeta *lhs = nullptr;
+        const ColMeta *rhs = nullptr;
+        if (!fed_conds_.empty() && !fed_conds_[0].is_rhs_val && fed_conds_[0].op == OP_EQ) {
+            auto &cond = fed_conds_[0];
+            lhs = find_col(left_->cols(), cond.lhs_col);
+            rhs = find_col(right_->cols(), cond.rhs_col);
+            if (lhs == nullptr || rhs == nullptr) {
+                lhs = find_col(left_->cols(), cond.rhs_col);
+                rhs = find_col(right_->cols(), cond.lhs_col);
+            }
+        }
+        if (lhs == nullptr || rhs == nullptr || lhs->type != rhs->type || lhs->len != rhs->len) {
+            throw InternalError("MergeJoinExecutor Error: the first condition must be an equi-join condition");
+        }
+        left_key_ = *lhs;
+        right_key_ = *rhs;
+        current_ = std::make_unique<RmRecord>(len_);
+        isend = true;
+    }
+
+    void beginTuple() override {
+        left_->beginTuple();
+        right_->beginTuple();
+        left_rec_ = left_->is_end() ? nullptr : left_->Next();
+        right_rec_ = right_->is_end() ? nullptr : right_->Next();
+        run_.clear();
+        in_run_ = false;
+        isend = false;
+        find_match();
+    }
+
+    void nextTuple() override { find_match(); }
+
+    std::unique_ptr<RmRecord> Next() override { return std::make_unique<RmRecord>(*current_); }
+
+    Rid &rid() override { return _abstract_rid; }
+    bool is_end() const override { return isend; }
+    size_t tupleLen() const override { return len_; };
+    std::string getType() override { return "MergeJoinExecutor"; };
+    const std::vector<ColMeta> &cols() const override { return cols_; };
+
+   private:
+    static const ColMeta *find_col(const std::vector<ColMeta> &cols, const TabCol &target) {
+        auto pos = std::find_if(cols.begin(), cols.end(), [&](const ColMeta &col) {
+            return col.tab_name == target.tab_name && col.name == target.col_name;
+        });
+        return pos == cols.end() ? nullptr : &*pos;
+    }
+
+    // 比较左侧元组和右侧元组的归并key
+    int compare_key(const char *left_row, const char *right_row) const {
+        return ix_compare(left_row + left_key_.offset, right_row + right_key_.offset, left_key_.type, left_key_.len);
+    }
+
+    static void advance(AbstractExecutor *child, std::unique_ptr<RmRecord> *rec) {
+        child->nextTuple();
+        *rec = child->is_end() ? nullptr : child->Next();
+    }
+
+    // 从当前位置开始找下一个满足条件的元组，放入current_；任意一侧读完并且没有正在连接的run_时结束
+    void find_match() {
+        size_t left_len = left_->tupleLen();
+        size_t right_len = right_->tupleLen();
+        while (!isend) {
+            if (in_run_) {
+                for (; run_pos_ < run_.size(); run_pos_ += right_len) {
+                    memcpy(current_->data, left_rec_->data, left_len);
+                    memcpy(current_->data + left_len, run_.data() + run_pos_, right_len);
+                    if (condCheck(current_.get(), fed_conds_, cols_)) {
+                        run_pos_ += right_len;
+                        return;
+                    }
+                }
+                // 下一个左侧元组的key仍然相同时与同一段元组连接
+                advance(left_.get(), &left_rec_);
+                run_pos_ = 0;
+                in_run_ = left_rec_ != nullptr && compare_key(left_rec_->data, run_.data()) == 0;
+                continue;
+            }
+            if (left_rec_ == nullptr || right_rec_ == nullptr) {
+                isend = true;
+                return;
+            }
+            int cmp = compare_key(left_rec_->data, right_rec_->data);
+            if (cmp < 0) {
+                advance(left_.get(), &left_rec_);
+            } else if (cmp > 0) {
+                advance(right_.get(), &right_rec_);
+            } else {
+                // 读入右侧key相同的一段元组
+                run_.clear();
+                while (right_rec_ != nullptr && compare_key(left_rec_->data, right_rec_->data) == 0) {
+                    run_.insert(run_.end(), right_rec_->data, right_rec_->data + right_len);
+                    advance(right_.get(), &right_rec_);
+                }
+                run_pos_ = 0;
+                in_run_ = true;
+            }
+        }
+    }
+};
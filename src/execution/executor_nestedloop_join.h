@@ -15,20 +15,31 @@ See the Mulan PSL v2 for more details. */
 #include "index/ix.h"
 #include "system/sm.h"
 
+/**
+ * 块嵌套循环连接：每次从右子算子（外层）读入block_size字节的元组缓存在内存中，再扫描一遍左子算子（内层），
+ * 把内层的每个元组与块中的所有元组连接。内层的扫描次数从外层的元组数降为外层的块数。
+ * 输出的元组左子算子的元组在前，右子算子的元组在后
+ */
 class NestedLoopJoinExecutor : public AbstractExecutor 
 {
    private:
-    std::unique_ptr<AbstractExecutor> left_;   // 左儿子节点（需要join的表）
-    std::unique_ptr<AbstractExecutor> right_;  // 右儿子节点（需要join的表）
+    std::unique_ptr<AbstractExecutor> left_;   // 左儿子节点（需要join的表），内层，每块扫描一遍
+    std::unique_ptr<AbstractExecutor> right_;  // 右儿子节点（需要join的表），外层，按块读入内存
     size_t len_;                               // join后获得的每条记录的长度
     std::vector<ColMeta> cols_;                // join后获得的记录的字段
 
     std::vector<Condition> fed_conds_;  // join条件
     bool isend;
 
+    size_t block_size_;                  // 每块缓存的外层元组的字节数，至少缓存一个元组
+    std::vector<char> block_;            // 当前块中的外层元组
+    size_t block_pos_;                   // 当前内层元组接下来要与块中的哪个元组连接
+    std::unique_ptr<RmRecord> inner_;    // 当前内层元组
+    std::unique_ptr<RmRecord> current_;  // 连接得到的元组
+
    public:
     NestedLoopJoinExecutor(std::unique_ptr<AbstractExecutor> left, std::unique_ptr<AbstractExecutor> right,
-                           std::vector<Condition> conds) {
+                           std::vector<Condition> conds, size_t block_size = NESTED_LOOP_JOIN_BLOCK_SIZE) {
         left_ = std::move(left); 
         right_ = std::move(right);
         len_ = left_->tupleLen() + right_->tupleLen(); // 连接后每条记录的总字节数
@@ -41,51 +52,81 @@ class NestedLoopJoinExecutor : public AbstractExecutor
         }
 
         cols_.insert(cols_.end(), right_cols.begin(), right_cols.end()); // 连接后的字段
-        isend = false; 
+        isend = true; 
         fed_conds_ = std::move(conds);
+        block_size_ = block_size;
+        block_pos_ = 0;
+        current_ = std::make_unique<RmRecord>(len_);
     }
 
     void beginTuple() override 
     {
-        left_->beginTuple();
         right_->beginTuple();
+        isend = !load_block() || !restart_inner();
+        find_match();
     }
 
     void nextTuple() override 
     {
-         // 遍历右表
-        for (; !right_->is_end(); right_->nextTuple()) 
-        {
-            // 处理左表的移动
-            if (left_->is_end())
-                left_->beginTuple();
-            else // 左表还没匹配完，接着匹配，不然就一直匹配同一个死循环了
-                left_->nextTuple();
-
-            // 遍历左表的每一行，并进行连接检查
-            for (; !left_->is_end(); left_->nextTuple()) 
-            {
-                if (condCheck(Next().get(), fed_conds_, cols_)) return;
-            }
-        }
+        find_match();
     }
 
     std::unique_ptr<RmRecord> Next() override 
     { 
-        std::unique_ptr<RmRecord> record = std::make_unique<RmRecord>(len_);
-        std::unique_ptr<RmRecord> l_rec = left_->Next();
-        std::unique_ptr<RmRecord> r_rec = right_->Next();
-        // 组合成一条record
-        memset(record->data, 0, record->size);
-        memcpy(record->data, l_rec->data, l_rec->size);
-        memcpy(record->data + l_rec->size, r_rec->data, r_rec->size);
-
-        return record;
+        return std::make_unique<RmRecord>(*current_);
     }
     
     Rid &rid() override { return _abstract_rid; }
-    bool is_end() const override { return left_->is_end(); }
+    bool is_end() const override { return isend; }
     size_t tupleLen() const override { return len_; };
     std::string getType() override { return "NestedLoopJoinExecutor"; };
     const std::vector<ColMeta> &cols() const override { return cols_; };
-};
\ No newline at end of file
+
+   private:
+    // 从当前位置开始找下一个满足连接条件的元组，放入current_；内层扫描完时换下一块，所有块都处理完时结束
+    void find_match() 
+    {
+        size_t left_len = left_->tupleLen();
+        size_t right_len = right_->tupleLen();
+        while (!isend) {
+            for (; block_pos_ < block_.size(); block_pos_ += right_len) {
+                memcpy(current_->data, inner_->data, left_len);
+                memcpy(current_->data + left_len, block_.data() + block_pos_, right_len);
+                if (condCheck(current_.get(), fed_conds_, cols_)) {
+                    block_pos_ += right_len;
+                    return;
+                }
+            }
+            left_->nextTuple();
+            if (left_->is_end()) {
+                isend = !load_block() || !restart_inner();
+            } else {
+                inner_ = left_->Next();
+                block_pos_ = 0;
+            }
+        }
+    }
+
+    // 读入外层的下一块，外层已经读完时返回false
+    bool load_block() 
+    {
+        block_.clear();
+        for (; !right_->is_end() && block_.size() < block_size_; right_->nextTuple()) {
+            auto rec = right_->Next();
+            block_.insert(block_.end(), rec->data, rec->data + right_->tupleLen());
+        }
+        return !block_.empty();
+    }
+
+    // 为新的一块重新扫描内层，内层为空时返回false
+    bool restart_inner() 
+    {
+        left_->beginTuple();
+        if (left_->is_end()) {
+            return false;
+        }
+        inner_ = left_->Next();
+        block_pos_ = 0;
+        return true;
+    }
+};
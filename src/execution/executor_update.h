@@ -57,18 +57,15 @@ class UpdateExecutor : public AbstractExecutor {
             // 删除该记录在索引中的旧条目
             for (auto & index : tab_.indexes) 
             {
-                // 获取索引处理句柄
-                auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
-                
                  // 创建索引键
                 char *key = new char[index.col_tot_len];
                 int offset = 0;
                 for (size_t j = 0; j < index.col_num; ++j) 
                 {
-                    memcpy(key + offset, rec->data + index.cols[j].offset, index.cols[j].len);
+                    memcpy(key + offset, updated_rec.data + index.cols[j].offset, index.cols[j].len);  // 旧条目的key取自更新前的记录
                     offset += index.cols[j].len;
                 }
-                ih->delete_entry(key, context_->txn_);
+                sm_manager_->delete_index_entry(tab_name_, index, key, rid, context_->txn_);
             }
 
             // 更新记录（将修改后的数据写回文件）
@@ -77,9 +74,6 @@ class UpdateExecutor : public AbstractExecutor {
             // 在索引中插入新的条目
             for (auto & index : tab_.indexes) 
             {
-                // 获取索引处理句柄
-                auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
-                
                 // 创建新的索引键
                 char *key = new char[index.col_tot_len];
                 int offset = 0;
@@ -88,7 +82,7 @@ class UpdateExecutor : public AbstractExecutor {
                     memcpy(key + offset, rec->data + index.cols[j].offset, index.cols[j].len);
                     offset += index.cols[j].len;
                 }
-                ih->insert_entry(key, rid, context_->txn_);
+                sm_manager_->insert_index_entry(tab_name_, index, key, rid, context_->txn_);
             }
             // lab4 modify write_set
             WriteRecord* write_rec = new WriteRecord(WType::UPDATE_TUPLE,tab_name_,rid,updated_rec);
@@ -0,0 +1,374 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_bulk_loader.h"
+
+#include <algorithm>
+#include <queue>
+
+static constexpr size_t RUN_READ_BUFFER_SIZE = 256 << 10;  // 归并时每个有序段的读缓冲区大小
+
+/**
+ * @description: 顺序读取一个有序段，每次从临时文件读入一整块键值对
+ */
+struct IxBulkLoader::RunReader {
+    FILE *file;
+    int entry_size;
+    std::vector<char> buf;
+    size_t pos = 0;
+    size_t len = 0;
+
+    RunReader(FILE *file_, int entry_size_)
+        : file(file_), entry_size(entry_size_), buf(std::max<size_t>(1, RUN_READ_BUFFER_SIZE / entry_size_) * entry_size_) {}
+
+    bool load() {
+        len = fread(buf.data(), 1, buf.size(), file);
+        pos = 0;
+        return len > 0;
+    }
+
+    const char *current() const { return buf.data() + pos; }
+
+    bool next() {
+        pos += entry_size;
+        return pos < len || load();
+    }
+};
+
+/**
+ * @param {IxIndexHandle*} ih 刚创建的空索引
+ * @param {double} fill_factor 结点的填充率，定长格式按btree_order计算、至少填入2个键值对，压缩格式按页面大小计算
+ * @param {size_t} memory_limit 内存中排序的键值对超过该字节数时写出一个有序段
+ */
+IxBulkLoader::IxBulkLoader(IxIndexHandle *ih, double fill_factor, size_t memory_limit)
+    : ih_(ih), file_hdr_(ih->file_hdr_), memory_limit_(memory_limit) {
+    entry_size_ = file_hdr_->col_tot_len_ + sizeof(Rid);
+    node_size_ = std::clamp(static_cast<int>(file_hdr_->btree_order_ * fill_factor), 2, file_hdr_->btree_order_);
+    node_bytes_ = std::min(static_cast<int>(PAGE_SIZE * fill_factor), PAGE_SIZE);
+    last_key_.resize(file_hdr_->col_tot_len_);
+}
+
+IxBulkLoader::~IxBulkLoader() {
+    for (auto run : runs_) {
+        fclose(run);
+    }
+}
+
+/**
+ * @description: 先按key、再按Rid比较两个键值对
+ */
+int IxBulkLoader::compare(const char *a, const char *b) const {
+    int res = ix_compare(a, b, file_hdr_);
+    if (res != 0) {
+        return res;
+    }
+    Rid ra, rb;
+    memcpy(&ra, a + file_hdr_->col_tot_len_, sizeof(Rid));
+    memcpy(&rb, b + file_hdr_->col_tot_len_, sizeof(Rid));
+    if (ra.page_no != rb.page_no) {
+        return ra.page_no < rb.page_no ? -1 : 1;
+    }
+    return ra.slot_no < rb.slot_no ? -1 : (ra.slot_no > rb.slot_no ? 1 : 0);
+}
+
+/**
+ * @description: 收集一个键值对，内存中的键值对超过memory_limit时写出一个有序段
+ * @param {char*} key 按字段原样拼接的key，在此转换为索引中存放的形式
+ */
+void IxBulkLoader::add(const char *key, const Rid &rid) {
+    size_t offset = buffer_.size();
+    buffer_.resize(offset + entry_size_);
+    char key_buf[IX_MAX_COL_LEN];
+    memcpy(buffer_.data() + offset, ih_->normalize_key(key, key_buf, &rid), file_hdr_->col_tot_len_);
+    memcpy(buffer_.data() + offset + file_hdr_->col_tot_len_, &rid, sizeof(Rid));
+    if (buffer_.size() >= memory_limit_) {
+        spill();
+    }
+}
+
+/**
+ * @description: 对buffer_中的键值对排序，只移动下标，最后按顺序搬运一次
+ */
+void IxBulkLoader::sort_buffer() {
+    int num = buffer_.size() / entry_size_;
+    std::vector<int> order(num);
+    for (int i = 0; i < num; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return compare(buffer_.data() + a * entry_size_, buffer_.data() + b * entry_size_) < 0;
+    });
+    std::vector<char> sorted(buffer_.size());
+    for (int i = 0; i < num; i++) {
+        memcpy(sorted.data() + i * entry_size_, buffer_.data() + order[i] * entry_size_, entry_size_);
+    }
+    buffer_.swap(sorted);
+}
+
+/**
+ * @description: 将buffer_排序后写入临时文件，形成一个有序段
+ */
+void IxBulkLoader::spill() {
+    if (buffer_.empty()) {
+        return;
+    }
+    sort_buffer();
+    FILE *run = tmpfile();
+    if (run == nullptr) {
+        throw UnixError();
+    }
+    runs_.push_back(run);
+    if (fwrite(buffer_.data(), 1, buffer_.size(), run) != buffer_.size() || fflush(run) != 0) {
+        throw UnixError();
+    }
+    rewind(run);
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+}
+
+/**
+ * @description: 按顺序接收排好序的键值对。唯一索引中出现重复的key时抛出DuplicateKeyError，非唯一索引的key含有Rid，不会重复
+ */
+void IxBulkLoader::append(const char *key, const Rid &rid) {
+    if (has_last_key_ && ix_compare(key, last_key_.data(), file_hdr_) == 0) {
+        throw DuplicateKeyError();
+    }
+    memcpy(last_key_.data(), key, file_hdr_->col_tot_len_);
+    has_last_key_ = true;
+    append_leaf(key, rid);
+}
+
+/**
+ * @description: 创建一个空结点
+ */
+IxWriteNode IxBulkLoader::new_node(bool is_leaf) {
+    IxWriteNode node = ih_->create_node();
+    *node.page_hdr = {
+        .next_free_page_no = IX_NO_PAGE,
+        .parent = IX_NO_PAGE,
+        .num_key = 0,
+        .is_leaf = is_leaf,
+        .prev_leaf = IX_NO_PAGE,
+        .next_leaf = IX_NO_PAGE,
+    };
+    return node;
+}
+
+/**
+ * @description: 结点放得下时将键值对追加到node，key大于node中所有的key
+ * @return {bool} 放不下时返回false，不修改node；空结点总能放下
+ */
+bool IxBulkLoader::try_add(PendingNode *node, const char *key, const Rid &rid) const {
+    int key_len = file_hdr_->col_tot_len_;
+    int n = node->rids.size();
+    if (!file_hdr_->compressed_keys_) {
+        if (n == node_size_) {
+            return false;
+        }
+    } else if (n == 0) {
+        node->prefix_len = ix_trimmed_len(key, key_len);
+        node->suffix_bytes = 0;
+    } else {
+        // 与IxNodeHandle::compact_rebuild相同，公共前缀取第一个和最后一个key的公共前缀
+        int prefix_len = std::min(ix_common_prefix_len(node->keys.data(), key, key_len), ix_trimmed_len(key, key_len));
+        int suffix_bytes = node->suffix_bytes;
+        if (prefix_len != node->prefix_len) {
+            suffix_bytes = 0;
+            for (int i = 0; i < n; i++) {
+                suffix_bytes += std::max(ix_trimmed_len(node->keys.data() + i * key_len, key_len) - prefix_len, 0);
+            }
+        }
+        suffix_bytes += std::max(ix_trimmed_len(key, key_len) - prefix_len, 0);
+        if (IxNodeHandle::compact_size(prefix_len, n + 1, suffix_bytes) > node_bytes_) {
+            return false;
+        }
+        node->prefix_len = prefix_len;
+        node->suffix_bytes = suffix_bytes;
+    }
+    node->keys.insert(node->keys.end(), key, key + key_len);
+    node->rids.push_back(rid);
+    return true;
+}
+
+/**
+ * @description: 将键值对追加到当前叶子结点，当前叶子已填满时写出它并开始下一个叶子
+ */
+void IxBulkLoader::append_leaf(const char *key, const Rid &rid) {
+    if (!try_add(&pending_leaf_, key, rid)) {
+        flush_leaf();
+        try_add(&pending_leaf_, key, rid);
+    }
+}
+
+/**
+ * @description: 将pending_leaf_写入一个叶子结点，并沿叶子链表连接到上一个叶子之后。
+ * 第一个叶子复用创建索引时的根结点IX_INIT_ROOT_PAGE，因此first_leaf不变
+ */
+void IxBulkLoader::flush_leaf() {
+    int key_len = file_hdr_->col_tot_len_;
+    int n = pending_leaf_.rids.size();
+    IxWriteNode leaf;
+    if (level_pages_.empty()) {
+        leaf = ih_->fetch_node_write(IX_INIT_ROOT_PAGE);
+        // 压缩格式中最左侧内部结点的第一个key取最小的key，见IxIndexHandle::insert_into_parent
+        if (file_hdr_->compressed_keys_) {
+            level_keys_.resize(key_len, 0);
+        } else {
+            level_keys_.insert(level_keys_.end(), pending_leaf_.keys.begin(), pending_leaf_.keys.begin() + key_len);
+        }
+    } else {
+        leaf = new_node(true);
+        leaf.set_prev_leaf(curr_leaf_.get_page_no());
+        curr_leaf_.set_next_leaf(leaf.get_page_no());
+        // 压缩格式使用前缀截断的分隔key，见IxIndexHandle::separator_key
+        size_t offset = level_keys_.size();
+        level_keys_.resize(offset + key_len);
+        if (file_hdr_->compressed_keys_) {
+            ix_separator_key(leaf_last_key_.data(), pending_leaf_.keys.data(), level_keys_.data() + offset, key_len);
+        } else {
+            memcpy(level_keys_.data() + offset, pending_leaf_.keys.data(), key_len);
+        }
+    }
+    leaf.insert_pairs(0, pending_leaf_.keys.data(), pending_leaf_.rids.data(), n);
+    level_pages_.push_back(leaf.get_page_no());
+    leaf_last_key_.assign(pending_leaf_.keys.end() - key_len, pending_leaf_.keys.end());
+    prev_leaf_ = std::move(curr_leaf_);
+    curr_leaf_ = std::move(leaf);
+    pending_leaf_ = PendingNode();
+}
+
+/**
+ * @description: 同一层的最后一个结点不足半满时，从左侧相邻结点移动键值对过来。
+ * 只用于定长格式，压缩格式的结点允许下溢（见IxIndexHandle::coalesce_or_redistribute）
+ * @param {char*} right_first_key 记录right第一个key的位置，移动后更新
+ */
+void IxBulkLoader::balance_last(IxWriteNode *left, IxWriteNode *right, char *right_first_key) {
+    int min_size = right->get_min_size();
+    if (right->get_size() >= min_size) {
+        return;
+    }
+    int total = left->get_size() + right->get_size();
+    int right_size = total - min_size >= min_size ? min_size : total / 2;
+    int moved = right_size - right->get_size();
+    int left_size = left->get_size() - moved;
+    right->insert_pairs(0, left->get_key(left_size), left->get_rid(left_size), moved);
+    left->set_size(left_size);
+    for (int i = 0; i < moved; i++) {
+        ih_->maintain_child(right, i);
+    }
+    memcpy(right_first_key, right->get_key(0), file_hdr_->col_tot_len_);
+}
+
+/**
+ * @description: 以level_keys_/level_pages_记录的叶子结点为最底层，逐层创建内部结点，直到只剩一个根结点
+ */
+void IxBulkLoader::build_internal_levels() {
+    int key_len = file_hdr_->col_tot_len_;
+    while (level_pages_.size() > 1) {
+        std::vector<char> parent_keys;
+        std::vector<page_id_t> parent_pages;
+        IxWriteNode prev, curr;
+        PendingNode pending;
+        // 将pending写入一个新的内部结点，它的第一个key就是它在上一层中的分隔key
+        auto flush = [&]() {
+            prev = std::move(curr);
+            curr = new_node(false);
+            curr.insert_pairs(0, pending.keys.data(), pending.rids.data(), pending.rids.size());
+            for (int i = 0; i < curr.get_size(); i++) {
+                ih_->maintain_child(&curr, i);
+            }
+            parent_pages.push_back(curr.get_page_no());
+            parent_keys.insert(parent_keys.end(), pending.keys.begin(), pending.keys.begin() + key_len);
+            pending = PendingNode();
+        };
+        for (size_t i = 0; i < level_pages_.size(); i++) {
+            const char *key = level_keys_.data() + i * key_len;
+            Rid child = {.page_no = level_pages_[i], .slot_no = -1};
+            if (!try_add(&pending, key, child)) {
+                flush();
+                try_add(&pending, key, child);
+            }
+        }
+        flush();
+        if (!file_hdr_->compressed_keys_ && parent_pages.size() > 1) {
+            balance_last(&prev, &curr, parent_keys.data() + (parent_pages.size() - 1) * key_len);
+        }
+        level_keys_.swap(parent_keys);
+        level_pages_.swap(parent_pages);
+    }
+    ih_->file_hdr_->root_page_ = level_pages_[0];
+}
+
+/**
+ * @description: 归并所有有序段并构建B+树
+ */
+void IxBulkLoader::finish() {
+    if (file_hdr_->root_page_ != IX_INIT_ROOT_PAGE) {
+        throw InternalError("IxBulkLoader::finish Error: index is not empty");
+    }
+    {
+        IxReadNode root = ih_->fetch_node_read(IX_INIT_ROOT_PAGE);
+        if (root.get_size() != 0) {
+            throw InternalError("IxBulkLoader::finish Error: index is not empty");
+        }
+    }
+
+    if (runs_.empty()) {
+        sort_buffer();
+        for (size_t offset = 0; offset < buffer_.size(); offset += entry_size_) {
+            const char *entry = buffer_.data() + offset;
+            Rid rid;
+            memcpy(&rid, entry + file_hdr_->col_tot_len_, sizeof(Rid));
+            append(entry, rid);
+        }
+    } else {
+        spill();
+        std::vector<RunReader> readers;
+        readers.reserve(runs_.size());
+        auto greater = [this](const RunReader *a, const RunReader *b) { return compare(a->current(), b->current()) > 0; };
+        std::priority_queue<RunReader *, std::vector<RunReader *>, decltype(greater)> heap(greater);
+        for (auto run : runs_) {
+            readers.emplace_back(run, entry_size_);
+            if (readers.back().load()) {
+                heap.push(&readers.back());
+            }
+        }
+        while (!heap.empty()) {
+            RunReader *reader = heap.top();
+            heap.pop();
+            Rid rid;
+            memcpy(&rid, reader->current() + file_hdr_->col_tot_len_, sizeof(Rid));
+            append(reader->current(), rid);
+            if (reader->next()) {
+                heap.push(reader);
+            }
+        }
+    }
+    buffer_.clear();
+
+    if (pending_leaf_.rids.empty()) {
+        return;
+    }
+    flush_leaf();
+    if (!file_hdr_->compressed_keys_ && level_pages_.size() > 1) {
+        balance_last(&prev_leaf_, &curr_leaf_, level_keys_.data() + (level_pages_.size() - 1) * file_hdr_->col_tot_len_);
+    }
+    // 最后一个叶子与leaf header组成双向循环链表
+    curr_leaf_.set_next_leaf(IX_LEAF_HEADER_PAGE);
+    {
+        IxWriteNode leaf_header = ih_->fetch_node_write(IX_LEAF_HEADER_PAGE);
+        leaf_header.set_prev_leaf(curr_leaf_.get_page_no());
+    }
+    ih_->file_hdr_->last_leaf_ = curr_leaf_.get_page_no();
+    prev_leaf_.drop();
+    curr_leaf_.drop();
+
+    build_internal_levels();
+}
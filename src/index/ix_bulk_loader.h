@@ -0,0 +1,87 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "ix_index_handle.h"
+
+/**
+ * @description: 批量构建B+树：先收集所有(key, Rid)并排序，再自底向上逐层构建叶子结点和内部结点。
+ * 收集的键值对超过memory_limit时排序后写入临时文件形成一个有序段（run），finish时多路归并所有有序段。
+ * 每个结点按fill_factor填充，为之后的插入预留空间：定长格式按btree_order计算键值对数量，压缩格式按编码后的字节数计算。
+ * 唯一索引中有重复的key时finish抛出DuplicateKeyError，此时索引只构建了一部分，调用者需要删除该索引。
+ * 只能用于刚创建的空索引，构建期间调用者需要保证没有其他线程访问该索引
+ */
+class IxBulkLoader {
+   public:
+    IxBulkLoader(IxIndexHandle *ih, double fill_factor = IX_BULK_LOAD_FILL_FACTOR,
+                 size_t memory_limit = IX_BULK_LOAD_MEMORY_LIMIT);
+
+    ~IxBulkLoader();
+
+    void add(const char *key, const Rid &rid);
+
+    void finish();
+
+    int num_runs() const { return static_cast<int>(runs_.size()); }
+
+   private:
+    struct RunReader;
+
+    // 正在填充、尚未写入页面的结点
+    struct PendingNode {
+        std::vector<char> keys;
+        std::vector<Rid> rids;
+        int prefix_len = 0;                 // 压缩格式：所有key的公共前缀的长度
+        int suffix_bytes = 0;               // 压缩格式：去掉公共前缀之后所有key后缀的字节数
+    };
+
+    int compare(const char *a, const char *b) const;
+
+    void sort_buffer();
+
+    void spill();
+
+    void append(const char *key, const Rid &rid);
+
+    bool try_add(PendingNode *node, const char *key, const Rid &rid) const;
+
+    void append_leaf(const char *key, const Rid &rid);
+
+    void flush_leaf();
+
+    IxWriteNode new_node(bool is_leaf);
+
+    void balance_last(IxWriteNode *left, IxWriteNode *right, char *right_first_key);
+
+    void build_internal_levels();
+
+    IxIndexHandle *ih_;
+    const IxFileHdr *file_hdr_;
+    int entry_size_;                    // 每个键值对占用的字节数：key + Rid
+    int node_size_;                     // 定长格式：每个结点填入的键值对数量
+    int node_bytes_;                    // 压缩格式：每个结点编码后最多占用的字节数
+    size_t memory_limit_;
+    std::vector<char> buffer_;          // 尚未写入有序段的键值对
+    std::vector<FILE *> runs_;          // 已写入临时文件的有序段
+
+    // 自底向上构建时，当前层每个结点的第一个key和页面号
+    std::vector<char> level_keys_;
+    std::vector<page_id_t> level_pages_;
+    PendingNode pending_leaf_;
+    IxWriteNode prev_leaf_;
+    IxWriteNode curr_leaf_;
+    std::vector<char> last_key_;        // 上一个写入叶子的key，用于检查唯一索引中重复的key
+    std::vector<char> leaf_last_key_;   // 上一个写出的叶子结点的最后一个key，用于计算分隔key
+    bool has_last_key_ = false;
+};
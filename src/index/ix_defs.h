@@ -13,6 +13,7 @@ See the Mulan PSL v2 for more details. */
 #include <vector>
 
 #include "defs.h"
+#include "ix_key_search.h"
 #include "storage/buffer_pool_manager.h"
 
 constexpr int IX_NO_PAGE = -1;
@@ -37,6 +38,13 @@ public:
     page_id_t first_leaf_;              // 首叶节点对应的页号，在上层IxManager的open函数进行初始化，初始化为root page_no
     page_id_t last_leaf_;               // 尾叶节点对应的页号
     int tot_len_;                       // 记录结构体的整体长度
+    bool normalized_keys_ = false;      // key是否以ix_normalize_key编码存储，旧的索引文件中没有该字段，视为false
+    bool compressed_keys_ = false;      // 结点是否使用前缀压缩的变长格式（IxCompactHdr），旧的索引文件中没有该字段，视为false
+    bool unique_ = true;                // 是否为唯一索引，旧的索引文件中没有该字段，视为true。非唯一索引在key之后拼接Rid作为最后一个字段，
+                                        // 使每个索引项的key互不相同，col_num_、col_types_、col_lens_和col_tot_len_都包括这个字段
+    IxSearchMode search_mode_ = IxSearchMode::GENERIC;  // 结点内key的查找方式，打开索引时选择，不写入磁盘
+
+    static constexpr int FIRST_FREE_PAGE_NO_OFFSET = sizeof(int);  // 序列化后first_free_page_no_的字节偏移，紧跟tot_len_
 
     IxFileHdr() {
         tot_len_ = col_num_ = 0;
@@ -49,9 +57,12 @@ public:
                     tot_len_ = 0;
                 } 
 
+    // 上层传入的key的长度，即col_tot_len_去掉非唯一索引拼接的Rid
+    int user_key_len() const { return unique_ ? col_tot_len_ : col_tot_len_ - static_cast<int>(sizeof(Rid)); }
+
     void update_tot_len() {
         tot_len_ = 0;
-        tot_len_ += sizeof(page_id_t) * 4 + sizeof(int) * 6;
+        tot_len_ += sizeof(page_id_t) * 4 + sizeof(int) * 9;
         tot_len_ += sizeof(ColType) * col_num_ + sizeof(int) * col_num_;
     }
 
@@ -85,6 +96,15 @@ public:
         offset += sizeof(page_id_t);
         memcpy(dest + offset, &last_leaf_, sizeof(page_id_t));
         offset += sizeof(page_id_t);
+        int normalized_keys = normalized_keys_;
+        memcpy(dest + offset, &normalized_keys, sizeof(int));
+        offset += sizeof(int);
+        int compressed_keys = compressed_keys_;
+        memcpy(dest + offset, &compressed_keys, sizeof(int));
+        offset += sizeof(int);
+        int unique = unique_;
+        memcpy(dest + offset, &unique, sizeof(int));
+        offset += sizeof(int);
         assert(offset == tot_len_);
     }
 
@@ -123,6 +143,22 @@ public:
         offset += sizeof(page_id_t);
         last_leaf_ = *reinterpret_cast<const page_id_t*>(src + offset);
         offset += sizeof(page_id_t);
+        // 旧版本的文件头到last_leaf为止
+        normalized_keys_ = false;
+        if (offset < tot_len_) {
+            normalized_keys_ = *reinterpret_cast<const int*>(src + offset) != 0;
+            offset += sizeof(int);
+        }
+        compressed_keys_ = false;
+        if (offset < tot_len_) {
+            compressed_keys_ = *reinterpret_cast<const int*>(src + offset) != 0;
+            offset += sizeof(int);
+        }
+        unique_ = true;
+        if (offset < tot_len_) {
+            unique_ = *reinterpret_cast<const int*>(src + offset) != 0;
+            offset += sizeof(int);
+        }
         assert(offset == tot_len_);
     }
 };
@@ -137,6 +173,115 @@ public:
     page_id_t next_leaf;            // next leaf node's page_no, effective only when is_leaf is true
 };
 
+/**
+ * 压缩格式结点（IxFileHdr::compressed_keys_为true）的页面布局：
+ * | IxPageHdr | IxCompactHdr | 公共前缀 | IxSlot数组 | 空闲空间 | key后缀（从页尾向前分配） |
+ * 结点中所有key共享长度为prefix_len的公共前缀，每个key只存放前缀之后的部分，并去掉末尾补齐用的0字节。
+ * 删除键值对时后缀占用的空间不立即回收，空闲空间不足时整个结点重新编码
+ */
+class IxCompactHdr {
+public:
+    uint16_t prefix_len;            // 公共前缀的长度
+    uint16_t heap_size;             // 页尾已分配给key后缀的字节数（包括已删除的后缀）
+};
+
+class IxSlot {
+public:
+    Rid rid;
+    uint16_t offset;                // key后缀在页面中的偏移
+    uint16_t len;                   // key后缀的长度
+};
+
+constexpr int IX_HASH_DIR_PAGE = 1;                 // 哈希索引：第一个目录页面
+constexpr int IX_HASH_INIT_BUCKET_PAGE = 2;         // 哈希索引：初始的唯一一个桶
+constexpr int IX_HASH_INIT_NUM_PAGES = 3;
+constexpr int IX_HASH_MAX_DEPTH = 24;               // 目录最多2^24项，局部深度达到上限的桶不再分裂，改用溢出页面
+
+/**
+ * 可扩展哈希索引的文件头，存放在第0页。目录dir_常驻内存，打开索引时从目录页面链表读入，关闭索引时写回。
+ * 目录页面的布局：| 下一个目录页面的页号 | 本页的目录项数量 | 目录项（桶的页号）... |
+ */
+class IxHashFileHdr {
+public:
+    int tot_len_;                       // 文件头序列化后的长度
+    int num_pages_;                     // 磁盘文件中页面的数量
+    int col_num_;                       // 索引包含的字段数量
+    std::vector<ColType> col_types_;    // 字段的类型
+    std::vector<int> col_lens_;         // 字段的长度
+    int col_tot_len_;                   // 索引包含的字段的总长度
+    int bucket_capacity_;               // 每个桶页面最多存放的键值对数量，不超过BUCKET_SIZE
+    bool unique_;                       // 是否为唯一索引
+    int global_depth_;                  // 目录的全局深度，目录共2^global_depth项
+    std::vector<page_id_t> dir_;        // 目录：按key哈希值的低global_depth位找到桶的页号，不写入文件头
+
+    IxHashFileHdr() : tot_len_(0), num_pages_(0), col_num_(0), col_tot_len_(0), bucket_capacity_(0), unique_(true),
+                      global_depth_(0) {}
+
+    void update_tot_len() {
+        tot_len_ = sizeof(int) * 7 + sizeof(ColType) * col_num_ + sizeof(int) * col_num_;
+    }
+
+    void serialize(char *dest) const {
+        int offset = 0;
+        int unique = unique_;
+        for (int field : {tot_len_, num_pages_, col_num_}) {
+            memcpy(dest + offset, &field, sizeof(int));
+            offset += sizeof(int);
+        }
+        for (int i = 0; i < col_num_; ++i) {
+            memcpy(dest + offset, &col_types_[i], sizeof(ColType));
+            offset += sizeof(ColType);
+        }
+        for (int i = 0; i < col_num_; ++i) {
+            memcpy(dest + offset, &col_lens_[i], sizeof(int));
+            offset += sizeof(int);
+        }
+        for (int field : {col_tot_len_, bucket_capacity_, unique, global_depth_}) {
+            memcpy(dest + offset, &field, sizeof(int));
+            offset += sizeof(int);
+        }
+        assert(offset == tot_len_);
+    }
+
+    void deserialize(const char *src) {
+        int offset = 0;
+        auto read_int = [&]() {
+            int val;
+            memcpy(&val, src + offset, sizeof(int));
+            offset += sizeof(int);
+            return val;
+        };
+        tot_len_ = read_int();
+        num_pages_ = read_int();
+        col_num_ = read_int();
+        col_types_.resize(col_num_);
+        for (int i = 0; i < col_num_; ++i) {
+            memcpy(&col_types_[i], src + offset, sizeof(ColType));
+            offset += sizeof(ColType);
+        }
+        col_lens_.resize(col_num_);
+        for (int i = 0; i < col_num_; ++i) {
+            col_lens_[i] = read_int();
+        }
+        col_tot_len_ = read_int();
+        bucket_capacity_ = read_int();
+        unique_ = read_int() != 0;
+        global_depth_ = read_int();
+        assert(offset == tot_len_);
+    }
+};
+
+/**
+ * 哈希桶页面的布局：| IxHashBucketHdr | 键值对数组（key + Rid）... |
+ * 桶满并且其中所有key的哈希值都与新key相同（分裂无法分开它们）时，键值对放入next_page串起的溢出页面，溢出页面的布局与桶相同
+ */
+class IxHashBucketHdr {
+public:
+    int local_depth;                // 桶的局部深度，目录中低local_depth位相同的项都指向该桶；溢出页面中未使用
+    int num_entries;                // 本页面中键值对的数量
+    page_id_t next_page;            // 下一个溢出页面，没有时为IX_NO_PAGE
+};
+
 class Iid {
 public:
     int page_no;
@@ -0,0 +1,346 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_hash_index_handle.h"
+
+IxHashIndexHandle::IxHashIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
+    : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), fd_(fd) {
+    char buf[PAGE_SIZE];
+    disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, buf, PAGE_SIZE);
+    file_hdr_ = std::make_unique<IxHashFileHdr>();
+    file_hdr_->deserialize(buf);
+    // disk_manager管理的fd对应的文件中，设置从file_hdr_->num_pages开始分配page_no
+    disk_manager_->set_fd2pageno(fd, file_hdr_->num_pages_);
+    load_dir();
+}
+
+/**
+ * @brief 查找key对应的所有Rid
+ *
+ * @param key 按字段原样拼接的key
+ * @param result 用于存放结果的容器
+ * @param transaction 事务指针
+ * @return bool 是否找到了key
+ */
+bool IxHashIndexHandle::get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    normalize_key(key, key_buf);
+    int key_len = file_hdr_->col_tot_len_;
+
+    std::shared_lock lock{dir_latch_};
+    size_t num = result->size();
+    ReadPageGuard head = buffer_pool_manager_->fetch_page_read(PageId{fd_, bucket_of(ix_hash_key(key_buf, key_len))});
+    ReadPageGuard overflow;
+    for (Page *page = head.get_page(); page != nullptr;) {
+        IxHashBucketHdr *hdr = bucket_hdr(page);
+        for (int i = 0; i < hdr->num_entries; i++) {
+            char *entry = entry_at(page, i);
+            if (memcmp(entry, key_buf, key_len) == 0) {
+                Rid rid;
+                memcpy(&rid, entry + key_len, sizeof(Rid));
+                result->push_back(rid);
+            }
+        }
+        if (hdr->next_page == IX_NO_PAGE) {
+            break;
+        }
+        // 持有桶页面的latch，溢出页面逐个访问
+        overflow = buffer_pool_manager_->fetch_page_read(PageId{fd_, hdr->next_page});
+        page = overflow.get_page();
+    }
+    return result->size() > num;
+}
+
+/**
+ * @brief 插入键值对，唯一索引中已经存在的key不再插入
+ *
+ * @param key 按字段原样拼接的key
+ * @param value 记录的位置
+ * @param transaction 事务指针
+ * @return bool 是否插入了键值对
+ */
+bool IxHashIndexHandle::insert_entry(const char *key, const Rid &value, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    normalize_key(key, key_buf);
+    uint64_t hash = ix_hash_key(key_buf, file_hdr_->col_tot_len_);
+
+    // 乐观插入：桶中还有空位时只需要共享持有目录
+    {
+        std::shared_lock lock{dir_latch_};
+        InsertResult ret = try_insert(bucket_of(hash), key_buf, value, false);
+        if (ret != InsertResult::FULL) {
+            return ret == InsertResult::INSERTED;
+        }
+    }
+
+    // 桶已满，独占目录后分裂桶，分裂无法腾出空位时使用溢出页面
+    std::unique_lock lock{dir_latch_};
+    while (true) {
+        InsertResult ret = try_insert(bucket_of(hash), key_buf, value, false);
+        if (ret != InsertResult::FULL) {
+            return ret == InsertResult::INSERTED;
+        }
+        if (!split_bucket(hash)) {
+            return try_insert(bucket_of(hash), key_buf, value, true) == InsertResult::INSERTED;
+        }
+    }
+}
+
+/**
+ * @brief 删除key的一个键值对
+ */
+bool IxHashIndexHandle::delete_entry(const char *key, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    normalize_key(key, key_buf);
+    return erase_entry(key_buf, nullptr);
+}
+
+/**
+ * @brief 删除键值对(key, value)，key相同但Rid不同的键值对不受影响
+ */
+bool IxHashIndexHandle::delete_entry(const char *key, const Rid &value, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    normalize_key(key, key_buf);
+    return erase_entry(key_buf, &value);
+}
+
+/**
+ * @brief 将key编码为按字节比较的形式，相等的key（包括0.0和-0.0）编码后字节相同，哈希值也相同
+ */
+void IxHashIndexHandle::normalize_key(const char *key, char *buf) const {
+    ix_normalize_key(key, buf, file_hdr_->col_types_, file_hdr_->col_lens_);
+}
+
+/**
+ * @brief 在桶及其溢出页面中插入键值对，调用者需要持有目录的latch
+ *
+ * @param bucket 桶的页号
+ * @param key 编码后的key
+ * @param allow_overflow 所有页面都满时是否在末尾追加一个溢出页面
+ * @return 唯一索引中key已存在时返回DUPLICATE；没有空位并且不允许追加溢出页面时返回FULL
+ */
+IxHashIndexHandle::InsertResult IxHashIndexHandle::try_insert(page_id_t bucket, const char *key, const Rid &value,
+                                                              bool allow_overflow) {
+    int key_len = file_hdr_->col_tot_len_;
+    // 桶页面的写latch在整个插入过程中持有，同一个桶上的插入和删除因此串行执行
+    std::vector<WritePageGuard> chain;
+    chain.push_back(buffer_pool_manager_->fetch_page_write(PageId{fd_, bucket}));
+    int free_idx = -1;
+    while (true) {
+        Page *page = chain.back().get_page();
+        IxHashBucketHdr *hdr = bucket_hdr(page);
+        if (file_hdr_->unique_) {
+            for (int i = 0; i < hdr->num_entries; i++) {
+                if (memcmp(entry_at(page, i), key, key_len) == 0) {
+                    return InsertResult::DUPLICATE;
+                }
+            }
+        }
+        if (free_idx < 0 && hdr->num_entries < file_hdr_->bucket_capacity_) {
+            free_idx = static_cast<int>(chain.size()) - 1;
+            if (!file_hdr_->unique_) {
+                break;
+            }
+        }
+        if (hdr->next_page == IX_NO_PAGE) {
+            break;
+        }
+        chain.push_back(buffer_pool_manager_->fetch_page_write(PageId{fd_, hdr->next_page}));
+    }
+    if (free_idx < 0) {
+        if (!allow_overflow) {
+            return InsertResult::FULL;
+        }
+        page_id_t page_no;
+        WritePageGuard overflow = new_bucket_page(&page_no, 0);
+        bucket_hdr(chain.back().get_page())->next_page = page_no;
+        chain.push_back(std::move(overflow));
+        free_idx = static_cast<int>(chain.size()) - 1;
+    }
+    Page *page = chain[free_idx].get_page();
+    IxHashBucketHdr *hdr = bucket_hdr(page);
+    char *entry = entry_at(page, hdr->num_entries);
+    memcpy(entry, key, key_len);
+    memcpy(entry + key_len, &value, sizeof(Rid));
+    hdr->num_entries++;
+    return InsertResult::INSERTED;
+}
+
+/**
+ * @brief 删除第一个匹配的键值对，页面中最后一个键值对移动到被删除的位置。
+ * 桶不合并，变空的溢出页面留在链表中，之后的插入可以继续使用
+ *
+ * @param key 编码后的key
+ * @param value 不为nullptr时只删除Rid相同的键值对
+ */
+bool IxHashIndexHandle::erase_entry(const char *key, const Rid *value) {
+    int key_len = file_hdr_->col_tot_len_;
+    std::shared_lock lock{dir_latch_};
+    WritePageGuard head = buffer_pool_manager_->fetch_page_write(PageId{fd_, bucket_of(ix_hash_key(key, key_len))});
+    WritePageGuard overflow;
+    for (Page *page = head.get_page(); page != nullptr;) {
+        IxHashBucketHdr *hdr = bucket_hdr(page);
+        for (int i = 0; i < hdr->num_entries; i++) {
+            char *entry = entry_at(page, i);
+            if (memcmp(entry, key, key_len) != 0 || (value != nullptr && memcmp(entry + key_len, value, sizeof(Rid)) != 0)) {
+                continue;
+            }
+            hdr->num_entries--;
+            memmove(entry, entry_at(page, hdr->num_entries), entry_size());
+            return true;
+        }
+        if (hdr->next_page == IX_NO_PAGE) {
+            break;
+        }
+        overflow = buffer_pool_manager_->fetch_page_write(PageId{fd_, hdr->next_page});
+        page = overflow.get_page();
+    }
+    return false;
+}
+
+/**
+ * @brief 分裂hash所在的桶：局部深度加一，按哈希值的第local_depth位把键值对分到原来的桶和新桶中，
+ * 局部深度等于全局深度时先将目录加倍。调用者需要独占持有目录的latch
+ *
+ * @return 桶中的key与hash完全相同或者局部深度已达上限，分裂无法腾出空位时返回false
+ */
+bool IxHashIndexHandle::split_bucket(uint64_t hash) {
+    int key_len = file_hdr_->col_tot_len_;
+    page_id_t old_page_no = bucket_of(hash);
+    std::vector<char> entries;
+    int local_depth;
+    bool same_hash = true;
+    {
+        // 取出桶及其溢出页面中的全部键值对，并清空这些页面，溢出页面仍留在原来的桶上
+        WritePageGuard head = buffer_pool_manager_->fetch_page_write(PageId{fd_, old_page_no});
+        local_depth = bucket_hdr(head.get_page())->local_depth;
+        WritePageGuard overflow;
+        for (Page *page = head.get_page(); page != nullptr;) {
+            IxHashBucketHdr *hdr = bucket_hdr(page);
+            for (int i = 0; i < hdr->num_entries; i++) {
+                same_hash = same_hash && ix_hash_key(entry_at(page, i), key_len) == hash;
+            }
+            if (hdr->next_page == IX_NO_PAGE) {
+                break;
+            }
+            overflow = buffer_pool_manager_->fetch_page_write(PageId{fd_, hdr->next_page});
+            page = overflow.get_page();
+        }
+        if (same_hash || local_depth >= IX_HASH_MAX_DEPTH) {
+            return false;
+        }
+        for (Page *page = head.get_page(); page != nullptr;) {
+            IxHashBucketHdr *hdr = bucket_hdr(page);
+            entries.insert(entries.end(), entry_at(page, 0), entry_at(page, hdr->num_entries));
+            hdr->num_entries = 0;
+            if (hdr->next_page == IX_NO_PAGE) {
+                break;
+            }
+            overflow = buffer_pool_manager_->fetch_page_write(PageId{fd_, hdr->next_page});
+            page = overflow.get_page();
+        }
+        bucket_hdr(head.get_page())->local_depth = local_depth + 1;
+    }
+
+    if (local_depth == file_hdr_->global_depth_) {
+        size_t dir_size = file_hdr_->dir_.size();
+        file_hdr_->dir_.resize(dir_size * 2);
+        std::copy_n(file_hdr_->dir_.begin(), dir_size, file_hdr_->dir_.begin() + dir_size);
+        file_hdr_->global_depth_++;
+    }
+    page_id_t new_page_no;
+    new_bucket_page(&new_page_no, local_depth + 1);
+    // 目录中指向原来的桶、并且第local_depth位为1的项改为指向新桶
+    for (size_t i = 0; i < file_hdr_->dir_.size(); i++) {
+        if (file_hdr_->dir_[i] == old_page_no && ((i >> local_depth) & 1)) {
+            file_hdr_->dir_[i] = new_page_no;
+        }
+    }
+    for (size_t offset = 0; offset < entries.size(); offset += entry_size()) {
+        const char *entry = entries.data() + offset;
+        Rid rid;
+        memcpy(&rid, entry + key_len, sizeof(Rid));
+        uint64_t entry_hash = ix_hash_key(entry, key_len);
+        try_insert((entry_hash >> local_depth) & 1 ? new_page_no : old_page_no, entry, rid, true);
+    }
+    return true;
+}
+
+/**
+ * @brief 分配一个空的桶页面
+ *
+ * @param page_no 传出参数，新页面的页号
+ * @return WritePageGuard 离开作用域时自动unpin并标记为脏页
+ */
+WritePageGuard IxHashIndexHandle::new_bucket_page(page_id_t *page_no, int local_depth) {
+    PageId page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+    WritePageGuard guard = buffer_pool_manager_->new_page_guarded(&page_id);
+    if (!guard.is_valid()) {
+        throw InternalError("IxHashIndexHandle::new_bucket_page Error: no free frame in buffer pool");
+    }
+    file_hdr_->num_pages_ = std::max(file_hdr_->num_pages_, page_id.page_no + 1);
+    *bucket_hdr(guard.get_page()) = {.local_depth = local_depth, .num_entries = 0, .next_page = IX_NO_PAGE};
+    *page_no = page_id.page_no;
+    return guard;
+}
+
+// 每个目录页面存放的目录项数量
+static constexpr int IX_HASH_DIR_ENTRIES_PER_PAGE = (PAGE_SIZE - 2 * sizeof(int)) / sizeof(page_id_t);
+
+/**
+ * @brief 从目录页面链表读入2^global_depth个目录项
+ */
+void IxHashIndexHandle::load_dir() {
+    file_hdr_->dir_.resize(size_t{1} << file_hdr_->global_depth_);
+    size_t loaded = 0;
+    for (page_id_t page_no = IX_HASH_DIR_PAGE; loaded < file_hdr_->dir_.size();) {
+        ReadPageGuard guard = buffer_pool_manager_->fetch_page_read(PageId{fd_, page_no});
+        const char *data = guard.get_page()->get_data();
+        int count;
+        memcpy(&page_no, data, sizeof(page_id_t));
+        memcpy(&count, data + sizeof(int), sizeof(int));
+        memcpy(file_hdr_->dir_.data() + loaded, data + 2 * sizeof(int), count * sizeof(page_id_t));
+        loaded += count;
+    }
+}
+
+/**
+ * @brief 将目录写回目录页面链表，目录只会变大，页面不够时在链表末尾追加
+ */
+void IxHashIndexHandle::save_dir() {
+    size_t saved = 0;
+    WritePageGuard guard = buffer_pool_manager_->fetch_page_write(PageId{fd_, IX_HASH_DIR_PAGE});
+    while (true) {
+        char *data = guard.get_page()->get_data();
+        int count = static_cast<int>(std::min<size_t>(IX_HASH_DIR_ENTRIES_PER_PAGE, file_hdr_->dir_.size() - saved));
+        memcpy(data + sizeof(int), &count, sizeof(int));
+        memcpy(data + 2 * sizeof(int), file_hdr_->dir_.data() + saved, count * sizeof(page_id_t));
+        saved += count;
+        if (saved == file_hdr_->dir_.size()) {
+            break;
+        }
+        page_id_t next_page;
+        memcpy(&next_page, data, sizeof(page_id_t));
+        if (next_page == IX_NO_PAGE) {
+            PageId page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+            WritePageGuard next = buffer_pool_manager_->new_page_guarded(&page_id);
+            if (!next.is_valid()) {
+                throw InternalError("IxHashIndexHandle::save_dir Error: no free frame in buffer pool");
+            }
+            file_hdr_->num_pages_ = std::max(file_hdr_->num_pages_, page_id.page_no + 1);
+            next_page = page_id.page_no;
+            memcpy(data, &next_page, sizeof(page_id_t));
+            memset(next.get_page()->get_data(), 0xff, sizeof(page_id_t));  // 新页面是链表的末尾
+            guard = std::move(next);
+        } else {
+            guard = buffer_pool_manager_->fetch_page_write(PageId{fd_, next_page});
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <memory>
+#include <shared_mutex>
+
+#include "ix_index_handle.h"
+
+/**
+ * @description: key的64位哈希值。对编码后的key做FNV-1a，再用splitmix64的终结步骤混合，使目录使用的低位分布均匀。
+ * 哈希值写入磁盘上的桶结构，不能依赖std::hash这类与实现相关的函数
+ */
+inline uint64_t ix_hash_key(const char *key, int len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < len; i++) {
+        h ^= static_cast<unsigned char>(key[i]);
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* 可扩展哈希索引，只支持等值查找 */
+class IxHashIndexHandle {
+    friend class IxManager;
+
+   private:
+    DiskManager *disk_manager_;
+    BufferPoolManager *buffer_pool_manager_;
+    int fd_;
+    std::unique_ptr<IxHashFileHdr> file_hdr_;
+    // 保护目录：查找、插入和删除共享持有，并持有桶页面的latch直到操作结束；分裂桶时独占持有，此时没有其他线程访问桶页面
+    std::shared_mutex dir_latch_;
+
+   public:
+    IxHashIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
+
+    bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction);
+
+    bool insert_entry(const char *key, const Rid &value, Transaction *transaction);
+
+    bool delete_entry(const char *key, Transaction *transaction);
+
+    bool delete_entry(const char *key, const Rid &value, Transaction *transaction);
+
+    int global_depth() const { return file_hdr_->global_depth_; }
+
+   private:
+    enum class InsertResult { INSERTED, DUPLICATE, FULL };
+
+    int entry_size() const { return file_hdr_->col_tot_len_ + static_cast<int>(sizeof(Rid)); }
+
+    static IxHashBucketHdr *bucket_hdr(Page *page) { return reinterpret_cast<IxHashBucketHdr *>(page->get_data()); }
+
+    char *entry_at(Page *page, int idx) const {
+        return page->get_data() + sizeof(IxHashBucketHdr) + idx * entry_size();
+    }
+
+    page_id_t bucket_of(uint64_t hash) const {
+        return file_hdr_->dir_[hash & ((uint64_t{1} << file_hdr_->global_depth_) - 1)];
+    }
+
+    void normalize_key(const char *key, char *buf) const;
+
+    InsertResult try_insert(page_id_t bucket, const char *key, const Rid &value, bool allow_overflow);
+
+    bool erase_entry(const char *key, const Rid *value);
+
+    bool split_bucket(uint64_t hash);
+
+    WritePageGuard new_bucket_page(page_id_t *page_no, int local_depth);
+
+    void load_dir();
+
+    void save_dir();
+};
@@ -10,8 +10,40 @@ See the Mulan PSL v2 for more details. */
 
 #include "ix_index_handle.h"
 
+#include <thread>
+#include <type_traits>
+
 #include "ix_scan.h"
 
+/**
+ * @brief 在当前node中查找第一个>=target（upper为true时为>target）的key_idx
+ *
+ * @note 单个INT/FLOAT字段的索引使用file_hdr->search_mode_选定的SIMD查找；其余索引使用无分支的二分查找，
+ * 每轮只根据比较结果选择base，不需要预测比较结果。压缩格式的结点见compact_search
+ */
+int IxNodeHandle::search(const char *target, bool upper) const {
+    if (is_compact()) {
+        return compact_search(target, upper);
+    }
+    int n = page_hdr->num_key;
+    if (file_hdr->search_mode_ != IxSearchMode::GENERIC) {
+        return ix_simd_search(file_hdr->search_mode_, keys, n, target, upper);
+    }
+    if (n == 0) {
+        return 0;
+    }
+    // 对任意key，lower_bound要跳过cmp < 0的key，upper_bound要跳过cmp <= 0的key
+    int bound = upper ? 1 : 0;
+    int base = 0;
+    while (n > 1) {
+        int half = n >> 1;
+        int cmp = ix_compare(get_key(base + half), target, file_hdr);
+        base = cmp < bound ? base + half : base;
+        n -= half;
+    }
+    return base + (ix_compare(get_key(base), target, file_hdr) < bound);
+}
+
 /**
  * @brief 在当前node中查找第一个>=target的key_idx
  *
@@ -19,23 +51,7 @@ See the Mulan PSL v2 for more details. */
  * @note 返回key index（同时也是rid index），作为slot no
  */
 int IxNodeHandle::lower_bound(const char *target) const {
-    // Todo:
-    // 查找当前节点中第一个大于等于target的key，并返回key的位置给上层
-    // 提示: 可以采用多种查找方式，如顺序遍历、二分查找等；使用ix_compare()函数进行比较
-    int l = 0, r = page_hdr->num_key;
-    while (l < r) 
-    {
-        int mid = (l + r) >> 1;
-        if (ix_compare(get_key(mid), target, file_hdr->col_types_, file_hdr->col_lens_) >= 0) 
-        {
-            r = mid;
-        } 
-        else 
-        {
-            l = mid + 1;
-        }
-    }
-    return l;
+    return search(target, false);
 }
 
 /**
@@ -45,23 +61,7 @@ int IxNodeHandle::lower_bound(const char *target) const {
  * @note 注意此处的范围从1开始
  */
 int IxNodeHandle::upper_bound(const char *target) const {
-    // Todo:
-    // 查找当前节点中第一个大于target的key，并返回key的位置给上层
-    // 提示: 可以采用多种查找方式：顺序遍历、二分查找等；使用ix_compare()函数进行比较
-    int l = 0, r = page_hdr->num_key;
-    while (l < r) 
-    {
-        int mid = (l + r) >> 1;
-        if (ix_compare(get_key(mid), target, file_hdr->col_types_, file_hdr->col_lens_) > 0) 
-        {
-            r = mid;
-        } 
-        else 
-        {
-            l = mid + 1;
-        }
-    }
-    return l;
+    return search(target, true);
 }
 
 /**
@@ -79,7 +79,7 @@ bool IxNodeHandle::leaf_lookup(const char *key, Rid **value) {
     // 3. 如果存在，获取key对应的Rid，并赋值给传出参数value
     // 提示：可以调用lower_bound()和get_rid()函数。
     int idx = lower_bound(key);
-    if (idx < page_hdr->num_key && ix_compare(key, get_key(idx), file_hdr->col_types_, file_hdr->col_lens_) == 0) 
+    if (idx < page_hdr->num_key && compare_key(idx, key) == 0) 
     {
         *value = get_rid(idx);
         return true;
@@ -129,6 +129,20 @@ void IxNodeHandle::insert_pairs(int pos, const char *key, const Rid *rid, int n)
     if(!(pos >= 0 && pos <= key_size)){  // 合法性
         return;
     }
+    if (is_compact()) {
+        if (n == 1 && compact_insert_in_place(pos, key, *rid)) {
+            return;
+        }
+        // 公共前缀可能变短或空闲空间不连续，解码所有键值对后重新编码整个结点
+        std::vector<char> all_keys;
+        std::vector<Rid> all_rids;
+        copy_pairs(0, key_size, &all_keys, &all_rids);
+        int key_len = file_hdr->col_tot_len_;
+        all_keys.insert(all_keys.begin() + pos * key_len, key, key + n * key_len);
+        all_rids.insert(all_rids.begin() + pos, rid, rid + n);
+        compact_rebuild(all_keys.data(), all_rids.data(), key_size + n);
+        return;
+    }
     // 原pos及以后数据后移n位
     for(int i = key_size - 1; i >= pos; i--) 
     {
@@ -160,7 +174,8 @@ int IxNodeHandle::insert(const char *key, const Rid &value)
     // 4. 返回完成插入操作之后的键值对数量
 
     int pos = lower_bound(key);
-    if(ix_compare(key, get_key(pos), file_hdr->col_types_, file_hdr->col_lens_) != 0||!page_hdr->num_key) // key不重复
+    // pos == num_key时get_key(pos)是分裂或删除后残留的旧数据，不能参与比较
+    if(pos == page_hdr->num_key || compare_key(pos, key) != 0) // key不重复
     {
         insert_pairs(pos, key, &value, 1); // 插入键值对
     }
@@ -181,6 +196,16 @@ void IxNodeHandle::erase_pair(int pos)
     // 3. 更新结点的键值对数量
 
     int key_size = get_size();
+    if (is_compact()) {
+        // 只移动slot，key后缀占用的空间留到重新编码结点时回收
+        IxSlot *slot = get_slot(pos);
+        memmove(slot, slot + 1, (key_size - pos - 1) * sizeof(IxSlot));
+        set_size(key_size - 1);
+        if (key_size == 1) {
+            *compact_hdr() = {.prefix_len = 0, .heap_size = 0};
+        }
+        return;
+    }
     for(int i = pos; i < key_size - 1; i++)  // 删除位置后的数据前移
     {
         set_key(i, get_key(i + 1));
@@ -203,13 +228,274 @@ int IxNodeHandle::remove(const char *key)
     // 3. 返回完成删除操作后的键值对数量
 
     int pos = lower_bound(key); // 查找位置
-    if(ix_compare(key, get_key(pos), file_hdr->col_types_, file_hdr->col_lens_) == 0)  // key存在
+    if(pos < page_hdr->num_key && compare_key(pos, key) == 0)  // key存在
     {
         erase_pair(pos);
     }
     return get_size(); // 返回删除后的键值对数量
 }
 
+/**
+ * @brief 将第key_idx个key解码为定长形式
+ *
+ * @param dest 至少col_tot_len字节
+ */
+void IxNodeHandle::copy_key(int key_idx, char *dest) const {
+    int key_len = file_hdr->col_tot_len_;
+    if (!is_compact()) {
+        memcpy(dest, get_key(key_idx), key_len);
+        return;
+    }
+    int prefix_len = compact_hdr()->prefix_len;
+    const IxSlot *slot = get_slot(key_idx);
+    memcpy(dest, compact_prefix(), prefix_len);
+    memcpy(dest + prefix_len, page->get_data() + slot->offset, slot->len);
+    memset(dest + prefix_len + slot->len, 0, key_len - prefix_len - slot->len);
+}
+
+/**
+ * @brief 比较第key_idx个key与target，返回值的符号与ix_compare(key, target)相同
+ */
+int IxNodeHandle::compare_key(int key_idx, const char *target) const {
+    if (!is_compact()) {
+        return ix_compare(get_key(key_idx), target, file_hdr);
+    }
+    int prefix_len = compact_hdr()->prefix_len;
+    int res = memcmp(compact_prefix(), target, prefix_len);
+    if (res != 0) {
+        return res;
+    }
+    const char *rest = target + prefix_len;
+    return compare_suffix(get_slot(key_idx), rest, ix_trimmed_len(rest, file_hdr->col_tot_len_ - prefix_len));
+}
+
+/**
+ * @brief 比较slot中的key后缀与target去掉公共前缀后的部分
+ *
+ * @param rest target去掉公共前缀后的部分
+ * @param rest_len rest去掉末尾0字节之后的长度
+ * @note 两边都去掉了末尾的0字节，公共部分相同时较短的一方补0后更小
+ */
+int IxNodeHandle::compare_suffix(const IxSlot *slot, const char *rest, int rest_len) const {
+    int res = memcmp(page->get_data() + slot->offset, rest, std::min<int>(slot->len, rest_len));
+    if (res != 0) {
+        return res;
+    }
+    return (slot->len < rest_len) ? -1 : ((slot->len > rest_len) ? 1 : 0);
+}
+
+/**
+ * @brief 压缩格式结点中的查找，结果与search相同
+ *
+ * @note 所有key共享公共前缀，先用target与前缀比较一次，不相同时target在所有key之前或之后；
+ * 相同时二分查找只比较key后缀
+ */
+int IxNodeHandle::compact_search(const char *target, bool upper) const {
+    int n = page_hdr->num_key;
+    if (n == 0) {
+        return 0;
+    }
+    int prefix_len = compact_hdr()->prefix_len;
+    int res = memcmp(target, compact_prefix(), prefix_len);
+    if (res != 0) {
+        return res < 0 ? 0 : n;
+    }
+    const char *rest = target + prefix_len;
+    int rest_len = ix_trimmed_len(rest, file_hdr->col_tot_len_ - prefix_len);
+    int bound = upper ? 1 : 0;
+    int base = 0;
+    while (n > 1) {
+        int half = n >> 1;
+        int cmp = compare_suffix(get_slot(base + half), rest, rest_len);
+        base = cmp < bound ? base + half : base;
+        n -= half;
+    }
+    return base + (compare_suffix(get_slot(base), rest, rest_len) < bound);
+}
+
+/**
+ * @brief 将[pos, pos + n)的键值对解码后追加到keys_out和rids_out
+ */
+void IxNodeHandle::copy_pairs(int pos, int n, std::vector<char> *keys_out, std::vector<Rid> *rids_out) const {
+    int key_len = file_hdr->col_tot_len_;
+    size_t key_offset = keys_out->size();
+    keys_out->resize(key_offset + n * key_len);
+    for (int i = 0; i < n; i++) {
+        copy_key(pos + i, keys_out->data() + key_offset + i * key_len);
+        rids_out->push_back(*get_rid(pos + i));
+    }
+}
+
+/**
+ * @brief 将src中[src_pos, src_pos + n)的键值对插入到当前结点的pos位置
+ */
+void IxNodeHandle::insert_pairs_from(int pos, const IxNodeHandle &src, int src_pos, int n) {
+    if (!is_compact()) {
+        insert_pairs(pos, src.get_key(src_pos), src.get_rid(src_pos), n);
+        return;
+    }
+    std::vector<char> moved_keys;
+    std::vector<Rid> moved_rids;
+    src.copy_pairs(src_pos, n, &moved_keys, &moved_rids);
+    insert_pairs(pos, moved_keys.data(), moved_rids.data(), n);
+}
+
+/**
+ * @brief 分裂结点时右半部分的起始位置
+ *
+ * @note 定长格式按键值对数量平分；压缩格式按key占用的字节数平分，范围为[1, num_key)
+ */
+int IxNodeHandle::split_position() const {
+    int n = page_hdr->num_key;
+    if (!is_compact()) {
+        return n >> 1;
+    }
+    int half = (compact_suffix_bytes() + n * static_cast<int>(sizeof(IxSlot))) / 2;
+    int bytes = 0;
+    int pos = 0;
+    while (pos < n - 1 && bytes < half) {
+        bytes += sizeof(IxSlot) + get_slot(pos)->len;
+        pos++;
+    }
+    return std::max(pos, 1);
+}
+
+/**
+ * @brief 删除键值对之后结点是否需要合并或重分配
+ *
+ * @note 定长格式按键值对数量判断；压缩格式的结点容量取决于key的实际长度，按占用的字节数不足半页判断
+ */
+bool IxNodeHandle::is_underflow() const {
+    if (!is_compact()) {
+        return page_hdr->num_key < (file_hdr->btree_order_ + 1) / 2;
+    }
+    return used_bytes() * 2 < PAGE_SIZE;
+}
+
+/**
+ * @brief 压缩格式结点中有效数据占用的字节数，不包括已删除的key后缀
+ */
+int IxNodeHandle::used_bytes() const {
+    return compact_size(compact_hdr()->prefix_len, page_hdr->num_key, compact_suffix_bytes());
+}
+
+int IxNodeHandle::compact_suffix_bytes() const {
+    int bytes = 0;
+    for (int i = 0; i < page_hdr->num_key; i++) {
+        bytes += get_slot(i)->len;
+    }
+    return bytes;
+}
+
+/**
+ * @brief 压缩格式的结点插入key之后是否仍能放在一个页面中
+ *
+ * @note key不以公共前缀开头时公共前缀会变短，每个key后缀最多增加缩短的字节数
+ */
+bool IxNodeHandle::can_insert(const char *key) const {
+    int n = page_hdr->num_key;
+    if (n == 0) {
+        return true;
+    }
+    int key_len = file_hdr->col_tot_len_;
+    int prefix_len = compact_hdr()->prefix_len;
+    int common = ix_common_prefix_len(key, compact_prefix(), prefix_len);
+    int suffix_bytes = compact_suffix_bytes() + n * (prefix_len - common) +
+                       std::max(ix_trimmed_len(key, key_len) - common, 0);
+    return compact_size(common, n + 1, suffix_bytes) <= PAGE_SIZE;
+}
+
+/**
+ * @brief 压缩格式的结点插入任意一个key之后是否仍能放在一个页面中，用于事先不知道要插入的key的内部结点
+ */
+bool IxNodeHandle::can_insert_any() const {
+    int n = page_hdr->num_key;
+    int prefix_len = compact_hdr()->prefix_len;
+    int suffix_bytes = compact_suffix_bytes() + n * prefix_len + file_hdr->col_tot_len_;
+    return compact_size(0, n + 1, suffix_bytes) <= PAGE_SIZE;
+}
+
+/**
+ * @brief 压缩格式的结点与右兄弟right合并之后是否能放在一个页面中，并且至少还能再插入一个键值对
+ */
+bool IxNodeHandle::can_merge(const IxNodeHandle &right) const {
+    int left_n = page_hdr->num_key;
+    int right_n = right.page_hdr->num_key;
+    if (left_n == 0 || right_n == 0) {
+        return true;
+    }
+    int left_prefix = compact_hdr()->prefix_len;
+    int right_prefix = right.compact_hdr()->prefix_len;
+    int common = ix_common_prefix_len(compact_prefix(), right.compact_prefix(), std::min(left_prefix, right_prefix));
+    int suffix_bytes = compact_suffix_bytes() + left_n * (left_prefix - common) + right.compact_suffix_bytes() +
+                       right_n * (right_prefix - common);
+    return compact_size(common, left_n + right_n, suffix_bytes) + max_entry_bytes() <= PAGE_SIZE;
+}
+
+/**
+ * @brief 不改变公共前缀，直接在空闲空间中插入一个键值对
+ *
+ * @return key不以公共前缀开头或连续的空闲空间不足时返回false，不修改结点
+ */
+bool IxNodeHandle::compact_insert_in_place(int pos, const char *key, const Rid &rid) {
+    int n = page_hdr->num_key;
+    IxCompactHdr *hdr = compact_hdr();
+    if (n == 0 || memcmp(key, compact_prefix(), hdr->prefix_len) != 0) {
+        return false;
+    }
+    int suffix_len = std::max(ix_trimmed_len(key, file_hdr->col_tot_len_) - hdr->prefix_len, 0);
+    int heap_begin = PAGE_SIZE - hdr->heap_size - suffix_len;
+    if (compact_size(hdr->prefix_len, n + 1, 0) > heap_begin) {
+        return false;
+    }
+    memcpy(page->get_data() + heap_begin, key + hdr->prefix_len, suffix_len);
+    hdr->heap_size += suffix_len;
+    IxSlot *slot = get_slot(pos);
+    memmove(slot + 1, slot, (n - pos) * sizeof(IxSlot));
+    *slot = {.rid = rid, .offset = static_cast<uint16_t>(heap_begin), .len = static_cast<uint16_t>(suffix_len)};
+    set_size(n + 1);
+    return true;
+}
+
+/**
+ * @brief 用n个有序的定长键值对重新编码整个压缩格式的结点，公共前缀取第一个和最后一个key的公共前缀
+ *
+ * @note keys_in和rids_in不能指向当前结点的页面
+ */
+void IxNodeHandle::compact_rebuild(const char *keys_in, const Rid *rids_in, int n) {
+    int key_len = file_hdr->col_tot_len_;
+    int prefix_len = 0;
+    if (n > 0) {
+        const char *last = keys_in + (n - 1) * key_len;
+        prefix_len = std::min(ix_common_prefix_len(keys_in, last, key_len), ix_trimmed_len(last, key_len));
+    }
+    int suffix_bytes = 0;
+    for (int i = 0; i < n; i++) {
+        suffix_bytes += std::max(ix_trimmed_len(keys_in + i * key_len, key_len) - prefix_len, 0);
+    }
+    if (compact_size(prefix_len, n, suffix_bytes) > PAGE_SIZE) {
+        throw InternalError("IxNodeHandle::compact_rebuild Error: keys do not fit in one page");
+    }
+
+    char buf[PAGE_SIZE];
+    memset(buf, 0, PAGE_SIZE);
+    auto hdr = reinterpret_cast<IxCompactHdr *>(buf + sizeof(IxPageHdr));
+    hdr->prefix_len = prefix_len;
+    hdr->heap_size = suffix_bytes;
+    memcpy(buf + sizeof(IxPageHdr) + sizeof(IxCompactHdr), keys_in, prefix_len);
+    auto slots = reinterpret_cast<IxSlot *>(buf + compact_slots_offset(prefix_len));
+    int heap_begin = PAGE_SIZE;
+    for (int i = 0; i < n; i++) {
+        const char *key = keys_in + i * key_len;
+        int suffix_len = std::max(ix_trimmed_len(key, key_len) - prefix_len, 0);
+        heap_begin -= suffix_len;
+        memcpy(buf + heap_begin, key + prefix_len, suffix_len);
+        slots[i] = {.rid = rids_in[i], .offset = static_cast<uint16_t>(heap_begin), .len = static_cast<uint16_t>(suffix_len)};
+    }
+    memcpy(page->get_data() + sizeof(IxPageHdr), buf + sizeof(IxPageHdr), PAGE_SIZE - sizeof(IxPageHdr));
+    set_size(n);
+}
+
 IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
     : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), fd_(fd) 
 {
@@ -220,10 +506,18 @@ IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffe
     disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, buf, PAGE_SIZE);
     file_hdr_ = new IxFileHdr();
     file_hdr_->deserialize(buf);
+    // 编码后的key只能按字节比较，不使用SIMD查找
+    file_hdr_->search_mode_ =
+        file_hdr_->normalized_keys_ ? IxSearchMode::GENERIC : ix_choose_search_mode(file_hdr_->col_types_);
     
-    // disk_manager管理的fd对应的文件中，设置从file_hdr_->num_pages开始分配page_no
-    int now_page_no = disk_manager_->get_fd2pageno(fd);
-    disk_manager_->set_fd2pageno(fd, now_page_no + 1);
+    // disk_manager管理的fd对应的文件中，设置从file_hdr_->num_pages开始分配page_no。
+    // 未正常关闭的索引文件头中num_pages_可能过时，文件中已有的页面不能再分配（空闲页面可能只写入了链表指针，向上取整）
+    int file_pages = (disk_manager_->get_file_size(disk_manager_->get_file_name(fd)) + PAGE_SIZE - 1) / PAGE_SIZE;
+    disk_manager_->set_fd2pageno(fd, std::max(file_hdr_->num_pages_, file_pages));
+    // 空闲页面链表交给disk_manager管理，每次变化都立即写入各空闲页面和文件头中的first_free_page_no_
+    off_t head_offset = static_cast<off_t>(IX_FILE_HDR_PAGE) * PAGE_SIZE + IxFileHdr::FIRST_FREE_PAGE_NO_OFFSET;
+    disk_manager_->load_free_pages(fd, file_hdr_->first_free_page_no_, head_offset);
+    file_hdr_->first_free_page_no_ = IX_NO_PAGE;
 }
 
 /**
@@ -232,33 +526,186 @@ IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffe
  * @param operation 查找到目标键值对后要进行的操作类型
  * @param transaction 事务参数，如果不需要则默认传入nullptr
  * @return [leaf node] and [root_is_latched] 返回目标叶子结点以及根结点是否加锁
- * @note need to Unlatch and unpin the leaf node outside!
- * 注意：用了FindLeafPage之后一定要unlatch叶结点，否则下次latch该结点会堵塞！
+ * @note 自顶向下以读latch进行latch crabbing：获取孩子结点的latch之后才释放父结点的latch。
+ * LeafGuard为ReadPageGuard时只读访问叶子结点（Operation::FIND的查找使用不加latch的find_leaf_optimistic）；
+ * 为WritePageGuard时对叶子结点加写latch，用于不会分裂或合并结点的乐观插入和删除。
+ * 返回的叶子结点离开作用域时自动释放latch并unpin，返回时不再持有其他latch
  */
-std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, Operation operation,
-                                                            Transaction *transaction, bool find_first) {
+template <class LeafGuard>
+std::pair<IxNodeGuard<LeafGuard>, bool> IxIndexHandle::find_leaf_page(const char *key, Operation operation,
+                                                                    Transaction *transaction, bool find_first) {
     // Todo:
     // 1. 获取根节点
     // 2. 从根节点开始不断向下查找目标key
     // 3. 找到包含该key值的叶子结点停止查找，并返回叶子节点
 
-    IxNodeHandle *node = fetch_node(file_hdr_->root_page_);
-    // bool root_is_latched = true; // 根节点是否上锁
-    while (!node->is_leaf_page()) 
+    // 获取根结点的latch之前根结点可能被替换，需要共享持有root_latch_
+    std::shared_lock<std::shared_mutex> root_lock(root_latch_);
+    IxReadNode parent;  // 当前结点的父结点
+    IxReadNode node = fetch_node_read(file_hdr_->root_page_);
+    while (!node.is_leaf_page()) 
     {
-        page_id_t child_page_no = node->internal_lookup(key);
-        buffer_pool_manager_->unpin_page(node->get_page_id(), false); // 释放node
-        node = fetch_node(child_page_no);
+        page_id_t child_page_no = node.internal_lookup(key);
+        parent = std::move(node);  // 赋值时自动释放原来的parent
+        node = fetch_node_read(child_page_no);
+        if (root_lock.owns_lock()) {
+            root_lock.unlock();
+        }
+    }
+    if constexpr (std::is_same_v<LeafGuard, ReadPageGuard>) {
+        return std::make_pair(std::move(node), false);
+    } else {
+        // 读latch不能升级为写latch，先释放叶子结点的读latch再获取写latch。期间仍持有父结点的读latch（叶子为根结点时
+        // 持有root_latch_），叶子结点不会被分裂或合并
+        page_id_t leaf_page_no = node.get_page_no();
+        node.drop();
+        IxWriteNode leaf = fetch_node_write(leaf_page_no);
+        return std::make_pair(std::move(leaf), false);
+    }
+}
+
+// 只读查找已改用find_leaf_optimistic，读latch的版本保留给需要与修改操作互斥的调用者
+template std::pair<IxReadNode, bool> IxIndexHandle::find_leaf_page<ReadPageGuard>(const char *, Operation, Transaction *,
+                                                                                  bool);
+
+/**
+ * @brief 乐观锁耦合（optimistic lock coupling）：不加latch，自顶向下查找key所在的叶子结点，用于Operation::FIND
+ *
+ * @param key 要查找的目标key值
+ * @param leaf 返回叶子结点的一致副本
+ * @note 每个结点先读版本号再复制内容，复制后版本号不变说明副本一致；进入孩子结点时，在读到孩子的版本号之后再次验证
+ * 父结点的版本号，保证孩子确实是父结点当时的孩子。任一验证失败（期间有结点被修改）时从根结点重新开始。
+ * 只读查找不获取root_latch_和页面latch，缓冲池中的结点通过try_read_node直接读取，也不pin页面，
+ * 不写任何共享数据，读操作之间互不竞争
+ */
+void IxIndexHandle::find_leaf_optimistic(const char *key, IxNodeSnapshot *leaf) const {
+    while (!try_find_leaf_optimistic(key, leaf)) {
+    }
+}
+
+/**
+ * @brief find_leaf_optimistic的一次尝试
+ *
+ * @return 是否得到了一致的叶子结点，为false时需要重新开始
+ */
+bool IxIndexHandle::try_find_leaf_optimistic(const char *key, IxNodeSnapshot *leaf) const {
+    // 不持有root_latch_时根结点可能正在被替换，读到的旧根结点通过下面的检查排除：
+    // 旧根结点分裂后有了父结点；旧根结点被合并（adjust_root）后是空的内部结点
+    if (!try_read_node(file_hdr_->root_page_, leaf) || !leaf->is_root_page() ||
+        (!leaf->is_leaf_page() && leaf->get_size() == 0)) {
+        return false;
+    }
+    while (!leaf->is_leaf_page()) {
+        const Page *parent = leaf->frame_;
+        uint64_t parent_version = leaf->version_;
+        page_id_t child_page_no = leaf->internal_lookup(key);
+        bool child_valid;
+        try {
+            child_valid = try_read_node(child_page_no, leaf);
+        } catch (...) {
+            // 孩子结点可能已被删除，页面已释放，此时父结点的版本号一定已经改变
+            if (!parent->validate_version(parent_version)) {
+                return false;
+            }
+            throw;
+        }
+        if (!child_valid || !parent->validate_version(parent_version)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 以latch crabbing的方式获取从根结点到目标叶子结点路径上的写latch，用于可能分裂或合并结点的插入和删除
+ *
+ * @param key 要查找的目标key值
+ * @param operation 要进行的操作类型，INSERT或DELETE
+ * @param transaction 事务指针，加latch的页面按自顶向下的顺序记录在index_latch_page_set中，nullptr表示root_latch_
+ * @return IxNodeHandle 目标叶子结点，其latch和pin由transaction持有，操作完成后调用release_latched_pages释放
+ * @note 某个结点安全（本次操作对它的修改不会传播到它的祖先）时，立即释放它的祖先的latch
+ */
+IxNodeHandle IxIndexHandle::find_leaf_page_exclusive(const char *key, Operation operation, Transaction *transaction) {
+    root_latch_.lock();
+    transaction->append_index_latch_page_set(nullptr);
+    page_id_t page_no = file_hdr_->root_page_;
+    while (true) {
+        Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no});
+        if (page == nullptr) {
+            release_latched_pages(transaction);
+            throw InternalError("IxIndexHandle::find_leaf_page_exclusive Error: no free frame in buffer pool");
+        }
+        page->wlatch();
+        IxNodeHandle node(file_hdr_, page);
+        if (is_safe(&node, key, operation)) {
+            release_latched_pages(transaction);
+        }
+        transaction->append_index_latch_page_set(page);
+        if (node.is_leaf_page()) {
+            return node;
+        }
+        page_no = node.internal_lookup(key);
+    }
+}
+
+/**
+ * @brief 按加latch的顺序释放transaction持有的所有结点latch和pin，以及root_latch_
+ *
+ * @param transaction 事务指针
+ */
+void IxIndexHandle::release_latched_pages(Transaction *transaction) {
+    auto page_set = transaction->get_index_latch_page_set();
+    for (Page *page : *page_set) {
+        if (page == nullptr) {
+            root_latch_.unlock();
+            continue;
+        }
+        PageId page_id = page->get_page_id();
+        page->wunlatch();
+        buffer_pool_manager_->unpin_page(page_id, true);
     }
-    // buffer_pool_manager_->unpin_page(node->get_page_id(), false); // 释放叶子节点node
-    return std::make_pair(node, false);
+    page_set->clear();
+}
+
+/**
+ * @brief 判断对node执行operation之后，修改是否不会传播到node的祖先
+ *
+ * @param node 持有写latch的结点
+ * @param key 要插入或删除的key
+ * @param operation INSERT或DELETE
+ * @return 为true时可以释放node的所有祖先的latch
+ * @note 插入：node插入一个键值对后不会分裂。
+ * 删除：node删除一个键值对后不会下溢，并且node的第一个key不会改变（否则需要通过maintain_parent更新祖先中的key）。
+ * 根结点没有父结点，只需要保证根结点不会被替换。
+ * 压缩格式的结点按字节数判断：内部结点要插入的key来自孩子结点的分裂，事先未知，按最坏情况判断；
+ * 删除时不需要更新祖先中的key（见maintain_parent），只需要保证不会下溢
+ */
+bool IxIndexHandle::is_safe(IxNodeHandle *node, const char *key, Operation operation) {
+    if (operation == Operation::INSERT) {
+        if (node->is_compact()) {
+            return node->is_leaf_page() ? node->can_insert(key) : node->can_insert_any();
+        }
+        return node->get_size() + 1 < node->get_max_size();
+    }
+    if (node->is_root_page()) {
+        return node->get_size() > (node->is_leaf_page() ? 1 : 2);
+    }
+    if (node->is_compact()) {
+        return (node->used_bytes() - node->max_entry_bytes()) * 2 >= PAGE_SIZE;
+    }
+    if (node->get_size() <= node->get_min_size()) {
+        return false;
+    }
+    // 沿第0个孩子（叶子结点中为第0个key）向下删除时，node的第一个key可能改变
+    int pos = node->is_leaf_page() ? node->lower_bound(key) : node->upper_bound(key) - 1;
+    return pos > 0;
 }
 
 /**
  * @brief 用于查找指定键在叶子结点中的对应的值result
  *
  * @param key 查找的目标key值
- * @param result 用于存放结果的容器
+ * @param result 用于存放结果的容器，非唯一索引按Rid的顺序存放该key的所有Rid
  * @param transaction 事务指针
  * @return bool 返回目标键值对是否存在
  */
@@ -270,17 +717,26 @@ bool IxIndexHandle::get_value(const char *key, std::vector<Rid> *result, Transac
     // 3. 把rid存入result参数中
     // 提示：使用完buffer_pool提供的page之后，记得unpin page；记得处理并发的上锁
 
-    std::scoped_lock<std::mutex> lock(root_latch_); // 上锁
-    auto leaf_node = find_leaf_page(key, Operation::FIND, transaction); // 查找叶子结点
-    IxNodeHandle *node = leaf_node.first; // 叶子结点
-    bool root_is_latched = leaf_node.second; // 根节点是否上锁
+    if (!file_hdr_->unique_) {
+        // 该key的索引项按Rid排列在[lower_bound, upper_bound)中，可能跨越多个叶子结点
+        size_t num = result->size();
+        for (IxScan scan(this, lower_bound(key), upper_bound(key), buffer_pool_manager_); !scan.is_end(); scan.next()) {
+            result->push_back(scan.rid());
+        }
+        return result->size() > num;
+    }
+
+    char key_buf[IX_MAX_COL_LEN];
+    key = normalize_key(key, key_buf);
+
+    IxNodeSnapshot node(file_hdr_);
+    find_leaf_optimistic(key, &node); // 查找叶子结点
     Rid *value = nullptr; 
-    bool ret = node->leaf_lookup(key, &value); // 查找key
+    bool ret = node.leaf_lookup(key, &value); // 查找key
     if (ret) 
     {
         result->push_back(*value);
     }
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false); // 释放叶子节点node
     return ret;
 
 }
@@ -288,11 +744,11 @@ bool IxIndexHandle::get_value(const char *key, std::vector<Rid> *result, Transac
 /**
  * @brief  将传入的一个node拆分(Split)成两个结点，在node的右边生成一个新结点new node
  * @param node 需要拆分的结点
+ * @param pos 分裂位置，[pos, num_key)的键值对移动到new_node，通常为node->split_position()
  * @return 拆分得到的new_node
- * @note need to unpin the new node outside
- * 注意：本函数执行完毕后，原node和new node都需要在函数外面进行unpin
+ * @note 返回的new_node离开作用域时自动unpin，原node由调用者负责释放
  */
-IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) 
+IxWriteNode IxIndexHandle::split(IxNodeHandle *node, int pos) 
 {
     // Todo:
     // 1. 将原结点的键值对平均分配，右半部分分裂为新的右兄弟结点
@@ -301,34 +757,88 @@ IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node)
     //    为新节点分配键值对，更新旧节点的键值对数记录
     // 3. 如果新的右兄弟结点不是叶子结点，更新该结点的所有孩子结点的父节点信息(使用IxIndexHandle::maintain_child())
     
-    IxNodeHandle *new_node = create_node(); // 创建新结点
-    int pos = node->page_hdr->num_key >> 1;  // 分裂位置
+    IxWriteNode new_node = create_node(); // 创建新结点
     // 复制一些公共属性：叶子节点标志、父节点、下一个空闲页号等
-    new_node->page_hdr->is_leaf = node->page_hdr->is_leaf;
-    new_node->page_hdr->parent = node->page_hdr->parent;
-    new_node->page_hdr->next_free_page_no = node->page_hdr->next_free_page_no;
+    new_node.page_hdr->is_leaf = node->page_hdr->is_leaf;
+    new_node.page_hdr->parent = node->page_hdr->parent;
+    new_node.page_hdr->next_free_page_no = node->page_hdr->next_free_page_no;
     // 将右半部分的键值对从原节点插入到新节点
-    new_node->insert_pairs(0, node->get_key(pos), node->get_rid(pos), node->page_hdr->num_key - pos);
+    new_node.insert_pairs_from(0, *node, pos, node->page_hdr->num_key - pos);
     // 更新原节点的键值对数目，剩余的部分留给原节点
     node->page_hdr->num_key = pos;
-    if (new_node->page_hdr->is_leaf) // 如果新节点是叶子节点
+    if (new_node.page_hdr->is_leaf) // 如果新节点是叶子节点
     {
         // 设置叶子节点的前后指针，链接到前后节点
-        new_node->page_hdr->prev_leaf = node->get_page_no();
-        new_node->page_hdr->next_leaf = node->page_hdr->next_leaf;
-        // 更新原节点和新节点的连接关系
-        IxNodeHandle *next = fetch_node(new_node->page_hdr->next_leaf);
-        next->page_hdr->prev_leaf = new_node->get_page_no();
-        buffer_pool_manager_->unpin_page(next->get_page_id(), true);
-        node->page_hdr->next_leaf = new_node->get_page_no();
+        new_node.page_hdr->prev_leaf = node->get_page_no();
+        new_node.page_hdr->next_leaf = node->page_hdr->next_leaf;
+        // 更新原节点和新节点的连接关系，后继叶子的latch已由insert_entry获取（见try_fetch_node_write），这里重入
+        IxWriteNode next = fetch_node_write(new_node.page_hdr->next_leaf);
+        next.page_hdr->prev_leaf = new_node.get_page_no();
+        node->page_hdr->next_leaf = new_node.get_page_no();
     } else {// 如果新节点不是叶子节点，维护子节点的父节点信息
-        for (int i = 0; i < new_node->page_hdr->num_key; i++) {
-            maintain_child(new_node, i);
+        for (int i = 0; i < new_node.page_hdr->num_key; i++) {
+            maintain_child(&new_node, i);
         }
     }
     return new_node;// 返回新的右兄弟节点
 }
 
+/**
+ * @brief 在node中插入键值对，插入后放不下时分裂node
+ *
+ * @param[out] new_node node分裂时传出新的右兄弟结点
+ * @return node是否分裂
+ * @note 定长格式的结点预留了一个空位，先插入，插入后已满再分裂。压缩格式的结点插入key可能使公共前缀变短、
+ * 所有key变长，因此放不下时先分裂再插入：key小于所有key时只把key和原来的第一个key留在node中，
+ * 大于所有key时只把原来的最后一个key和key放到new_node中，其余情况按字节数平分，插入后都能放在一个页面中
+ */
+bool IxIndexHandle::insert_or_split(IxNodeHandle *node, const char *key, const Rid &value, IxWriteNode *new_node) {
+    if (!node->is_compact()) {
+        node->insert(key, value);
+        if (node->get_size() < node->get_max_size()) {
+            return false;
+        }
+        *new_node = split(node, node->split_position());
+        return true;
+    }
+    if (node->can_insert(key)) {
+        node->insert(key, value);
+        return false;
+    }
+    int n = node->get_size();
+    int pos = node->lower_bound(key);
+    if (pos < n && node->compare_key(pos, key) == 0) {
+        return false;
+    }
+    int split_pos = (pos == 0) ? 1 : ((pos == n) ? n - 1 : node->split_position());
+    *new_node = split(node, split_pos);
+    if (pos <= split_pos) {
+        node->insert_pair(pos, key, value);
+    } else {
+        new_node->insert_pair(pos - split_pos, key, value);
+    }
+    return true;
+}
+
+/**
+ * @brief 分裂之后插入父结点的key，left的key都小于它，right的key都大于等于它
+ *
+ * @param dest 至少col_tot_len字节
+ * @note 压缩格式的叶子结点使用前缀截断的分隔key（ix_separator_key），使内部结点中的key尽可能短；
+ * 内部结点的第一个key已经是分隔key，直接使用
+ */
+void IxIndexHandle::separator_key(IxNodeHandle *left, IxNodeHandle *right, char *dest) {
+    if (!right->is_compact() || !right->is_leaf_page()) {
+        right->copy_key(0, dest);
+        return;
+    }
+    char left_last[IX_MAX_COL_LEN];
+    char right_first[IX_MAX_COL_LEN];
+    left->copy_key(left->get_size() - 1, left_last);
+    right->copy_key(0, right_first);
+    ix_separator_key(left_last, right_first, dest, file_hdr_->col_tot_len_);
+}
+
 /**
  * @brief Insert key & value pair into internal page after split
  * 拆分(Split)后，向上找到old_node的父结点
@@ -340,7 +850,7 @@ IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node)
  * @param key 要插入parent的key
  * @note 一个结点插入了键值对之后需要分裂，分裂后左半部分的键值对保留在原结点，在参数中称为old_node，
  * 右半部分的键值对分裂为新的右兄弟节点，在参数中称为new_node（参考Split函数来理解old_node和new_node）
- * @note 本函数执行完毕后，new node和old node都需要在函数外面进行unpin
+ * @note old node和new node由调用者负责释放
  */
 void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node,
                                      Transaction *transaction) 
@@ -350,40 +860,50 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
     // 2. 获取原结点（old_node）的父亲结点
     // 3. 获取key对应的rid，并将(key, rid)插入到父亲结点
     // 4. 如果父亲结点仍需要继续分裂，则进行递归插入
-    // 提示：记得unpin page
-    IxNodeHandle* parent;
+    // 提示：parent离开作用域时自动unpin
+    IxWriteNode parent;
     if(old_node->is_root_page()) 
     {
         // 新的父节点
-        IxNodeHandle* new_root = this->create_node();
-        new_root -> page_hdr -> is_leaf = false;
-        new_root -> page_hdr -> next_free_page_no = IX_NO_PAGE;
-        new_root -> page_hdr -> next_leaf = IX_NO_PAGE;
-        new_root -> page_hdr -> prev_leaf = IX_NO_PAGE;
-        new_root -> page_hdr -> num_key = 0;
-        new_root -> page_hdr -> parent = IX_NO_PAGE;
-
-        file_hdr_->root_page_ = new_root->get_page_no();
-        new_root->insert(old_node->get_key(0), Rid{old_node->get_page_no(), -1});
-        old_node->set_parent_page_no(new_root->get_page_no());
-        parent = new_root;
+        parent = this->create_node();
+        parent.page_hdr->is_leaf = false;
+        parent.page_hdr->next_free_page_no = IX_NO_PAGE;
+        parent.page_hdr->next_leaf = IX_NO_PAGE;
+        parent.page_hdr->prev_leaf = IX_NO_PAGE;
+        parent.page_hdr->num_key = 0;
+        parent.page_hdr->parent = IX_NO_PAGE;
+
+        file_hdr_->root_page_ = parent.get_page_no();
+        // 压缩格式中最左侧内部结点的第一个key取最小的key（全0），插入更小的key之后也不会过时
+        char first_key[IX_MAX_COL_LEN];
+        if (parent.is_compact()) {
+            memset(first_key, 0, file_hdr_->col_tot_len_);
+        } else {
+            old_node->copy_key(0, first_key);
+        }
+        parent.insert(first_key, Rid{old_node->get_page_no(), -1});
+        old_node->set_parent_page_no(parent.get_page_no());
     } 
     else 
     {
-        parent = fetch_node(old_node->get_parent_page_no());
+        parent = fetch_node_write(old_node->get_parent_page_no());
+        // 插入更小的key时不更新祖先，最左侧路径上父结点的第一个key可能大于old_node的第一个key，甚至不小于key，
+        // 先更新为old_node的第一个key，保证key插入到old_node之后
+        if (!parent.is_compact() && parent.find_child(old_node) == 0) {
+            parent.set_key(0, old_node->get_key(0));
+        }
     }
-    // 以上处理之后，old_root只有一种情况，即存在parent
-    parent->insert(key, Rid{new_node->get_page_no(), -1});
-
-    new_node->set_parent_page_no(parent->get_page_no());
-    // 是否继续分裂
-    if(parent->get_size() == parent->get_max_size()) 
+    // 以上处理之后，old_root只有一种情况，即存在parent；插入后放不下时分裂parent，并继续向上插入
+    IxWriteNode new_new_node;
+    bool parent_split = insert_or_split(&parent, key, Rid{new_node->get_page_no(), -1}, &new_new_node);
+    bool in_new_parent = parent_split && new_new_node.compare_key(0, key) <= 0;
+    new_node->set_parent_page_no(in_new_parent ? new_new_node.get_page_no() : parent.get_page_no());
+    if (parent_split) 
     {
-        IxNodeHandle* new_new_node = this->split(parent);
-        this->insert_into_parent(parent, new_new_node->get_key(0), new_new_node, transaction);
-        buffer_pool_manager_->unpin_page(new_new_node->get_page_id(), true);
+        char separator[IX_MAX_COL_LEN];
+        separator_key(&parent, &new_new_node, separator);
+        this->insert_into_parent(&parent, separator, &new_new_node, transaction);
     }
-    buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
 }
 
 /**
@@ -397,29 +917,64 @@ page_id_t IxIndexHandle::insert_entry(const char *key, const Rid &value, Transac
     // 1. 查找key值应该插入到哪个叶子节点
     // 2. 在该叶子节点中插入键值对
     // 3. 如果结点已满，分裂结点，并把新结点的相关信息插入父节点
-    // 提示：记得unpin page；若当前叶子节点是最右叶子节点，则需要更新file_hdr_.last_leaf；记得处理并发的上锁
+    // 提示：结点离开作用域时自动unpin；若当前叶子节点是最右叶子节点，则需要更新file_hdr_.last_leaf；记得处理并发的上锁
+
+    char key_buf[IX_MAX_COL_LEN];
+    key = normalize_key(key, key_buf, &value);
 
-    std::scoped_lock lock{root_latch_};
-    auto leaf_node = find_leaf_page(key, Operation::INSERT, transaction);  // 查找叶子结点
-    IxNodeHandle *node = leaf_node.first;
-    node->insert(key, value);
-    if(node->get_size() == node->get_max_size()) 
+    // 乐观插入：只对叶子结点加写latch，叶子结点插入后不会分裂时直接插入
     {
-        IxNodeHandle* new_node = this->split(node);
-        this->insert_into_parent(node, new_node->get_key(0), new_node, transaction);
-        if (file_hdr_->last_leaf_ == node->get_page_no()) 
-        {
-            file_hdr_->last_leaf_ = new_node->get_page_no();
+        IxWriteNode leaf = find_leaf_page<WritePageGuard>(key, Operation::INSERT, transaction).first;
+        if (is_safe(&leaf, key, Operation::INSERT)) {
+            leaf.insert(key, value);
+            return leaf.get_page_no();
+        }
+    }
+
+    // 叶子结点可能分裂，重新自顶向下获取路径上的写latch
+    Transaction local_txn(INVALID_TXN_ID);
+    if (transaction == nullptr) {
+        transaction = &local_txn;
+    }
+    while (true) {
+        try {
+            IxNodeHandle node = find_leaf_page_exclusive(key, Operation::INSERT, transaction);  // 查找叶子结点
+            // 叶子结点分裂时要修改后继叶子的prev_leaf，后继叶子不在node的祖先之下，只能在修改之前尝试获取latch
+            IxWriteNode next_leaf;
+            if (!is_safe(&node, key, Operation::INSERT) && !try_fetch_node_write(node.get_next_leaf(), &next_leaf)) {
+                release_latched_pages(transaction);
+                std::this_thread::yield();
+                continue;
+            }
+            page_id_t page_no = node.get_page_no();
+            IxWriteNode new_node;
+            bool node_split = insert_or_split(&node, key, value, &new_node);  // split中重入next_leaf的latch
+            next_leaf.drop();  // 向上插入父结点可能阻塞，之前释放叶子链表中的兄弟结点
+            if (node_split) 
+            {
+                char separator[IX_MAX_COL_LEN];
+                separator_key(&node, &new_node, separator);
+                this->insert_into_parent(&node, separator, &new_node, transaction);
+                if (file_hdr_->last_leaf_ == node.get_page_no()) 
+                {
+                    file_hdr_->last_leaf_ = new_node.get_page_no();
+                }
+                if (new_node.compare_key(0, key) <= 0) {
+                    page_no = new_node.get_page_no();
+                }
+            }
+            new_node.drop();
+            release_latched_pages(transaction);
+            return page_no;
+        } catch (...) {
+            release_latched_pages(transaction);
+            throw;
         }
-        buffer_pool_manager_->unpin_page(new_node->get_page_id(), true);
     }
-    
-    buffer_pool_manager_->unpin_page(node->get_page_id(), true);
-    return node->get_page_no();
 }
 
 /**
- * @brief 用于删除B+树中含有指定key的键值对
+ * @brief 用于删除B+树中含有指定key的键值对，非唯一索引删除该key的第一个键值对
  * @param key 要删除的key值
  * @param transaction 事务指针
  */
@@ -430,14 +985,87 @@ bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
     // 3. 如果删除成功需要调用CoalesceOrRedistribute来进行合并或重分配操作，并根据函数返回结果判断是否有结点需要删除
     // 4. 如果需要并发，并且需要删除叶子结点，则需要在事务的delete_page_set中添加删除结点的对应页面；记得处理并发的上锁
 
-    std::scoped_lock lock{root_latch_};
-    IxNodeHandle *leaf_page = find_leaf_page(key, Operation::DELETE, transaction).first;
-    int num = leaf_page->page_hdr->num_key;
-    bool flag = (leaf_page->remove(key) < num);
-    if (flag) {
-        coalesce_or_redistribute(leaf_page);
+    if (!file_hdr_->unique_) {
+        std::vector<Rid> rids;
+        if (!get_value(key, &rids, transaction)) {
+            return false;
+        }
+        return delete_entry(key, rids.front(), transaction);
+    }
+    char key_buf[IX_MAX_COL_LEN];
+    return erase_entry(normalize_key(key, key_buf), nullptr, transaction);
+}
+
+/**
+ * @brief 删除键值对(key, value)，key相同但Rid不同的键值对不受影响
+ * @param key 要删除的key值
+ * @param value 键值对中记录的位置
+ * @param transaction 事务指针
+ */
+bool IxIndexHandle::delete_entry(const char *key, const Rid &value, Transaction *transaction) {
+    char key_buf[IX_MAX_COL_LEN];
+    return erase_entry(normalize_key(key, key_buf, &value), &value, transaction);
+}
+
+/**
+ * @brief delete_entry的实现
+ * @param key 索引中存放的形式的key
+ * @param value 不为nullptr时只删除Rid相同的键值对
+ * @param transaction 事务指针
+ */
+bool IxIndexHandle::erase_entry(const char *key, const Rid *value, Transaction *transaction) {
+    // 乐观删除：只对叶子结点加写latch，叶子结点删除后不会下溢且第一个key不变时直接删除
+    {
+        IxWriteNode leaf = find_leaf_page<WritePageGuard>(key, Operation::DELETE, transaction).first;
+        int pos = leaf.lower_bound(key);
+        if (pos == leaf.get_size() || leaf.compare_key(pos, key) != 0 ||
+            (value != nullptr && *leaf.get_rid(pos) != *value)) {
+            return false;
+        }
+        if (is_safe(&leaf, key, Operation::DELETE)) {
+            leaf.erase_pair(pos);
+            return true;
+        }
+    }
+
+    // 可能需要合并或重分配结点，重新自顶向下获取路径上的写latch
+    Transaction local_txn(INVALID_TXN_ID);
+    if (transaction == nullptr) {
+        transaction = &local_txn;
     }
-    buffer_pool_manager_->unpin_page(leaf_page->get_page_id(), flag);
+    bool flag;
+    while (true) {
+        try {
+            IxNodeHandle leaf = find_leaf_page_exclusive(key, Operation::DELETE, transaction);
+            // 叶子结点安全时父结点的latch已经释放，删除后也不需要合并、重分配或更新父结点
+            bool leaf_is_safe = is_safe(&leaf, key, Operation::DELETE);
+            int pos = leaf.lower_bound(key);
+            flag = pos < leaf.get_size() && leaf.compare_key(pos, key) == 0 &&
+                   (value == nullptr || *leaf.get_rid(pos) == *value);
+            IxWriteNode neighbor;
+            IxWriteNode next_leaf;
+            if (flag && !leaf_is_safe && !latch_leaf_siblings(&leaf, &neighbor, &next_leaf)) {
+                neighbor.drop();
+                release_latched_pages(transaction);
+                std::this_thread::yield();
+                continue;
+            }
+            if (flag) {
+                leaf.erase_pair(pos);
+            }
+            if (flag && !leaf_is_safe) {
+                coalesce_or_redistribute(&leaf, transaction, &next_leaf);
+            }
+            next_leaf.drop();
+            neighbor.drop();
+            release_latched_pages(transaction);
+            break;
+        } catch (...) {
+            release_latched_pages(transaction);
+            throw;
+        }
+    }
+    free_deleted_pages(transaction);
     return flag;
 }
 
@@ -446,13 +1074,13 @@ bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
  *
  * @param node 执行完删除操作的结点
  * @param transaction 事务指针
- * @param root_is_latched 传出参数：根节点是否上锁，用于并发操作
+ * @param next_leaf node为叶子结点时，与兄弟结点合并后被删除的叶子的后继叶子，由erase_entry事先获取（见latch_leaf_siblings）
  * @return 是否需要删除结点
  * @note User needs to first find the sibling of input page.
  * If sibling's size + input page's size >= 2 * page's minsize, then redistribute.
  * Otherwise, merge(Coalesce).
  */
-bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction, bool *root_is_latched) 
+bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction, IxWriteNode *next_leaf) 
 {
     // Todo:
     // 1. 判断node结点是否为根节点
@@ -468,57 +1096,66 @@ bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *tr
     if(node->is_root_page()) 
     {
         // 如果是根节点，调用调整根节点的函数，并返回调整后的根节点是否需要删除
-        return adjust_root(node);
+        return adjust_root(node, transaction);
     }
 
-    // 如果节点的键值对数量大于等于最小节点大小，则无需合并或重分配，直接返回false
-    if (node->get_size() >= node->get_min_size()) {
-        // 保持父节点的一致性
+    // 叶子结点的第一个key可能被删除，先保持父节点的一致性（之后的重分配与合并不会再改变它的第一个key）；
+    // 内部结点删除的不是第一个键值对，无需更新
+    if (node->is_leaf_page() && node->get_size() > 0) {
         maintain_parent(node);
+    }
+
+    // 如果节点的键值对数量大于等于最小节点大小，则无需合并或重分配，直接返回false
+    if (!node->is_underflow()) {
         return false;  // 没有需要进行的合并或重分配操作
     } 
 
-    // 获取父节点
-    IxNodeHandle* parent = fetch_node(node->get_parent_page_no());
+    // 获取父节点，父节点和兄弟节点离开作用域时自动unpin
+    IxWriteNode parent = fetch_node_write(node->get_parent_page_no());
+    if (parent.get_size() < 2) {
+        // 压缩格式的结点不能合并时允许下溢，父结点可能只剩一个孩子
+        return false;
+    }
     
     // 在父节点中找到当前节点的位置索引
-    int index = parent->find_child(node);
+    int index = parent.find_child(node);
 
     // 根据索引确定兄弟节点（优先选择前驱节点）
-    IxNodeHandle *neighbor;
+    IxWriteNode neighbor;
     if (index > 0) 
     {
         // 如果当前节点不是父节点的第一个子节点，选择前驱节点作为兄弟节点
-        neighbor = fetch_node(parent->get_rid(index - 1)->page_no);
+        neighbor = fetch_node_write(parent.get_rid(index - 1)->page_no);
     } 
     else 
     {
         // 如果当前节点是父节点的第一个子节点，选择后继节点作为兄弟节点
-        neighbor = fetch_node(parent->get_rid(index + 1)->page_no);
+        neighbor = fetch_node_write(parent.get_rid(index + 1)->page_no);
     }
 
+    // 压缩格式的结点在两个结点能放进一个页面时合并，否则保持不变：两个结点合计超过一个页面时平均已经超过半满，
+    // 而移动一个键值对可能使接收方的公共前缀变短，不一定放得下
+    if (node->is_compact()) {
+        IxNodeHandle *left = (index == 0) ? node : &neighbor;
+        IxNodeHandle *right = (index == 0) ? &neighbor : node;
+        if (!left->can_merge(*right)) {
+            return false;
+        }
+    }
     // 如果当前节点和兄弟节点的键值对数之和足够支撑两个节点（>= NodeMinSize * 2），则进行键值对重分配
-    if(node->get_size() + neighbor->get_size() >= node->get_min_size() * 2) 
+    else if(node->get_size() + neighbor.get_size() >= node->get_min_size() * 2) 
     {
         // 调用Redistribute函数执行键值对的重新分配
-        redistribute(neighbor, node, parent, index);
-        
-        // 解锁父节点和兄弟节点
-        buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
-        buffer_pool_manager_->unpin_page(neighbor->get_page_id(), true);
+        redistribute(&neighbor, node, &parent, index);
         return false;  // 重分配完成，不需要继续合并操作
     } 
 
     // 如果不能重分配，则进行节点合并
-    IxNodeHandle *neighbor_node = neighbor;
-    IxNodeHandle *parent_node = parent;
+    IxNodeHandle *neighbor_node = &neighbor;
+    IxNodeHandle *parent_node = &parent;
     
     // 调用Coalesce函数将当前节点与兄弟节点合并
-    coalesce(&neighbor_node, &node, &parent_node, index, transaction, root_is_latched);
-
-    // 解锁父节点和兄弟节点
-    buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
-    buffer_pool_manager_->unpin_page(neighbor->get_page_id(), true);
+    coalesce(&neighbor_node, &node, &parent_node, index, transaction, next_leaf);
 
     return true;  // 合并完成，返回true
 }
@@ -526,10 +1163,11 @@ bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *tr
 /**
  * @brief 用于当根结点被删除了一个键值对之后的处理
  * @param old_root_node 原根节点
+ * @param transaction 事务指针
  * @return bool 根结点是否需要被删除
  * @note size of root page can be less than min size and this method is only called within coalesce_or_redistribute()
  */
-bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node) 
+bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node, Transaction *transaction) 
 {
     // Todo:
     // 1. 如果old_root_node是内部结点，并且大小为1，则直接把它的孩子更新成新的根结点
@@ -545,11 +1183,10 @@ bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node)
     if(!old_root_node->is_leaf_page() && old_root_node->get_size() == 1)  // 内部结点,大小为1,直接把它的孩子更新成
     {
         file_hdr_->root_page_ = old_root_node->remove_and_return_only_child();
-        IxNodeHandle* new_root = fetch_node(file_hdr_->root_page_);
-        new_root->set_parent_page_no(IX_NO_PAGE);
-        // file_hdr_->root_page_ = new_root->get_page_no();
-        buffer_pool_manager_->unpin_page(new_root->get_page_id(), true);
-        release_node_handle(*old_root_node); //更新file_hdr_->num_pages
+        IxWriteNode new_root = fetch_node_write(file_hdr_->root_page_);
+        new_root.set_parent_page_no(IX_NO_PAGE);
+        new_root.drop();
+        release_node_handle(*old_root_node, transaction); //更新file_hdr_->num_pages
         return true;
     }
     
@@ -587,7 +1224,7 @@ void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node
         neighbor_node->erase_pair(0);
         
         // 更新当前节点(child)中键值对的父节点信息
-        maintain_child(node, node->get_size());
+        maintain_child(node, node->get_size() - 1);
         
         // 更新前驱节点的父节点信息
         maintain_parent(neighbor_node);
@@ -621,11 +1258,12 @@ void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node
  * @param node input from method coalesceOrRedistribute() (node结点是需要被删除的)
  * @param parent parent page of input "node"
  * @param index node在parent中的rid_idx
+ * @param next_leaf 合并叶子结点时被删除的右结点的后继叶子，已持有写latch
  * @return true means parent node should be deleted, false means no deletion happend
  * @note Assume that *neighbor_node is the left sibling of *node (neighbor -> node)
  */
 bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, IxNodeHandle **parent, int index,
-                             Transaction *transaction, bool *root_is_latched) {
+                             Transaction *transaction, IxWriteNode *next_leaf) {
     // Todo:
     // 1. 用index判断neighbor_node是否为node的前驱结点，若不是则交换两个结点，让neighbor_node作为左结点，node作为右结点
     // 2. 把node结点的键值对移动到neighbor_node中，并更新node结点孩子结点的父节点信息（调用maintain_child函数）
@@ -647,7 +1285,7 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
     //    插入位置是neighbor_node的末尾，保持键值对顺序
     int pos = (*neighbor_node)->get_size(); // 获取neighbor_node的当前键值对数
     int num = (*node)->get_size(); // 获取node的当前键值对数
-    (*neighbor_node)->insert_pairs(pos, (*node)->get_key(0), (*node)->get_rid(0), num); // 将node的键值对添加到neighbor_node中
+    (*neighbor_node)->insert_pairs_from(pos, **node, 0, num); // 将node的键值对添加到neighbor_node中
 
     // 4. 更新节点中的孩子结点的父节点信息
     //    对node中的每一个键值对，更新其对应孩子结点的父节点信息
@@ -657,17 +1295,17 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
 
     // 5. 如果node是叶子结点，需要更新叶子结点之间的指针（prev_leaf, next_leaf）
     if ((*node)->is_leaf_page()) {
-        this->erase_leaf(*node); // 更新node结点的叶子结点指针
+        this->erase_leaf(*node, *neighbor_node, next_leaf); // 更新node结点的叶子结点指针
     }
 
     // 6. 释放node结点的资源
-    release_node_handle(**node);  // 更新file_hdr_.num_pages，释放node结点
+    release_node_handle(**node, transaction);  // 更新file_hdr_.num_pages，释放node结点
 
     // 7. 删除父节点中的node结点的信息
     (*parent)->erase_pair((*parent)->find_child(*node)); // 从父节点中移除指向node的键值对
 
     // 8. 调用coalesce_or_redistribute函数来处理父节点的合并或重分配操作
-    return coalesce_or_redistribute(*parent); // 如果父节点需要合并或重分配，返回true
+    return coalesce_or_redistribute(*parent, transaction); // 如果父节点需要合并或重分配，返回true
 }
 
 /**
@@ -681,13 +1319,45 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
  */
 Rid IxIndexHandle::get_rid(const Iid &iid) const 
 {
-    IxNodeHandle *node = fetch_node(iid.page_no); // 获取对应的结点
-    if (iid.slot_no >= node->get_size()) // 如果slot_no超出了结点的范围
+    IxNodeSnapshot node(file_hdr_);
+    read_node_optimistic(iid.page_no, &node); // 获取对应的结点
+    if (iid.slot_no >= node.get_size()) // 如果slot_no超出了结点的范围
     {
         throw IndexEntryNotFoundError(); // 抛出异常
     }
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
-    return *node->get_rid(iid.slot_no);
+    return *node.get_rid(iid.slot_no);
+}
+
+/**
+ * @brief 将iid对应的key按字段原样拼接的形式（即插入时上层传入的形式）写入dest，用于只读索引的扫描
+ *
+ * @param iid
+ * @param dest 至少user_key_len字节，非唯一索引拼接的Rid不写入
+ */
+void IxIndexHandle::get_key(const Iid &iid, char *dest) const {
+    IxNodeSnapshot node(file_hdr_);
+    read_node_optimistic(iid.page_no, &node);
+    if (iid.slot_no >= node.get_size()) {
+        throw IndexEntryNotFoundError();
+    }
+    copy_user_key(node, iid.slot_no, dest);
+}
+
+/**
+ * @brief 将node中第key_idx个key转换为按字段原样拼接的形式写入dest，get_key的实现
+ *
+ * @param dest 至少user_key_len字节，非唯一索引拼接的Rid不写入
+ */
+void IxIndexHandle::copy_user_key(const IxNodeHandle &node, int key_idx, char *dest) const {
+    char key_buf[IX_MAX_COL_LEN];
+    node.copy_key(key_idx, key_buf);
+    if (!file_hdr_->normalized_keys_) {
+        memcpy(dest, key_buf, file_hdr_->user_key_len());
+        return;
+    }
+    char raw_key[IX_MAX_COL_LEN];
+    ix_denormalize_key(key_buf, raw_key, file_hdr_->col_types_, file_hdr_->col_lens_);
+    memcpy(dest, raw_key, file_hdr_->user_key_len());
 }
 
 /**
@@ -699,16 +1369,22 @@ Rid IxIndexHandle::get_rid(const Iid &iid) const
  * 可用*(int *)key转换回去
  */
 Iid IxIndexHandle::lower_bound(const char *key) {
-    std::scoped_lock lock{root_latch_}; // 上锁 
-    IxNodeHandle *node = find_leaf_page(key, Operation::FIND, nullptr, true).first; // 查找叶子结点
-    int key_idx = node->lower_bound(key); // 查找key的下界
+    char key_buf[IX_MAX_COL_LEN];
+    key = normalize_key(key, key_buf);
+    IxNodeSnapshot node(file_hdr_);
+    find_leaf_optimistic(key, &node); // 查找叶子结点
+    int key_idx = node.lower_bound(key); // 查找key的下界
+    bool at_end = key_idx == node.get_size();
+    page_id_t page_no = node.get_page_no();
+    page_id_t next_leaf = node.get_next_leaf();
     Iid iid;
-    if (key_idx == node->get_size()) { // 如果key_idx等于结点的大小
+    if (at_end && page_no == file_hdr_->last_leaf_) { // 如果key大于最后一个叶子中的所有key
         iid = leaf_end(); // 返回叶子的最后一个结点的后一个
+    } else if (at_end) { // key大于该叶子中的所有key，但可能小于下一个叶子的第一个key
+        iid = {.page_no = next_leaf, .slot_no = 0};
     } else {
-        iid = {.page_no = node->get_page_no(), .slot_no = key_idx}; // 返回找到的索引槽
+        iid = {.page_no = page_no, .slot_no = key_idx}; // 返回找到的索引槽
     }
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false); // 释放叶子结点
     return iid; // 返回iid
 }
 
@@ -719,16 +1395,22 @@ Iid IxIndexHandle::lower_bound(const char *key) {
  * @return Iid
  */
 Iid IxIndexHandle::upper_bound(const char *key) {
-    std::scoped_lock lock{root_latch_};
-    IxNodeHandle *node = find_leaf_page(key, Operation::FIND, nullptr, true).first; // 查找叶子结点
-    int key_idx = node->upper_bound(key); // 查找key的上界
+    char key_buf[IX_MAX_COL_LEN];
+    key = normalize_key(key, key_buf, nullptr, true);
+    IxNodeSnapshot node(file_hdr_);
+    find_leaf_optimistic(key, &node); // 查找叶子结点
+    int key_idx = node.upper_bound(key); // 查找key的上界
+    bool at_end = key_idx == node.get_size();
+    page_id_t page_no = node.get_page_no();
+    page_id_t next_leaf = node.get_next_leaf();
     Iid iid; 
-    if (key_idx == node->get_size()) { // 如果key_idx等于结点的大小
+    if (at_end && page_no == file_hdr_->last_leaf_) { // 如果key大于等于最后一个叶子中的所有key
         iid = leaf_end(); // 返回叶子的最后一个结点的后一个
+    } else if (at_end) { // 下一个叶子的第一个key一定大于key
+        iid = {.page_no = next_leaf, .slot_no = 0};
     } else { 
-        iid = {.page_no = node->get_page_no(), .slot_no = key_idx}; // 返回找到的索引槽
+        iid = {.page_no = page_no, .slot_no = key_idx}; // 返回找到的索引槽
     }
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);
     return iid;
 }
 
@@ -739,9 +1421,9 @@ Iid IxIndexHandle::upper_bound(const char *key) {
  * @return Iid
  */
 Iid IxIndexHandle::leaf_end() const {
-    IxNodeHandle *node = fetch_node(file_hdr_->last_leaf_); // 获取最后一个叶子结点
-    Iid iid = {.page_no = file_hdr_->last_leaf_, .slot_no = node->get_size()}; // 返回最后一个叶子结点的后一个
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
+    IxNodeSnapshot node(file_hdr_);
+    read_node_optimistic(file_hdr_->last_leaf_, &node); // 获取最后一个叶子结点
+    Iid iid = {.page_no = file_hdr_->last_leaf_, .slot_no = node.get_size()}; // 返回最后一个叶子结点的后一个
     return iid;
 }
 
@@ -761,7 +1443,8 @@ Iid IxIndexHandle::leaf_begin() const {
  *
  * @param page_no
  * @return IxNodeHandle*
- * @note pin the page, remember to unpin it outside!
+ * @note pin the page, remember to unpin it outside! 仅供测试代码遍历B+树使用，
+ * 索引内部统一使用fetch_node_read/fetch_node_write
  */
 IxNodeHandle *IxIndexHandle::fetch_node(int page_no) const {
     Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no}); // 获取指定结点
@@ -770,48 +1453,239 @@ IxNodeHandle *IxIndexHandle::fetch_node(int page_no) const {
     return node; // 返回结点
 }
 
+/**
+ * @brief 以只读方式获取一个指定结点
+ *
+ * @param page_no
+ * @return IxReadNode 持有结点的读latch，离开作用域时自动释放latch并unpin
+ */
+IxReadNode IxIndexHandle::fetch_node_read(int page_no) const {
+    ReadPageGuard guard = buffer_pool_manager_->fetch_page_read(PageId{fd_, page_no});
+    if (!guard.is_valid()) {
+        throw InternalError("IxIndexHandle::fetch_node_read Error: no free frame in buffer pool");
+    }
+    return IxReadNode(file_hdr_, std::move(guard));
+}
+
+/**
+ * @brief pin住指定结点所在的页面，不获取latch，用于乐观读取
+ *
+ * @param page_no
+ * @return Page* 调用者负责unpin_page
+ */
+Page *IxIndexHandle::pin_page(page_id_t page_no) const {
+    Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no});
+    if (page == nullptr) {
+        throw InternalError("IxIndexHandle::pin_page Error: no free frame in buffer pool");
+    }
+    return page;
+}
+
+/**
+ * @brief 不加latch读取一个指定结点，得到其一致的副本
+ *
+ * @param page_no
+ * @param node 返回结点的副本
+ * @note 复制期间结点被修改时重新复制；只保证单个结点的一致性，与latch crabbing之外的fetch_node_read相同
+ */
+void IxIndexHandle::read_node_optimistic(page_id_t page_no, IxNodeSnapshot *node) const {
+    while (!try_read_node(page_no, node)) {
+    }
+}
+
+/**
+ * @brief 不加latch复制一个指定结点，并记录复制时结点所在的帧和版本号，之后可用IxNodeSnapshot::is_unchanged
+ * 检查结点是否被修改
+ *
+ * @param page_no
+ * @param node 返回结点的副本
+ * @return 副本是否一致，为false时复制期间结点被修改
+ * @note 结点在缓冲池中且没有正被修改时，通过BufferPoolManager::probe_page直接读取所在的帧，不pin页面、
+ * 不获取分区latch；否则pin住页面（必要时读入缓冲池）再复制。帧被换成其他页面时版本号也会改变，
+ * 因此两种情况下之后的验证都只需比较帧的版本号
+ */
+bool IxIndexHandle::try_read_node(page_id_t page_no, IxNodeSnapshot *node) const {
+    PageId page_id = {.fd = fd_, .page_no = page_no};
+    const Page *frame = buffer_pool_manager_->probe_page(page_id);
+    uint64_t version;
+    if (frame != nullptr && frame->try_read_version(&version)) {
+        frame->copy_to(&node->snapshot_);
+        if (frame->validate_version(version) && node->snapshot_.get_page_id() == page_id) {
+            node->frame_ = frame;
+            node->version_ = version;
+            return true;
+        }
+    }
+    Page *page = pin_page(page_no);
+    version = page->read_version();
+    page->copy_to(&node->snapshot_);
+    bool valid = page->validate_version(version);
+    unpin_page(page);
+    node->frame_ = page;
+    node->version_ = version;
+    return valid;
+}
+
+/**
+ * @brief 沿叶子链表把leaf的下一个（next为false时为前一个）叶子读入leaf，用于IxScan
+ *
+ * @param leaf 乐观读取得到的叶子结点副本，返回相邻叶子的副本
+ * @param next 读取next_leaf还是prev_leaf
+ * @return 是否读到了一致的相邻叶子，为false时leaf的内容不确定，调用者需要按key重新查找
+ * @note 读到相邻叶子之后原来的叶子仍未被修改，说明它确实是原来叶子当时的相邻叶子：相邻叶子被合并时，
+ * erase_leaf会修改原来叶子的指针
+ */
+bool IxIndexHandle::read_sibling_leaf(IxNodeSnapshot *leaf, bool next) const {
+    const Page *frame = leaf->frame_;
+    uint64_t version = leaf->version_;
+    page_id_t sibling = next ? leaf->get_next_leaf() : leaf->get_prev_leaf();
+    bool sibling_valid;
+    try {
+        sibling_valid = try_read_node(sibling, leaf);
+    } catch (...) {
+        // 相邻叶子可能已被删除，页面已释放，此时原来叶子的版本号一定已经改变
+        if (!frame->validate_version(version)) {
+            return false;
+        }
+        throw;
+    }
+    return sibling_valid && frame->validate_version(version);
+}
+
+/**
+ * @brief 获取一个指定结点用于修改
+ *
+ * @param page_no
+ * @return IxWriteNode 持有结点的写latch，离开作用域时自动释放latch，unpin并标记为脏页
+ */
+IxWriteNode IxIndexHandle::fetch_node_write(int page_no) const {
+    WritePageGuard guard = buffer_pool_manager_->fetch_page_write(PageId{fd_, page_no});
+    if (!guard.is_valid()) {
+        throw InternalError("IxIndexHandle::fetch_node_write Error: no free frame in buffer pool");
+    }
+    return IxWriteNode(file_hdr_, std::move(guard));
+}
+
+/**
+ * @brief fetch_node_write的不等待版本，用于获取不在已持有结点之下的结点（叶子链表中的兄弟结点）
+ *
+ * @param page_no
+ * @param[out] node 获取成功时传出持有写latch的结点
+ * @return 结点的latch被其他线程持有时返回false
+ * @note 除叶子链表中的兄弟结点外，所有写latch都在持有父结点latch时获取，等待关系只会自顶向下，不会死锁。
+ * 兄弟结点可能被其他线程在自底向上的结构修改中持有，并等待本线程持有的结点，因此不能阻塞等待
+ */
+bool IxIndexHandle::try_fetch_node_write(int page_no, IxWriteNode *node) const {
+    Page *page = pin_page(page_no);
+    if (!page->try_wlatch()) {
+        unpin_page(page);
+        return false;
+    }
+    *node = IxWriteNode(file_hdr_, WritePageGuard(buffer_pool_manager_, page));
+    return true;
+}
+
+/**
+ * @brief 将上层传入的key转换为索引中存放的形式
+ *
+ * @param key 按字段原样拼接的key
+ * @param buf 至少IX_MAX_COL_LEN字节的缓冲区，索引使用编码后的key或非唯一索引拼接Rid时存放结果
+ * @param rid 非唯一索引拼接在key之后的Rid，为nullptr时拼接最小（max_rid为false）或最大（max_rid为true）的Rid，
+ * 得到的key是该key所有索引项的下界或上界
+ * @return 索引中存放的key，不需要转换时直接返回key
+ */
+const char *IxIndexHandle::normalize_key(const char *key, char *buf, const Rid *rid, bool max_rid) const {
+    if (!file_hdr_->unique_) {
+        char full_key[IX_MAX_COL_LEN];
+        int key_len = file_hdr_->user_key_len();
+        memcpy(full_key, key, key_len);
+        ix_encode_rid(rid, max_rid, full_key + key_len);
+        if (file_hdr_->normalized_keys_) {
+            ix_normalize_key(full_key, buf, file_hdr_->col_types_, file_hdr_->col_lens_);
+        } else {
+            memcpy(buf, full_key, file_hdr_->col_tot_len_);
+        }
+        return buf;
+    }
+    if (!file_hdr_->normalized_keys_) {
+        return key;
+    }
+    ix_normalize_key(key, buf, file_hdr_->col_types_, file_hdr_->col_lens_);
+    return buf;
+}
+
 /**
  * @brief 创建一个新结点
  *
- * @return IxNodeHandle*
- * @note pin the page, remember to unpin it outside!
+ * @return IxWriteNode 离开作用域时自动unpin并标记为脏页
  * 注意：对于Index的处理是，删除某个页面后，认为该被删除的页面是free_page
- * 而first_free_page实际上就是最新被删除的页面，初始为IX_NO_PAGE
- * 在最开始插入时，一直是create node，那么first_page_no一直没变，一直是IX_NO_PAGE
+ * 打开索引后空闲页面由disk_manager管理，new_page会优先复用它们；空闲页面串成链表，每次变化都写入磁盘，
+ * 文件头中的first_free_page_no指向链表头，初始为IX_NO_PAGE
  * 与Record的处理不同，Record将未插入满的记录页认为是free_page
  */
-IxNodeHandle *IxIndexHandle::create_node() {
-    IxNodeHandle *node; // 创建一个新结点
-    file_hdr_->num_pages_++;    // 更新file_hdr_.num_pages
-
+IxWriteNode IxIndexHandle::create_node() {
     PageId new_page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};  // 创建一个新的page_id
-    // 从3开始分配page_no，第一次分配之后，new_page_id.page_no=3，file_hdr_.num_pages=4
-    Page *page = buffer_pool_manager_->new_page(&new_page_id); // 从buffer pool manager中分配一个新的页面
-    node = new IxNodeHandle(file_hdr_, page); // 创建一个新的结点
-    return node;
+    // 没有空闲页面时从3开始分配page_no，第一次分配之后，new_page_id.page_no=3，file_hdr_.num_pages=4
+    WritePageGuard guard = buffer_pool_manager_->new_page_guarded(&new_page_id); // 从buffer pool manager中分配一个新的页面
+    if (!guard.is_valid()) {
+        throw InternalError("IxIndexHandle::create_node Error: no free frame in buffer pool");
+    }
+    // num_pages记录文件中曾分配过的页面数，复用空闲页面时不变。不同子树的结构修改可以并行，需要加锁
+    std::lock_guard<std::mutex> lock(num_pages_latch_);
+    file_hdr_->num_pages_ = std::max(file_hdr_->num_pages_, new_page_id.page_no + 1);
+    return IxWriteNode(file_hdr_, std::move(guard)); // 创建一个新的结点
+}
+
+/**
+ * @brief 删除可能使叶子结点下溢时，在修改之前获取合并或重分配需要的兄弟结点的latch
+ *
+ * @param leaf 持有写latch的叶子结点，不安全时其父结点的latch也已持有
+ * @param[out] neighbor coalesce_or_redistribute将选取的兄弟结点，在父结点之下，可以阻塞获取
+ * @param[out] next_leaf 两者合并时被删除的右结点的后继叶子，只尝试获取（见try_fetch_node_write）
+ * @return 获取next_leaf失败时返回false，调用者应释放所有latch后重新查找
+ */
+bool IxIndexHandle::latch_leaf_siblings(IxNodeHandle *leaf, IxWriteNode *neighbor, IxWriteNode *next_leaf) {
+    if (leaf->is_root_page() || (!leaf->is_compact() && leaf->get_size() > leaf->get_min_size())) {
+        return true;  // 删除后不会下溢，只需要更新父结点中的key
+    }
+    IxWriteNode parent = fetch_node_write(leaf->get_parent_page_no());
+    if (parent.get_size() < 2) {
+        return true;
+    }
+    int index = parent.find_child(leaf);
+    *neighbor = fetch_node_write(parent.value_at(index > 0 ? index - 1 : index + 1));
+    IxNodeHandle *right = (index > 0) ? leaf : neighbor;
+    return try_fetch_node_write(right->get_next_leaf(), next_leaf);
 }
 
 /**
  * @brief 从node开始更新其父节点的第一个key，一直向上更新直到根节点
  *
  * @param node
+ * @note 压缩格式的索引中父结点的key是分隔key，只要求不大于孩子结点的所有key、大于左兄弟的所有key。
+ * 删除第一个key不会破坏这一点，并且不重分配键值对，因此不需要更新；更新为完整的key也可能使父结点放不下
  */
 void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
+    if (file_hdr_->compressed_keys_) {
+        return;
+    }
     IxNodeHandle *curr = node; // 从当前结点开始
+    IxWriteNode curr_guard;    // 持有向上遍历时的当前结点，被替换时自动释放
     while (curr->get_parent_page_no() != IX_NO_PAGE) { // 如果当前结点的父节点不是根节点
         // Load its parent
-        IxNodeHandle *parent = fetch_node(curr->get_parent_page_no());  // 获取父节点
-        int rank = parent->find_child(curr);                     // 在父节点中找到当前结点的位置
-        char *parent_key = parent->get_key(rank);               // 获取父节点的键值
+        IxWriteNode parent = fetch_node_write(curr->get_parent_page_no());  // 获取父节点
+        int rank = parent.find_child(curr);                     // 在父节点中找到当前结点的位置
+        char *parent_key = parent.get_key(rank);               // 获取父节点的键值
         char *child_first_key = curr->get_key(0);              // 获取当前结点的第一个键值
         if (memcmp(parent_key, child_first_key, file_hdr_->col_tot_len_) == 0) { // 如果父节点的键值等于当前结点的第一个键值
-            assert(buffer_pool_manager_->unpin_page(parent->get_page_id(), true)); // 释放父节点
             break;
         }
         memcpy(parent_key, child_first_key, file_hdr_->col_tot_len_);  // 修改了parent node
-        curr = parent; // 更新当前结点
-
-        assert(buffer_pool_manager_->unpin_page(parent->get_page_id(), true)); // 释放父节点
+        if (rank != 0) {  // parent的第一个key没有改变，无需继续向上更新
+            break;
+        }
+        curr_guard = std::move(parent);
+        curr = &curr_guard; // 更新当前结点
     }
 }
 
@@ -819,26 +1693,56 @@ void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
  * @brief 要删除leaf之前调用此函数，更新leaf前驱结点的next指针和后继结点的prev指针
  *
  * @param leaf 要删除的leaf
+ * @param prev leaf的前驱结点，即合并leaf的左兄弟，已持有写latch
+ * @param next leaf的后继结点，已持有写latch，更新后释放：之后向上合并父结点时不能持有叶子链表中的兄弟结点
  */
-void IxIndexHandle::erase_leaf(IxNodeHandle *leaf) {
+void IxIndexHandle::erase_leaf(IxNodeHandle *leaf, IxNodeHandle *prev, IxWriteNode *next) {
     assert(leaf->is_leaf_page()); // 确保是叶子结点
+    assert(prev->get_page_no() == leaf->get_prev_leaf() && next->get_page_no() == leaf->get_next_leaf());
 
-    IxNodeHandle *prev = fetch_node(leaf->get_prev_leaf()); // 获取前一个叶子结点
     prev->set_next_leaf(leaf->get_next_leaf()); // 注意此处是SetNextLeaf()
-    buffer_pool_manager_->unpin_page(prev->get_page_id(), true); // 释放前一个叶子结点
-
-    IxNodeHandle *next = fetch_node(leaf->get_next_leaf()); // 获取后一个叶子结点
     next->set_prev_leaf(leaf->get_prev_leaf());  // 注意此处是SetPrevLeaf()
-    buffer_pool_manager_->unpin_page(next->get_page_id(), true); // 释放后一个叶子结点
+    next->drop();
 }
 
 /**
- * @brief 删除node时，更新file_hdr_.num_pages
+ * @brief 删除node时，将其页面记录在transaction的index_deleted_page_set中，待释放latch之后由delete_entry删除
  *
  * @param node
+ * @param transaction
+ * @note 额外pin一次页面，保证delete_entry删除之前页面不会被换出并被其他页面复用
  */
-void IxIndexHandle::release_node_handle(IxNodeHandle &node) {
-    file_hdr_->num_pages_--;
+void IxIndexHandle::release_node_handle(IxNodeHandle &node, Transaction *transaction) {
+    Page *page = buffer_pool_manager_->fetch_page(node.get_page_id());
+    if (page == nullptr) {
+        throw InternalError("IxIndexHandle::release_node_handle Error: no free frame in buffer pool");
+    }
+    transaction->append_index_deleted_page(page);
+}
+
+/**
+ * @brief 合并过程中被删除的结点此时只剩release_node_handle中的pin，将其页面交还给缓冲池和磁盘管理器复用
+ *
+ * @param transaction 记录了被删除结点的事务，为nullptr时只重试deferred_pages_
+ * @note 仍被其他线程（如乐观读取）pin住的页面无法删除，放入deferred_pages_，在之后的删除和关闭索引时重试，避免页面泄漏
+ */
+void IxIndexHandle::free_deleted_pages(Transaction *transaction) {
+    std::lock_guard<std::mutex> lock(deferred_pages_latch_);
+    std::vector<page_id_t> pages;
+    pages.swap(deferred_pages_);
+    if (transaction != nullptr) {
+        auto deleted_page_set = transaction->get_index_deleted_page_set();
+        for (Page *page : *deleted_page_set) {
+            buffer_pool_manager_->unpin_page(page->get_page_id(), false);
+            pages.push_back(page->get_page_id().page_no);
+        }
+        deleted_page_set->clear();
+    }
+    for (page_id_t page_no : pages) {
+        if (!buffer_pool_manager_->delete_page(PageId{fd_, page_no})) {
+            deferred_pages_.push_back(page_no);
+        }
+    }
 }
 
 /**
@@ -848,8 +1752,7 @@ void IxIndexHandle::maintain_child(IxNodeHandle *node, int child_idx) {
     if (!node->is_leaf_page()) { 
         //  Current node is inner node, load its child and set its parent to current node
         int child_page_no = node->value_at(child_idx); // 获取孩子结点的page_no
-        IxNodeHandle *child = fetch_node(child_page_no); // 获取孩子结点
-        child->set_parent_page_no(node->get_page_no()); // 设置孩子结点的父节点为当前结点
-        buffer_pool_manager_->unpin_page(child->get_page_id(), true); // 释放孩子结点
+        IxWriteNode child = fetch_node_write(child_page_no); // 获取孩子结点，离开作用域时自动释放
+        child.set_parent_page_no(node->get_page_no()); // 设置孩子结点的父节点为当前结点
     }
 }
\ No newline at end of file
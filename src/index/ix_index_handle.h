@@ -10,13 +10,14 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <algorithm>
+#include <shared_mutex>
+
 #include "ix_defs.h"
 #include "transaction/transaction.h"
 
 enum class Operation { FIND = 0, INSERT, DELETE };  // 三种操作：查找、插入、删除
 
-static const bool binary_search = false;
-
 inline int ix_compare(const char *a, const char *b, ColType type, int col_len) {
     switch (type) {
         case TYPE_INT: {
@@ -47,10 +48,146 @@ inline int ix_compare(const char* a, const char* b, const std::vector<ColType>&
     return 0;
 }
 
+/**
+ * @description: 将索引key编码为可以直接按字节比较的形式，编码前后长度不变。
+ * INT翻转符号位后按大端存放；FLOAT非负数翻转符号位、负数按位取反后按大端存放（-0.0编码为0.0）；
+ * STRING按定长补齐存放，原样复制
+ */
+inline void ix_normalize_key(const char *src, char *dest, const std::vector<ColType>& col_types,
+                             const std::vector<int>& col_lens) {
+    int offset = 0;
+    for (size_t i = 0; i < col_types.size(); ++i) {
+        if (col_types[i] == TYPE_INT || col_types[i] == TYPE_FLOAT) {
+            uint32_t bits;
+            memcpy(&bits, src + offset, sizeof(uint32_t));
+            if (col_types[i] == TYPE_INT) {
+                bits ^= 0x80000000u;
+            } else {
+                bits = (bits == 0x80000000u) ? 0 : bits;
+                bits = (bits & 0x80000000u) ? ~bits : bits ^ 0x80000000u;
+            }
+            unsigned char *out = reinterpret_cast<unsigned char *>(dest + offset);
+            out[0] = bits >> 24;
+            out[1] = bits >> 16;
+            out[2] = bits >> 8;
+            out[3] = bits;
+        } else {
+            memcpy(dest + offset, src + offset, col_lens[i]);
+        }
+        offset += col_lens[i];
+    }
+}
+
+/**
+ * @description: ix_normalize_key的逆过程
+ */
+inline void ix_denormalize_key(const char *src, char *dest, const std::vector<ColType>& col_types,
+                               const std::vector<int>& col_lens) {
+    int offset = 0;
+    for (size_t i = 0; i < col_types.size(); ++i) {
+        if (col_types[i] == TYPE_INT || col_types[i] == TYPE_FLOAT) {
+            const unsigned char *in = reinterpret_cast<const unsigned char *>(src + offset);
+            uint32_t bits = (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) | in[3];
+            if (col_types[i] == TYPE_INT) {
+                bits ^= 0x80000000u;
+            } else {
+                bits = (bits & 0x80000000u) ? bits ^ 0x80000000u : ~bits;
+            }
+            memcpy(dest + offset, &bits, sizeof(uint32_t));
+        } else {
+            memcpy(dest + offset, src + offset, col_lens[i]);
+        }
+        offset += col_lens[i];
+    }
+}
+
+/**
+ * @description: 非唯一索引拼接在key之后的Rid，page_no和slot_no按大端存放，按字节比较的顺序与先比较page_no再比较slot_no相同
+ * @param {Rid*} rid 为nullptr时写入最小（is_max为false）或最大（is_max为true）的编码，用于查找某个key的所有索引项
+ */
+inline void ix_encode_rid(const Rid *rid, bool is_max, char *dest) {
+    if (rid == nullptr) {
+        memset(dest, is_max ? 0xff : 0, sizeof(Rid));
+        return;
+    }
+    unsigned char *out = reinterpret_cast<unsigned char *>(dest);
+    uint32_t fields[2] = {static_cast<uint32_t>(rid->page_no), static_cast<uint32_t>(rid->slot_no)};
+    for (uint32_t bits : fields) {
+        out[0] = bits >> 24;
+        out[1] = bits >> 16;
+        out[2] = bits >> 8;
+        out[3] = bits;
+        out += sizeof(uint32_t);
+    }
+}
+
+/**
+ * @description: 比较两个编码后的key，结果与memcmp相同。每次读取8个字节，不相等时转为大端顺序再作为整数比较
+ */
+inline int ix_compare_normalized(const char *a, const char *b, int len) {
+    int offset = 0;
+    for (; offset + 8 <= len; offset += 8) {
+        uint64_t wa, wb;
+        memcpy(&wa, a + offset, sizeof(uint64_t));
+        memcpy(&wb, b + offset, sizeof(uint64_t));
+        if (wa != wb) {
+            wa = __builtin_bswap64(wa);
+            wb = __builtin_bswap64(wb);
+            return wa < wb ? -1 : 1;
+        }
+    }
+    return offset == len ? 0 : memcmp(a + offset, b + offset, len - offset);
+}
+
+/**
+ * @description: 比较索引中存放的两个key，按文件头选择编码后的比较或按字段比较
+ */
+inline int ix_compare(const char *a, const char *b, const IxFileHdr *file_hdr) {
+    if (file_hdr->normalized_keys_) {
+        return ix_compare_normalized(a, b, file_hdr->col_tot_len_);
+    }
+    return ix_compare(a, b, file_hdr->col_types_, file_hdr->col_lens_);
+}
+
+/**
+ * @description: key去掉末尾的0字节之后的长度。字符串按定长补0存放，去掉的部分在比较和解码时视为0
+ */
+inline int ix_trimmed_len(const char *key, int len) {
+    while (len > 0 && key[len - 1] == 0) {
+        len--;
+    }
+    return len;
+}
+
+/**
+ * @description: 两个key的最长公共前缀的长度，最多比较len个字节
+ */
+inline int ix_common_prefix_len(const char *a, const char *b, int len) {
+    int i = 0;
+    while (i < len && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * @description: 计算前缀截断的分隔key：right_first中比left_last多一个字节的最短前缀，其余字节补0。
+ * 结果大于left_last并且不大于right_first，只用于可以按字节比较的key
+ * @param {char*} left_last 左边结点的最后一个key，小于right_first
+ * @param {char*} right_first 右边结点的第一个key
+ * @param {char*} dest 至少len字节
+ */
+inline void ix_separator_key(const char *left_last, const char *right_first, char *dest, int len) {
+    int sep_len = std::min(ix_common_prefix_len(left_last, right_first, len) + 1, len);
+    memcpy(dest, right_first, sep_len);
+    memset(dest + sep_len, 0, len - sep_len);
+}
+
 /* 管理B+树中的每个节点 */
 class IxNodeHandle {
     friend class IxIndexHandle;
     friend class IxScan;
+    friend class IxBulkLoader;
 
    private:
     const IxFileHdr *file_hdr;      // 节点所在文件的头部信息
@@ -72,6 +209,9 @@ class IxNodeHandle {
 
     void set_size(int size) { page_hdr->num_key = size; }
 
+    /* 结点是否使用前缀压缩的变长格式，此时get_key不可用，通过copy_key/compare_key访问key */
+    bool is_compact() const { return file_hdr->compressed_keys_; }
+
     int get_max_size() { return file_hdr->btree_order_ + 1; }
 
     int get_min_size() { return get_max_size() / 2; }
@@ -101,13 +241,40 @@ class IxNodeHandle {
 
     void set_parent_page_no(page_id_t parent) { page_hdr->parent = parent; }
 
-    char *get_key(int key_idx) const { return keys + key_idx * file_hdr->col_tot_len_; }
+    char *get_key(int key_idx) const {
+        assert(!is_compact());
+        return keys + key_idx * file_hdr->col_tot_len_;
+    }
 
-    Rid *get_rid(int rid_idx) const { return &rids[rid_idx]; }
+    Rid *get_rid(int rid_idx) const { return is_compact() ? &get_slot(rid_idx)->rid : &rids[rid_idx]; }
 
     void set_key(int key_idx, const char *key) { memcpy(keys + key_idx * file_hdr->col_tot_len_, key, file_hdr->col_tot_len_); }
 
-    void set_rid(int rid_idx, const Rid &rid) { rids[rid_idx] = rid; }
+    void set_rid(int rid_idx, const Rid &rid) { *get_rid(rid_idx) = rid; }
+
+    void copy_key(int key_idx, char *dest) const;
+
+    int compare_key(int key_idx, const char *target) const;
+
+    void copy_pairs(int pos, int n, std::vector<char> *keys_out, std::vector<Rid> *rids_out) const;
+
+    void insert_pairs_from(int pos, const IxNodeHandle &src, int src_pos, int n);
+
+    int split_position() const;
+
+    bool is_underflow() const;
+
+    int used_bytes() const;
+
+    int max_entry_bytes() const { return sizeof(IxSlot) + file_hdr->col_tot_len_; }
+
+    bool can_insert(const char *key) const;
+
+    bool can_insert_any() const;
+
+    bool can_merge(const IxNodeHandle &right) const;
+
+    int search(const char *target, bool upper) const;
 
     int lower_bound(const char *target) const;
 
@@ -156,19 +323,96 @@ class IxNodeHandle {
         assert(rid_idx < page_hdr->num_key);
         return rid_idx;
     }
+
+   private:
+    // 压缩格式结点的各部分，见IxCompactHdr
+    IxCompactHdr *compact_hdr() const { return reinterpret_cast<IxCompactHdr *>(page->get_data() + sizeof(IxPageHdr)); }
+
+    char *compact_prefix() const { return page->get_data() + sizeof(IxPageHdr) + sizeof(IxCompactHdr); }
+
+    IxSlot *get_slot(int slot_idx) const {
+        return reinterpret_cast<IxSlot *>(page->get_data() + compact_slots_offset(compact_hdr()->prefix_len)) + slot_idx;
+    }
+
+    static int compact_slots_offset(int prefix_len) {
+        int offset = sizeof(IxPageHdr) + sizeof(IxCompactHdr) + prefix_len;
+        return (offset + alignof(IxSlot) - 1) / alignof(IxSlot) * alignof(IxSlot);
+    }
+
+    static int compact_size(int prefix_len, int num_key, int suffix_bytes) {
+        return compact_slots_offset(prefix_len) + num_key * static_cast<int>(sizeof(IxSlot)) + suffix_bytes;
+    }
+
+    int compact_suffix_bytes() const;
+
+    int compare_suffix(const IxSlot *slot, const char *rest, int rest_len) const;
+
+    int compact_search(const char *target, bool upper) const;
+
+    bool compact_insert_in_place(int pos, const char *key, const Rid &rid);
+
+    void compact_rebuild(const char *keys_in, const Rid *rids_in, int n);
+};
+
+/**
+ * 持有页面guard的结点句柄，离开作用域（或调用drop）时自动释放页面latch并unpin结点所在的页面
+ * IxReadNode持有读latch，只读访问结点；IxWriteNode持有写latch，用于修改结点，unpin时标记为脏页
+ */
+template <class PageGuard>
+class IxNodeGuard : public IxNodeHandle {
+   public:
+    IxNodeGuard() = default;
+
+    IxNodeGuard(const IxFileHdr *file_hdr_, PageGuard &&guard)
+        : IxNodeHandle(file_hdr_, guard.get_page()), guard_(std::move(guard)) {}
+
+    void drop() { guard_.drop(); }
+
+   private:
+    PageGuard guard_;
+};
+
+using IxReadNode = IxNodeGuard<ReadPageGuard>;
+using IxWriteNode = IxNodeGuard<WritePageGuard>;
+
+/**
+ * 乐观读取得到的结点副本：页面内容复制到snapshot_中，不持有latch和pin，只读访问。
+ * 由IxIndexHandle::find_leaf_optimistic/read_node_optimistic填充，内部指针指向snapshot_，不能复制
+ */
+class IxNodeSnapshot : public IxNodeHandle {
+    friend class IxIndexHandle;
+
+   public:
+    explicit IxNodeSnapshot(const IxFileHdr *file_hdr_) { IxNodeHandle::operator=(IxNodeHandle(file_hdr_, &snapshot_)); }
+
+    IxNodeSnapshot(const IxNodeSnapshot &) = delete;
+
+    IxNodeSnapshot &operator=(const IxNodeSnapshot &) = delete;
+
+    /** 复制之后结点是否没有被修改，结点所在的帧被换成其他页面也视为修改 */
+    bool is_unchanged() const { return frame_->validate_version(version_); }
+
+   private:
+    Page snapshot_;
+    const Page *frame_ = nullptr;  // 复制时结点所在的帧
+    uint64_t version_ = 0;         // 复制时帧的版本号
 };
 
 /* B+树 */
 class IxIndexHandle {
     friend class IxScan;
     friend class IxManager;
+    friend class IxBulkLoader;
 
    private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
     int fd_;                                    // 存储B+树的文件
     IxFileHdr* file_hdr_;                       // 存了root_page，但其初始化为2（第0页存FILE_HDR_PAGE，第1页存LEAF_HEADER_PAGE）
-    std::mutex root_latch_;
+    std::shared_mutex root_latch_;              // 保护file_hdr_->root_page_，查找时共享持有直到获取根结点的latch
+    std::mutex num_pages_latch_;                // 保护file_hdr_->num_pages_
+    std::mutex deferred_pages_latch_;           // 保护deferred_pages_
+    std::vector<page_id_t> deferred_pages_;     // 已从B+树删除，但释放时仍被其他线程（如乐观读取）pin住的结点页面
 
    public:
     IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
@@ -176,27 +420,42 @@ class IxIndexHandle {
     // for search
     bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction);
 
-    std::pair<IxNodeHandle *, bool> find_leaf_page(const char *key, Operation operation, Transaction *transaction,
-                                                 bool find_first = false);
+    template <class LeafGuard>
+    std::pair<IxNodeGuard<LeafGuard>, bool> find_leaf_page(const char *key, Operation operation, Transaction *transaction,
+                                                         bool find_first = false);
+
+    IxNodeHandle find_leaf_page_exclusive(const char *key, Operation operation, Transaction *transaction);
+
+    void find_leaf_optimistic(const char *key, IxNodeSnapshot *leaf) const;
+
+    void read_node_optimistic(page_id_t page_no, IxNodeSnapshot *node) const;
+
+    void release_latched_pages(Transaction *transaction);
 
     // for insert
     page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction);
 
-    IxNodeHandle *split(IxNodeHandle *node);
+    IxWriteNode split(IxNodeHandle *node, int pos);
+
+    bool insert_or_split(IxNodeHandle *node, const char *key, const Rid &value, IxWriteNode *new_node);
+
+    void separator_key(IxNodeHandle *left, IxNodeHandle *right, char *dest);
 
     void insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node, Transaction *transaction);
 
     // for delete
     bool delete_entry(const char *key, Transaction *transaction);
 
+    bool delete_entry(const char *key, const Rid &value, Transaction *transaction);
+
     bool coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction = nullptr,
-                                bool *root_is_latched = nullptr);
-    bool adjust_root(IxNodeHandle *old_root_node);
+                                  IxWriteNode *next_leaf = nullptr);
+    bool adjust_root(IxNodeHandle *old_root_node, Transaction *transaction = nullptr);
 
     void redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node, IxNodeHandle *parent, int index);
 
     bool coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, IxNodeHandle **parent, int index,
-                  Transaction *transaction, bool *root_is_latched);
+                  Transaction *transaction, IxWriteNode *next_leaf);
 
     Iid lower_bound(const char *key);
 
@@ -215,17 +474,47 @@ class IxIndexHandle {
     // for get/create node
     IxNodeHandle *fetch_node(int page_no) const;
 
-    IxNodeHandle *create_node();
+    IxReadNode fetch_node_read(int page_no) const;
+
+    IxWriteNode fetch_node_write(int page_no) const;
+
+    bool try_fetch_node_write(int page_no, IxWriteNode *node) const;
+
+    Page *pin_page(page_id_t page_no) const;
+
+    void unpin_page(Page *page) const { buffer_pool_manager_->unpin_page(page->get_page_id(), false); }
+
+    bool try_read_node(page_id_t page_no, IxNodeSnapshot *node) const;
+
+    bool read_sibling_leaf(IxNodeSnapshot *leaf, bool next) const;
+
+    bool try_find_leaf_optimistic(const char *key, IxNodeSnapshot *leaf) const;
+
+    void copy_user_key(const IxNodeHandle &node, int key_idx, char *dest) const;
+
+    IxWriteNode create_node();
+
+    const char *normalize_key(const char *key, char *buf, const Rid *rid = nullptr, bool max_rid = false) const;
+
+    bool erase_entry(const char *key, const Rid *value, Transaction *transaction);
 
     // for maintain data structure
     void maintain_parent(IxNodeHandle *node);
 
-    void erase_leaf(IxNodeHandle *leaf);
+    bool latch_leaf_siblings(IxNodeHandle *leaf, IxWriteNode *neighbor, IxWriteNode *next_leaf);
+
+    void erase_leaf(IxNodeHandle *leaf, IxNodeHandle *prev, IxWriteNode *next);
 
-    void release_node_handle(IxNodeHandle &node);
+    void release_node_handle(IxNodeHandle &node, Transaction *transaction);
+
+    void free_deleted_pages(Transaction *transaction);
+
+    bool is_safe(IxNodeHandle *node, const char *key, Operation operation);
 
     void maintain_child(IxNodeHandle *node, int child_idx);
 
     // for index test
     Rid get_rid(const Iid &iid) const;
+
+    void get_key(const Iid &iid, char *dest) const;
 };
\ No newline at end of file
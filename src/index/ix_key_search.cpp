@@ -0,0 +1,173 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "ix_key_search.h"
+
+#include <cstring>
+
+#include "errors.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define IX_SEARCH_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * @description: 根据索引字段和CPU支持的指令集选择结点内key的查找方式
+ * @return {IxSearchMode} 单个INT/FLOAT字段且CPU支持SSE2/AVX2时返回对应的SIMD方式，否则返回GENERIC
+ * @param {vector<ColType>&} col_types 索引字段的类型
+ */
+IxSearchMode ix_choose_search_mode(const std::vector<ColType> &col_types) {
+#ifdef IX_SEARCH_X86
+    if (col_types.size() != 1 || (col_types[0] != TYPE_INT && col_types[0] != TYPE_FLOAT)) {
+        return IxSearchMode::GENERIC;
+    }
+    bool is_int = col_types[0] == TYPE_INT;
+    if (__builtin_cpu_supports("avx2")) {
+        return is_int ? IxSearchMode::INT_AVX2 : IxSearchMode::FLOAT_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return is_int ? IxSearchMode::INT_SSE2 : IxSearchMode::FLOAT_SSE2;
+    }
+#endif
+    return IxSearchMode::GENERIC;
+}
+
+const char *ix_search_mode_name(IxSearchMode mode) {
+    switch (mode) {
+        case IxSearchMode::INT_SSE2:
+            return "INT_SSE2";
+        case IxSearchMode::INT_AVX2:
+            return "INT_AVX2";
+        case IxSearchMode::FLOAT_SSE2:
+            return "FLOAT_SSE2";
+        case IxSearchMode::FLOAT_AVX2:
+            return "FLOAT_AVX2";
+        default:
+            return "GENERIC";
+    }
+}
+
+/**
+ * @description: 无分支的二分查找，把结果所在的范围缩小到IX_SIMD_SEARCH_WINDOW个key以内
+ * @return {int} 返回时结果在[*base, *base + n]中，n为返回值
+ */
+template <typename T>
+static int narrow_window(const T *keys, int num_key, T target, bool upper, int *base) {
+    int lo = 0;
+    int n = num_key;
+    while (n > IX_SIMD_SEARCH_WINDOW) {
+        int half = n >> 1;
+        T key = keys[lo + half];
+        bool go_right = upper ? !(target < key) : key < target;
+        lo = go_right ? lo + half : lo;  // 编译为条件传送
+        n -= half;
+    }
+    *base = lo;
+    return n;
+}
+
+/**
+ * @description: 标量版本，统计keys[0, n)中小于target（upper为true时小于等于target）的key的数量
+ */
+template <typename T>
+static int count_less_scalar(const T *keys, int n, T target, bool upper) {
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        count += upper ? !(target < keys[i]) : keys[i] < target;
+    }
+    return count;
+}
+
+#ifdef IX_SEARCH_X86
+__attribute__((target("sse2"))) static int count_less_int_sse2(const int *keys, int n, int target, bool upper) {
+    __m128i t = _mm_set1_epi32(target);
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+        // lower: key < target；upper: key <= target，即4 - (key > target)
+        __m128i cmp = upper ? _mm_cmpgt_epi32(k, t) : _mm_cmpgt_epi32(t, k);
+        int bits = __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(cmp)));
+        count += upper ? 4 - bits : bits;
+    }
+    return count + count_less_scalar(keys + i, n - i, target, upper);
+}
+
+__attribute__((target("avx2"))) static int count_less_int_avx2(const int *keys, int n, int target, bool upper) {
+    __m256i t = _mm256_set1_epi32(target);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+        __m256i cmp = upper ? _mm256_cmpgt_epi32(k, t) : _mm256_cmpgt_epi32(t, k);
+        int bits = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(cmp)));
+        count += upper ? 8 - bits : bits;
+    }
+    return count + count_less_scalar(keys + i, n - i, target, upper);
+}
+
+__attribute__((target("sse2"))) static int count_less_float_sse2(const float *keys, int n, float target, bool upper) {
+    __m128 t = _mm_set1_ps(target);
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 k = _mm_loadu_ps(keys + i);
+        __m128 cmp = upper ? _mm_cmple_ps(k, t) : _mm_cmplt_ps(k, t);
+        count += __builtin_popcount(_mm_movemask_ps(cmp));
+    }
+    return count + count_less_scalar(keys + i, n - i, target, upper);
+}
+
+__attribute__((target("avx2"))) static int count_less_float_avx2(const float *keys, int n, float target, bool upper) {
+    __m256 t = _mm256_set1_ps(target);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 k = _mm256_loadu_ps(keys + i);
+        __m256 cmp = upper ? _mm256_cmp_ps(k, t, _CMP_LE_OQ) : _mm256_cmp_ps(k, t, _CMP_LT_OQ);
+        count += __builtin_popcount(_mm256_movemask_ps(cmp));
+    }
+    return count + count_less_scalar(keys + i, n - i, target, upper);
+}
+#endif
+
+/**
+ * @description: 在有序的num_key个单字段key中查找第一个>=target（upper为true时为>target）的位置
+ * @return {int} key的位置，范围为[0, num_key]
+ * @param {IxSearchMode} mode 查找方式，不能为GENERIC
+ * @param {char*} keys 结点中的key数组，INT/FLOAT的key各占4字节且连续存放
+ * @param {int} num_key key的数量
+ * @param {char*} target 要查找的key
+ * @param {bool} upper 为false时相当于lower_bound，为true时相当于upper_bound
+ */
+int ix_simd_search(IxSearchMode mode, const char *keys, int num_key, const char *target, bool upper) {
+#ifdef IX_SEARCH_X86
+    int base;
+    if (mode == IxSearchMode::INT_SSE2 || mode == IxSearchMode::INT_AVX2) {
+        const int *int_keys = reinterpret_cast<const int *>(keys);
+        int int_target;
+        memcpy(&int_target, target, sizeof(int));
+        int n = narrow_window(int_keys, num_key, int_target, upper, &base);
+        return base + (mode == IxSearchMode::INT_AVX2 ? count_less_int_avx2(int_keys + base, n, int_target, upper)
+                                                      : count_less_int_sse2(int_keys + base, n, int_target, upper));
+    }
+    if (mode == IxSearchMode::FLOAT_SSE2 || mode == IxSearchMode::FLOAT_AVX2) {
+        const float *float_keys = reinterpret_cast<const float *>(keys);
+        float float_target;
+        memcpy(&float_target, target, sizeof(float));
+        int n = narrow_window(float_keys, num_key, float_target, upper, &base);
+        return base + (mode == IxSearchMode::FLOAT_AVX2
+                           ? count_less_float_avx2(float_keys + base, n, float_target, upper)
+                           : count_less_float_sse2(float_keys + base, n, float_target, upper));
+    }
+#endif
+    throw InternalError("ix_simd_search Error: unsupported search mode");
+}
@@ -0,0 +1,30 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <vector>
+
+#include "defs.h"
+
+/**
+ * @description: 结点内key的查找方式，打开索引时由ix_choose_search_mode根据索引字段和CPU支持的指令集选择。
+ * GENERIC对任意索引使用无分支的二分查找；其余方式只用于单个INT或FLOAT字段的索引，
+ * 先用无分支的二分查找把范围缩小到IX_SIMD_SEARCH_WINDOW个key以内，再用SIMD指令一次比较多个key
+ */
+enum class IxSearchMode { GENERIC = 0, INT_SSE2, INT_AVX2, FLOAT_SSE2, FLOAT_AVX2 };
+
+constexpr int IX_SIMD_SEARCH_WINDOW = 32;
+
+IxSearchMode ix_choose_search_mode(const std::vector<ColType> &col_types);
+
+const char *ix_search_mode_name(IxSearchMode mode);
+
+int ix_simd_search(IxSearchMode mode, const char *keys, int num_key, const char *target, bool upper);
@@ -10,11 +10,13 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <string>
 
 #include "system/sm_meta.h"
 #include "ix_defs.h"
+#include "ix_hash_index_handle.h"
 #include "ix_index_handle.h"
 
 class IxManager {
@@ -54,8 +56,33 @@ class IxManager {
         return disk_manager_->is_file(ix_name);
     }
 
-    void create_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+    // 多字段索引默认以编码后的key存放，比较时不必逐个字段区分类型；单字段索引保留原始key以使用SIMD查找。
+    // 非唯一索引拼接Rid之后总是多字段，同样默认编码
+    void create_index(const std::string &filename, const std::vector<ColMeta>& index_cols, bool unique = true) {
+        create_index(filename, index_cols, unique, !unique || index_cols.size() > 1);
+    }
+
+    // 含字符串字段并且key可以按字节比较时，默认使用前缀压缩的结点格式
+    void create_index(const std::string &filename, const std::vector<ColMeta>& index_cols, bool unique,
+                      bool normalized_keys) {
+        bool has_string = std::any_of(index_cols.begin(), index_cols.end(),
+                                      [](const ColMeta &col) { return col.type == TYPE_STRING; });
+        create_index(filename, index_cols, unique, normalized_keys,
+                     has_string && is_byte_comparable(index_cols, normalized_keys));
+    }
+
+    void create_index(const std::string &filename, const std::vector<ColMeta>& index_cols, bool unique,
+                      bool normalized_keys, bool compressed_keys) {
+        if (compressed_keys && !is_byte_comparable(index_cols, normalized_keys)) {
+            throw InternalError("IxManager::create_index Error: compressed keys must be byte-comparable");
+        }
         std::string ix_name = get_index_name(filename, index_cols);
+        // 非唯一索引的key之后拼接按字节比较的Rid，作为一个额外的定长字符串字段
+        std::vector<ColMeta> key_cols = index_cols;
+        if (!unique) {
+            key_cols.push_back(ColMeta{.tab_name = filename, .name = "", .type = TYPE_STRING,
+                                       .len = static_cast<int>(sizeof(Rid)), .offset = 0, .index = false});
+        }
         // Create index file
         disk_manager_->create_file(ix_name);
         // Open index file
@@ -66,8 +93,8 @@ class IxManager {
         // but we reserve one slot for convenient inserting and deleting, i.e.
         // |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE
         int col_tot_len = 0;
-        int col_num = index_cols.size();
-        for(auto& col: index_cols) {
+        int col_num = key_cols.size();
+        for(auto& col: key_cols) {
             col_tot_len += col.len;
         }
         if (col_tot_len > IX_MAX_COL_LEN) {
@@ -83,9 +110,12 @@ class IxManager {
                                 col_num, col_tot_len, btree_order, (btree_order + 1) * col_tot_len,
                                 IX_INIT_ROOT_PAGE, IX_INIT_ROOT_PAGE);
         for(int i = 0; i < col_num; ++i) {
-            fhdr->col_types_.push_back(index_cols[i].type);
-            fhdr->col_lens_.push_back(index_cols[i].len);
+            fhdr->col_types_.push_back(key_cols[i].type);
+            fhdr->col_lens_.push_back(key_cols[i].len);
         }
+        fhdr->normalized_keys_ = normalized_keys;
+        fhdr->compressed_keys_ = compressed_keys;
+        fhdr->unique_ = unique;
         fhdr->update_tot_len();
         
         char* data = new char[fhdr->tot_len_];
@@ -133,6 +163,56 @@ class IxManager {
         disk_manager_->close_file(fd);
     }
 
+    /**
+     * @description: 创建可扩展哈希索引，与B+树索引使用相同的文件名。初始时全局深度为0，目录只有一项，指向唯一的空桶
+     * @param {bool} unique 是否为唯一索引，唯一索引中key相同的键值对只插入一次
+     */
+    void create_hash_index(const std::string &filename, const std::vector<ColMeta>& index_cols, bool unique = true) {
+        std::string ix_name = get_index_name(filename, index_cols);
+        IxHashFileHdr fhdr;
+        fhdr.num_pages_ = IX_HASH_INIT_NUM_PAGES;
+        fhdr.col_num_ = index_cols.size();
+        for (auto &col : index_cols) {
+            fhdr.col_types_.push_back(col.type);
+            fhdr.col_lens_.push_back(col.len);
+            fhdr.col_tot_len_ += col.len;
+        }
+        if (fhdr.col_tot_len_ > IX_MAX_COL_LEN) {
+            throw InvalidColLengthError(fhdr.col_tot_len_);
+        }
+        int max_entries = static_cast<int>((PAGE_SIZE - sizeof(IxHashBucketHdr)) / (fhdr.col_tot_len_ + sizeof(Rid)));
+        fhdr.bucket_capacity_ = std::min(BUCKET_SIZE, max_entries);
+        fhdr.unique_ = unique;
+        fhdr.global_depth_ = 0;
+        fhdr.update_tot_len();
+
+        disk_manager_->create_file(ix_name);
+        int fd = disk_manager_->open_file(ix_name);
+        char page_buf[PAGE_SIZE];
+        memset(page_buf, 0, PAGE_SIZE);
+        fhdr.serialize(page_buf);
+        disk_manager_->write_page(fd, IX_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
+        // 目录页面：没有下一个目录页面，只有一项，指向初始的桶
+        {
+            memset(page_buf, 0, PAGE_SIZE);
+            int dir_page[3] = {IX_NO_PAGE, 1, IX_HASH_INIT_BUCKET_PAGE};
+            memcpy(page_buf, dir_page, sizeof(dir_page));
+            disk_manager_->write_page(fd, IX_HASH_DIR_PAGE, page_buf, PAGE_SIZE);
+        }
+        {
+            memset(page_buf, 0, PAGE_SIZE);
+            *reinterpret_cast<IxHashBucketHdr *>(page_buf) = {.local_depth = 0, .num_entries = 0, .next_page = IX_NO_PAGE};
+            disk_manager_->write_page(fd, IX_HASH_INIT_BUCKET_PAGE, page_buf, PAGE_SIZE);
+        }
+        disk_manager_->close_file(fd);
+    }
+
+    // 编码后的key，以及只含字符串字段的key，可以直接按字节比较
+    static bool is_byte_comparable(const std::vector<ColMeta>& index_cols, bool normalized_keys) {
+        return normalized_keys || std::all_of(index_cols.begin(), index_cols.end(),
+                                              [](const ColMeta &col) { return col.type == TYPE_STRING; });
+    }
+
     void destroy_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
         std::string ix_name = get_index_name(filename, index_cols);
         disk_manager_->destroy_file(ix_name);
@@ -156,12 +236,35 @@ class IxManager {
         return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
     }
 
-    void close_index(const IxIndexHandle *ih) {
+    std::unique_ptr<IxHashIndexHandle> open_hash_index(const std::string &filename,
+                                                       const std::vector<ColMeta>& index_cols) {
+        std::string ix_name = get_index_name(filename, index_cols);
+        int fd = disk_manager_->open_file(ix_name);
+        return std::make_unique<IxHashIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+    }
+
+    void close_index(IxIndexHandle *ih) {
+        // 重试释放之前仍被pin住的已删除结点，空闲页面链表已写入各空闲页面，链表头记录在文件头中
+        ih->free_deleted_pages(nullptr);
+        ih->file_hdr_->first_free_page_no_ = disk_manager_->save_free_pages(ih->fd_);
         char* data = new char[ih->file_hdr_->tot_len_];
         ih->file_hdr_->serialize(data);
         disk_manager_->write_page(ih->fd_, IX_FILE_HDR_PAGE, data, ih->file_hdr_->tot_len_);
         // 缓冲区的所有页刷到磁盘，注意这句话必须写在close_file前面
         buffer_pool_manager_->flush_all_pages(ih->fd_);
+        buffer_pool_manager_->discard_all_pages(ih->fd_);
+        disk_manager_->close_file(ih->fd_);
+    }
+
+    // 目录写回目录页面链表之后再写文件头，写回目录可能分配新的页面
+    void close_hash_index(IxHashIndexHandle *ih) {
+        ih->save_dir();
+        char page_buf[PAGE_SIZE];
+        memset(page_buf, 0, PAGE_SIZE);
+        ih->file_hdr_->serialize(page_buf);
+        disk_manager_->write_page(ih->fd_, IX_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
+        buffer_pool_manager_->flush_all_pages(ih->fd_);
+        buffer_pool_manager_->discard_all_pages(ih->fd_);
         disk_manager_->close_file(ih->fd_);
     }
 };
\ No newline at end of file
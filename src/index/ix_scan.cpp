@@ -10,24 +10,216 @@ See the Mulan PSL v2 for more details. */
 
 #include "ix_scan.h"
 
+IxScan::IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm, bool reverse)
+    : ih_(ih), end_(reverse ? lower : upper), bpm_(bpm), reverse_(reverse), leaf_(ih->file_hdr_) {
+    if (lower == upper) {
+        is_end_ = true;
+        return;
+    }
+    // 终点转换为key，用于判断扫描是否结束。lower和upper只是位置，算出之后所在叶子被修改时可能已经偏移
+    has_bound_ = key_at(end_, bound_);
+    if (reverse_ && !has_bound_) {
+        // lower之后没有索引项
+        is_end_ = true;
+    } else if (!reverse_) {
+        if (key_at(lower, key_)) {
+            arrive();
+        } else {
+            is_end_ = true;
+        }
+    } else if (!key_at(upper, key_)) {
+        seek_last();
+    } else if (!step_back()) {
+        seek();
+    }
+}
+
 /**
- * @brief 
- * @todo 加上读锁（需要使用缓冲池得到page）
+ * @brief 移动到下一个索引项（反向扫描时为前一个）。当前叶子的副本读取之后没有被修改时直接在副本中移动，
+ * 否则从根结点按当前索引项的key重新查找：正向扫描定位到upper_bound(key)，反向扫描定位到lower_bound(key)之前
  */
 void IxScan::next() {
     assert(!is_end());
-    IxNodeHandle *node = ih_->fetch_node(iid_.page_no);
-    assert(node->is_leaf_page());
-    assert(iid_.slot_no < node->get_size());
-    // increment slot no
-    iid_.slot_no++;
-    if (iid_.page_no != ih_->file_hdr_->last_leaf_ && iid_.slot_no == node->get_size()) {
-        // go to next leaf
-        iid_.slot_no = 0;
-        iid_.page_no = node->get_next_leaf();
+    if (leaf_.is_unchanged()) {
+        if (reverse_) {
+            if (step_back()) {
+                return;
+            }
+        } else {
+            iid_.slot_no++;
+            if (settle()) {
+                return;
+            }
+        }
+    }
+    seek();
+}
+
+/**
+ * @brief 把iid处的索引项在索引中存放的key写入dest，iid在叶子末尾时取之后的第一个索引项，并把iid_和leaf_定位到该索引项
+ *
+ * @return 之后是否还有索引项，iid为leaf_end时返回false
+ */
+bool IxScan::key_at(const Iid &iid, char *dest) {
+    while (true) {
+        ih_->read_node_optimistic(iid.page_no, &leaf_);
+        if (!leaf_.is_leaf_page() || iid.slot_no > leaf_.get_size()) {
+            // 得到iid之后B+树已被修改，结点已被合并或复用
+            throw IndexEntryNotFoundError();
+        }
+        int slot_no = iid.slot_no;
+        bool consistent = true;
+        while (consistent && slot_no == leaf_.get_size()) {
+            if (leaf_.get_next_leaf() == IX_LEAF_HEADER_PAGE) {
+                return false;
+            }
+            consistent = ih_->read_sibling_leaf(&leaf_, true);
+            slot_no = 0;
+        }
+        // 读到的下一个叶子不一致时重新读取
+        if (consistent) {
+            iid_ = {.page_no = leaf_.get_page_no(), .slot_no = slot_no};
+            leaf_.copy_key(slot_no, dest);
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief 按key_从根结点重新查找位置：正向扫描定位到第一个大于key_的索引项，反向扫描定位到最后一个小于key_的索引项
+ */
+void IxScan::seek() {
+    do {
+        ih_->find_leaf_optimistic(key_, &leaf_);
+        int slot_no = reverse_ ? leaf_.lower_bound(key_) : leaf_.upper_bound(key_);
+        iid_ = {.page_no = leaf_.get_page_no(), .slot_no = slot_no};
+    } while (!(reverse_ ? step_back() : settle()));
+}
+
+/**
+ * @brief 反向扫描的upper为leaf_end时，定位到最后一个索引项
+ */
+void IxScan::seek_last() {
+    do {
+        ih_->read_node_optimistic(ih_->file_hdr_->last_leaf_, &leaf_);
+        iid_ = {.page_no = leaf_.get_page_no(), .slot_no = leaf_.get_size()};
+        // 读取last_leaf_之后最后一个叶子可能已经分裂或被合并
+    } while (!leaf_.is_leaf_page() || leaf_.get_next_leaf() != IX_LEAF_HEADER_PAGE || !step_back());
+}
+
+/**
+ * @brief 正向扫描时，当前叶子已经扫描完则沿next_leaf进入下一个叶子，直到iid_指向一个索引项；没有更多索引项时结束扫描
+ *
+ * @return 为false时读到的下一个叶子不一致，需要按key_重新查找
+ */
+bool IxScan::settle() {
+    while (iid_.slot_no >= leaf_.get_size()) {
+        if (leaf_.get_next_leaf() == IX_LEAF_HEADER_PAGE) {
+            is_end_ = true;
+            return true;
+        }
+        page_id_t leaf_page_no = iid_.page_no;
+        page_id_t parent_page_no = leaf_.is_root_page() ? INVALID_PAGE_ID : leaf_.get_parent_page_no();
+        if (!ih_->read_sibling_leaf(&leaf_, true)) {
+            return false;
+        }
+        iid_ = {.page_no = leaf_.get_page_no(), .slot_no = 0};
+        readahead(leaf_page_no, parent_page_no);
+    }
+    arrive();
+    return true;
+}
+
+/**
+ * @brief 反向扫描时移动到前一个索引项，当前叶子已经扫描完时沿prev_leaf切换到前一个叶子的最后一个索引项；
+ * 没有更多索引项时结束扫描
+ *
+ * @return 为false时读到的前一个叶子不一致，需要按key_重新查找
+ */
+bool IxScan::step_back() {
+    while (iid_.slot_no == 0) {
+        if (leaf_.get_prev_leaf() == IX_LEAF_HEADER_PAGE) {
+            is_end_ = true;
+            return true;
+        }
+        page_id_t leaf_page_no = iid_.page_no;
+        page_id_t parent_page_no = leaf_.is_root_page() ? INVALID_PAGE_ID : leaf_.get_parent_page_no();
+        if (!ih_->read_sibling_leaf(&leaf_, false)) {
+            return false;
+        }
+        iid_ = {.page_no = leaf_.get_page_no(), .slot_no = leaf_.get_size()};
+        readahead(leaf_page_no, parent_page_no);
+    }
+    iid_.slot_no--;
+    arrive();
+    return true;
+}
+
+/**
+ * @brief iid_指向一个索引项之后调用：记录它的key，并与终点的key比较判断扫描是否结束
+ */
+void IxScan::arrive() {
+    leaf_.copy_key(iid_.slot_no, key_);
+    if (!has_bound_) {
+        is_end_ = false;
+        return;
     }
+    int cmp = leaf_.compare_key(iid_.slot_no, bound_);
+    is_end_ = reverse_ ? cmp < 0 : cmp >= 0;
+}
+
+/**
+ * @brief 沿next_leaf（反向扫描时为prev_leaf）切换到下一个叶子时调用。叶子的页面编号不一定连续，因此借助父结点得到接下来的叶子，
+ * 异步预读至多readahead_window_个叶子（不超过扫描终点），窗口每次加倍直到READAHEAD_MAX_PAGES
+ *
+ * @param leaf_page_no 刚刚扫描完的叶子结点
+ * @param parent_page_no 该叶子的父结点，叶子为根结点时为INVALID_PAGE_ID
+ */
+void IxScan::readahead(page_id_t leaf_page_no, page_id_t parent_page_no) {
+    if (readahead_trigger_ != INVALID_PAGE_ID && iid_.page_no != readahead_trigger_) {
+        return;
+    }
+    if (parent_page_no == INVALID_PAGE_ID) {
+        return;
+    }
+    IxNodeSnapshot parent(ih_->file_hdr_);
+    ih_->read_node_optimistic(parent_page_no, &parent);
+    // 读取叶子之后树可能已被修改，父结点中找不到该叶子时放弃本次预读
+    int child_idx = 0;
+    while (!parent.is_leaf_page() && child_idx < parent.get_size() && parent.value_at(child_idx) != leaf_page_no) {
+        child_idx++;
+    }
+    if (parent.is_leaf_page() || child_idx == parent.get_size()) {
+        readahead_trigger_ = INVALID_PAGE_ID;
+        return;
+    }
+    std::vector<page_id_t> leaves;
+    int step = reverse_ ? -1 : 1;
+    for (int i = child_idx + step; i >= 0 && i < parent.get_size(); i += step) {
+        if (static_cast<int>(leaves.size()) == readahead_window_) {
+            break;
+        }
+        leaves.push_back(parent.value_at(i));
+        if (leaves.back() == end_.page_no) {
+            break;
+        }
+    }
+
+    if (leaves.empty()) {
+        // 当前父结点的孩子已经扫描完，切换到下一个父结点下的叶子时再预读
+        readahead_trigger_ = INVALID_PAGE_ID;
+        return;
+    }
+    bpm_->prefetch(ih_->fd_, leaves);
+    // leaves[0]就是即将进入的叶子，至少要隔一个叶子才能作为下一次的触发点
+    readahead_trigger_ = leaves.size() > 1 ? leaves[leaves.size() / 2] : INVALID_PAGE_ID;
+    readahead_window_ = std::min(readahead_window_ * 2, READAHEAD_MAX_PAGES);
 }
 
 Rid IxScan::rid() const {
-    return ih_->get_rid(iid_);
-}
\ No newline at end of file
+    return *leaf_.get_rid(iid_.slot_no);
+}
+
+void IxScan::key(char *dest) const {
+    ih_->copy_user_key(leaf_, iid_.slot_no, dest);
+}
@@ -17,22 +17,51 @@ See the Mulan PSL v2 for more details. */
 
 // 用于遍历叶子结点
 // 用于直接遍历叶子结点，而不用findleafpage来得到叶子结点
-// TODO：对page遍历时，要加上读锁
+// 当前叶子结点保存为乐观读取的副本leaf_，不持有页面latch和pin。每次移动前检查该叶子是否被修改（包括结点被合并、
+// 页面被复用），被修改时按当前索引项的key重新查找位置，因此并发修改不会使扫描跳过或重复访问索引项
 class IxScan : public RecScan {
     const IxIndexHandle *ih_;
-    Iid iid_;  // 初始为lower（用于遍历的指针）
-    Iid end_;  // 初始为upper
+    Iid iid_;  // 当前索引项
+    Iid end_;  // 构造时传入的upper，反向扫描时为lower，只用于预读时不越过扫描终点
     BufferPoolManager *bpm_;
+    bool reverse_;          // 沿prev_leaf从upper向lower反向扫描
+    bool is_end_ = false;
+
+    IxNodeSnapshot leaf_;             // iid_所在叶子结点的副本
+    char key_[IX_MAX_COL_LEN];        // 当前索引项在索引中存放的key，非唯一索引拼接了Rid，因此各索引项的key互不相同
+    char bound_[IX_MAX_COL_LEN];      // 终点索引项的key：正向扫描为upper处的索引项（不访问），反向扫描为lower处的索引项（访问）
+    bool has_bound_ = false;          // 正向扫描的upper为leaf_end时没有终点key
+
+    // 叶子结点预读：进入readahead_trigger_时，按父结点中的孩子顺序预读接下来readahead_window_个叶子
+    // readahead_trigger_为INVALID_PAGE_ID表示下一次切换叶子时就预读
+    int readahead_window_ = READAHEAD_MIN_PAGES;
+    page_id_t readahead_trigger_ = INVALID_PAGE_ID;
+
+    void readahead(page_id_t leaf_page_no, page_id_t parent_page_no);
+
+    bool key_at(const Iid &iid, char *dest);
+
+    void seek();
+
+    void seek_last();
+
+    bool settle();
+
+    bool step_back();
+
+    void arrive();
 
    public:
-    IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm)
-        : ih_(ih), iid_(lower), end_(upper), bpm_(bpm) {}
+    IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm, bool reverse = false);
 
     void next() override;
 
-    bool is_end() const override { return iid_ == end_; }
+    bool is_end() const override { return is_end_; }
 
     Rid rid() const override;
 
+    // 当前索引项的key，按字段原样拼接，dest至少col_tot_len字节
+    void key(char *dest) const;
+
     const Iid &iid() const { return iid_; }
 };
\ No newline at end of file
@@ -38,7 +38,12 @@ typedef enum PlanTag{
     T_Transaction_rollback,
     T_SeqScan,
     T_IndexScan,
+    T_IndexOnlyScan,
+    T_HashIndexScan,
     T_NestLoop,
+    T_IndexNestLoop,
+    T_MergeJoin,
+    T_HashJoin,
     T_Sort,
     T_Projection
 } PlanTag;
@@ -74,6 +79,7 @@ class ScanPlan : public Plan
         size_t len_;                               
         std::vector<Condition> fed_conds_;
         std::vector<std::string> index_col_names_;
+        bool reverse_ = false;                     // 索引扫描沿prev_leaf反向进行，按索引key降序输出
     
 };
 
@@ -95,6 +101,9 @@ class JoinPlan : public Plan
         std::shared_ptr<Plan> right_;
         // 连接条件
         std::vector<Condition> conds_;
+        // 索引嵌套循环连接：内层表是否为左节点，以及内层表上用于查找的索引字段
+        bool inner_left_ = true;
+        std::vector<std::string> index_col_names_;
         // future TODO: 后续可以支持的连接类型
         JoinType type;
         
@@ -118,17 +127,17 @@ class ProjectionPlan : public Plan
 class SortPlan : public Plan
 {
     public:
-        SortPlan(PlanTag tag, std::shared_ptr<Plan> subplan, TabCol sel_col, bool is_desc)
+        SortPlan(PlanTag tag, std::shared_ptr<Plan> subplan, std::vector<TabCol> sel_cols, std::vector<bool> is_desc)
         {
             Plan::tag = tag;
             subplan_ = std::move(subplan);
-            sel_col_ = sel_col;
-            is_desc_ = is_desc;
+            sel_cols_ = std::move(sel_cols);
+            is_desc_ = std::move(is_desc);
         }
         ~SortPlan(){}
         std::shared_ptr<Plan> subplan_;
-        TabCol sel_col_;
-        bool is_desc_;
+        std::vector<TabCol> sel_cols_;  // 排序键，按优先级排列
+        std::vector<bool> is_desc_;     // 每个排序键是否降序
         
 };
 
@@ -170,6 +179,8 @@ class DDLPlan : public Plan
         std::string tab_name_;
         std::vector<std::string> tab_col_names_;
         std::vector<ColDef> cols_;
+        bool unique_ = false;       // create index：是否为唯一索引
+        IndexType index_type_ = INDEX_BTREE;    // create index：索引的存取方法
 };
 
 // help; show tables; desc tables; begin; abort; commit; rollback语句对应的plan
@@ -22,16 +22,50 @@ See the Mulan PSL v2 for more details. */
 #include "index/ix.h"
 #include "record_printer.h"
 
-// 目前的索引匹配规则为：完全匹配索引字段，且全部为单点查询，不会自动调整where条件的顺序
+// 索引匹配规则：按索引字段的顺序匹配最左前缀，前缀中的字段都有等值条件，其后的一个字段可以只有范围条件（<, <=, >, >=）。
+// 哈希索引只能用于全部字段都有等值条件的查找，此时优先于匹配字段数相同的B+树索引。
+// 选择匹配字段最多的索引，匹配字段数相同时优先选择等值条件多的；index_col_names返回所选索引的全部字段
 bool Planner::get_index_cols(std::string tab_name, std::vector<Condition> curr_conds, std::vector<std::string>& index_col_names) {
     index_col_names.clear();
-    for(auto& cond: curr_conds) {
-        if(cond.is_rhs_val && cond.op == OP_EQ && cond.lhs_col.tab_name.compare(tab_name) == 0)
-            index_col_names.push_back(cond.lhs_col.col_name);
-    }
     TabMeta& tab = sm_manager_->db_.get_table(tab_name);
-    if(tab.is_index(index_col_names)) return true;
-    return false;
+    int best_score = 0;
+    for(auto& index: tab.indexes) {
+        int num_eq = 0;
+        bool has_range = false;
+        for(auto& col: index.cols) {
+            bool has_eq = false;
+            for(auto& cond: curr_conds) {
+                if(!cond.is_rhs_val || cond.op == OP_NE || cond.lhs_col.tab_name.compare(tab_name) != 0 ||
+                   cond.lhs_col.col_name.compare(col.name) != 0)
+                    continue;
+                if(cond.op == OP_EQ)
+                    has_eq = true;
+                else
+                    has_range = true;
+            }
+            if(!has_eq) break;
+            num_eq++;
+            has_range = false;
+        }
+        int score = num_eq * 2 + (has_range ? 1 : 0);
+        if(index.type == INDEX_HASH) {
+            if(num_eq < index.col_num) continue;
+            score = num_eq * 2 + 1;
+        }
+        if(score > best_score) {
+            best_score = score;
+            index_col_names.clear();
+            for(auto& col: index.cols)
+                index_col_names.push_back(col.name);
+        }
+    }
+    return best_score > 0;
+}
+
+// get_index_cols选出的索引对应的扫描方式
+PlanTag Planner::index_scan_tag(const std::string &tab_name, const std::vector<std::string> &index_col_names) {
+    TabMeta &tab = sm_manager_->db_.get_table(tab_name);
+    return tab.get_index_meta(index_col_names)->type == INDEX_HASH ? T_HashIndexScan : T_IndexScan;
 }
 
 /**
@@ -117,6 +151,34 @@ std::shared_ptr<Plan> pop_scan(int *scantbl, std::string table, std::vector<std:
 }
 
 
+/**
+ * @brief 收集算子树中扫描条件、连接条件和排序用到的列
+ */
+void collect_used_cols(const std::shared_ptr<Plan> &plan, std::vector<TabCol> &used_cols)
+{
+    auto add_conds = [&](const std::vector<Condition> &conds) {
+        for (auto &cond : conds) {
+            used_cols.push_back(cond.lhs_col);
+            if (!cond.is_rhs_val) {
+                used_cols.push_back(cond.rhs_col);
+            }
+        }
+    };
+    if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+        add_conds(x->conds_);
+    } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        add_conds(x->conds_);
+        collect_used_cols(x->left_, used_cols);
+        collect_used_cols(x->right_, used_cols);
+    } else if (auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
+        used_cols.insert(used_cols.end(), x->sel_cols_.begin(), x->sel_cols_.end());
+        collect_used_cols(x->subplan_, used_cols);
+    } else if (auto x = std::dynamic_pointer_cast<ProjectionPlan>(plan)) {
+        used_cols.insert(used_cols.end(), x->sel_cols_.begin(), x->sel_cols_.end());
+        collect_used_cols(x->subplan_, used_cols);
+    }
+}
+
 std::shared_ptr<Query> Planner::logical_optimization(std::shared_ptr<Query> query, Context *context)
 {
     
@@ -130,6 +192,7 @@ std::shared_ptr<Plan> Planner::physical_optimization(std::shared_ptr<Query> quer
     std::shared_ptr<Plan> plan = make_one_rel(query);
     
     // 其他物理优化
+    choose_join_methods(plan);
 
     // 处理orderby
     plan = generate_sort_plan(query, std::move(plan)); 
@@ -156,7 +219,8 @@ std::shared_ptr<Plan> Planner::make_one_rel(std::shared_ptr<Query> query)
                 std::make_shared<ScanPlan>(T_SeqScan, sm_manager_, tables[i], curr_conds, index_col_names);
         } else {  // 存在索引
             table_scan_executors[i] =
-                std::make_shared<ScanPlan>(T_IndexScan, sm_manager_, tables[i], curr_conds, index_col_names);
+                std::make_shared<ScanPlan>(index_scan_tag(tables[i], index_col_names), sm_manager_, tables[i],
+                                           curr_conds, index_col_names);
         }
     }
     // 只有一个表，不需要join。
@@ -262,15 +326,230 @@ std::shared_ptr<Plan> Planner::generate_sort_plan(std::shared_ptr<Query> query,
         const auto &sel_tab_cols = sm_manager_->db_.get_table(sel_tab_name).cols;
         all_cols.insert(all_cols.end(), sel_tab_cols.begin(), sel_tab_cols.end());
     }
-    TabCol sel_col;
-    for (auto &col : all_cols) {
-        if(col.name.compare(x->order->cols->col_name) == 0 )
-        sel_col = {.tab_name = col.tab_name, .col_name = col.name};
+    std::vector<TabCol> sel_cols;
+    std::vector<bool> is_desc;
+    for (auto &order : x->orders) {
+        TabCol sel_col;
+        for (auto &col : all_cols) {
+            if(col.name.compare(order->cols->col_name) == 0 &&
+               (order->cols->tab_name.empty() || col.tab_name.compare(order->cols->tab_name) == 0))
+            sel_col = {.tab_name = col.tab_name, .col_name = col.name};
+        }
+        sel_cols.push_back(sel_col);
+        is_desc.push_back(order->orderby_dir == ast::OrderBy_DESC);
+    }
+    // 只有一个排序键的单表查询按索引顺序扫描即可得到有序的结果，不需要排序算子
+    if (auto scan = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+        if (sel_cols.size() == 1 && use_index_order(scan, sel_cols[0], is_desc[0])) {
+            return plan;
+        }
+    }
+    return std::make_shared<SortPlan>(T_Sort, std::move(plan), std::move(sel_cols), std::move(is_desc));
+}
+
+/**
+ * @brief 判断能否按索引的顺序扫描得到按sel_col排序的结果，能则调整扫描方式：索引中sel_col之前的字段都有等值条件时，
+ * 索引扫描输出的元组按sel_col有序，降序时反向扫描。已经选择的索引不满足要求时保留原来的索引，由排序算子排序；
+ * 顺序扫描时改用满足要求的索引
+ *
+ * @param scan 单表查询的扫描算子
+ * @param sel_col 排序的列
+ * @param is_desc 是否降序
+ * @return 是否不再需要排序算子
+ */
+bool Planner::use_index_order(std::shared_ptr<ScanPlan> scan, const TabCol &sel_col, bool is_desc)
+{
+    const IndexMeta *index = find_order_index(scan, sel_col);
+    if (index == nullptr) {
+        return false;
+    }
+    set_index_order(scan, *index, is_desc);
+    return true;
+}
+
+/**
+ * @brief 查找能使扫描结果按sel_col有序的B+树索引，规则见use_index_order
+ *
+ * @return 已经选择的索引满足要求时返回该索引，顺序扫描时返回第一个满足要求的索引，否则返回nullptr
+ */
+const IndexMeta *Planner::find_order_index(std::shared_ptr<ScanPlan> scan, const TabCol &sel_col)
+{
+    if (sel_col.tab_name != scan->tab_name_) {
+        return nullptr;
+    }
+    TabMeta &tab = sm_manager_->db_.get_table(scan->tab_name_);
+    auto provides_order = [&](const IndexMeta &index) {
+        if (index.type == INDEX_HASH) {
+            return false;
+        }
+        for (auto &index_col : index.cols) {
+            if (index_col.name == sel_col.col_name) {
+                return true;
+            }
+            bool has_eq = std::any_of(scan->conds_.begin(), scan->conds_.end(), [&](const Condition &cond) {
+                return cond.is_rhs_val && cond.op == OP_EQ && cond.lhs_col.tab_name == scan->tab_name_ &&
+                       cond.lhs_col.col_name == index_col.name;
+            });
+            if (!has_eq) {
+                return false;
+            }
+        }
+        return false;
+    };
+    if (scan->tag == T_IndexScan) {
+        auto index = tab.get_index_meta(scan->index_col_names_);
+        return provides_order(*index) ? &*index : nullptr;
+    }
+    auto index = std::find_if(tab.indexes.begin(), tab.indexes.end(), provides_order);
+    return index == tab.indexes.end() ? nullptr : &*index;
+}
+
+// 改为在index上扫描，is_desc时反向扫描
+void Planner::set_index_order(std::shared_ptr<ScanPlan> scan, const IndexMeta &index, bool is_desc)
+{
+    scan->tag = T_IndexScan;
+    scan->index_col_names_.clear();
+    for (auto &col : index.cols) {
+        scan->index_col_names_.push_back(col.name);
+    }
+    scan->reverse_ = is_desc;
+}
+
+
+/**
+ * @brief 查询用到的某个表的列全部包含在该表所选的索引中时，将索引扫描改为只读索引的扫描，
+ * 直接由key还原元组，不再为每条满足条件的记录访问一次记录所在的页面
+ *
+ * @param plan 算子树
+ * @param used_cols 整个查询用到的列，见collect_used_cols
+ */
+void Planner::choose_index_only_scans(std::shared_ptr<Plan> plan, const std::vector<TabCol> &used_cols)
+{
+    if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+        if (x->tag != T_IndexScan) {
+            return;
+        }
+        TabMeta &tab = sm_manager_->db_.get_table(x->tab_name_);
+        auto &index_cols = tab.get_index_meta(x->index_col_names_)->cols;
+        for (auto &col : used_cols) {
+            if (col.tab_name != x->tab_name_) {
+                continue;
+            }
+            auto covered = std::find_if(index_cols.begin(), index_cols.end(),
+                                        [&](const ColMeta &index_col) { return index_col.name == col.col_name; });
+            if (covered == index_cols.end()) {
+                return;
+            }
+        }
+        x->tag = T_IndexOnlyScan;
+    } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        choose_index_only_scans(x->left_, used_cols);
+        choose_index_only_scans(x->right_, used_cols);
+    } else if (auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
+        choose_index_only_scans(x->subplan_, used_cols);
+    } else if (auto x = std::dynamic_pointer_cast<ProjectionPlan>(plan)) {
+        choose_index_only_scans(x->subplan_, used_cols);
+    }
+}
+
+/**
+ * @brief 为算子树中的每个连接选择连接算法：两侧都能按连接字段的顺序扫描时使用归并连接；
+ * 否则可以在一侧表的索引上按连接字段查找时使用索引嵌套循环连接；
+ * 否则连接条件中有可以作为哈希key的等值条件时使用哈希连接，都不满足时使用嵌套循环连接
+ *
+ * @param plan 算子树，连接条件已经下推到各个连接算子
+ */
+void Planner::choose_join_methods(std::shared_ptr<Plan> plan)
+{
+    if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        choose_join_methods(x->left_);
+        choose_join_methods(x->right_);
+        if (choose_merge_join(x) || choose_index_join(x)) {
+            return;
+        }
+        if (std::any_of(x->conds_.begin(), x->conds_.end(), [&](const Condition &cond) { return is_hash_join_cond(cond); })) {
+            x->tag = T_HashJoin;
+        }
     }
-    return std::make_shared<SortPlan>(T_Sort, std::move(plan), sel_col, 
-                                    x->order->orderby_dir == ast::OrderBy_DESC);
 }
 
+/**
+ * @brief 连接的两侧都是单表扫描，并且都能通过B+树索引按同一个等值连接条件中各自的字段升序扫描时，使用归并连接。
+ * 两侧的扫描改为按该顺序的索引扫描，所用的连接条件移到连接条件的最前面，作为归并的key
+ *
+ * @return 是否选择了归并连接
+ */
+bool Planner::choose_merge_join(std::shared_ptr<JoinPlan> join)
+{
+    auto left = std::dynamic_pointer_cast<ScanPlan>(join->left_);
+    auto right = std::dynamic_pointer_cast<ScanPlan>(join->right_);
+    if (left == nullptr || right == nullptr) {
+        return false;
+    }
+    for (auto cond = join->conds_.begin(); cond != join->conds_.end(); ++cond) {
+        if (!is_hash_join_cond(*cond)) {
+            continue;
+        }
+        bool lhs_left = cond->lhs_col.tab_name == left->tab_name_;
+        const IndexMeta *left_index = find_order_index(left, lhs_left ? cond->lhs_col : cond->rhs_col);
+        const IndexMeta *right_index = find_order_index(right, lhs_left ? cond->rhs_col : cond->lhs_col);
+        if (left_index == nullptr || right_index == nullptr) {
+            continue;
+        }
+        set_index_order(left, *left_index, false);
+        set_index_order(right, *right_index, false);
+        std::rotate(join->conds_.begin(), cond, cond + 1);
+        join->tag = T_MergeJoin;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 连接的一侧是单表扫描，并且该表上有只包含连接字段的B+树索引（TabMeta::is_index）时，以该表作为内层，
+ * 对外层的每个元组在索引上查找。两侧都满足时以左侧作为内层：左侧总是单表扫描，右侧可能是已经连接的结果
+ *
+ * @return 是否选择了索引嵌套循环连接
+ */
+bool Planner::choose_index_join(std::shared_ptr<JoinPlan> join)
+{
+    for (bool inner_left : {true, false}) {
+        auto scan = std::dynamic_pointer_cast<ScanPlan>(inner_left ? join->left_ : join->right_);
+        if (scan == nullptr) {
+            continue;
+        }
+        TabMeta &tab = sm_manager_->db_.get_table(scan->tab_name_);
+        for (auto &cond : join->conds_) {
+            if (!is_hash_join_cond(cond)) {
+                continue;
+            }
+            const TabCol &inner_col = cond.lhs_col.tab_name == scan->tab_name_ ? cond.lhs_col : cond.rhs_col;
+            std::vector<std::string> index_col_names{inner_col.col_name};
+            if (inner_col.tab_name != scan->tab_name_ || !tab.is_index(index_col_names) ||
+                tab.get_index_meta(index_col_names)->type != INDEX_BTREE) {
+                continue;
+            }
+            join->tag = T_IndexNestLoop;
+            join->inner_left_ = inner_left;
+            join->index_col_names_ = std::move(index_col_names);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 两个字段的等值连接条件，并且两个字段类型和长度相同，可以按字节比较连接key
+ */
+bool Planner::is_hash_join_cond(const Condition &cond)
+{
+    if (cond.is_rhs_val || cond.op != OP_EQ || cond.lhs_col.tab_name == cond.rhs_col.tab_name) {
+        return false;
+    }
+    auto lhs = sm_manager_->db_.get_table(cond.lhs_col.tab_name).get_col(cond.lhs_col.col_name);
+    auto rhs = sm_manager_->db_.get_table(cond.rhs_col.tab_name).get_col(cond.rhs_col.col_name);
+    return lhs->type == rhs->type && lhs->len == rhs->len;
+}
 
 /**
  * @brief select plan 生成
@@ -289,6 +568,10 @@ std::shared_ptr<Plan> Planner::generate_select_plan(std::shared_ptr<Query> query
     plannerRoot = std::make_shared<ProjectionPlan>(T_Projection, std::move(plannerRoot), 
                                                         std::move(sel_cols));
 
+    std::vector<TabCol> used_cols;
+    collect_used_cols(plannerRoot, used_cols);
+    choose_index_only_scans(plannerRoot, used_cols);
+
     return plannerRoot;
 }
 
@@ -315,7 +598,10 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
         plannerRoot = std::make_shared<DDLPlan>(T_DropTable, x->tab_name, std::vector<std::string>(), std::vector<ColDef>());
     } else if (auto x = std::dynamic_pointer_cast<ast::CreateIndex>(query->parse)) {
         // create index;
-        plannerRoot = std::make_shared<DDLPlan>(T_CreateIndex, x->tab_name, x->col_names, std::vector<ColDef>());
+        auto ddl_plan = std::make_shared<DDLPlan>(T_CreateIndex, x->tab_name, x->col_names, std::vector<ColDef>());
+        ddl_plan->unique_ = x->unique;
+        ddl_plan->index_type_ = x->method == ast::IndexMethod_HASH ? INDEX_HASH : INDEX_BTREE;
+        plannerRoot = ddl_plan;
     } else if (auto x = std::dynamic_pointer_cast<ast::DropIndex>(query->parse)) {
         // drop index
         plannerRoot = std::make_shared<DDLPlan>(T_DropIndex, x->tab_name, x->col_names, std::vector<ColDef>());
@@ -338,7 +624,8 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
                 std::make_shared<ScanPlan>(T_SeqScan, sm_manager_, x->tab_name, query->conds, index_col_names);
         } else {  // 存在索引
             table_scan_executors =
-                std::make_shared<ScanPlan>(T_IndexScan, sm_manager_, x->tab_name, query->conds, index_col_names);
+                std::make_shared<ScanPlan>(index_scan_tag(x->tab_name, index_col_names), sm_manager_, x->tab_name,
+                                           query->conds, index_col_names);
         }
 
         plannerRoot = std::make_shared<DMLPlan>(T_Delete, table_scan_executors, x->tab_name,  
@@ -358,7 +645,8 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
                 std::make_shared<ScanPlan>(T_SeqScan, sm_manager_, x->tab_name, query->conds, index_col_names);
         } else {  // 存在索引
             table_scan_executors =
-                std::make_shared<ScanPlan>(T_IndexScan, sm_manager_, x->tab_name, query->conds, index_col_names);
+                std::make_shared<ScanPlan>(index_scan_tag(x->tab_name, index_col_names), sm_manager_, x->tab_name,
+                                           query->conds, index_col_names);
         }
         plannerRoot = std::make_shared<DMLPlan>(T_Update, table_scan_executors, x->tab_name,
                                                      std::vector<Value>(), query->conds, 
@@ -43,13 +43,31 @@ class Planner {
     std::shared_ptr<Plan> make_one_rel(std::shared_ptr<Query> query);
 
     std::shared_ptr<Plan> generate_sort_plan(std::shared_ptr<Query> query, std::shared_ptr<Plan> plan);
+
+    bool use_index_order(std::shared_ptr<ScanPlan> scan, const TabCol &sel_col, bool is_desc);
+
+    const IndexMeta *find_order_index(std::shared_ptr<ScanPlan> scan, const TabCol &sel_col);
+
+    void set_index_order(std::shared_ptr<ScanPlan> scan, const IndexMeta &index, bool is_desc);
     
     std::shared_ptr<Plan> generate_select_plan(std::shared_ptr<Query> query, Context *context);
 
+    void choose_index_only_scans(std::shared_ptr<Plan> plan, const std::vector<TabCol> &used_cols);
+
+    void choose_join_methods(std::shared_ptr<Plan> plan);
+
+    bool choose_index_join(std::shared_ptr<JoinPlan> join);
+
+    bool choose_merge_join(std::shared_ptr<JoinPlan> join);
+
+    bool is_hash_join_cond(const Condition &cond);
+
 
     // int get_indexNo(std::string tab_name, std::vector<Condition> curr_conds);
     bool get_index_cols(std::string tab_name, std::vector<Condition> curr_conds, std::vector<std::string>& index_col_names);
 
+    PlanTag index_scan_tag(const std::string &tab_name, const std::vector<std::string> &index_col_names);
+
     ColType interp_sv_type(ast::SvType sv_type) {
         std::map<ast::SvType, ColType> m = {
             {ast::SV_TYPE_INT, TYPE_INT}, {ast::SV_TYPE_FLOAT, TYPE_FLOAT}, {ast::SV_TYPE_STRING, TYPE_STRING}};
@@ -90,11 +90,13 @@ private:
             std::cout << "DESC_TABLE\n";
             print_val(x->tab_name, offset);
         } else if (auto x = std::dynamic_pointer_cast<CreateIndex>(node)) {
-            std::cout << "CREATE_INDEX\n";
+            std::cout << (x->unique ? "CREATE_UNIQUE_INDEX\n" : "CREATE_INDEX\n");
             print_val(x->tab_name, offset);
             // print_val(x->col_name, offset);
             for(auto col_name: x->col_names)
                 print_val(col_name, offset);
+            if (x->method == IndexMethod_HASH)
+                print_val(std::string("USING_HASH"), offset);
         } else if (auto x = std::dynamic_pointer_cast<DropIndex>(node)) {
             std::cout << "DROP_INDEX\n";
             print_val(x->tab_name, offset);
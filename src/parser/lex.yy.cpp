@@ -1136,6 +1136,10 @@ case 42:
 YY_RULE_SETUP
 #line 95 "lex.l"
 {
+    // UNIQUE、USING、HASH只出现在CREATE INDEX语句中，在标识符中识别，不增加扫描器的规则
+    if (strcasecmp(yytext, "UNIQUE") == 0) return UNIQUE;
+    if (strcasecmp(yytext, "USING") == 0) return USING;
+    if (strcasecmp(yytext, "HASH") == 0) return HASH;
     yylval->sv_str = yytext;
     return IDENTIFIER;
 }
@@ -1143,7 +1147,7 @@ YY_RULE_SETUP
 /* literals */
 case 43:
 YY_RULE_SETUP
-#line 100 "lex.l"
+#line 104 "lex.l"
 {
     yylval->sv_int = atoi(yytext);
     return VALUE_INT;
@@ -1151,7 +1155,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 44:
 YY_RULE_SETUP
-#line 104 "lex.l"
+#line 108 "lex.l"
 {
     yylval->sv_float = atof(yytext);
     return VALUE_FLOAT;
@@ -1160,7 +1164,7 @@ YY_RULE_SETUP
 case 45:
 /* rule 45 can match eol */
 YY_RULE_SETUP
-#line 108 "lex.l"
+#line 112 "lex.l"
 {
     yylval->sv_str = std::string(yytext + 1, strlen(yytext) - 2);
     return VALUE_STRING;
@@ -1169,21 +1173,21 @@ YY_RULE_SETUP
 /* EOF */
 case YY_STATE_EOF(INITIAL):
 case YY_STATE_EOF(STATE_COMMENT):
-#line 113 "lex.l"
+#line 117 "lex.l"
 { return T_EOF; }
 	YY_BREAK
 /* unexpected char */
 case 46:
 YY_RULE_SETUP
-#line 115 "lex.l"
+#line 119 "lex.l"
 { std::cerr << "Lexer Error: unexpected character " << yytext[0] << std::endl; }
 	YY_BREAK
 case 47:
 YY_RULE_SETUP
-#line 116 "lex.l"
+#line 120 "lex.l"
 ECHO;
 	YY_BREAK
-#line 1186 "/Users/sxy/Documents/projects/rucbase/src/parser/lex.yy.cpp"
+#line 1190 "/Users/sxy/Documents/projects/rucbase/src/parser/lex.yy.cpp"
 
 	case YY_END_OF_BUFFER:
 		{
@@ -2149,6 +2153,6 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 116 "lex.l"
+#line 120 "lex.l"
 
 
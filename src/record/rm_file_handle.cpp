@@ -21,8 +21,9 @@ std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid& rid, Context* cont
     context->lock_mgr_->lock_IS_on_table(context->txn_,fd_);
     context->lock_mgr_->lock_shared_on_record(context->txn_,rid,fd_);
 
-    // 获取包含指定记录的页面句柄
-    RmPageHandle temp = fetch_page_handle(rid.page_no);
+    // 获取包含指定记录的页面，只读访问，guard离开作用域时自动unpin
+    ReadPageGuard guard = fetch_page_read(rid.page_no);
+    RmPageHandle temp(&file_hdr_, guard.get_page());
     
     // 检查记录槽位是否被占用；如果未被占用，则抛出记录未找到的异常
     if(!Bitmap::is_set(temp.bitmap, rid.slot_no)){
@@ -49,13 +50,19 @@ Rid RmFileHandle::insert_record(char* buf, Context* context)
 {
     
     context->lock_mgr_->lock_IX_on_table(context->txn_,fd_);
-    context->lock_mgr_->lock_exclusive_on_table(context->txn_,fd_);
+
+    // 选择空闲页面和槽位期间持有file_latch_，防止多个线程同时修改空闲页面链表
+    std::scoped_lock lock{file_latch_};
     
-    // 创建一个新的页面句柄
+    // 获取一个有空闲槽位的页面句柄，句柄持有页面的写latch
     RmPageHandle temp = create_page_handle();
     
     // 在页面句柄中找到空闲的槽位
     int slot_no = Bitmap::first_bit(false, temp.bitmap, file_hdr_.num_records_per_page);
+    Rid rid{temp.page->get_page_id().page_no, slot_no};
+
+    // 修改页面之前先对新记录加排他锁，加锁失败时事务回滚，页面保持不变
+    context->lock_mgr_->lock_exclusive_on_record(context->txn_, rid, fd_);
     
     // 将找到的槽位设置为占用
     Bitmap::set(temp.bitmap, slot_no);
@@ -73,7 +80,7 @@ Rid RmFileHandle::insert_record(char* buf, Context* context)
     memcpy(slot, buf, file_hdr_.record_size);
     
     // 返回新记录的位置信息（页面号和槽号）
-    return Rid{temp.page->get_page_id().page_no, slot_no};
+    return rid;
 }
 
 /**
@@ -83,31 +90,30 @@ Rid RmFileHandle::insert_record(char* buf, Context* context)
  */
 void RmFileHandle::insert_record(const Rid& rid, char* buf) 
 {
-    // 如果指定页面号超过已有页面数量，创建一个新页面句柄
-    if(rid.page_no < file_hdr_.num_pages){
+    std::scoped_lock lock{file_latch_};
+
+    // 如果指定页面号超过已有页面数量，创建新页面直到该页面存在
+    while(rid.page_no >= file_hdr_.num_pages){
         create_new_page_handle();
     }
     
     // 获取指定页面的句柄
     RmPageHandle temp = fetch_page_handle(rid.page_no);
     
-    // 将指定的槽位设置为占用
-    Bitmap::set(temp.bitmap, rid.slot_no);
-    
-    // 增加页面中记录的数量
-    temp.page_hdr->num_records++;
-    
-    // 如果页面已满，更新文件头的第一个空闲页面号
-    if(temp.page_hdr->num_records == file_hdr_.num_records_per_page){
-        file_hdr_.first_free_page_no = temp.page_hdr->next_free_page_no;
+    // 槽位空闲时将其设置为占用，并增加页面中记录的数量
+    if (!Bitmap::is_set(temp.bitmap, rid.slot_no)) {
+        Bitmap::set(temp.bitmap, rid.slot_no);
+        temp.page_hdr->num_records++;
+        
+        // 如果页面已满，把它从空闲页面链表中摘除，它不一定是链表的第一个页面
+        if(temp.page_hdr->num_records == file_hdr_.num_records_per_page){
+            unlink_free_page(temp);
+        }
     }
     
-    // 将数据复制到指定的槽位
+    // 将数据复制到指定的槽位，temp析构时解除页面的固定，并将其标记为已修改
     char *slot = temp.get_slot(rid.slot_no);
     memcpy(slot, buf, file_hdr_.record_size);
-    
-    // 解除页面的固定，并将其标记为已修改
-    buffer_pool_manager_->unpin_page(temp.page->get_page_id(), true);
 }
 
 /**
@@ -121,14 +127,21 @@ void RmFileHandle::delete_record(const Rid& rid, Context* context)
     context->lock_mgr_->lock_exclusive_on_record(context->txn_,rid,fd_);
 
     // 获取包含指定记录的页面句柄
+    std::unique_lock<std::mutex> lock{file_latch_, std::defer_lock};
     RmPageHandle temp = fetch_page_handle(rid.page_no);
+    if (temp.page_hdr->num_records == file_hdr_.num_records_per_page) {
+        // 删除后页面需要加入空闲页面链表，按先file_latch_后页面latch的顺序重新获取页面
+        temp.guard.drop();
+        lock.lock();
+        temp = fetch_page_handle(rid.page_no);
+    }
     
     // 检查记录槽位是否被占用；如果未被占用，则抛出记录未找到的异常
     if(!Bitmap::is_set(temp.bitmap, rid.slot_no)){
         throw RecordNotFoundError(rid.page_no, rid.slot_no);
     }
     
-    // 如果页面已满，更新文件头的第一个空闲页面号
+    // 如果页面已满，更新文件头的第一个空闲页面号（此时一定持有file_latch_）
     if(temp.page_hdr->num_records == file_hdr_.num_records_per_page){
         release_page_handle(temp);
     }
@@ -165,43 +178,62 @@ void RmFileHandle::update_record(const Rid& rid, char* buf, Context* context)
 }
 
 /**
- * 辅助函数：获取指定页面的页面句柄
+ * 辅助函数：获取指定页面的页面句柄，用于修改页面
  * @param {int} page_no 页面号
- * @return {RmPageHandle} 指定页面的句柄
+ * @return {RmPageHandle} 指定页面的句柄，持有页面的写latch，析构时释放latch，unpin页面并标记为脏页
  */
 RmPageHandle RmFileHandle::fetch_page_handle(int page_no) const {
     // 检查页面号是否合法，如果非法则抛出页面不存在异常
-    if (page_no < 0 || page_no >= file_hdr_.num_pages) {
+    if (page_no < 0 || page_no >= get_num_pages()) {
         throw PageNotExistError("??", page_no);
     }
     
-    // 使用缓冲池获取指定页面并生成页面句柄返回
-    PageId page_id;
-    page_id.fd = fd_;
-    page_id.page_no = page_no;
-    Page* page = buffer_pool_manager_->fetch_page(page_id);
-    
-    return RmPageHandle(&file_hdr_, page);
+    // 使用缓冲池获取指定页面并生成页面句柄返回，句柄析构时unpin页面并标记为脏页
+    WritePageGuard guard = buffer_pool_manager_->fetch_page_write(PageId{fd_, page_no});
+    if (!guard.is_valid()) {
+        throw InternalError("RmFileHandle::fetch_page_handle Error: no free frame in buffer pool");
+    }
+    return RmPageHandle(&file_hdr_, std::move(guard));
+}
+
+/**
+ * 辅助函数：以只读方式获取指定页面
+ * @param {int} page_no 页面号
+ * @return {ReadPageGuard} 指定页面的guard，持有页面的读latch，离开作用域时释放latch并unpin页面
+ */
+ReadPageGuard RmFileHandle::fetch_page_read(int page_no) const {
+    if (page_no < 0 || page_no >= get_num_pages()) {
+        throw PageNotExistError("??", page_no);
+    }
+    ReadPageGuard guard = buffer_pool_manager_->fetch_page_read(PageId{fd_, page_no});
+    if (!guard.is_valid()) {
+        throw InternalError("RmFileHandle::fetch_page_read Error: no free frame in buffer pool");
+    }
+    return guard;
 }
 
 /**
- * 辅助函数：创建一个新的页面句柄
+ * 辅助函数：创建一个新的页面句柄，调用者需要持有file_latch_
  * @return {RmPageHandle} 新的页面句柄
  */
 RmPageHandle RmFileHandle::create_new_page_handle() {
     // 创建新的页面ID并使用缓冲池分配一个新页面
-    PageId *page_id = new PageId;
-    page_id->fd = fd_;
-    Page* page = buffer_pool_manager_->new_page(page_id);
+    PageId page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+    WritePageGuard guard = buffer_pool_manager_->new_page_guarded(&page_id);
+    if (!guard.is_valid()) {
+        throw InternalError("RmFileHandle::create_new_page_handle Error: no free frame in buffer pool");
+    }
+    Page* page = guard.get_page();
     
     // 初始化新页面的句柄和相关信息
-    RmPageHandle temp = RmPageHandle(&file_hdr_, page);
+    RmPageHandle temp = RmPageHandle(&file_hdr_, std::move(guard));
     temp.page_hdr->num_records = 0;
     temp.page_hdr->next_free_page_no = RM_NO_PAGE;
     Bitmap::init(temp.bitmap, file_hdr_.bitmap_size);
     
     // 更新文件头中的页面数量和第一个空闲页面号
     file_hdr_.num_pages++;
+    num_pages_ = file_hdr_.num_pages;
     file_hdr_.first_free_page_no = page->get_page_id().page_no;
     
     return temp;
@@ -211,7 +243,7 @@ RmPageHandle RmFileHandle::create_new_page_handle() {
  * @brief 创建或获取一个空闲的页面句柄
  *
  * @return RmPageHandle 返回生成的空闲页面句柄
- * @note 固定页面，记得在外部解锁！
+ * @note 页面的pin和写latch由句柄持有，句柄析构时自动释放；调用者需要持有file_latch_
  */
 RmPageHandle RmFileHandle::create_page_handle() {
     // 如果没有空闲页面，则创建一个新的页面句柄
@@ -223,6 +255,30 @@ RmPageHandle RmFileHandle::create_page_handle() {
     }
 }
 
+/**
+ * @description: 页面变满时把它从空闲页面链表中摘除，调用者需要持有file_latch_。
+ * 页面不是链表的第一个页面时，沿链表找到它的前驱并修改前驱的下一个空闲页面号
+ */
+void RmFileHandle::unlink_free_page(RmPageHandle& page_handle) {
+    int page_no = page_handle.page->get_page_id().page_no;
+    int next_free_page_no = page_handle.page_hdr->next_free_page_no;
+    page_handle.page_hdr->next_free_page_no = RM_NO_PAGE;
+    if (file_hdr_.first_free_page_no == page_no) {
+        file_hdr_.first_free_page_no = next_free_page_no;
+        return;
+    }
+    // 持有file_latch_时其他线程最多持有一个页面的latch且不会等待其他页面，可以再获取前驱页面的latch
+    int prev_page_no = file_hdr_.first_free_page_no;
+    while (prev_page_no != RM_NO_PAGE) {
+        RmPageHandle prev = fetch_page_handle(prev_page_no);
+        if (prev.page_hdr->next_free_page_no == page_no) {
+            prev.page_hdr->next_free_page_no = next_free_page_no;
+            return;
+        }
+        prev_page_no = prev.page_hdr->next_free_page_no;
+    }
+}
+
 /**
  * @description: 当一个页面从没有空闲空间的状态变为有空闲空间状态时，更新文件头和页头中空闲页面相关的元数据
  */
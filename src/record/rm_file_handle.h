@@ -12,7 +12,9 @@ See the Mulan PSL v2 for more details. */
 
 #include <assert.h>
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 #include "bitmap.h"
 #include "common/context.h"
@@ -27,6 +29,7 @@ struct RmPageHandle {
     RmPageHdr *page_hdr;        // page->data的第一部分，存储页面元信息，指针指向首地址，长度为sizeof(RmPageHdr)
     char *bitmap;               // page->data的第二部分，存储页面的bitmap，指针指向首地址，长度为file_hdr->bitmap_size
     char *slots;                // page->data的第三部分，存储表的记录，指针指向首地址，每个slot的长度为file_hdr->record_size
+    WritePageGuard guard;       // 页面的pin，句柄析构时unpin页面并标记为脏页；只读访问时为空，由调用者持有ReadPageGuard
 
     RmPageHandle(const RmFileHdr *fhdr_, Page *page_) : file_hdr(fhdr_), page(page_) {
         page_hdr = reinterpret_cast<RmPageHdr *>(page->get_data() + page->OFFSET_PAGE_HDR);
@@ -34,6 +37,10 @@ struct RmPageHandle {
         slots = bitmap + file_hdr->bitmap_size;
     }
 
+    RmPageHandle(const RmFileHdr *fhdr_, WritePageGuard &&guard_) : RmPageHandle(fhdr_, guard_.get_page()) {
+        guard = std::move(guard_);
+    }
+
     // 返回指定slot_no的slot存储收地址
     char* get_slot(int slot_no) const {
         return slots + slot_no * file_hdr->record_size;  // slots的首地址 + slot个数 * 每个slot的大小(每个record的大小)
@@ -50,6 +57,8 @@ class RmFileHandle {
     BufferPoolManager *buffer_pool_manager_;
     int fd_;        // 打开文件后产生的文件句柄
     RmFileHdr file_hdr_;    // 文件头，维护当前表文件的元数据
+    std::mutex file_latch_; // 保护文件头中的页面数量和空闲页面链表；需要同时持有页面latch时，先获取file_latch_
+    std::atomic<int> num_pages_;    // file_hdr_.num_pages的副本，在file_latch_下与其一同修改，供不持有file_latch_的读者使用
 
    public:
     RmFileHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
@@ -58,6 +67,7 @@ class RmFileHandle {
         // 这里实际就是初始化file_hdr，只不过是从磁盘中读出进行初始化
         // init file_hdr_
         disk_manager_->read_page(fd, RM_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
+        num_pages_ = file_hdr_.num_pages;
         // disk_manager管理的fd对应的文件中，设置从file_hdr_.num_pages开始分配page_no
         disk_manager_->set_fd2pageno(fd, file_hdr_.num_pages);
     }
@@ -65,9 +75,13 @@ class RmFileHandle {
     RmFileHdr get_file_hdr() { return file_hdr_; }
     int GetFd() { return fd_; }
 
+    /* 文件中已分配的页面个数，不需要持有file_latch_ */
+    int get_num_pages() const { return num_pages_.load(); }
+
     /* 判断指定位置上是否已经存在一条记录，通过Bitmap来判断 */
     bool is_record(const Rid &rid) const {
-        RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+        ReadPageGuard guard = fetch_page_read(rid.page_no);
+        RmPageHandle page_handle(&file_hdr_, guard.get_page());
         return Bitmap::is_set(page_handle.bitmap, rid.slot_no);  // page的slot_no位置上是否有record
     }
 
@@ -85,8 +99,12 @@ class RmFileHandle {
 
     RmPageHandle fetch_page_handle(int page_no) const;
 
+    ReadPageGuard fetch_page_read(int page_no) const;
+
    private:
     RmPageHandle create_page_handle();
 
     void release_page_handle(RmPageHandle &page_handle);
+
+    void unlink_free_page(RmPageHandle &page_handle);
 };
\ No newline at end of file
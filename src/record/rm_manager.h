@@ -79,6 +79,7 @@ class RmManager {
                                   sizeof(file_handle->file_hdr_));
         // 缓冲区的所有页刷到磁盘，注意这句话必须写在close_file前面
         buffer_pool_manager_->flush_all_pages(file_handle->fd_);
+        buffer_pool_manager_->discard_all_pages(file_handle->fd_);
         disk_manager_->close_file(file_handle->fd_);
     }
     
@@ -15,7 +15,11 @@ See the Mulan PSL v2 for more details. */
  * @brief 初始化file_handle和rid
  * @param file_handle
  */
-RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle) 
+RmScan::RmScan(const RmFileHandle *file_handle)
+    : file_handle_(file_handle),
+      readahead_window_(READAHEAD_MIN_PAGES),
+      readahead_next_(RM_FIRST_RECORD_PAGE),
+      readahead_trigger_(RM_FIRST_RECORD_PAGE) 
 {
     // Todo:
     // 初始化file_handle和rid（指向第一个存放了记录的位置）
@@ -30,9 +34,11 @@ void RmScan::next()
 {
     // Todo:
     // 找到文件中下一个存放了记录的非空闲位置，用rid_来指向这个位置
-    while(rid_.page_no<file_handle_->file_hdr_.num_pages)
+    while(rid_.page_no<file_handle_->get_num_pages())
     {
-        RmPageHandle temp = file_handle_->fetch_page_handle(rid_.page_no);
+        readahead(rid_.page_no);
+        ReadPageGuard guard = file_handle_->fetch_page_read(rid_.page_no);
+        RmPageHandle temp(&file_handle_->file_hdr_, guard.get_page());
         rid_.slot_no = Bitmap::next_bit(true,temp.bitmap,file_handle_->file_hdr_.num_records_per_page,rid_.slot_no);
         if(rid_.slot_no<file_handle_->file_hdr_.num_records_per_page){
             return;
@@ -44,6 +50,24 @@ void RmScan::next()
     rid_.page_no = RM_NO_PAGE;
 }
 
+/**
+ * @description: 扫描进入上一个预读窗口的后半段时，异步预读下一个窗口，使读盘与扫描重叠；
+ * 窗口从READAHEAD_MIN_PAGES开始每次加倍，直到READAHEAD_MAX_PAGES
+ * @param {page_id_t} page_no 扫描即将访问的页面
+ */
+void RmScan::readahead(page_id_t page_no) {
+    if (page_no < readahead_trigger_) {
+        return;
+    }
+    int count = std::min(readahead_window_, file_handle_->get_num_pages() - readahead_next_);
+    if (count > 0) {
+        file_handle_->buffer_pool_manager_->prefetch(file_handle_->fd_, readahead_next_, count);
+    }
+    readahead_trigger_ = readahead_next_ + readahead_window_ / 2;
+    readahead_next_ += readahead_window_;
+    readahead_window_ = std::min(readahead_window_ * 2, READAHEAD_MAX_PAGES);
+}
+
 /**
  * @brief ​ 判断是否到达文件末尾
  */
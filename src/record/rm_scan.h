@@ -19,6 +19,13 @@ class RmScan : public RecScan
     const RmFileHandle *file_handle_;
     Rid rid_;
 
+    // 顺序预读：扫描到达readahead_trigger_时预读从readahead_next_开始的readahead_window_个页面，并将窗口加倍
+    int readahead_window_;
+    page_id_t readahead_next_;
+    page_id_t readahead_trigger_;
+
+    void readahead(page_id_t page_no);
+
    public:
     RmScan(const RmFileHandle *file_handle);
 
@@ -0,0 +1,119 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "clock_replacer.h"
+
+ClockReplacer::ClockReplacer(size_t num_pages)
+    : in_replacer_(num_pages, false), ref_bit_(num_pages, false), hand_(0), size_(0), max_size_(num_pages) {}
+
+ClockReplacer::~ClockReplacer() = default;
+
+/**
+ * @description: 使用CLOCK策略选择一个victim frame：时钟指针跳过被固定的frame，
+ * 遇到访问位为1的frame则清零后跳过，遇到访问位为0的frame即将其淘汰。
+ * 每次扫描最多清零size_个访问位，因此均摊复杂度为O(1)
+ * @param {frame_id_t*} frame_id 被移除的frame的id
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool ClockReplacer::victim(frame_id_t *frame_id) {
+    std::scoped_lock lock{latch_};
+
+    if (size_ == 0) {
+        return false;
+    }
+    while (true) {
+        size_t cur = hand_;
+        hand_ = (hand_ + 1) % max_size_;
+        if (!in_replacer_[cur]) {
+            continue;
+        }
+        if (ref_bit_[cur]) {
+            ref_bit_[cur] = false;  // 给予第二次机会
+            continue;
+        }
+        in_replacer_[cur] = false;
+        size_--;
+        *frame_id = static_cast<frame_id_t>(cur);
+        return true;
+    }
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void ClockReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+
+    // 如果该frame不在replacer中，直接返回
+    if (!in_replacer_[frame_id]) {
+        return;
+    }
+    in_replacer_[frame_id] = false;
+    size_--;
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰，同时置位其访问位
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void ClockReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+
+    // 如果该frame已经在replacer中，直接返回
+    if (in_replacer_[frame_id]) {
+        return;
+    }
+    in_replacer_[frame_id] = true;
+    ref_bit_[frame_id] = true;
+    size_++;
+}
+
+/**
+ * @description: 移除一个页面已被删除的frame，并清除其访问位
+ * @param {frame_id_t} frame_id 需要移除的frame的id
+ */
+void ClockReplacer::remove(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+
+    if (in_replacer_[frame_id]) {
+        in_replacer_[frame_id] = false;
+        size_--;
+    }
+    ref_bit_[frame_id] = false;
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t ClockReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return size_;
+}
+
+/**
+ * @description: 按淘汰顺序列出至多max_num个可以被淘汰的frame，不移除它们也不修改访问位：
+ * 先是从时钟指针开始访问位为0的frame，再是访问位为1的frame（它们要在下一圈才会被淘汰）
+ * @return {size_t} 实际列出的frame数量
+ */
+size_t ClockReplacer::victim_candidates(frame_id_t *frame_ids, size_t max_num) {
+    std::scoped_lock lock{latch_};
+    size_t num = 0;
+    for (int round = 0; round < 2; round++) {
+        bool want_ref = (round == 1);
+        for (size_t i = 0; i < max_size_ && num < max_num; i++) {
+            size_t cur = (hand_ + i) % max_size_;
+            if (in_replacer_[cur] && ref_bit_[cur] == want_ref) {
+                frame_ids[num++] = static_cast<frame_id_t>(cur);
+            }
+        }
+    }
+    return num;
+}
@@ -77,7 +77,26 @@ void LRUReplacer::unpin(frame_id_t frame_id) {
     LRUhash_[frame_id] = LRUlist_.begin(); // 更新hash表,将frame_id映射到LRUlist的头部,表示最近被访问
 }
 
+/**
+ * @description: 移除一个页面已被删除的frame，LRU不记录访问历史，与pin相同
+ * @param {frame_id_t} frame_id 需要移除的frame的id
+ */
+void LRUReplacer::remove(frame_id_t frame_id) { pin(frame_id); }
+
 /**
  * @description: 获取当前replacer中可以被淘汰的页面数量
  */
 size_t LRUReplacer::Size() { return LRUlist_.size(); }
+
+/**
+ * @description: 按淘汰顺序（从最久未使用开始）列出至多max_num个可以被淘汰的frame，不移除它们
+ * @return {size_t} 实际列出的frame数量
+ */
+size_t LRUReplacer::victim_candidates(frame_id_t *frame_ids, size_t max_num) {
+    std::scoped_lock lock{latch_};
+    size_t num = 0;
+    for (auto iter = LRUlist_.rbegin(); iter != LRUlist_.rend() && num < max_num; ++iter) {
+        frame_ids[num++] = *iter;
+    }
+    return num;
+}
@@ -37,8 +37,12 @@ class LRUReplacer : public Replacer {
 
     void unpin(frame_id_t frame_id);
 
+    void remove(frame_id_t frame_id);
+
     size_t Size();
 
+    size_t victim_candidates(frame_id_t *frame_ids, size_t max_num);
+
    private:
     std::mutex latch_;                  // 互斥锁
     std::list<frame_id_t> LRUlist_;     // 按加入的时间顺序存放unpinned pages的frame id，首部表示最近被访问
@@ -39,6 +39,22 @@ class Replacer {
      */
     virtual void unpin(frame_id_t frame_id) = 0;
 
+    /**
+     * Removes a frame whose page has been dropped from the buffer pool. Unlike pin, this does not count as an
+     * access: the frame's access history is cleared so that the next page loaded into it starts afresh.
+     * @param frame_id the id of the frame to remove
+     */
+    virtual void remove(frame_id_t frame_id) = 0;
+
     /** @return the number of elements in the replacer that can be victimized */
     virtual size_t Size() = 0;
+
+    /**
+     * Lists the frames that would be victimized next, in eviction order, without removing them.
+     * Used by the background flusher to clean cold dirty pages ahead of eviction.
+     * @param[out] frame_ids caller-provided array with room for at least max_num frames
+     * @param max_num the maximum number of frames to list
+     * @return the number of frames written to frame_ids
+     */
+    virtual size_t victim_candidates(frame_id_t *frame_ids, size_t max_num) = 0;
 };
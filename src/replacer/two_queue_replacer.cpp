@@ -0,0 +1,165 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "two_queue_replacer.h"
+
+TwoQueueReplacer::TwoQueueReplacer(size_t num_pages)
+    : prev_(num_pages, INVALID_FRAME_ID),
+      next_(num_pages, INVALID_FRAME_ID),
+      queue_(num_pages, QUEUE_NONE),
+      in_list_(num_pages, false),
+      a1_seq_(num_pages, 0),
+      a1_counter_(0),
+      max_size_(num_pages) {
+    // 经典2Q建议A1in占缓冲池的25%
+    kin_ = std::max<size_t>(1, num_pages / 4);
+}
+
+TwoQueueReplacer::~TwoQueueReplacer() = default;
+
+void TwoQueueReplacer::list_push_back(FrameList &list, frame_id_t frame_id) {
+    prev_[frame_id] = list.tail;
+    next_[frame_id] = INVALID_FRAME_ID;
+    if (list.tail != INVALID_FRAME_ID) {
+        next_[list.tail] = frame_id;
+    } else {
+        list.head = frame_id;
+    }
+    list.tail = frame_id;
+    list.size++;
+}
+
+void TwoQueueReplacer::list_remove(FrameList &list, frame_id_t frame_id) {
+    if (prev_[frame_id] != INVALID_FRAME_ID) {
+        next_[prev_[frame_id]] = next_[frame_id];
+    } else {
+        list.head = next_[frame_id];
+    }
+    if (next_[frame_id] != INVALID_FRAME_ID) {
+        prev_[next_[frame_id]] = prev_[frame_id];
+    } else {
+        list.tail = prev_[frame_id];
+    }
+    prev_[frame_id] = next_[frame_id] = INVALID_FRAME_ID;
+    list.size--;
+}
+
+/**
+ * @description: 使用2Q策略删除一个victim frame，并返回该frame的id
+ * @param {frame_id_t*} frame_id 被移除的frame的id
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool TwoQueueReplacer::victim(frame_id_t *frame_id) {
+    std::scoped_lock lock{latch_};
+
+    FrameList *list;
+    if (a1_.size > 0 && (a1_.size >= kin_ || am_.size == 0)) {
+        list = &a1_;
+    } else if (am_.size > 0) {
+        list = &am_;
+    } else {
+        return false;
+    }
+    *frame_id = list->head;
+    list_remove(*list, *frame_id);
+    in_list_[*frame_id] = false;
+    queue_[*frame_id] = QUEUE_NONE;  // frame将装入新的页面，清空访问历史
+    return true;
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰；同时记录一次访问，决定frame所属的队列
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void TwoQueueReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+
+    if (in_list_[frame_id]) {
+        list_remove(list_of(frame_id), frame_id);
+        in_list_[frame_id] = false;
+    }
+    if (queue_[frame_id] == QUEUE_NONE) {
+        queue_[frame_id] = QUEUE_A1;
+        a1_seq_[frame_id] = ++a1_counter_;
+    } else if (queue_[frame_id] == QUEUE_A1 && a1_counter_ - a1_seq_[frame_id] >= kin_) {
+        // 已经离开逻辑上的A1in后再次被访问，不属于相关访问
+        queue_[frame_id] = QUEUE_AM;
+    }
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void TwoQueueReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+
+    // 如果该frame已经在replacer中，直接返回
+    if (in_list_[frame_id]) {
+        return;
+    }
+    if (queue_[frame_id] == QUEUE_NONE) {
+        // 未经pin直接unpin的frame视为第一次访问
+        queue_[frame_id] = QUEUE_A1;
+        a1_seq_[frame_id] = ++a1_counter_;
+    }
+    list_push_back(list_of(frame_id), frame_id);
+    in_list_[frame_id] = true;
+}
+
+/**
+ * @description: 移除一个页面已被删除的frame，不记录访问，并清空其所属队列，
+ * 否则帧被复用时装入的新页面会被误判为再次访问而直接进入Am
+ * @param {frame_id_t} frame_id 需要移除的frame的id
+ */
+void TwoQueueReplacer::remove(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+
+    if (in_list_[frame_id]) {
+        list_remove(list_of(frame_id), frame_id);
+        in_list_[frame_id] = false;
+    }
+    queue_[frame_id] = QUEUE_NONE;
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t TwoQueueReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return a1_.size + am_.size;
+}
+
+/**
+ * @description: 按victim()的规则依次列出至多max_num个将被淘汰的frame，不移除它们
+ * @return {size_t} 实际列出的frame数量
+ */
+size_t TwoQueueReplacer::victim_candidates(frame_id_t *frame_ids, size_t max_num) {
+    std::scoped_lock lock{latch_};
+    size_t num = 0;
+    size_t a1_left = a1_.size;
+    size_t am_left = am_.size;
+    frame_id_t a1_cur = a1_.head;
+    frame_id_t am_cur = am_.head;
+    while (num < max_num) {
+        if (a1_left > 0 && (a1_left >= kin_ || am_left == 0)) {
+            frame_ids[num++] = a1_cur;
+            a1_cur = next_[a1_cur];
+            a1_left--;
+        } else if (am_left > 0) {
+            frame_ids[num++] = am_cur;
+            am_cur = next_[am_cur];
+            am_left--;
+        } else {
+            break;
+        }
+    }
+    return num;
+}
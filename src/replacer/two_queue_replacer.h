@@ -0,0 +1,76 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+#include "replacer/replacer.h"
+
+/*
+TwoQueueReplacer实现了2Q替换策略，用于抵抗顺序扫描对缓冲池的污染：
+  - 页面载入后第一次被访问时进入A1队列（FIFO），扫描产生的页面只会停留在A1中并被优先淘汰；
+  - 页面在A1中"老化"（此后又有kin_个页面进入A1）之后再次被访问，说明它不是扫描中的相关访问，提升到Am队列（LRU）；
+  - 淘汰时，若A1中可淘汰的frame数量达到kin_或Am为空，则淘汰A1队首，否则淘汰Am中最久未使用的frame。
+replacer只能看到frame而看不到PageId，因此用"进入A1后经过的A1入队次数"代替经典2Q中的A1out幽灵队列。
+两个队列都是建立在定长数组上的侵入式双向链表，victim/pin/unpin均为O(1)且不申请内存。
+*/
+class TwoQueueReplacer : public Replacer {
+   public:
+    /**
+     * @description: 创建一个新的TwoQueueReplacer
+     * @param {size_t} num_pages TwoQueueReplacer最多需要存储的page数量，frame_id必须小于该值
+     */
+    explicit TwoQueueReplacer(size_t num_pages);
+
+    ~TwoQueueReplacer();
+
+    bool victim(frame_id_t *frame_id);
+
+    void pin(frame_id_t frame_id);
+
+    void unpin(frame_id_t frame_id);
+
+    void remove(frame_id_t frame_id);
+
+    size_t Size();
+
+    size_t victim_candidates(frame_id_t *frame_ids, size_t max_num);
+
+   private:
+    enum QueueType { QUEUE_NONE = 0, QUEUE_A1, QUEUE_AM };
+
+    struct FrameList {
+        frame_id_t head = INVALID_FRAME_ID;    // 队首，最先被淘汰
+        frame_id_t tail = INVALID_FRAME_ID;    // 队尾，最近加入
+        size_t size = 0;
+    };
+
+    void list_push_back(FrameList &list, frame_id_t frame_id);
+
+    void list_remove(FrameList &list, frame_id_t frame_id);
+
+    FrameList &list_of(frame_id_t frame_id) { return queue_[frame_id] == QUEUE_A1 ? a1_ : am_; }
+
+    std::mutex latch_;                  // 互斥锁
+    std::vector<frame_id_t> prev_;      // 侵入式链表的前驱
+    std::vector<frame_id_t> next_;      // 侵入式链表的后继
+    std::vector<QueueType> queue_;      // frame当前所属的队列，QUEUE_NONE表示自上次被淘汰后尚未被访问
+    std::vector<bool> in_list_;         // frame是否处于unpinned状态，即是否在链表中
+    std::vector<size_t> a1_seq_;        // frame进入A1时的a1_counter_
+    size_t a1_counter_;                 // 累计进入A1的次数
+    FrameList a1_;                      // 只被访问过一次的frame
+    FrameList am_;                      // 被多次访问的frame
+    size_t kin_;                        // A1的目标容量，也是判断相关访问的距离
+    size_t max_size_;                   // 最大容量（与缓冲池的容量相同）
+};
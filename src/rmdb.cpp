@@ -31,7 +31,7 @@ static bool should_exit = false;
 
 // 构建全局所需的管理器对象
 auto disk_manager = std::make_unique<DiskManager>();
-auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get(), BUFFER_POOL_SHARDS);
 auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
 auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
 auto sm_manager = std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
@@ -296,6 +296,10 @@ int main(int argc, char **argv) {
         recovery->analyze();
         recovery->redo();
         recovery->undo();
+
+        // 恢复完成后再启动后台刷脏线程
+        buffer_pool_manager->start_flusher(BUFFER_POOL_MIN_CLEAN_FRAMES,
+                                           std::chrono::milliseconds(BUFFER_POOL_FLUSH_INTERVAL_MS));
         
         // 开启服务端，开始接受客户端连接
         start_server();
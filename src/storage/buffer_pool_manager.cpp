@@ -11,39 +11,48 @@ See the Mulan PSL v2 for more details. */
 #include "buffer_pool_manager.h"
 
 /**
- * @description: 从free_list或replacer中得到可淘汰帧页的 *frame_id
+ * @description: 从分区的free_list或replacer中得到可淘汰帧页的 *frame_id，调用者需持有shard.latch_
  * @return {bool} true: 可替换帧查找成功 , false: 可替换帧查找失败
- * @param {frame_id_t*} frame_id 帧页id指针,返回成功找到的可替换帧id
+ * @param {BufferPoolShard&} shard 目标分区
+ * @param {frame_id_t*} frame_id 帧页id指针,返回成功找到的可替换帧id（分区内编号）
  */
-bool BufferPoolManager::find_victim_page(frame_id_t* frame_id) {
+bool BufferPoolManager::find_victim_page(BufferPoolShard &shard, frame_id_t* frame_id) {
     // Todo:
     // 1 使用BufferPoolManager::free_list_判断缓冲池是否已满需要淘汰页面
     // 1.1 未满获得frame
     // 1.2 已满使用lru_replacer中的方法选择淘汰页面
 
-    if (free_list_.empty()) 
+    if (shard.free_list_.empty()) 
     {
-        if (!replacer_->victim(frame_id)) 
+        while (shard.replacer_->victim(frame_id)) 
         {
-            return false;
+            // 后台刷脏线程正在写回的页面带着pin留在replacer中，跳过它，写回结束释放pin时会重新放回replacer
+            if (shard.pages_[*frame_id].pin_count_ == 0) 
+            {
+                return true;
+            }
         }
+        return false;
     } 
     else 
     {
-        *frame_id = free_list_.front();
-        free_list_.pop_front();
+        *frame_id = shard.free_list_.front();
+        shard.free_list_.pop_front();
     }
     return true;
 }
 
 /**
  * @description: 更新页面数据, 如果为脏页则需写入磁盘，再更新为新页面，更新page元数据(data, is_dirty, page_id)和page
- * table
+ * table。写回脏页时，把分区中接下来将被淘汰的脏页一起按页面顺序合并写回，之后淘汰它们时无需再同步写盘。
+ * page必须属于shard，调用者需持有shard.latch_。返回时page的版本号仍为奇数（见PageLatch::begin_reload），
+ * 调用者在新页面可以读取（或读入失败）之后调用end_reload
+ * @param {BufferPoolShard&} shard page所在的分区
  * @param {Page*} page 写回页指针
  * @param {PageId} new_page_id 新的page_id
  * @param {frame_id_t} new_frame_id 新的帧frame_id
  */
-void BufferPoolManager::update_page(Page* page, PageId new_page_id, frame_id_t new_frame_id) {
+void BufferPoolManager::update_page(BufferPoolShard &shard, Page* page, PageId new_page_id, frame_id_t new_frame_id) {
     // Todo:
     // 1 如果是脏页，写回磁盘，并且把dirty置为false
     // 2 更新page table
@@ -51,12 +60,22 @@ void BufferPoolManager::update_page(Page* page, PageId new_page_id, frame_id_t n
 
     // std::lock_guard<std::mutex> guard(latch_);
     if (page->is_dirty_) {
-        page->is_dirty_=false;
-        disk_manager_->write_page(page->get_page_id().fd,page->get_page_id().page_no,page->get_data(),PAGE_SIZE);
+        std::vector<Page *> dirty_pages{page};
+        frame_id_t candidates[EVICTION_WRITE_BATCH - 1];
+        size_t num = shard.replacer_->victim_candidates(candidates, EVICTION_WRITE_BATCH - 1);
+        for (size_t i = 0; i < num; i++) {
+            Page *candidate = &shard.pages_[candidates[i]];
+            if (candidate != page && candidate->is_dirty_ && candidate->pin_count_ == 0 && !candidate->is_loading_) {
+                dirty_pages.push_back(candidate);
+            }
+        }
+        write_back_sorted(dirty_pages);
     }
-    page_table_.erase(page->id_);
+    page->latch_.begin_reload();
+    shard.page_table_.erase(page->id_);
     if(new_page_id.page_no!=INVALID_PAGE_ID){
-        page_table_.insert(std::make_pair(new_page_id,new_frame_id));
+        shard.page_table_.insert(std::make_pair(new_page_id,new_frame_id));
+        frame_hint(new_page_id).store(static_cast<int>(page - pages_), std::memory_order_relaxed);
     }
     page->reset_memory();
     page->id_=new_page_id;
@@ -76,33 +95,69 @@ Page* BufferPoolManager::fetch_page(PageId page_id) {
     //  1.1    若目标页有被page_table_记录，则将其所在frame固定(pin)，并返回目标页。
     //  1.2    否则，尝试调用find_victim_page获得一个可用的frame，若失败则返回nullptr
     //  2.     若获得的可用frame存储的为dirty page，则须调用updata_page将page写回到磁盘
-    //  3.     调用disk_manager_的read_page读取目标页到frame
+    //  3.     通过disk_manager_的IO引擎读取目标页到frame
     //  4.     固定目标页，更新pin_count_
     //  5.     返回目标页
 
-    std::lock_guard<std::mutex> guard(latch_);
+    BufferPoolShard &shard = get_shard(page_id);
+    std::unique_lock<std::mutex> lock(shard.latch_);
 
-    auto iter = page_table_.find(page_id);
-    if (iter != page_table_.end()) {
+    auto iter = shard.page_table_.find(page_id);
+    if (iter != shard.page_table_.end()) {
         frame_id_t frame_id = iter->second;
+        Page *page = &shard.pages_[frame_id];
         //
-        replacer_->pin(frame_id);
-        pages_[frame_id].pin_count_++;
-        //
-        return &pages_[frame_id];
+        shard.replacer_->pin(frame_id);
+        page->pin_count_++;
+        // 提示表项可能已被哈希冲突的页面覆盖，重新指向本页面
+        frame_hint(page_id).store(static_cast<int>(page - pages_), std::memory_order_relaxed);
+        // 页面正在被其他线程从磁盘读入，等待读取完成
+        if (page->is_loading_) {
+            shard.io_cv_.wait(lock, [page] { return !page->is_loading_; });
+            if (page->id_ != page_id) {
+                // 读取失败，页面已从页表中移除
+                release_failed_frame(shard, frame_id);
+                return nullptr;
+            }
+        }
+        return page;
     }
 
     frame_id_t frame_id;
-    if (!find_victim_page(&frame_id)) 
+    if (!find_victim_page(shard, &frame_id)) 
     {
         return nullptr;
     }
    
-    update_page(&pages_[frame_id], page_id, frame_id);
-    disk_manager_->read_page(page_id.fd, page_id.page_no, pages_[frame_id].data_, PAGE_SIZE);
-    replacer_->pin(frame_id);   // 固定目标页
-    pages_[frame_id].pin_count_=1; // 更新pin_count_
-    return &pages_[frame_id];
+    Page *page = &shard.pages_[frame_id];
+    update_page(shard, page, page_id, frame_id);
+    shard.replacer_->pin(frame_id);   // 固定目标页
+    page->pin_count_=1; // 更新pin_count_
+    // 读盘期间释放分区latch，其他线程访问同一页面时在io_cv_上等待
+    page->is_loading_ = true;
+    lock.unlock();
+    try {
+        // 与预读和写回一样交给IO引擎完成（编译时开启USE_IO_URING时为io_uring）
+        IoBatch batch;
+        char *data = page->data_;
+        batch.add_read(page_id.fd, page_id.page_no, &data, 1);
+        disk_manager_->submit_io(batch);
+        batch.wait();
+    } catch (...) {
+        lock.lock();
+        page->is_loading_ = false;
+        shard.page_table_.erase(page_id);
+        page->id_.page_no = INVALID_PAGE_ID;
+        page->latch_.end_reload();
+        release_failed_frame(shard, frame_id);
+        shard.io_cv_.notify_all();
+        throw;
+    }
+    lock.lock();
+    page->latch_.end_reload();
+    page->is_loading_ = false;
+    shard.io_cv_.notify_all();
+    return page;
 }
 
 /**
@@ -123,21 +178,27 @@ bool BufferPoolManager::unpin_page(PageId page_id, bool is_dirty) {
     // 3 根据参数is_dirty，更改P的is_dirty_
 
     //
-    std::lock_guard<std::mutex> guard(latch_);
+    BufferPoolShard &shard = get_shard(page_id);
+    std::lock_guard<std::mutex> guard(shard.latch_);
     //
-    if (page_table_.find(page_id) == page_table_.end()) {
+    auto iter = shard.page_table_.find(page_id);
+    if (iter == shard.page_table_.end()) {
         return false;
     }
-    frame_id_t frame_id = page_table_[page_id];
-    if (pages_[frame_id].pin_count_ == 0) 
+    frame_id_t frame_id = iter->second;
+    Page *page = &shard.pages_[frame_id];
+    if (page->pin_count_ == 0) 
     {
         return false;
     }
-    pages_[frame_id].pin_count_--;
-    if (pages_[frame_id].pin_count_ == 0) {
-        replacer_->unpin(frame_id);
+    page->pin_count_--;
+    if (page->pin_count_ == 0) {
+        shard.replacer_->unpin(frame_id);
+    }
+    // 只置位不清除：其他持有者可能已经修改过该页，脏标记只能由写回操作清除
+    if (is_dirty) {
+        page->is_dirty_ = true;
     }
-    pages_[frame_id].is_dirty_ = is_dirty;
 
     return true;
 }
@@ -155,13 +216,21 @@ bool BufferPoolManager::flush_page(PageId page_id) {
     // 2. 无论P是否为脏都将其写回磁盘。
     // 3. 更新P的is_dirty_
 
-    std::lock_guard<std::mutex> guard(latch_);
-    if (page_table_.find(page_id) == page_table_.end()) {
+    BufferPoolShard &shard = get_shard(page_id);
+    std::unique_lock<std::mutex> lock(shard.latch_);
+    // 后台刷脏线程写回的旧内容可能晚于本次写入到达磁盘，先等它写完
+    shard.io_cv_.wait(lock, [&shard] { return !shard.is_flushing_; });
+    auto iter = shard.page_table_.find(page_id);
+    if (iter == shard.page_table_.end()) {
         return false;
     }
-    frame_id_t frame_id = page_table_[page_id];
-    disk_manager_->write_page(page_id.fd, page_id.page_no, pages_[frame_id].data_, PAGE_SIZE);
-    pages_[frame_id].is_dirty_ = false;
+    Page *page = &shard.pages_[iter->second];
+    if (page->is_loading_) {
+        // 页面内容尚未读入，读入后与磁盘一致，无需写回
+        return true;
+    }
+    disk_manager_->write_page(page_id.fd, page_id.page_no, page->data_, PAGE_SIZE);
+    page->is_dirty_ = false;
 
     return true;
 }
@@ -172,24 +241,49 @@ bool BufferPoolManager::flush_page(PageId page_id) {
  * @param {PageId*} page_id 当成功创建一个新的page时存储其page_id
  */
 Page* BufferPoolManager::new_page(PageId* page_id) {
-    // 1.   获得一个可用的frame，若无法获得则返回nullptr
-    // 2.   在fd对应的文件分配一个新的page_id
+    // 1.   在fd对应的文件分配一个新的page_id，并由此确定所属分区
+    // 2.   在该分区获得一个可用的frame，若无法获得则撤销分配并返回nullptr
     // 3.   将frame的数据写回磁盘
     // 4.   固定frame，更新pin_count_
     // 5.   返回获得的page
 
-    std::lock_guard<std::mutex> guard(latch_);
+    PageId new_page_id = {.fd = page_id->fd, .page_no = disk_manager_->allocate_page(page_id->fd)};
+    BufferPoolShard &shard = get_shard(new_page_id);
+    std::unique_lock<std::mutex> lock(shard.latch_);
+    auto iter = shard.page_table_.find(new_page_id);
+    if (iter != shard.page_table_.end()) {
+        // 复用的页面编号仍在缓冲池中：页面释放后，不持有latch的乐观读取按旧的页面编号把它重新读入了缓冲池
+        // （见IxIndexHandle::find_leaf_optimistic）。直接复用该帧，清空内容时获取写latch，使仍在读取它的线程验证失败
+        frame_id_t frame_id = iter->second;
+        Page *page = &shard.pages_[frame_id];
+        shard.replacer_->pin(frame_id);
+        page->pin_count_++;
+        if (page->is_loading_) {
+            shard.io_cv_.wait(lock, [page] { return !page->is_loading_; });
+        }
+        if (page->id_ == new_page_id) {
+            lock.unlock();
+            page->wlatch();
+            page->reset_memory();
+            page->wunlatch();
+            *page_id = new_page_id;
+            return page;
+        }
+        // 读入失败，页面已从页表中移除，按一般情况分配新的帧
+        release_failed_frame(shard, frame_id);
+    }
     frame_id_t frame_id;
-    if (!find_victim_page(&frame_id)) {
+    if (!find_victim_page(shard, &frame_id)) {
+        // 分区已满，尽量归还页面编号，避免文件中留下空洞
+        disk_manager_->revert_allocate_page(new_page_id.fd, new_page_id.page_no);
         return nullptr;
     }
-    //
-    page_id->page_no = disk_manager_->allocate_page(page_id->fd);
-    //
-    update_page(&pages_[frame_id], *page_id, frame_id);
-    replacer_->pin(frame_id);
-    pages_[frame_id].pin_count_=1;
-    return &pages_[frame_id];
+    *page_id = new_page_id;
+    update_page(shard, &shard.pages_[frame_id], *page_id, frame_id);
+    shard.pages_[frame_id].latch_.end_reload();
+    shard.replacer_->pin(frame_id);
+    shard.pages_[frame_id].pin_count_=1;
+    return &shard.pages_[frame_id];
 }
 
 /**
@@ -198,35 +292,401 @@ Page* BufferPoolManager::new_page(PageId* page_id) {
  * @param {PageId} page_id 目标页
  */
 bool BufferPoolManager::delete_page(PageId page_id) {
-    // 1.   在page_table_中查找目标页，若不存在返回true
+    // 1.   在page_table_中查找目标页，若不存在则直接释放其磁盘页面并返回true
     // 2.   若目标页的pin_count不为0，则返回false
-    // 3.   将目标页数据写回磁盘，从页表中删除目标页，重置其元数据，将其加入free_list_，返回true
+    // 3.   从页表中删除目标页，重置其元数据，将其加入free_list_，并把磁盘页面交还给DiskManager复用，返回true
 
-    std::lock_guard<std::mutex> guard(latch_);
-    if (page_table_.find(page_id) == page_table_.end()) {
+    BufferPoolShard &shard = get_shard(page_id);
+    std::unique_lock<std::mutex> lock(shard.latch_);
+    // 后台刷脏线程写回期间持有页面的pin，等它写完再判断页面是否被使用
+    shard.io_cv_.wait(lock, [&shard] { return !shard.is_flushing_; });
+    auto iter = shard.page_table_.find(page_id);
+    if (iter == shard.page_table_.end()) {
+        disk_manager_->deallocate_page(page_id.fd, page_id.page_no);
         return true;
     }
-    frame_id_t frame_id = page_table_[page_id];
-    if (pages_[frame_id].pin_count_ != 0) {
+    frame_id_t frame_id = iter->second;
+    if (shard.pages_[frame_id].pin_count_ != 0) {
         return false;
     }
 
-    // disk_manager_->write_page(page_id.fd, page_id.page_no, pages_[frame_id].data_, PAGE_SIZE);
-    // page_table_.erase(page_id);
-    // pages_[frame_id].reset_memory();
-    // free_list_.push_back(frame_id);
-    disk_manager_->deallocate_page(page_id.page_no);
-    page_id.page_no = INVALID_PAGE_ID;
-    Page *page = &pages_[frame_id];
-    update_page(page,page_id,frame_id);
-    free_list_.push_back(frame_id);
+    // 页面已被删除，其中的数据不需要写回磁盘
+    Page *page = &shard.pages_[frame_id];
+    page->is_dirty_ = false;
+    shard.replacer_->remove(frame_id);  // 从replacer中移除，避免空闲帧被再次淘汰，不记为一次访问
+    update_page(shard, page, PageId{page_id.fd, INVALID_PAGE_ID}, frame_id);
+    page->latch_.end_reload();
+    shard.free_list_.push_back(frame_id);
+    disk_manager_->deallocate_page(page_id.fd, page_id.page_no);
     return true;
+}
+
+/**
+ * @description: 不获取分区latch、不pin页面，通过提示表找到页面可能所在的帧，用于乐观读取。
+ * 返回的帧随时可能被换成其他页面，调用者用Page::try_read_version读取版本号后复制页面内容，
+ * 再验证版本号并检查复制到的PageId。帧的内存在缓冲池析构之前一直有效
+ * @return {const Page*} 页面可能所在的帧，提示表中没有记录时返回nullptr
+ * @param {PageId} page_id 目标页面
+ */
+const Page *BufferPoolManager::probe_page(PageId page_id) const {
+    int frame = frame_hint(page_id).load(std::memory_order_relaxed);
+    return frame < 0 ? nullptr : &pages_[frame];
+}
+
+/**
+ * @description: 将一批页面内容按(fd, page_no)排序后写入磁盘，同一文件中编号连续的页面合并为一次写入
+ * @param {vector<pair<PageId, const char*>>&} pages 页面编号及要写入的内容，函数内会对其排序
+ * @param {bool} holding_latch 调用者是否持有分区latch。持有时在当前线程同步写入而不等待IO引擎：
+ * 预读完成的回调在IO引擎的线程中执行并需要获取分区latch，持有latch等待IO引擎会造成死锁
+ */
+void BufferPoolManager::write_sorted(std::vector<std::pair<PageId, const char *>> &pages, bool holding_latch) {
+    std::sort(pages.begin(), pages.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    std::vector<const char *> datas(pages.size());
+    IoBatch batch;
+    size_t run_start = 0;
+    for (size_t i = 0; i < pages.size(); i++) {
+        datas[i] = pages[i].second;
+        bool run_ends = i + 1 == pages.size() || pages[i + 1].first.fd != pages[i].first.fd ||
+                        pages[i + 1].first.page_no != pages[i].first.page_no + 1;
+        if (!run_ends) {
+            continue;
+        }
+        const PageId &first = pages[run_start].first;
+        int num_pages = static_cast<int>(i + 1 - run_start);
+        if (holding_latch) {
+            disk_manager_->write_pages(first.fd, first.page_no, datas.data() + run_start, num_pages);
+        } else {
+            batch.add_write(first.fd, first.page_no, datas.data() + run_start, num_pages);
+        }
+        run_start = i + 1;
+    }
+    if (batch.empty()) {
+        return;
+    }
+    // 各段写入交给IO引擎并行完成
+    disk_manager_->submit_io(batch);
+    batch.wait();
+}
+
+/**
+ * @description: 将一批未被pin的页面按页面顺序写回磁盘并清除脏标记。调用者需持有这些页面所在分区的latch_
+ * @param {vector<Page*>&} pages 需要写回的页面
+ */
+void BufferPoolManager::write_back_sorted(std::vector<Page *> &pages) {
+    std::vector<std::pair<PageId, const char *>> writes;
+    writes.reserve(pages.size());
+    for (Page *page : pages) {
+        writes.emplace_back(page->id_, page->data_);
+    }
+    write_sorted(writes, true);
+    for (Page *page : pages) {
+        page->is_dirty_ = false;
+    }
+}
 
-    // return true;
+/**
+ * @description: 读盘失败后，持有该帧的线程依次释放自己的pin，最后一个线程把帧归还到free_list_。
+ * 调用者需持有shard.latch_
+ */
+void BufferPoolManager::release_failed_frame(BufferPoolShard &shard, frame_id_t frame_id) {
+    Page *page = &shard.pages_[frame_id];
+    if (--page->pin_count_ == 0) {
+        page->reset_memory();
+        shard.free_list_.push_back(frame_id);
+    }
 }
 
 /**
- * @description: 将buffer_pool中的所有页写回到磁盘
+ * @description: 异步预读文件中[first_page, first_page+count)范围内的页面，函数不等待读取完成。
+ * 已在缓冲池中的页面和超出文件已分配范围的页面会被跳过
  * @param {int} fd 文件句柄
+ * @param {page_id_t} first_page 第一个页面的编号
+ * @param {int} count 页面个数
  */
-void BufferPoolManager::flush_all_pages(int fd) {}
\ No newline at end of file
+void BufferPoolManager::prefetch(int fd, page_id_t first_page, int count) {
+    std::vector<page_id_t> page_nos;
+    page_nos.reserve(count);
+    for (int i = 0; i < count; i++) {
+        page_nos.push_back(first_page + i);
+    }
+    prefetch(fd, page_nos);
+}
+
+/**
+ * @description: 异步预读文件中的一组页面（例如B+树中接下来要访问的叶子结点），函数不等待读取完成。
+ * 被预读的页面以is_loading_状态进入页表，此时fetch_page会等待读取完成；读取完成后页面处于unpinned状态
+ * @param {int} fd 文件句柄
+ * @param {vector<page_id_t>&} page_nos 需要预读的页面编号，按升序排列时相邻页面会合并为一次读取
+ */
+void BufferPoolManager::prefetch(int fd, const std::vector<page_id_t> &page_nos) {
+    page_id_t num_pages = disk_manager_->get_fd2pageno(fd);
+    std::vector<Page *> pages;
+    for (page_id_t page_no : page_nos) {
+        if (page_no < 0 || page_no >= num_pages) {
+            continue;
+        }
+        PageId page_id = {.fd = fd, .page_no = page_no};
+        BufferPoolShard &shard = get_shard(page_id);
+        std::lock_guard<std::mutex> guard(shard.latch_);
+        frame_id_t frame_id;
+        if (shard.page_table_.count(page_id) != 0 || !find_victim_page(shard, &frame_id)) {
+            continue;
+        }
+        // 由预读批次持有一个pin，防止读取期间被淘汰
+        Page *page = &shard.pages_[frame_id];
+        update_page(shard, page, page_id, frame_id);
+        shard.replacer_->pin(frame_id);
+        page->pin_count_ = 1;
+        page->is_loading_ = true;
+        pages.push_back(page);
+    }
+    if (pages.empty()) {
+        return;
+    }
+
+    auto *batch = new IoBatch();
+    std::vector<char *> datas(pages.size());
+    size_t run_start = 0;
+    for (size_t i = 0; i < pages.size(); i++) {
+        datas[i] = pages[i]->data_;
+        if (i + 1 == pages.size() || pages[i + 1]->id_.page_no != pages[i]->id_.page_no + 1) {
+            batch->add_read(fd, pages[run_start]->id_.page_no, datas.data() + run_start,
+                            static_cast<int>(i + 1 - run_start));
+            run_start = i + 1;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(prefetch_mutex_);
+        num_prefetching_++;
+    }
+    batch->set_callback([this, batch, pages](bool ok) {
+        finish_prefetch(pages, ok);
+        delete batch;
+        std::lock_guard<std::mutex> guard(prefetch_mutex_);
+        if (--num_prefetching_ == 0) {
+            prefetch_cv_.notify_all();
+        }
+    });
+    disk_manager_->submit_io(*batch);
+}
+
+/**
+ * @description: 预读批次完成后由IO引擎线程调用：释放预读持有的pin并唤醒等待这些页面的线程。
+ * 若读取失败，则把这些页面从页表中移除
+ */
+void BufferPoolManager::finish_prefetch(const std::vector<Page *> &pages, bool ok) {
+    for (Page *page : pages) {
+        PageId page_id = page->id_;
+        BufferPoolShard &shard = get_shard(page_id);
+        std::lock_guard<std::mutex> guard(shard.latch_);
+        frame_id_t frame_id = static_cast<frame_id_t>(page - shard.pages_);
+        page->is_loading_ = false;
+        if (!ok) {
+            shard.page_table_.erase(page_id);
+            page->id_.page_no = INVALID_PAGE_ID;
+            page->latch_.end_reload();
+            release_failed_frame(shard, frame_id);
+        } else {
+            page->latch_.end_reload();
+            if (--page->pin_count_ == 0) {
+                shard.replacer_->unpin(frame_id);
+            }
+        }
+        shard.io_cv_.notify_all();
+    }
+}
+
+/**
+ * @description: 等待所有已提交的预读完成
+ */
+void BufferPoolManager::wait_prefetch() {
+    std::unique_lock<std::mutex> lock(prefetch_mutex_);
+    prefetch_cv_.wait(lock, [this] { return num_prefetching_ == 0; });
+}
+
+/**
+ * @description: 将buffer_pool中属于fd的所有脏页按页面顺序写回到磁盘，写盘期间不持有分区latch
+ * @param {int} fd 文件句柄
+ */
+void BufferPoolManager::flush_all_pages(int fd) {
+    // 1. 逐个分区找出fd的脏页并pin住，写回完成之前它们不会被淘汰，也就不会有人从磁盘读到旧的内容
+    std::vector<Page *> dirty_pages;
+    for (size_t s = 0; s < num_shards_; ++s) {
+        BufferPoolShard &shard = shards_[s];
+        std::unique_lock<std::mutex> lock(shard.latch_);
+        // 等后台刷脏线程写完，否则它写回的旧内容可能晚于本次写回到达磁盘
+        shard.io_cv_.wait(lock, [&shard] { return !shard.is_flushing_; });
+        for (auto &entry : shard.page_table_) {
+            Page *page = &shard.pages_[entry.second];
+            if (entry.first.fd == fd && page->is_dirty_ && !page->is_loading_) {
+                shard.replacer_->pin(entry.second);
+                page->pin_count_++;
+                dirty_pages.push_back(page);
+            }
+        }
+    }
+    // 2. 不持有分区latch，在页面的读latch下复制页面内容，得到一致的页面，并清除脏标记。
+    // 此后对页面的修改在unpin时会重新标记为脏页，由下一次写回处理
+    std::vector<char> copies(dirty_pages.size() * PAGE_SIZE);
+    std::vector<std::pair<PageId, const char *>> writes;
+    writes.reserve(dirty_pages.size());
+    for (size_t i = 0; i < dirty_pages.size(); i++) {
+        Page *page = dirty_pages[i];
+        char *copy = copies.data() + i * PAGE_SIZE;
+        page->rlatch();
+        memcpy(copy, page->data_, PAGE_SIZE);
+        {
+            std::lock_guard<std::mutex> guard(get_shard(page->id_).latch_);
+            page->is_dirty_ = false;
+        }
+        page->runlatch();
+        writes.emplace_back(page->id_, copy);
+    }
+    // 3. 按页面顺序合并写回，然后释放pin；写回失败时恢复脏标记
+    try {
+        write_sorted(writes, false);
+    } catch (...) {
+        for (Page *page : dirty_pages) {
+            unpin_page(page->id_, true);
+        }
+        throw;
+    }
+    for (Page *page : dirty_pages) {
+        unpin_page(page->id_, false);
+    }
+}
+
+/**
+ * @description: 关闭文件时将该文件未被pin的页面移出缓冲池（脏页先写回），帧放回free_list_。
+ * 文件关闭后fd可能被新打开的文件复用，不移出的话新文件会读到旧文件的页面
+ * @param {int} fd 文件句柄
+ */
+void BufferPoolManager::discard_all_pages(int fd) {
+    for (size_t s = 0; s < num_shards_; ++s) {
+        BufferPoolShard &shard = shards_[s];
+        std::unique_lock<std::mutex> lock(shard.latch_);
+        // 后台刷脏线程写回期间持有页面的pin，等它写完，避免漏掉这些页面
+        shard.io_cv_.wait(lock, [&shard] { return !shard.is_flushing_; });
+        std::vector<std::pair<PageId, frame_id_t>> victims;
+        for (auto &entry : shard.page_table_) {
+            if (entry.first.fd == fd && shard.pages_[entry.second].pin_count_ == 0) {
+                victims.push_back(entry);
+            }
+        }
+        for (auto &[page_id, frame_id] : victims) {
+            shard.replacer_->remove(frame_id);  // 从replacer中移除，避免空闲帧被再次淘汰，不记为一次访问
+            update_page(shard, &shard.pages_[frame_id], PageId{fd, INVALID_PAGE_ID}, frame_id);
+            shard.pages_[frame_id].latch_.end_reload();
+            shard.free_list_.push_back(frame_id);
+        }
+    }
+}
+
+/**
+ * @description: 若分区中空闲帧与接下来将被淘汰的干净帧之和不足min_clean_frames，
+ * 则把replacer给出的前若干个淘汰候选中的脏页按页面顺序写回，写盘期间不持有分区latch
+ * @param {BufferPoolShard&} shard 目标分区
+ * @param {size_t} min_clean_frames 该分区需要保持干净的帧数
+ * @param {vector<frame_id_t>&} candidates 复用的候选帧缓冲区
+ */
+void BufferPoolManager::flush_cold_pages(BufferPoolShard &shard, size_t min_clean_frames,
+                                         std::vector<frame_id_t> &candidates) {
+    // 1. 持有分区latch选出淘汰候选中的脏页，复制其内容并清除脏标记。未被pin的页面不会被修改，复制的内容是一致的。
+    // 给页面加pin但不从replacer中取出，写回完成之前它们不会被淘汰，淘汰顺序也保持不变
+    std::vector<Page *> dirty_pages;
+    std::vector<char> copies;
+    std::vector<std::pair<PageId, const char *>> writes;
+    {
+        std::lock_guard<std::mutex> guard(shard.latch_);
+        size_t num_free = shard.free_list_.size();
+        if (num_free >= min_clean_frames) {
+            return;
+        }
+        candidates.resize(min_clean_frames - num_free);
+        size_t num = shard.replacer_->victim_candidates(candidates.data(), candidates.size());
+        for (size_t i = 0; i < num; ++i) {
+            Page *page = &shard.pages_[candidates[i]];
+            if (page->is_dirty_ && page->pin_count_ == 0 && !page->is_loading_) {
+                dirty_pages.push_back(page);
+            }
+        }
+        if (dirty_pages.empty()) {
+            return;
+        }
+        copies.resize(dirty_pages.size() * PAGE_SIZE);
+        for (size_t i = 0; i < dirty_pages.size(); ++i) {
+            Page *page = dirty_pages[i];
+            char *copy = copies.data() + i * PAGE_SIZE;
+            memcpy(copy, page->data_, PAGE_SIZE);
+            page->pin_count_++;
+            page->is_dirty_ = false;
+            writes.emplace_back(page->id_, copy);
+        }
+        shard.is_flushing_ = true;
+    }
+    // 2. 不持有分区latch，按页面顺序合并写回。此后对页面的修改在unpin时会重新标记为脏页
+    bool ok = true;
+    try {
+        write_sorted(writes, false);
+    } catch (InternalError &) {
+        ok = false;
+    }
+    // 3. 释放pin，写回失败时恢复脏标记，由之后的写回重试；后台线程中不抛出异常
+    std::lock_guard<std::mutex> guard(shard.latch_);
+    for (Page *page : dirty_pages) {
+        if (!ok) {
+            page->is_dirty_ = true;
+        }
+        if (--page->pin_count_ == 0) {
+            shard.replacer_->unpin(static_cast<frame_id_t>(page - shard.pages_));
+        }
+    }
+    shard.is_flushing_ = false;
+    shard.io_cv_.notify_all();
+}
+
+/**
+ * @description: 后台刷脏线程的主循环，每隔interval检查一遍所有分区
+ */
+void BufferPoolManager::flusher_loop(size_t min_clean_frames, std::chrono::milliseconds interval) {
+    // 目标干净帧数平均分到各个分区
+    size_t per_shard = std::max<size_t>(1, min_clean_frames / num_shards_);
+    std::vector<frame_id_t> candidates;
+    std::unique_lock<std::mutex> lock(flusher_mutex_);
+    while (flusher_running_) {
+        lock.unlock();
+        for (size_t s = 0; s < num_shards_; ++s) {
+            flush_cold_pages(shards_[s], std::min(per_shard, shards_[s].pool_size_), candidates);
+        }
+        lock.lock();
+        flusher_cv_.wait_for(lock, interval, [this] { return !flusher_running_; });
+    }
+}
+
+/**
+ * @description: 启动后台刷脏线程，若已经启动则什么也不做
+ * @param {size_t} min_clean_frames 整个缓冲池需要保持干净（可直接淘汰而无需写盘）的帧数
+ * @param {milliseconds} interval 两次检查之间的间隔
+ */
+void BufferPoolManager::start_flusher(size_t min_clean_frames, std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> guard(flusher_mutex_);
+    if (flusher_running_) {
+        return;
+    }
+    flusher_running_ = true;
+    flusher_ = std::thread(&BufferPoolManager::flusher_loop, this, min_clean_frames, interval);
+}
+
+/**
+ * @description: 停止后台刷脏线程并等待其退出
+ */
+void BufferPoolManager::stop_flusher() {
+    {
+        std::lock_guard<std::mutex> guard(flusher_mutex_);
+        flusher_running_ = false;
+    }
+    flusher_cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+}
\ No newline at end of file
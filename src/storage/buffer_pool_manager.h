@@ -12,49 +12,117 @@ See the Mulan PSL v2 for more details. */
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <list>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include "disk_manager.h"
 #include "errors.h"
 #include "page.h"
+#include "page_guard.h"
+#include "replacer/clock_replacer.h"
 #include "replacer/lru_replacer.h"
 #include "replacer/replacer.h"
+#include "replacer/two_queue_replacer.h"
+
+/**
+ * @description: 缓冲池的一个分区。每个分区拥有独立的页表、空闲帧链表、替换器和互斥锁，
+ * 不同分区上的操作互不阻塞。分区内的frame_id是相对于本分区pages_的下标。
+ */
+struct BufferPoolShard {
+    size_t pool_size_ = 0;  // 本分区的帧数
+    Page *pages_ = nullptr; // 指向BufferPoolManager::pages_中属于本分区的第一帧
+    std::unordered_map<PageId, frame_id_t, PageIdHash> page_table_; // 本分区的页表
+    std::list<frame_id_t> free_list_;   // 本分区空闲帧编号的链表
+    Replacer *replacer_ = nullptr;      // 本分区的置换策略
+    std::mutex latch_;                  // 只保护本分区的数据结构
+    std::condition_variable io_cv_;     // 页面读盘完成时通知等待该页面的线程
+    bool is_flushing_ = false;          // 后台刷脏线程正在写回本分区的页面，写回结束时通过io_cv_通知
+};
 
 class BufferPoolManager {
    private:
     size_t pool_size_;      // buffer_pool中可容纳页面的个数，即帧的个数
     Page *pages_;           // buffer_pool中的Page对象数组，在构造空间中申请内存空间，在析构函数中释放，大小为BUFFER_POOL_SIZE
-    std::unordered_map<PageId, frame_id_t, PageIdHash> page_table_; // 帧号和页面号的映射哈希表，用于根据页面的PageId定位该页面的帧编号
-    std::list<frame_id_t> free_list_;   // 空闲帧编号的链表
+    size_t num_shards_;     // 分区个数，页面按PageId的哈希值映射到分区
+    BufferPoolShard *shards_;   // 分区数组，每个分区管理pages_中连续的一段帧
+    // 页面所在帧的提示表，按PageId的哈希值直接映射，存放pages_中的下标（-1表示空），供probe_page不加锁读取。
+    // 表项在页面换入时由持有分区latch的线程写入，可能已经过时或被哈希冲突的页面覆盖
+    std::atomic<int> *frame_hints_;
+    size_t num_frame_hints_;
     DiskManager *disk_manager_;
-    Replacer *replacer_;    // buffer_pool的置换策略，当前赛题中为LRU置换策略
-    std::mutex latch_;      // 用于共享数据结构的并发控制
+
+    // 后台刷脏线程，使每个分区接下来将被淘汰的帧保持干净，淘汰时无需同步写盘
+    std::thread flusher_;
+    std::mutex flusher_mutex_;
+    std::condition_variable flusher_cv_;
+    bool flusher_running_ = false;      // 由flusher_mutex_保护
+
+    // 尚未完成的预读批次个数，析构前需等待其归零
+    std::mutex prefetch_mutex_;
+    std::condition_variable prefetch_cv_;
+    int num_prefetching_ = 0;
+
+    // 同一文件中连续SHARD_EXTENT_PAGES个页面映射到同一分区，便于按页面顺序批量写回
+    static constexpr page_id_t SHARD_EXTENT_PAGES = 8;
 
    public:
-    BufferPoolManager(size_t pool_size, DiskManager *disk_manager)
+    /**
+     * @description: 创建缓冲池
+     * @param {size_t} pool_size 缓冲池的总帧数
+     * @param {DiskManager*} disk_manager
+     * @param {size_t} num_shards 分区个数，默认为1，即所有操作共用一把锁
+     */
+    BufferPoolManager(size_t pool_size, DiskManager *disk_manager, size_t num_shards = 1)
         : pool_size_(pool_size), disk_manager_(disk_manager) {
+        // 分区数不能超过帧数，否则会出现没有帧的分区
+        num_shards_ = std::max<size_t>(1, std::min(num_shards, pool_size_));
         // 为buffer pool分配一块连续的内存空间
         pages_ = new Page[pool_size_];
-        // 可以被Replacer改变
-        if (REPLACER_TYPE.compare("LRU"))
-            replacer_ = new LRUReplacer(pool_size_);
-        else if (REPLACER_TYPE.compare("CLOCK"))
-            replacer_ = new LRUReplacer(pool_size_);
-        else {
-            replacer_ = new LRUReplacer(pool_size_);
+        shards_ = new BufferPoolShard[num_shards_];
+        num_frame_hints_ = pool_size_ * 2;
+        frame_hints_ = new std::atomic<int>[num_frame_hints_];
+        for (size_t i = 0; i < num_frame_hints_; ++i) {
+            frame_hints_[i].store(-1, std::memory_order_relaxed);
         }
-        // 初始化时，所有的page都在free_list_中
-        for (size_t i = 0; i < pool_size_; ++i) {
-            free_list_.emplace_back(static_cast<frame_id_t>(i));  // static_cast转换数据类型
+        size_t offset = 0;
+        for (size_t s = 0; s < num_shards_; ++s) {
+            BufferPoolShard &shard = shards_[s];
+            // 余数部分分给前面的分区
+            shard.pool_size_ = pool_size_ / num_shards_ + (s < pool_size_ % num_shards_ ? 1 : 0);
+            shard.pages_ = pages_ + offset;
+            offset += shard.pool_size_;
+            // 可以被Replacer改变
+            if (REPLACER_TYPE == "CLOCK")
+                shard.replacer_ = new ClockReplacer(shard.pool_size_);
+            else if (REPLACER_TYPE == "2Q")
+                shard.replacer_ = new TwoQueueReplacer(shard.pool_size_);
+            else {
+                shard.replacer_ = new LRUReplacer(shard.pool_size_);
+            }
+            // 初始化时，所有的page都在free_list_中
+            for (size_t i = 0; i < shard.pool_size_; ++i) {
+                shard.free_list_.emplace_back(static_cast<frame_id_t>(i));  // static_cast转换数据类型
+            }
         }
     }
 
     ~BufferPoolManager() {
+        stop_flusher();
+        wait_prefetch();
+        for (size_t s = 0; s < num_shards_; ++s) {
+            delete shards_[s].replacer_;
+        }
+        delete[] shards_;
+        delete[] frame_hints_;
         delete[] pages_;
-        delete replacer_;
     }
 
     /**
@@ -63,6 +131,8 @@ class BufferPoolManager {
      */
     static void mark_dirty(Page* page) { page->is_dirty_ = true; }
 
+    size_t get_num_shards() const { return num_shards_; }
+
    public: 
     Page* fetch_page(PageId page_id);
 
@@ -74,10 +144,81 @@ class BufferPoolManager {
 
     bool delete_page(PageId page_id);
 
+    const Page *probe_page(PageId page_id) const;
+
     void flush_all_pages(int fd);
 
+    void discard_all_pages(int fd);
+
+    /**
+     * @description: fetch_page并获取页面的读latch，返回的guard离开作用域时自动释放latch并unpin页面
+     */
+    ReadPageGuard fetch_page_read(PageId page_id) {
+        Page *page = fetch_page(page_id);
+        if (page != nullptr) {
+            page->rlatch();
+        }
+        return ReadPageGuard(this, page);
+    }
+
+    /**
+     * @description: fetch_page并获取页面的写latch，返回的guard离开作用域时自动释放latch，unpin页面并标记为脏页
+     */
+    WritePageGuard fetch_page_write(PageId page_id) {
+        Page *page = fetch_page(page_id);
+        if (page != nullptr) {
+            page->wlatch();
+        }
+        return WritePageGuard(this, page);
+    }
+
+    /**
+     * @description: new_page并获取页面的写latch，返回的guard离开作用域时自动释放latch，unpin页面并标记为脏页
+     */
+    WritePageGuard new_page_guarded(PageId *page_id) {
+        Page *page = new_page(page_id);
+        if (page != nullptr) {
+            page->wlatch();
+        }
+        return WritePageGuard(this, page);
+    }
+
+    void prefetch(int fd, page_id_t first_page, int count);
+
+    void prefetch(int fd, const std::vector<page_id_t> &page_nos);
+
+    void wait_prefetch();
+
+    void start_flusher(size_t min_clean_frames, std::chrono::milliseconds interval);
+
+    void stop_flusher();
+
    private:
-    bool find_victim_page(frame_id_t* frame_id);
+    /**
+     * @description: 根据PageId的哈希值选择其所属的分区
+     */
+    BufferPoolShard &get_shard(const PageId &page_id) {
+        PageId extent = {.fd = page_id.fd, .page_no = page_id.page_no / SHARD_EXTENT_PAGES};
+        return shards_[std::hash<PageId>()(extent) % num_shards_];
+    }
+
+    std::atomic<int> &frame_hint(const PageId &page_id) const {
+        return frame_hints_[std::hash<PageId>()(page_id) % num_frame_hints_];
+    }
+
+    bool find_victim_page(BufferPoolShard &shard, frame_id_t* frame_id);
+
+    void update_page(BufferPoolShard &shard, Page* page, PageId new_page_id, frame_id_t new_frame_id);
+
+    void write_sorted(std::vector<std::pair<PageId, const char *>> &pages, bool holding_latch);
+
+    void write_back_sorted(std::vector<Page *> &pages);
+
+    void release_failed_frame(BufferPoolShard &shard, frame_id_t frame_id);
+
+    void finish_prefetch(const std::vector<Page *> &pages, bool ok);
+
+    void flush_cold_pages(BufferPoolShard &shard, size_t min_clean_frames, std::vector<frame_id_t> &candidates);
 
-    void update_page(Page* page, PageId new_page_id, frame_id_t new_frame_id);
+    void flusher_loop(size_t min_clean_frames, std::chrono::milliseconds interval);
 };
\ No newline at end of file
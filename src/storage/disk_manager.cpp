@@ -10,14 +10,22 @@ See the Mulan PSL v2 for more details. */
 
 #include "storage/disk_manager.h"
 
+#include <algorithm>
 #include <assert.h>    // for assert
 #include <string.h>    // for memset
 #include <sys/stat.h>  // for stat
-#include <unistd.h>    // for lseek
+#include <sys/uio.h>   // for pwritev
+#include <unistd.h>    // for lseek, pread, pwrite
 
 #include "defs.h"
 
-DiskManager::DiskManager() { memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<page_id_t>) / sizeof(char))); }
+DiskManager::DiskManager() : DiskManager(IoEngine::create()) {}
+
+DiskManager::DiskManager(std::unique_ptr<IoEngine> io_engine) : io_engine_(std::move(io_engine)) {
+    memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<page_id_t>) / sizeof(char)));
+}
+
+DiskManager::~DiskManager() = default;
 
 /**
  * @description: 将数据写入文件的指定磁盘页面中
@@ -28,20 +36,41 @@ DiskManager::DiskManager() { memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<
  */
 void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, int num_bytes) 
 {
-    // Todo:
-    // 1.lseek()定位到文件头，通过(fd,page_no)可以定位指定页面及其在磁盘文件中的偏移量
-    // 2.调用write()函数
+    // 使用pwrite()一次完成定位和写入，不修改文件偏移量，多个线程可以并发写同一个文件
     // 注意write返回值与num_bytes不等时 throw InternalError("DiskManager::write_page Error");
-    off_t seek_offset = page_no * PAGE_SIZE;
-    if (lseek(fd, seek_offset, SEEK_SET) == -1) {
-        throw UnixError();
-    }
-    ssize_t bytes_write = write(fd, offset, num_bytes);
+    off_t seek_offset = static_cast<off_t>(page_no) * PAGE_SIZE;
+    ssize_t bytes_write = pwrite(fd, offset, num_bytes, seek_offset);
     if (bytes_write != num_bytes) {
         throw InternalError("DiskManager::write_page Error");
     }
 }
 
+/**
+ * @description: 将num_pages个页面写入文件中从first_page_no开始的连续页面，
+ * 使用pwritev()把一段连续页面合并为一次系统调用
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} first_page_no 第一个页面的编号
+ * @param {char*} const *pages pages[i]为写入第first_page_no+i页的PAGE_SIZE字节数据
+ * @param {int} num_pages 页面个数
+ */
+void DiskManager::write_pages(int fd, page_id_t first_page_no, const char *const *pages, int num_pages) {
+    struct iovec iov[IoRequest::MAX_PAGES];
+    int done = 0;
+    while (done < num_pages) {
+        int batch = std::min(num_pages - done, IoRequest::MAX_PAGES);
+        for (int i = 0; i < batch; i++) {
+            iov[i].iov_base = const_cast<char *>(pages[done + i]);
+            iov[i].iov_len = PAGE_SIZE;
+        }
+        off_t seek_offset = static_cast<off_t>(first_page_no + done) * PAGE_SIZE;
+        ssize_t bytes_write = pwritev(fd, iov, batch, seek_offset);
+        if (bytes_write != static_cast<ssize_t>(batch) * PAGE_SIZE) {
+            throw InternalError("DiskManager::write_pages Error");
+        }
+        done += batch;
+    }
+}
+
 /**
  * @description: 读取文件中指定编号的页面中的部分数据到内存中
  * @param {int} fd 磁盘文件的文件句柄
@@ -50,32 +79,145 @@ void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, int
  * @param {int} num_bytes 读取的数据量大小
  */
 void DiskManager::read_page(int fd, page_id_t page_no, char *offset, int num_bytes) {
-    // Todo:
-    // 1.lseek()定位到文件头，通过(fd,page_no)可以定位指定页面及其在磁盘文件中的偏移量
-    // 2.调用read()函数
+    // 使用pread()一次完成定位和读取，不修改文件偏移量，多个线程可以并发读同一个文件
     // 注意read返回值与num_bytes不等时，throw InternalError("DiskManager::read_page Error");
-    off_t seek_offset = page_no * PAGE_SIZE;
-    if (lseek(fd, seek_offset, SEEK_SET) == -1) {
-        throw UnixError();
-    }
-    ssize_t bytes_read = read(fd, offset, num_bytes);
+    off_t seek_offset = static_cast<off_t>(page_no) * PAGE_SIZE;
+    ssize_t bytes_read = pread(fd, offset, num_bytes, seek_offset);
     if (bytes_read != num_bytes) {
         throw InternalError("DiskManager::read_page Error");
     }
 }
 
 /**
- * @description: 分配一个新的页号
+ * @description: 分配一个新的页号，优先复用该文件中已被释放的页面
  * @return {page_id_t} 分配的新页号
  * @param {int} fd 指定文件的文件句柄
  */
 page_id_t DiskManager::allocate_page(int fd) {
-    // 简单的自增分配策略，指定文件的页面编号加1
     assert(fd >= 0 && fd < MAX_FD);
+    {
+        std::lock_guard<std::mutex> lock(free_pages_latch_);
+        auto iter = free_pages_.find(fd);
+        if (iter != free_pages_.end() && !iter->second.empty()) {
+            page_id_t page_no = iter->second.back();
+            iter->second.pop_back();
+            // 先把磁盘上的链表头改为下一个空闲页面，之后该页面被覆盖也不会破坏链表
+            write_free_list_head(fd, iter->second.empty() ? INVALID_PAGE_ID : iter->second.back());
+            return page_no;
+        }
+    }
+    // 没有空闲页面时采用简单的自增分配策略，指定文件的页面编号加1
     return fd2pageno_[fd]++;
 }
 
-void DiskManager::deallocate_page(__attribute__((unused)) page_id_t page_id) {}
+/**
+ * @description: 释放一个页面，之后allocate_page可以再次分配该页号。
+ * 调用者需保证该页面已不在缓冲池中，也不会再被访问
+ * @param {int} fd 文件句柄
+ * @param {page_id_t} page_no 要释放的页面编号
+ */
+void DiskManager::deallocate_page(int fd, page_id_t page_no) {
+    assert(fd >= 0 && fd < MAX_FD);
+    assert(page_no >= 0 && page_no < fd2pageno_[fd]);
+    std::lock_guard<std::mutex> lock(free_pages_latch_);
+    std::vector<page_id_t> &pages = free_pages_[fd];
+    assert(std::find(pages.begin(), pages.end(), page_no) == pages.end());  // 同一页面不能被重复释放
+    if (free_list_heads_.count(fd) != 0) {
+        // 先在页面中写入链表的下一个空闲页面，再让链表头指向该页面
+        page_id_t next = pages.empty() ? INVALID_PAGE_ID : pages.back();
+        write_page(fd, page_no, reinterpret_cast<const char *>(&next), sizeof(page_id_t));
+        write_free_list_head(fd, page_no);
+    }
+    pages.push_back(page_no);
+}
+
+/**
+ * @description: 撤销刚刚分配的页面编号。若page_no仍是该文件最后分配的页面，则直接回退fd2pageno_，
+ * 否则（页面来自空闲列表，或其他线程已在其后分配了新页面）将其放回空闲列表
+ * @return {bool} 回退fd2pageno_成功返回true，放回空闲列表返回false
+ * @param {int} fd 文件句柄
+ * @param {page_id_t} page_no 由allocate_page返回的页面编号
+ */
+bool DiskManager::revert_allocate_page(int fd, page_id_t page_no) {
+    assert(fd >= 0 && fd < MAX_FD);
+    page_id_t expected = page_no + 1;
+    if (fd2pageno_[fd].compare_exchange_strong(expected, page_no)) {
+        return true;
+    }
+    deallocate_page(fd, page_no);
+    return false;
+}
+
+/**
+ * @description: 把文件的空闲页面串成链表写入磁盘，并清空内存中的空闲列表，通常在关闭文件前调用。
+ * 每个空闲页面的前sizeof(page_id_t)个字节存放链表中下一个空闲页面的编号，最后一个为INVALID_PAGE_ID。
+ * 以head_offset调用load_free_pages的文件，链表在每次变化时已经写入磁盘，这里只返回链表头
+ * @return {page_id_t} 链表头的页面编号，没有空闲页面时返回INVALID_PAGE_ID
+ * @param {int} fd 文件句柄
+ */
+page_id_t DiskManager::save_free_pages(int fd) {
+    std::vector<page_id_t> pages;
+    {
+        std::lock_guard<std::mutex> lock(free_pages_latch_);
+        auto iter = free_pages_.find(fd);
+        if (iter != free_pages_.end()) {
+            pages.swap(iter->second);
+            free_pages_.erase(iter);
+        }
+        if (free_list_heads_.erase(fd) != 0) {
+            return pages.empty() ? INVALID_PAGE_ID : pages.back();
+        }
+    }
+    page_id_t next = INVALID_PAGE_ID;
+    for (page_id_t page_no : pages) {
+        write_page(fd, page_no, reinterpret_cast<const char *>(&next), sizeof(page_id_t));
+        next = page_no;
+    }
+    return next;
+}
+
+/**
+ * @description: 从磁盘读取save_free_pages写入的空闲页面链表，恢复内存中的空闲列表
+ * @param {int} fd 文件句柄
+ * @param {page_id_t} first_free_page_no 链表头的页面编号
+ * @param {off_t} head_offset 链表头在文件中的字节偏移。不为-1时，之后空闲列表每次变化都立即把链表和链表头写入磁盘，
+ * 进程崩溃后磁盘上的链表仍然有效；为-1时只在save_free_pages时写入
+ */
+void DiskManager::load_free_pages(int fd, page_id_t first_free_page_no, off_t head_offset) {
+    std::vector<page_id_t> pages;
+    page_id_t page_no = first_free_page_no;
+    while (page_no != INVALID_PAGE_ID) {
+        if (page_no < 0 || page_no >= fd2pageno_[fd] || pages.size() >= static_cast<size_t>(fd2pageno_[fd])) {
+            throw InternalError("DiskManager::load_free_pages Error: corrupted free page list");
+        }
+        pages.push_back(page_no);
+        read_page(fd, page_no, reinterpret_cast<char *>(&page_no), sizeof(page_id_t));
+    }
+    // 保持save_free_pages之前的分配顺序
+    std::reverse(pages.begin(), pages.end());
+    std::lock_guard<std::mutex> lock(free_pages_latch_);
+    free_pages_[fd] = std::move(pages);
+    if (head_offset >= 0) {
+        free_list_heads_[fd] = head_offset;
+    } else {
+        free_list_heads_.erase(fd);
+    }
+}
+
+/**
+ * @description: 空闲列表立即写入磁盘的文件，把链表头写到load_free_pages指定的位置；调用者需持有free_pages_latch_
+ * @param {int} fd 文件句柄
+ * @param {page_id_t} head 新的链表头
+ */
+void DiskManager::write_free_list_head(int fd, page_id_t head) {
+    auto iter = free_list_heads_.find(fd);
+    if (iter == free_list_heads_.end()) {
+        return;
+    }
+    if (pwrite(fd, &head, sizeof(page_id_t), iter->second) != sizeof(page_id_t)) {
+        throw InternalError("DiskManager::write_free_list_head Error");
+    }
+}
 
 bool DiskManager::is_dir(const std::string &path) {
     struct stat st;
@@ -189,6 +331,9 @@ void DiskManager::close_file(int fd) {
     std::string path = fd2path_[fd];
     fd2path_.erase(fd);
     path2fd_.erase(path);
+    std::lock_guard<std::mutex> lock(free_pages_latch_);
+    free_pages_.erase(fd);
+    free_list_heads_.erase(fd);
 }
 
 /**
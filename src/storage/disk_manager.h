@@ -17,11 +17,15 @@ See the Mulan PSL v2 for more details. */
 #include <atomic>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "common/config.h"
 #include "errors.h"
+#include "storage/io_engine.h"
 
 /**
  * @description: DiskManager的作用主要是根据上层的需要对磁盘文件进行操作
@@ -30,15 +34,49 @@ class DiskManager {
    public:
     explicit DiskManager();
 
-    ~DiskManager() = default;
+    /**
+     * @description: 使用指定的IO引擎读写页面，默认构造时使用IoEngine::create()创建的引擎
+     */
+    explicit DiskManager(std::unique_ptr<IoEngine> io_engine);
+
+    ~DiskManager();
 
     void write_page(int fd, page_id_t page_no, const char *offset, int num_bytes);
 
     void read_page(int fd, page_id_t page_no, char *offset, int num_bytes);
 
+    void write_pages(int fd, page_id_t first_page_no, const char *const *pages, int num_pages);
+
+    /**
+     * @description: 把一批读写请求交给异步IO引擎，之后调用batch.wait()等待它们完成
+     */
+    void submit_io(IoBatch &batch) {
+        if (!batch.empty()) {
+            io_engine_->submit(batch);
+        }
+    }
+
+    const char *io_engine_name() const { return io_engine_->name(); }
+
     page_id_t allocate_page(int fd);
 
-    void deallocate_page(page_id_t page_id);
+    void deallocate_page(int fd, page_id_t page_no);
+
+    bool revert_allocate_page(int fd, page_id_t page_no);
+
+    page_id_t save_free_pages(int fd);
+
+    void load_free_pages(int fd, page_id_t first_free_page_no, off_t head_offset = -1);
+
+    /**
+     * @description: 获得文件当前空闲页面的个数
+     * @param {int} fd 文件对应的句柄
+     */
+    size_t get_num_free_pages(int fd) {
+        std::lock_guard<std::mutex> lock(free_pages_latch_);
+        auto iter = free_pages_.find(fd);
+        return iter == free_pages_.end() ? 0 : iter->second.size();
+    }
 
     /*目录操作*/
     bool is_dir(const std::string &path);
@@ -90,10 +128,19 @@ class DiskManager {
     static constexpr int MAX_FD = 8192;
 
    private:
+    void write_free_list_head(int fd, page_id_t head);
+
     // 文件打开列表，用于记录文件是否被打开
     std::unordered_map<std::string, int> path2fd_;  //<Page文件磁盘路径,Page fd>哈希表
     std::unordered_map<int, std::string> fd2path_;  //<Page fd,Page文件磁盘路径>哈希表
 
     int log_fd_ = -1;  // WAL日志文件的文件句柄，默认为-1，代表未打开日志文件
     std::atomic<page_id_t> fd2pageno_[MAX_FD]{};  // 文件中已经分配的页面个数，初始值为0
+
+    // 每个文件中被释放、可供allocate_page复用的页面编号
+    std::unordered_map<int, std::vector<page_id_t>> free_pages_;
+    std::unordered_map<int, off_t> free_list_heads_;   // 空闲列表立即写入磁盘的文件，及其链表头在文件中的字节偏移
+    std::mutex free_pages_latch_;
+
+    std::unique_ptr<IoEngine> io_engine_;   // 异步页面读写引擎
 };
\ No newline at end of file
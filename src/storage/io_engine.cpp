@@ -0,0 +1,224 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/io_engine.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+/**
+ * @description: 加入一个读请求，把文件中从first_page_no开始的num_pages个页面分别读入pages[i]
+ */
+void IoBatch::add_read(int fd, page_id_t first_page_no, char *const *pages, int num_pages) {
+    add_request(IoRequest::READ, fd, first_page_no, pages, num_pages);
+}
+
+/**
+ * @description: 加入一个写请求，把pages[i]写入文件中第first_page_no+i个页面
+ */
+void IoBatch::add_write(int fd, page_id_t first_page_no, const char *const *pages, int num_pages) {
+    add_request(IoRequest::WRITE, fd, first_page_no, const_cast<char *const *>(pages), num_pages);
+}
+
+/**
+ * @description: 按IoRequest::MAX_PAGES把连续的页面拆成多个请求
+ */
+void IoBatch::add_request(IoRequest::IoType type, int fd, page_id_t first_page_no, char *const *pages, int num_pages) {
+    for (int start = 0; start < num_pages; start += IoRequest::MAX_PAGES) {
+        int count = std::min(num_pages - start, IoRequest::MAX_PAGES);
+        IoRequest request{type, fd, first_page_no + start, {}, this};
+        request.iov_.resize(count);
+        for (int i = 0; i < count; i++) {
+            request.iov_[i].iov_base = pages[start + i];
+            request.iov_[i].iov_len = PAGE_SIZE;
+        }
+        requests_.push_back(std::move(request));
+    }
+}
+
+/**
+ * @description: 由IO引擎在开始提交前调用，记录需要等待的请求个数
+ */
+void IoBatch::on_submit() {
+    std::lock_guard<std::mutex> guard(latch_);
+    pending_ += requests_.size();
+}
+
+/**
+ * @description: 由IO引擎在一个请求完成时调用
+ * @param {ssize_t} result 实际读写的字节数，出错时为负数
+ */
+void IoBatch::on_complete(IoRequest *request, ssize_t result) {
+    std::unique_lock<std::mutex> lock(latch_);
+    if (result != request->expected_bytes()) {
+        failed_ = true;
+    }
+    if (--pending_ > 0) {
+        return;
+    }
+    if (callback_) {
+        // 回调可能释放本对象，需先解锁
+        auto callback = std::move(callback_);
+        bool ok = !failed_;
+        lock.unlock();
+        callback(ok);
+        return;
+    }
+    cv_.notify_all();
+}
+
+/**
+ * @description: 等待这一批请求全部完成，若有请求没有读写完整则抛出InternalError
+ */
+void IoBatch::wait() {
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [this] { return pending_ == 0; });
+    if (failed_) {
+        throw InternalError("IoBatch::wait Error");
+    }
+}
+
+/**
+ * @description: 创建IO引擎：编译时开启了RMDB_USE_IO_URING且内核支持时使用io_uring，否则使用线程池
+ */
+std::unique_ptr<IoEngine> IoEngine::create() {
+#ifdef RMDB_USE_IO_URING
+    if (auto engine = IoUringEngine::try_create(IO_URING_QUEUE_DEPTH)) {
+        return engine;
+    }
+#endif
+    return std::make_unique<ThreadPoolIoEngine>(IO_ENGINE_THREADS);
+}
+
+ThreadPoolIoEngine::ThreadPoolIoEngine(size_t num_threads) {
+    for (size_t i = 0; i < num_threads; i++) {
+        workers_.emplace_back(&ThreadPoolIoEngine::worker_loop, this);
+    }
+}
+
+ThreadPoolIoEngine::~ThreadPoolIoEngine() {
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPoolIoEngine::submit(IoBatch &batch) {
+    batch.on_submit();
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        for (auto &request : batch.requests()) {
+            queue_.push_back(&request);
+        }
+    }
+    cv_.notify_all();
+}
+
+void ThreadPoolIoEngine::worker_loop() {
+    while (true) {
+        IoRequest *request;
+        {
+            std::unique_lock<std::mutex> lock(latch_);
+            cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            // 退出前先把队列中的请求做完，保证提交者不会永远等待
+            if (queue_.empty()) {
+                return;
+            }
+            request = queue_.front();
+            queue_.pop_front();
+        }
+        ssize_t result;
+        if (request->type_ == IoRequest::READ) {
+            result = preadv(request->fd_, request->iov_.data(), request->iov_.size(), request->offset());
+        } else {
+            result = pwritev(request->fd_, request->iov_.data(), request->iov_.size(), request->offset());
+        }
+        request->batch_->on_complete(request, result);
+    }
+}
+
+#ifdef RMDB_USE_IO_URING
+/**
+ * @description: 初始化io_uring，内核不支持时返回nullptr，由调用者退回到线程池
+ */
+std::unique_ptr<IoEngine> IoUringEngine::try_create(unsigned queue_depth) {
+    std::unique_ptr<IoUringEngine> engine(new IoUringEngine());
+    if (io_uring_queue_init(queue_depth, &engine->ring_, 0) < 0) {
+        return nullptr;
+    }
+    engine->reaper_ = std::thread(&IoUringEngine::reaper_loop, engine.get());
+    return engine;
+}
+
+IoUringEngine::~IoUringEngine() {
+    {
+        // 提交一个user_data为空的NOP，通知收割线程退出
+        std::lock_guard<std::mutex> guard(submit_latch_);
+        struct io_uring_sqe *sqe = get_sqe();
+        io_uring_prep_nop(sqe);
+        io_uring_sqe_set_data(sqe, nullptr);
+        io_uring_submit(&ring_);
+    }
+    reaper_.join();
+    io_uring_queue_exit(&ring_);
+}
+
+/**
+ * @description: 获取一个提交队列项，提交队列已满时先把已有的项提交给内核。调用者需持有submit_latch_
+ */
+struct io_uring_sqe *IoUringEngine::get_sqe() {
+    struct io_uring_sqe *sqe;
+    while ((sqe = io_uring_get_sqe(&ring_)) == nullptr) {
+        io_uring_submit(&ring_);
+    }
+    return sqe;
+}
+
+void IoUringEngine::submit(IoBatch &batch) {
+    batch.on_submit();
+    std::lock_guard<std::mutex> guard(submit_latch_);
+    for (auto &request : batch.requests()) {
+        struct io_uring_sqe *sqe = get_sqe();
+        if (request.type_ == IoRequest::READ) {
+            io_uring_prep_readv(sqe, request.fd_, request.iov_.data(), request.iov_.size(), request.offset());
+        } else {
+            io_uring_prep_writev(sqe, request.fd_, request.iov_.data(), request.iov_.size(), request.offset());
+        }
+        io_uring_sqe_set_data(sqe, &request);
+    }
+    io_uring_submit(&ring_);
+}
+
+void IoUringEngine::reaper_loop() {
+    while (true) {
+        struct io_uring_cqe *cqe;
+        int ret = io_uring_wait_cqe(&ring_, &cqe);
+        if (ret == -EINTR) {
+            continue;
+        }
+        if (ret < 0) {
+            return;
+        }
+        auto *request = static_cast<IoRequest *>(io_uring_cqe_get_data(cqe));
+        ssize_t result = cqe->res;
+        io_uring_cqe_seen(&ring_, cqe);
+        if (request == nullptr) {
+            return;
+        }
+        request->batch_->on_complete(request, result);
+    }
+}
+#endif
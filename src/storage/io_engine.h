@@ -0,0 +1,161 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <limits.h>  // for IOV_MAX
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+#include "errors.h"
+
+class IoBatch;
+
+/**
+ * @description: 一次异步读写请求，读写文件中从first_page_no开始的若干个连续页面
+ */
+struct IoRequest {
+    enum IoType { READ = 0, WRITE };
+
+    // 一个请求最多包含的页面个数，preadv/pwritev一次最多接受IOV_MAX个iovec，更长的连续页面需拆成多个请求
+    static constexpr int MAX_PAGES = IOV_MAX;
+
+    IoType type_;
+    int fd_;
+    page_id_t first_page_no_;
+    std::vector<struct iovec> iov_;     // 每个页面一个iovec，长度为PAGE_SIZE
+    IoBatch *batch_;                    // 请求所属的批次，完成时通知该批次
+
+    off_t offset() const { return static_cast<off_t>(first_page_no_) * PAGE_SIZE; }
+
+    ssize_t expected_bytes() const { return static_cast<ssize_t>(iov_.size()) * PAGE_SIZE; }
+};
+
+/**
+ * @description: 一批异步读写请求。先通过add_read/add_write加入请求，交给DiskManager::submit_io提交后，
+ * 调用wait()等待这一批请求全部完成。提交之后到wait()返回之前不能再加入请求，也不能析构该对象。
+ * 若设置了回调，则不能调用wait()，全部请求完成后由IO引擎的线程调用回调，回调中可以释放该批次
+ */
+class IoBatch {
+   public:
+    IoBatch() = default;
+
+    ~IoBatch() = default;
+
+    IoBatch(const IoBatch &) = delete;
+
+    IoBatch &operator=(const IoBatch &) = delete;
+
+    void add_read(int fd, page_id_t first_page_no, char *const *pages, int num_pages);
+
+    void add_write(int fd, page_id_t first_page_no, const char *const *pages, int num_pages);
+
+    bool empty() const { return requests_.empty(); }
+
+    std::vector<IoRequest> &requests() { return requests_; }
+
+    void wait();
+
+    /**
+     * @description: 设置全部请求完成后的回调，参数表示是否所有请求都读写完整
+     */
+    void set_callback(std::function<void(bool)> callback) { callback_ = std::move(callback); }
+
+    void on_submit();
+
+    void on_complete(IoRequest *request, ssize_t result);
+
+   private:
+    void add_request(IoRequest::IoType type, int fd, page_id_t first_page_no, char *const *pages, int num_pages);
+
+    std::vector<IoRequest> requests_;
+    std::mutex latch_;
+    std::condition_variable cv_;
+    size_t pending_ = 0;        // 已提交但尚未完成的请求个数
+    bool failed_ = false;       // 是否有请求没有读写完整
+    std::function<void(bool)> callback_;
+};
+
+/**
+ * @description: 异步IO引擎的抽象接口，DiskManager通过它把页面读写交给后台完成
+ */
+class IoEngine {
+   public:
+    virtual ~IoEngine() = default;
+
+    /**
+     * @description: 提交一批请求，函数返回时请求可能尚未完成，完成后调用IoBatch::on_complete
+     */
+    virtual void submit(IoBatch &batch) = 0;
+
+    virtual const char *name() const = 0;
+
+    static std::unique_ptr<IoEngine> create();
+};
+
+/**
+ * @description: 基于线程池的IO引擎，由若干工作线程执行preadv/pwritev，在没有io_uring时使用
+ */
+class ThreadPoolIoEngine : public IoEngine {
+   public:
+    explicit ThreadPoolIoEngine(size_t num_threads);
+
+    ~ThreadPoolIoEngine();
+
+    void submit(IoBatch &batch) override;
+
+    const char *name() const override { return "thread-pool"; }
+
+   private:
+    void worker_loop();
+
+    std::vector<std::thread> workers_;
+    std::deque<IoRequest *> queue_;     // 等待执行的请求
+    std::mutex latch_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
+
+#ifdef RMDB_USE_IO_URING
+#include <liburing.h>
+
+/**
+ * @description: 基于io_uring的IO引擎，提交线程把请求放入提交队列，后台线程收割完成队列
+ */
+class IoUringEngine : public IoEngine {
+   public:
+    static std::unique_ptr<IoEngine> try_create(unsigned queue_depth);
+
+    ~IoUringEngine();
+
+    void submit(IoBatch &batch) override;
+
+    const char *name() const override { return "io_uring"; }
+
+   private:
+    IoUringEngine() = default;
+
+    struct io_uring_sqe *get_sqe();
+
+    void reaper_loop();
+
+    struct io_uring ring_;
+    std::mutex submit_latch_;   // io_uring的提交队列只允许单线程操作
+    std::thread reaper_;
+};
+#endif
@@ -10,6 +10,10 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+
 #include "common/config.h"
 
 /**
@@ -21,8 +25,9 @@ struct PageId
     page_id_t page_no = INVALID_PAGE_ID;
 
     friend bool operator==(const PageId &x, const PageId &y) { return x.fd == y.fd && x.page_no == y.page_no; }
+    friend bool operator!=(const PageId &x, const PageId &y) { return !(x == y); }
     bool operator<(const PageId& x) const {
-        if(fd < x.fd) return true;
+        if (fd != x.fd) return fd < x.fd;
         return page_no < x.page_no;
     }
 
@@ -47,6 +52,109 @@ struct std::hash<PageId>
     size_t operator()(const PageId &obj) const { return std::hash<int64_t>()(obj.Get()); }
 };
 
+/**
+ * @description: 页面的读写latch，防止多个线程同时修改同一页面的数据。
+ * 持有写latch的线程可以再次获取同一页面的读latch或写latch（按次数计数），B+树修改时会多次访问同一结点；
+ * 只持有读latch的线程不能再申请写latch，否则会死锁。
+ * 另外维护一个版本号，供不加latch的乐观读取使用：获取写latch时加1变为奇数，释放时再加1变为偶数
+ */
+class PageLatch {
+   public:
+    void wlock() {
+        if (owner_.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+            ++depth_;
+            return;
+        }
+        mutex_.lock();
+        owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        depth_ = 1;
+        version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);  // 版本号变为奇数先于对页面的修改可见
+    }
+
+    /** wlock的不等待版本，latch被其他线程持有时返回false，用于不符合自顶向下加latch顺序的获取 */
+    bool try_wlock() {
+        if (owner_.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+            ++depth_;
+            return true;
+        }
+        if (!mutex_.try_lock()) {
+            return false;
+        }
+        owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        depth_ = 1;
+        version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return true;
+    }
+
+    void wunlock() {
+        if (--depth_ == 0) {
+            version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            owner_.store(std::thread::id(), std::memory_order_relaxed);
+            mutex_.unlock();
+        }
+    }
+
+    void rlock() {
+        if (owner_.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+            ++depth_;
+            return;
+        }
+        mutex_.lock_shared();
+    }
+
+    void runlock() {
+        if (owner_.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+            wunlock();
+            return;
+        }
+        mutex_.unlock_shared();
+    }
+
+    /**
+     * 乐观读取开始时获取版本号，页面正被其他线程修改（版本号为奇数）时等待修改完成。
+     * 乐观读取不写任何共享数据，读完之后用validate检查期间页面是否被修改
+     */
+    uint64_t read_version() const {
+        uint64_t version = version_.load(std::memory_order_acquire);
+        while ((version & 1) != 0 && owner_.load(std::memory_order_relaxed) != std::this_thread::get_id()) {
+            std::this_thread::yield();
+            version = version_.load(std::memory_order_acquire);
+        }
+        return version;
+    }
+
+    /** read_version的不等待版本，用于不pin页面的读取：页面正被修改或换入时返回false */
+    bool try_read_version(uint64_t *version) const {
+        *version = version_.load(std::memory_order_acquire);
+        return (*version & 1) == 0;
+    }
+
+    /** 版本号仍为read_version的返回值时，期间读到的页面内容是一致的 */
+    bool validate(uint64_t version) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version_.load(std::memory_order_relaxed) == version;
+    }
+
+    /**
+     * 缓冲池把帧换成另一个页面时，在修改PageId和内容之前调用begin_reload，新页面可以读取之后调用end_reload。
+     * 期间版本号为奇数，不pin页面的读取者会验证失败。调用时帧没有被pin，因此没有线程持有latch
+     */
+    void begin_reload() {
+        version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end_reload() { version_.store(version_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+   private:
+    std::shared_mutex mutex_;
+    std::atomic<std::thread::id> owner_{};  // 持有写latch的线程
+    int depth_ = 0;                         // 持有写latch的线程获取latch的次数，只由该线程访问
+    std::atomic<uint64_t> version_{0};      // 页面被修改的次数*2，正在修改时为奇数
+};
+
 /**
  * @description: Page类声明, Page是RMDB数据块的单位、是负责数据操作Record模块的操作对象，
  * Page对象在磁盘上有文件存储, 若在Buffer中则有帧偏移, 并非特指Buffer或Disk上的数据
@@ -67,6 +175,34 @@ class Page
 
     bool is_dirty() const { return is_dirty_; }
 
+    /** 页面latch，只能在页面被pin期间获取，通常通过ReadPageGuard/WritePageGuard使用 */
+    void rlatch() { latch_.rlock(); }
+
+    void runlatch() { latch_.runlock(); }
+
+    void wlatch() { latch_.wlock(); }
+
+    bool try_wlatch() { return latch_.try_wlock(); }
+
+    void wunlatch() { latch_.wunlock(); }
+
+    /** 不加latch的乐观读取，见PageLatch::read_version，只能在页面被pin期间使用 */
+    uint64_t read_version() const { return latch_.read_version(); }
+
+    /**
+     * 不pin页面的乐观读取（帧由BufferPoolManager::probe_page得到）：帧可能随时被换成其他页面，
+     * 换页期间版本号也会改变，因此复制后除了验证版本号，还要检查复制到的PageId
+     */
+    bool try_read_version(uint64_t *version) const { return latch_.try_read_version(version); }
+
+    bool validate_version(uint64_t version) const { return latch_.validate(version); }
+
+    /** 把页面的PageId和内容复制到snapshot，复制期间页面可能被其他线程修改，需用版本号检查复制结果 */
+    void copy_to(Page *snapshot) const {
+        snapshot->id_ = id_;
+        memcpy(snapshot->data_, data_, PAGE_SIZE);
+    }
+
     static constexpr size_t OFFSET_PAGE_START = 0;
     static constexpr size_t OFFSET_LSN = 0;
     static constexpr size_t OFFSET_PAGE_HDR = 4;
@@ -91,4 +227,10 @@ class Page
 
     /** The pin count of this page. */
     int pin_count_ = 0;
+
+    /** 页面正在从磁盘读入，此时data_尚不可用 */
+    bool is_loading_ = false;
+
+    /** 保护data_的读写latch */
+    PageLatch latch_;
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "page_guard.h"
+
+#include "buffer_pool_manager.h"
+
+ReadPageGuard::ReadPageGuard(ReadPageGuard &&that) noexcept : bpm_(that.bpm_), page_(that.page_) {
+    that.bpm_ = nullptr;
+    that.page_ = nullptr;
+}
+
+ReadPageGuard &ReadPageGuard::operator=(ReadPageGuard &&that) noexcept {
+    if (this != &that) {
+        drop();
+        bpm_ = that.bpm_;
+        page_ = that.page_;
+        that.bpm_ = nullptr;
+        that.page_ = nullptr;
+    }
+    return *this;
+}
+
+/**
+ * @description: 提前释放guard持有的latch和pin，之后guard为空，重复调用没有影响
+ */
+void ReadPageGuard::drop() {
+    if (page_ != nullptr) {
+        page_->runlatch();
+        bpm_->unpin_page(page_->get_page_id(), false);
+        bpm_ = nullptr;
+        page_ = nullptr;
+    }
+}
+
+WritePageGuard::WritePageGuard(WritePageGuard &&that) noexcept : bpm_(that.bpm_), page_(that.page_) {
+    that.bpm_ = nullptr;
+    that.page_ = nullptr;
+}
+
+WritePageGuard &WritePageGuard::operator=(WritePageGuard &&that) noexcept {
+    if (this != &that) {
+        drop();
+        bpm_ = that.bpm_;
+        page_ = that.page_;
+        that.bpm_ = nullptr;
+        that.page_ = nullptr;
+    }
+    return *this;
+}
+
+/**
+ * @description: 提前释放guard持有的latch和pin并标记脏页，之后guard为空，重复调用没有影响
+ */
+void WritePageGuard::drop() {
+    if (page_ != nullptr) {
+        page_->wunlatch();
+        bpm_->unpin_page(page_->get_page_id(), true);
+        bpm_ = nullptr;
+        page_ = nullptr;
+    }
+}
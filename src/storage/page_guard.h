@@ -0,0 +1,91 @@
+/* Copyright (c) 2023 Renmin University of China
+RMDB is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+        http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include "page.h"
+
+class BufferPoolManager;
+
+/**
+ * @description: 只读页面guard，持有页面的一次pin和读latch，离开作用域（或调用drop）时释放latch并unpin页面，不标记脏页。
+ * 只能移动不能拷贝；fetch失败时得到的guard为空，is_valid()返回false
+ */
+class ReadPageGuard {
+   public:
+    ReadPageGuard() = default;
+
+    // page必须已被pin并持有读latch，由guard负责释放
+    ReadPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+
+    ReadPageGuard(const ReadPageGuard &) = delete;
+
+    ReadPageGuard &operator=(const ReadPageGuard &) = delete;
+
+    ReadPageGuard(ReadPageGuard &&that) noexcept;
+
+    ReadPageGuard &operator=(ReadPageGuard &&that) noexcept;
+
+    ~ReadPageGuard() { drop(); }
+
+    void drop();
+
+    bool is_valid() const { return page_ != nullptr; }
+
+    Page *get_page() const { return page_; }
+
+    PageId get_page_id() const { return page_->get_page_id(); }
+
+    const char *get_data() const { return page_->get_data(); }
+
+   private:
+    BufferPoolManager *bpm_ = nullptr;
+    Page *page_ = nullptr;
+};
+
+/**
+ * @description: 可写页面guard，持有页面的一次pin和写latch，离开作用域（或调用drop）时释放latch，unpin页面并标记为脏页。
+ * 只能移动不能拷贝；fetch失败时得到的guard为空，is_valid()返回false
+ */
+class WritePageGuard {
+   public:
+    WritePageGuard() = default;
+
+    // page必须已被pin并持有写latch，由guard负责释放
+    WritePageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+
+    WritePageGuard(const WritePageGuard &) = delete;
+
+    WritePageGuard &operator=(const WritePageGuard &) = delete;
+
+    WritePageGuard(WritePageGuard &&that) noexcept;
+
+    WritePageGuard &operator=(WritePageGuard &&that) noexcept;
+
+    ~WritePageGuard() { drop(); }
+
+    void drop();
+
+    bool is_valid() const { return page_ != nullptr; }
+
+    Page *get_page() const { return page_; }
+
+    PageId get_page_id() const { return page_->get_page_id(); }
+
+    char *get_data() const { return page_->get_data(); }
+
+   private:
+    BufferPoolManager *bpm_ = nullptr;
+    Page *page_ = nullptr;
+};
@@ -104,6 +104,11 @@ void SmManager::open_db(const std::string& db_name)
     // 打开所有索引文件
     for (auto &entry : db_.tabs_) {
         for (auto &index : entry.second.indexes) { // 遍历表的索引
+            if (index.type == INDEX_HASH) {
+                hash_ihs_.emplace(ix_manager_->get_index_name(entry.first, index.cols),
+                                  ix_manager_->open_hash_index(entry.first, index.cols));
+                continue;
+            }
             ihs_.emplace(ix_manager_->get_index_name(entry.first, index.cols), ix_manager_->open_index(entry.first, index.cols)); 
         }
 
@@ -145,6 +150,10 @@ void SmManager::close_db()
         ix_manager_->close_index(entry.second.get());
     }
     ihs_.clear();
+    for (auto &entry : hash_ihs_) {
+        ix_manager_->close_hash_index(entry.second.get());
+    }
+    hash_ihs_.clear();
 
     if (chdir("..") < 0)
     {
@@ -267,8 +276,11 @@ void SmManager::drop_table(const std::string& tab_name, Context* context)
  * @param {string&} tab_name 表的名称
  * @param {vector<string>&} col_names 索引包含的字段名称
  * @param {Context*} context
+ * @param {bool} unique 是否为唯一索引，非唯一索引可以包含重复的key
+ * @param {IndexType} type 索引的存取方法，B+树或哈希
  */
-void SmManager::create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context) 
+void SmManager::create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context,
+                             bool unique, IndexType type) 
 {
     // 1. 获取表的元数据
     // 从数据库中获取指定表的元数据对象（tab_meta），以便后续操作
@@ -277,6 +289,7 @@ void SmManager::create_index(const std::string& tab_name, const std::vector<std:
     // 2. 创建并初始化索引元数据对象
     // 索引元数据对象 (index_meta) 包含了关于索引的基本信息
     IndexMeta index_meta = {tab_name};  // 初始化索引元数据，设置表名
+    index_meta.type = type;
 
     // 3. 获取列的元数据并计算索引相关信息
     // col_meta 是一个存储列元数据的 vector，index_meta.cols 存储了所有索引列的信息
@@ -294,20 +307,90 @@ void SmManager::create_index(const std::string& tab_name, const std::vector<std:
     }
 
     // 4. 锁定表，确保操作的独占性
-    // 如果 context 存在，且无法对表进行独占锁定，抛出异常
-    context->lock_mgr_->lock_exclusive_on_table(context->txn_,fhs_[tab_name]->GetFd());
+    // 如果 context 存在，且无法对表进行独占锁定，抛出异常；没有context（如单元测试中直接建索引）时不加锁
+    Transaction *txn = nullptr;
+    if (context != nullptr) {
+        context->lock_mgr_->lock_exclusive_on_table(context->txn_,fhs_[tab_name]->GetFd());
+        txn = context->txn_;
+    }
 
     // 5. 调用索引管理器创建索引
     // 使用索引管理器创建索引并将相关列元数据传递给它
-    ix_manager_->create_index(tab_name, col_meta);
+    if (type == INDEX_HASH) {
+        ix_manager_->create_hash_index(tab_name, col_meta, unique);
+    } else {
+        ix_manager_->create_index(tab_name, col_meta, unique);
+    }
 
     // 6. 更新表的索引列表
     // 将创建的索引元数据添加到表的索引列表中
     tab_meta.indexes.push_back(index_meta);
 
-    // 7. 将索引句柄保存在索引句柄映射表中
-    // 打开并获取该索引的句柄，然后将其存入索引句柄映射表（ihs_）
-    ihs_[ix_manager_->get_index_name(tab_name, col_meta)] = ix_manager_->open_index(tab_name, col_meta);
+    if (type == INDEX_HASH) {
+        // 哈希索引没有批量构建的方式，逐条插入表中已有的记录
+        auto hih = ix_manager_->open_hash_index(tab_name, col_meta);
+        auto fh = fhs_.at(tab_name).get();
+        RmFileHdr file_hdr = fh->get_file_hdr();
+        std::vector<char> key(index_meta.col_tot_len);
+        try {
+            for (RmScan scan(fh); !scan.is_end(); scan.next()) {
+                Rid rid = scan.rid();
+                ReadPageGuard guard = fh->fetch_page_read(rid.page_no);
+                RmPageHandle page_handle(&file_hdr, guard.get_page());
+                char *record = page_handle.get_slot(rid.slot_no);
+                int offset = 0;
+                for (auto& col : col_meta) {
+                    memcpy(key.data() + offset, record + col.offset, col.len);
+                    offset += col.len;
+                }
+                guard.drop();
+                // 唯一索引中key已存在时insert_entry返回false，表中已有重复的key，不能建立该索引
+                if (!hih->insert_entry(key.data(), rid, txn)) {
+                    throw DuplicateKeyError(tab_name, col_names);
+                }
+            }
+        } catch (...) {
+            ix_manager_->close_hash_index(hih.get());
+            ix_manager_->destroy_index(tab_name, col_meta);
+            tab_meta.indexes.pop_back();
+            throw;
+        }
+        hash_ihs_[ix_manager_->get_index_name(tab_name, col_meta)] = std::move(hih);
+        return;
+    }
+
+    // 7. 用表中已有的记录批量构建索引
+    // 顺序扫描表得到所有(key, Rid)，排序后自底向上构建B+树，避免逐条insert_entry的自顶向下查找和结点分裂
+    auto ih = ix_manager_->open_index(tab_name, col_meta);
+    auto fh = fhs_.at(tab_name).get();
+    RmFileHdr file_hdr = fh->get_file_hdr();
+    std::vector<char> key(index_meta.col_tot_len);
+    try {
+        IxBulkLoader loader(ih.get());
+        for (RmScan scan(fh); !scan.is_end(); scan.next()) {
+            Rid rid = scan.rid();
+            // 已持有表的排他锁，直接读取页面中的记录，不再逐条加记录锁
+            ReadPageGuard guard = fh->fetch_page_read(rid.page_no);
+            RmPageHandle page_handle(&file_hdr, guard.get_page());
+            char *record = page_handle.get_slot(rid.slot_no);
+            int offset = 0;
+            for (auto& col : col_meta) {
+                memcpy(key.data() + offset, record + col.offset, col.len);
+                offset += col.len;
+            }
+            loader.add(key.data(), rid);
+        }
+        loader.finish();
+    } catch (const DuplicateKeyError&) {
+        // 唯一索引中有重复的key，删除建了一半的索引文件和索引元数据
+        ix_manager_->close_index(ih.get());
+        ix_manager_->destroy_index(tab_name, col_meta);
+        tab_meta.indexes.pop_back();
+        throw DuplicateKeyError(tab_name, col_names);
+    }
+
+    // 8. 将索引句柄保存在索引句柄映射表中
+    ihs_[ix_manager_->get_index_name(tab_name, col_meta)] = std::move(ih);
 }
 
 
@@ -327,14 +410,19 @@ void SmManager::drop_index(const std::string& tab_name, const std::vector<std::s
     }
 
     auto index_name = ix_manager_->get_index_name(tab_name, col_names); // 获取索引名称
-    
-    ix_manager_->close_index(ihs_[index_name].get());
-    ix_manager_->destroy_index(tab_name, col_names);
-
     TabMeta& tab = db_.get_table(tab_name);
-    tab.indexes.erase(tab.get_index_meta(col_names));
+    auto index_meta = tab.get_index_meta(col_names);
+
+    if (index_meta->type == INDEX_HASH) {
+        ix_manager_->close_hash_index(hash_ihs_[index_name].get());
+        hash_ihs_.erase(index_name);
+    } else {
+        ix_manager_->close_index(ihs_[index_name].get());
+        ihs_.erase(index_name);
+    }
+    ix_manager_->destroy_index(tab_name, col_names);
 
-    ihs_.erase(index_name);
+    tab.indexes.erase(index_meta);
     flush_meta();
 
 }
@@ -355,4 +443,35 @@ void SmManager::drop_index(const std::string& tab_name, const std::vector<ColMet
 
     drop_index(tab_name, col_names, context);
 
-}
\ No newline at end of file
+}
+
+/**
+ * @description: 在索引中插入键值对，根据索引的存取方法选择B+树或哈希索引的句柄，唯一索引中key已存在时不插入
+ * @param {string&} tab_name 表名称
+ * @param {IndexMeta&} index 索引元数据
+ * @param {char*} key 按索引字段顺序拼接的字段值
+ * @param {Rid&} rid 记录的位置
+ * @param {Transaction*} txn 事务
+ */
+void SmManager::insert_index_entry(const std::string& tab_name, const IndexMeta& index, const char* key,
+                                   const Rid& rid, Transaction* txn) {
+    auto index_name = ix_manager_->get_index_name(tab_name, index.cols);
+    if (index.type == INDEX_HASH) {
+        hash_ihs_.at(index_name)->insert_entry(key, rid, txn);
+    } else {
+        ihs_.at(index_name)->insert_entry(key, rid, txn);
+    }
+}
+
+/**
+ * @description: 删除索引中的键值对(key, rid)，根据索引的存取方法选择B+树或哈希索引的句柄
+ * @return {bool} 是否找到并删除了该键值对
+ */
+bool SmManager::delete_index_entry(const std::string& tab_name, const IndexMeta& index, const char* key,
+                                   const Rid& rid, Transaction* txn) {
+    auto index_name = ix_manager_->get_index_name(tab_name, index.cols);
+    if (index.type == INDEX_HASH) {
+        return hash_ihs_.at(index_name)->delete_entry(key, rid, txn);
+    }
+    return ihs_.at(index_name)->delete_entry(key, rid, txn);
+}
@@ -30,6 +30,7 @@ class SmManager {
     DbMeta db_;             // 当前打开的数据库的元数据
     std::unordered_map<std::string, std::unique_ptr<RmFileHandle>> fhs_;    // file name -> record file handle, 当前数据库中每张表的数据文件
     std::unordered_map<std::string, std::unique_ptr<IxIndexHandle>> ihs_;   // file name -> index file handle, 当前数据库中每个索引的文件
+    std::unordered_map<std::string, std::unique_ptr<IxHashIndexHandle>> hash_ihs_;  // file name -> hash index file handle, 当前数据库中每个哈希索引的文件
    private:
     DiskManager* disk_manager_;
     BufferPoolManager* buffer_pool_manager_;
@@ -72,9 +73,17 @@ class SmManager {
 
     void drop_table(const std::string& tab_name, Context* context);
 
-    void create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context);
+    void create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context,
+                      bool unique = true, IndexType type = INDEX_BTREE);
 
     void drop_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context);
     
     void drop_index(const std::string& tab_name, const std::vector<ColMeta>& col_names, Context* context);
+
+    // 按索引的存取方法维护索引中的键值对，key为按索引字段顺序拼接的字段值
+    void insert_index_entry(const std::string& tab_name, const IndexMeta& index, const char* key, const Rid& rid,
+                            Transaction* txn);
+
+    bool delete_index_entry(const std::string& tab_name, const IndexMeta& index, const char* key, const Rid& rid,
+                            Transaction* txn);
 };
\ No newline at end of file
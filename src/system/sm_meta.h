@@ -13,6 +13,7 @@ See the Mulan PSL v2 for more details. */
 #include <algorithm>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -39,15 +40,22 @@ struct ColMeta {
     }
 };
 
+/* 索引的存取方法 */
+enum IndexType {
+    INDEX_BTREE,    // B+树索引，支持等值查找、范围扫描和有序输出
+    INDEX_HASH      // 可扩展哈希索引，只支持等值查找
+};
+
 /* 索引元数据 */
 struct IndexMeta {
     std::string tab_name;           // 索引所属表名称
     int col_tot_len;                // 索引字段长度总和
     int col_num;                    // 索引字段数量
     std::vector<ColMeta> cols;      // 索引包含的字段
+    IndexType type = INDEX_BTREE;   // 索引的存取方法
 
     friend std::ostream &operator<<(std::ostream &os, const IndexMeta &index) {
-        os << index.tab_name << " " << index.col_tot_len << " " << index.col_num;
+        os << index.tab_name << " " << index.col_tot_len << " " << index.col_num << " " << index.type;
         for(auto& col: index.cols) {
             os << "\n" << col;
         }
@@ -56,6 +64,13 @@ struct IndexMeta {
 
     friend std::istream &operator>>(std::istream &is, IndexMeta &index) {
         is >> index.tab_name >> index.col_tot_len >> index.col_num;
+        // 旧的db.meta中这一行没有存取方法字段，索引字段从下一行开始，视为B+树索引
+        std::string rest;
+        std::getline(is, rest);
+        std::istringstream rest_is(rest);
+        if (!(rest_is >> index.type)) {
+            index.type = INDEX_BTREE;
+        }
         for(int i = 0; i < index.col_num; ++i) {
             ColMeta col;
             is >> col;
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <random>  // for std::default_random_engine
+#include <string>
+#include <vector>
+
+#include "execution/executor_abstract.h"
+
+/** 按顺序输出内存中的元组的扫描算子，元组由num_cols个int字段组成，字段名为c0, c1, ...，所有元组连续存放 */
+class MockScanExecutor : public AbstractExecutor {
+   private:
+    std::vector<ColMeta> cols_;
+    size_t len_;
+    std::vector<int> data_;
+    size_t num_rows_;
+    size_t pos_ = 0;
+
+   public:
+    int num_scans = 0;  // beginTuple的调用次数，即扫描的遍数
+
+    // data中按顺序连续存放每个元组的num_cols个字段
+    MockScanExecutor(const std::string &tab_name, int num_cols, std::vector<int> data) : data_(std::move(data)) {
+        for (int i = 0; i < num_cols; i++) {
+            cols_.push_back(ColMeta{.tab_name = tab_name, .name = "c" + std::to_string(i), .type = TYPE_INT,
+                                    .len = sizeof(int), .offset = static_cast<int>(i * sizeof(int)), .index = false});
+        }
+        len_ = num_cols * sizeof(int);
+        num_rows_ = data_.size() / num_cols;
+    }
+
+    MockScanExecutor(const std::string &tab_name, int num_cols, const std::vector<std::vector<int>> &rows)
+        : MockScanExecutor(tab_name, num_cols, flatten(rows)) {}
+
+    void beginTuple() override {
+        pos_ = 0;
+        num_scans++;
+    }
+    void nextTuple() override { pos_++; }
+    bool is_end() const override { return pos_ >= num_rows_; }
+
+    std::unique_ptr<RmRecord> Next() override {
+        auto rec = std::make_unique<RmRecord>(len_);
+        memcpy(rec->data, data_.data() + pos_ * cols_.size(), len_);
+        return rec;
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+    size_t tupleLen() const override { return len_; }
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    static std::vector<int> flatten(const std::vector<std::vector<int>> &rows) {
+        std::vector<int> data;
+        for (auto &row : rows) {
+            data.insert(data.end(), row.begin(), row.end());
+        }
+        return data;
+    }
+};
+
+// 每行num_cols个字段，前num_keys列在[0, key_range)中随机取值，其余列为行号
+inline std::vector<std::vector<int>> make_rows(int num_rows, int num_cols, int key_range, unsigned seed,
+                                               int num_keys = 1) {
+    std::default_random_engine rng(seed);
+    std::uniform_int_distribution<int> dist(0, key_range - 1);
+    std::vector<std::vector<int>> rows(num_rows);
+    for (int i = 0; i < num_rows; i++) {
+        for (int j = 0; j < num_cols; j++) {
+            rows[i].push_back(j < num_keys ? dist(rng) : i);
+        }
+    }
+    return rows;
+}
@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <chrono>  // NOLINT
+
+#include "gtest/gtest.h"
+
+#include "execution/executor_hash_join.h"
+#include "execution/executor_index_nestedloop_join.h"
+#include "execution/executor_merge_join.h"
+#include "execution/executor_nestedloop_join.h"
+#include "execution/executor_seq_scan.h"
+#include "executor_test_util.h"
+
+class JoinExecutorTest : public ::testing::Test {
+   public:
+    static Condition col_cond(const std::string &lhs_tab, const std::string &lhs_col, CompOp op,
+                              const std::string &rhs_tab, const std::string &rhs_col) {
+        Condition cond;
+        cond.lhs_col = {.tab_name = lhs_tab, .col_name = lhs_col};
+        cond.op = op;
+        cond.is_rhs_val = false;
+        cond.rhs_col = {.tab_name = rhs_tab, .col_name = rhs_col};
+        return cond;
+    }
+
+    // 执行join，把输出的元组按字段转成int数组后排序
+    static std::vector<std::vector<int>> collect(AbstractExecutor *join) {
+        std::vector<std::vector<int>> result;
+        int num_cols = join->tupleLen() / sizeof(int);
+        for (join->beginTuple(); !join->is_end(); join->nextTuple()) {
+            auto rec = join->Next();
+            std::vector<int> row(num_cols);
+            memcpy(row.data(), rec->data, join->tupleLen());
+            result.push_back(std::move(row));
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // 按定义计算满足pred的两表连接结果
+    template <class Pred>
+    static std::vector<std::vector<int>> expected_join(const std::vector<std::vector<int>> &left,
+                                                       const std::vector<std::vector<int>> &right, Pred pred) {
+        std::vector<std::vector<int>> result;
+        for (auto &l : left) {
+            for (auto &r : right) {
+                if (pred(l, r)) {
+                    std::vector<int> row = l;
+                    row.insert(row.end(), r.begin(), r.end());
+                    result.push_back(std::move(row));
+                }
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+};
+
+/**
+ * @brief 哈希连接的结果与按定义计算的结果相同：内存中连接，构建侧分别为左侧和右侧，以及带有非等值条件的连接
+ */
+TEST_F(JoinExecutorTest, HashJoinInMemoryTest) {
+    auto left = make_rows(1000, 2, 100, 1);
+    auto right = make_rows(300, 3, 120, 2);
+    auto eq = [](const std::vector<int> &l, const std::vector<int> &r) { return l[0] == r[0]; };
+    for (bool swap_sides : {false, true}) {
+        // 元组较少的一侧先读完，作为构建侧
+        auto &outer = swap_sides ? right : left;
+        auto &inner = swap_sides ? left : right;
+        HashJoinExecutor join(std::make_unique<MockScanExecutor>("l", outer[0].size(), outer),
+                              std::make_unique<MockScanExecutor>("r", inner[0].size(), inner),
+                              {col_cond("l", "c0", OP_EQ, "r", "c0")});
+        EXPECT_EQ(collect(&join), expected_join(outer, inner, eq));
+        // 重新开始得到相同的结果
+        EXPECT_EQ(collect(&join), expected_join(outer, inner, eq));
+    }
+
+    // 条件的左边是右子算子的字段；另有一个非等值条件
+    HashJoinExecutor join(std::make_unique<MockScanExecutor>("l", 2, left),
+                          std::make_unique<MockScanExecutor>("r", 3, right),
+                          {col_cond("r", "c0", OP_EQ, "l", "c0"), col_cond("l", "c1", OP_LT, "r", "c2")});
+    EXPECT_EQ(collect(&join), expected_join(left, right, [](const std::vector<int> &l, const std::vector<int> &r) {
+                  return l[0] == r[0] && l[1] < r[2];
+              }));
+
+    // 构建侧为空
+    HashJoinExecutor empty_join(std::make_unique<MockScanExecutor>("l", 2, left),
+                                std::make_unique<MockScanExecutor>("r", 3, std::vector<std::vector<int>>()),
+                                {col_cond("l", "c0", OP_EQ, "r", "c0")});
+    EXPECT_TRUE(collect(&empty_join).empty());
+}
+
+/**
+ * @brief 内存限制远小于输入时通过分区文件连接（grace hash join），包括所有元组的key都相同的倾斜分区
+ */
+TEST_F(JoinExecutorTest, HashJoinPartitionTest) {
+    auto left = make_rows(5000, 2, 2000, 3);
+    auto right = make_rows(4000, 2, 2500, 4);
+    auto eq = [](const std::vector<int> &l, const std::vector<int> &r) { return l[0] == r[0]; };
+    HashJoinExecutor join(std::make_unique<MockScanExecutor>("l", 2, left),
+                          std::make_unique<MockScanExecutor>("r", 2, right), {col_cond("l", "c0", OP_EQ, "r", "c0")},
+                          4096);
+    EXPECT_EQ(collect(&join), expected_join(left, right, eq));
+
+    auto skew_left = make_rows(300, 2, 1, 5);
+    auto skew_right = make_rows(200, 2, 1, 6);
+    HashJoinExecutor skew_join(std::make_unique<MockScanExecutor>("l", 2, skew_left),
+                               std::make_unique<MockScanExecutor>("r", 2, skew_right),
+                               {col_cond("l", "c0", OP_EQ, "r", "c0")}, 1024);
+    auto result = collect(&skew_join);
+    EXPECT_EQ(result.size(), 300u * 200u);
+    EXPECT_EQ(result, expected_join(skew_left, skew_right, eq));
+}
+
+/**
+ * @brief 块嵌套循环连接的结果与按定义计算的结果相同，内层（左子算子）每块只扫描一遍
+ */
+TEST_F(JoinExecutorTest, BlockNestedLoopJoinTest) {
+    auto left = make_rows(500, 2, 50, 11);
+    auto right = make_rows(700, 3, 60, 12);
+    auto theta = [](const std::vector<int> &l, const std::vector<int> &r) { return l[0] < r[0] && l[1] != r[2]; };
+    size_t right_len = 3 * sizeof(int);
+    // 每块一个元组、块大小不是元组长度的整数倍、外层全部放入一块
+    for (size_t block_size : {size_t{1}, right_len * 64 + 5, NESTED_LOOP_JOIN_BLOCK_SIZE}) {
+        auto inner = std::make_unique<MockScanExecutor>("l", 2, left);
+        auto inner_ptr = inner.get();
+        NestedLoopJoinExecutor join(std::move(inner), std::make_unique<MockScanExecutor>("r", 3, right),
+                                    {col_cond("l", "c0", OP_LT, "r", "c0"), col_cond("l", "c1", OP_NE, "r", "c2")},
+                                    block_size);
+        EXPECT_EQ(collect(&join), expected_join(left, right, theta));
+        size_t rows_per_block = std::max<size_t>(1, (block_size + right_len - 1) / right_len);
+        EXPECT_EQ(inner_ptr->num_scans, static_cast<int>((right.size() + rows_per_block - 1) / rows_per_block));
+    }
+
+    // 没有条件时为笛卡尔积；任意一侧为空时结果为空
+    NestedLoopJoinExecutor cross(std::make_unique<MockScanExecutor>("l", 2, left),
+                                 std::make_unique<MockScanExecutor>("r", 3, right), {}, 1000);
+    EXPECT_EQ(collect(&cross).size(), left.size() * right.size());
+    for (bool empty_left : {false, true}) {
+        NestedLoopJoinExecutor empty_join(
+            std::make_unique<MockScanExecutor>("l", 2, empty_left ? std::vector<std::vector<int>>() : left),
+            std::make_unique<MockScanExecutor>("r", 3, empty_left ? right : std::vector<std::vector<int>>()), {});
+        EXPECT_TRUE(collect(&empty_join).empty());
+    }
+}
+
+/**
+ * @brief 归并连接的结果与按定义计算的结果相同：两侧都有大量重复key，归并key为第一个条件，另有非等值条件
+ */
+TEST_F(JoinExecutorTest, MergeJoinTest) {
+    auto left = make_rows(2000, 2, 300, 17);
+    auto right = make_rows(1500, 3, 400, 18);
+    std::sort(left.begin(), left.end());
+    std::sort(right.begin(), right.end());
+    MergeJoinExecutor join(std::make_unique<MockScanExecutor>("l", 2, left), std::make_unique<MockScanExecutor>("r", 3, right),
+                           {col_cond("r", "c0", OP_EQ, "l", "c0"), col_cond("l", "c1", OP_GT, "r", "c2")});
+    auto expected = expected_join(left, right, [](const std::vector<int> &l, const std::vector<int> &r) {
+        return l[0] == r[0] && l[1] > r[2];
+    });
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(collect(&join), expected);
+    EXPECT_EQ(collect(&join), expected);
+
+    // 归并连接按key有序输出；所有key相同时为笛卡尔积
+    auto same_left = make_rows(100, 2, 1, 19);
+    auto same_right = make_rows(70, 2, 1, 20);
+    MergeJoinExecutor same_join(std::make_unique<MockScanExecutor>("l", 2, same_left),
+                                std::make_unique<MockScanExecutor>("r", 2, same_right),
+                                {col_cond("l", "c0", OP_EQ, "r", "c0")});
+    EXPECT_EQ(collect(&same_join).size(), 100u * 70u);
+
+    // 一侧为空，或两侧的key没有交集
+    MergeJoinExecutor empty_join(std::make_unique<MockScanExecutor>("l", 2, left),
+                                 std::make_unique<MockScanExecutor>("r", 3, std::vector<std::vector<int>>()),
+                                 {col_cond("l", "c0", OP_EQ, "r", "c0")});
+    EXPECT_TRUE(collect(&empty_join).empty());
+    MergeJoinExecutor disjoint_join(std::make_unique<MockScanExecutor>("l", 2, std::vector<std::vector<int>>{{1, 0}, {3, 0}}),
+                                    std::make_unique<MockScanExecutor>("r", 2, std::vector<std::vector<int>>{{2, 0}, {4, 0}}),
+                                    {col_cond("l", "c0", OP_EQ, "r", "c0")});
+    EXPECT_TRUE(collect(&disjoint_join).empty());
+}
+
+/**
+ * @brief 比较哈希连接与嵌套循环连接的耗时，归并连接与哈希连接的耗时，以及哈希连接在内存中连接和分区连接的耗时
+ */
+TEST_F(JoinExecutorTest, HashJoinBenchmark) {
+    auto time_join = [](AbstractExecutor *join, size_t *num_rows) {
+        auto start = std::chrono::steady_clock::now();
+        *num_rows = 0;
+        for (join->beginTuple(); !join->is_end(); join->nextTuple()) {
+            (*num_rows)++;
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    const int small = 2000;
+    auto left = make_rows(small, 2, small, 7);
+    auto right = make_rows(small, 2, small, 8);
+    NestedLoopJoinExecutor nlj(std::make_unique<MockScanExecutor>("l", 2, left),
+                               std::make_unique<MockScanExecutor>("r", 2, right), {col_cond("l", "c0", OP_EQ, "r", "c0")});
+    HashJoinExecutor hj(std::make_unique<MockScanExecutor>("l", 2, left), std::make_unique<MockScanExecutor>("r", 2, right),
+                        {col_cond("l", "c0", OP_EQ, "r", "c0")});
+    size_t nlj_rows, hj_rows;
+    double nlj_ms = time_join(&nlj, &nlj_rows);
+    double hj_ms = time_join(&hj, &hj_rows);
+    EXPECT_EQ(nlj_rows, hj_rows);
+    printf("%d x %d rows: nested loop join %.1f ms, hash join %.1f ms\n", small, small, nlj_ms, hj_ms);
+
+    const int large = 100000;
+    left = make_rows(large, 2, large, 9);
+    right = make_rows(large, 2, large, 10);
+    auto sorted_left = left;
+    auto sorted_right = right;
+    std::sort(sorted_left.begin(), sorted_left.end());
+    std::sort(sorted_right.begin(), sorted_right.end());
+    MergeJoinExecutor mj(std::make_unique<MockScanExecutor>("l", 2, sorted_left),
+                         std::make_unique<MockScanExecutor>("r", 2, sorted_right), {col_cond("l", "c0", OP_EQ, "r", "c0")});
+    size_t mj_rows;
+    double mj_ms = time_join(&mj, &mj_rows);
+    printf("%d x %d sorted rows: merge join %.1f ms, %zu rows\n", large, large, mj_ms, mj_rows);
+    for (size_t memory_limit : {HASH_JOIN_MEMORY_LIMIT, size_t{256} << 10}) {
+        HashJoinExecutor join(std::make_unique<MockScanExecutor>("l", 2, left),
+                              std::make_unique<MockScanExecutor>("r", 2, right), {col_cond("l", "c0", OP_EQ, "r", "c0")},
+                              memory_limit);
+        size_t num_rows;
+        double ms = time_join(&join, &num_rows);
+        printf("%d x %d rows, memory limit %zu KB: hash join %.1f ms, %zu rows\n", large, large, memory_limit >> 10, ms,
+               num_rows);
+    }
+}
+
+/**
+ * 索引嵌套循环连接的内层是真实的表：先创建和进入目录TEST_DB_NAME，然后在此目录下创建表"t"及其c0字段上的非唯一B+树索引
+ */
+class IndexJoinExecutorTest : public JoinExecutorTest {
+   public:
+    const std::string TEST_DB_NAME = "IndexJoinTest_db";
+    const std::string TAB_NAME = "t";
+
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    std::unique_ptr<LockManager> lock_manager_;
+    std::unique_ptr<Transaction> txn_;
+    std::unique_ptr<Context> context_;
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        lock_manager_ = std::make_unique<LockManager>();
+        txn_ = std::make_unique<Transaction>(0);
+        context_ = std::make_unique<Context>(lock_manager_.get(), nullptr, txn_.get());
+
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        for (auto &entry : sm_manager_->ihs_) {
+            ix_manager_->close_index(entry.second.get());
+        }
+        for (auto &entry : sm_manager_->fhs_) {
+            rm_manager_->close_file(entry.second.get());
+        }
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    // 创建表TAB_NAME，字段与MockScanExecutor相同，插入rows并在c0字段上建立非唯一索引
+    void create_inner_table(int num_cols, const std::vector<std::vector<int>> &rows) {
+        TabMeta tab;
+        tab.name = TAB_NAME;
+        tab.cols = MockScanExecutor(TAB_NAME, num_cols, std::vector<int>()).cols();
+        std::vector<ColMeta> index_cols{tab.cols[0]};
+        tab.indexes.push_back(IndexMeta{.tab_name = TAB_NAME, .col_tot_len = sizeof(int), .col_num = 1, .cols = index_cols});
+        sm_manager_->db_.SetTabMeta(TAB_NAME, tab);
+
+        rm_manager_->create_file(TAB_NAME, num_cols * sizeof(int));
+        auto fh = rm_manager_->open_file(TAB_NAME);
+        ix_manager_->create_index(TAB_NAME, index_cols, false);
+        auto ih = ix_manager_->open_index(TAB_NAME, index_cols);
+        for (auto &row : rows) {
+            std::vector<int> buf = row;
+            Rid rid = fh->insert_record(reinterpret_cast<char *>(buf.data()), context_.get());
+            ih->insert_entry(reinterpret_cast<const char *>(&row[0]), rid, txn_.get());
+        }
+        sm_manager_->fhs_[TAB_NAME] = std::move(fh);
+        sm_manager_->ihs_[ix_manager_->get_index_name(TAB_NAME, index_cols)] = std::move(ih);
+    }
+};
+
+/**
+ * @brief 索引嵌套循环连接的结果与按定义计算的结果相同：内层分别为左侧和右侧，内层表上有扫描条件，另有非等值连接条件
+ */
+TEST_F(IndexJoinExecutorTest, IndexNestedLoopJoinTest) {
+    auto inner = make_rows(3000, 2, 500, 13);
+    auto outer = make_rows(800, 2, 600, 14);  // 部分外层元组在内层中没有匹配
+    create_inner_table(2, inner);
+
+    Condition inner_cond;
+    inner_cond.lhs_col = {.tab_name = TAB_NAME, .col_name = "c1"};
+    inner_cond.op = OP_GE;
+    inner_cond.is_rhs_val = true;
+    inner_cond.rhs_val.set_int(1000);
+    inner_cond.rhs_val.init_raw(sizeof(int));
+
+    for (bool inner_left : {true, false}) {
+        IndexNestedLoopJoinExecutor join(sm_manager_.get(), std::make_unique<MockScanExecutor>("o", 2, outer), TAB_NAME,
+                                         {inner_cond}, {"c0"},
+                                         {col_cond("o", "c0", OP_EQ, TAB_NAME, "c0"), col_cond("o", "c1", OP_LT, TAB_NAME, "c1")},
+                                         inner_left, context_.get());
+        auto pred = [](const std::vector<int> &t, const std::vector<int> &o) {
+            return t[0] == o[0] && t[1] >= 1000 && o[1] < t[1];
+        };
+        auto expected = inner_left ? expected_join(inner, outer, pred)
+                                   : expected_join(outer, inner, [&](const std::vector<int> &o, const std::vector<int> &t) {
+                                         return pred(t, o);
+                                     });
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(collect(&join), expected);
+        EXPECT_EQ(collect(&join), expected);
+    }
+
+    // 外层为空
+    IndexNestedLoopJoinExecutor empty_join(sm_manager_.get(),
+                                           std::make_unique<MockScanExecutor>("o", 2, std::vector<std::vector<int>>()),
+                                           TAB_NAME, {}, {"c0"}, {col_cond("o", "c0", OP_EQ, TAB_NAME, "c0")}, true,
+                                           context_.get());
+    EXPECT_TRUE(collect(&empty_join).empty());
+}
+
+/**
+ * @brief 外层元组较少、内层表较大时，比较索引嵌套循环连接与扫描整个内层表的哈希连接、块嵌套循环连接的耗时。
+ * 运行时间较长，默认不运行，需要时用--gtest_also_run_disabled_tests运行
+ */
+TEST_F(IndexJoinExecutorTest, DISABLED_IndexNestedLoopJoinBenchmark) {
+    const int num_inner = 100000;
+    const int num_outer = 1000;
+    auto inner = make_rows(num_inner, 2, num_inner, 15);
+    auto outer = make_rows(num_outer, 2, num_inner, 16);
+    create_inner_table(2, inner);
+    auto eq = [&]() { return std::vector<Condition>{col_cond("o", "c0", OP_EQ, TAB_NAME, "c0")}; };
+
+    auto time_join = [](AbstractExecutor *join, size_t *num_rows) {
+        auto start = std::chrono::steady_clock::now();
+        *num_rows = 0;
+        for (join->beginTuple(); !join->is_end(); join->nextTuple()) {
+            (*num_rows)++;
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    IndexNestedLoopJoinExecutor inlj(sm_manager_.get(), std::make_unique<MockScanExecutor>("o", 2, outer), TAB_NAME, {},
+                                     {"c0"}, eq(), false, context_.get());
+    HashJoinExecutor hj(std::make_unique<MockScanExecutor>("o", 2, outer),
+                        std::make_unique<SeqScanExecutor>(sm_manager_.get(), TAB_NAME, std::vector<Condition>(), context_.get()),
+                        eq());
+    NestedLoopJoinExecutor bnlj(std::make_unique<SeqScanExecutor>(sm_manager_.get(), TAB_NAME, std::vector<Condition>(),
+                                                                  context_.get()),
+                                std::make_unique<MockScanExecutor>("o", 2, outer), eq());
+    size_t inlj_rows, hj_rows, bnlj_rows;
+    double inlj_ms = time_join(&inlj, &inlj_rows);
+    double hj_ms = time_join(&hj, &hj_rows);
+    double bnlj_ms = time_join(&bnlj, &bnlj_rows);
+    EXPECT_EQ(inlj_rows, hj_rows);
+    EXPECT_EQ(inlj_rows, bnlj_rows);
+    printf("%d outer x %d inner rows: index nested loop join %.1f ms, hash join %.1f ms, block nested loop join %.1f ms\n",
+           num_outer, num_inner, inlj_ms, hj_ms, bnlj_ms);
+}
+
+/**
+ * @brief 内层为真实表上的顺序扫描时，比较每个外层元组扫描一遍内层（块大小为1）与块嵌套循环连接的耗时，
+ * 块嵌套循环连接每块外层元组只扫描一遍内层表的所有页面。运行时间较长，默认不运行，需要时用--gtest_also_run_disabled_tests运行
+ */
+TEST_F(IndexJoinExecutorTest, DISABLED_BlockNestedLoopJoinBenchmark) {
+    const int num_inner = 10000;
+    const int num_outer = 500;
+    auto inner = make_rows(num_inner, 2, num_inner, 21);
+    auto outer = make_rows(num_outer, 2, 100, 22);
+    create_inner_table(2, inner);
+
+    std::vector<double> times;
+    std::vector<size_t> counts;
+    for (size_t block_size : {size_t{1}, NESTED_LOOP_JOIN_BLOCK_SIZE}) {
+        NestedLoopJoinExecutor join(
+            std::make_unique<SeqScanExecutor>(sm_manager_.get(), TAB_NAME, std::vector<Condition>(), context_.get()),
+            std::make_unique<MockScanExecutor>("o", 2, outer), {col_cond(TAB_NAME, "c0", OP_LT, "o", "c0")}, block_size);
+        auto start = std::chrono::steady_clock::now();
+        size_t num_rows = 0;
+        for (join.beginTuple(); !join.is_end(); join.nextTuple()) {
+            num_rows++;
+        }
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        counts.push_back(num_rows);
+        printf("%d outer x %d inner rows, theta join with block size %zu bytes: %.1f ms, %zu rows\n", num_outer,
+               num_inner, block_size, times.back(), num_rows);
+    }
+    EXPECT_EQ(counts[0], counts[1]);
+    EXPECT_EQ(counts[0], expected_join(inner, outer, [](const std::vector<int> &t, const std::vector<int> &o) {
+                             return t[0] < o[0];
+                         }).size());
+}
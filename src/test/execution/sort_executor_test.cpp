@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <chrono>  // NOLINT
+
+#include "gtest/gtest.h"
+
+#include "execution/execution_sort.h"
+#include "executor_test_util.h"
+
+class SortExecutorTest : public ::testing::Test {
+   public:
+    static std::vector<TabCol> key_cols(const std::vector<int> &col_ids) {
+        std::vector<TabCol> cols;
+        for (int id : col_ids) {
+            cols.push_back({.tab_name = "t", .col_name = "c" + std::to_string(id)});
+        }
+        return cols;
+    }
+
+    // 执行排序，把输出的元组按字段转成int数组
+    static std::vector<std::vector<int>> collect(SortExecutor *sort) {
+        std::vector<std::vector<int>> result;
+        int num_cols = sort->tupleLen() / sizeof(int);
+        for (sort->beginTuple(); !sort->is_end(); sort->nextTuple()) {
+            auto rec = sort->Next();
+            std::vector<int> row(num_cols);
+            memcpy(row.data(), rec->data, sort->tupleLen());
+            result.push_back(std::move(row));
+        }
+        return result;
+    }
+
+    // 按定义计算的排序结果：按各个键依次比较，排序键相同时保持原来的顺序
+    static std::vector<std::vector<int>> expected_sort(std::vector<std::vector<int>> rows, const std::vector<int> &col_ids,
+                                                       const std::vector<bool> &is_desc) {
+        std::stable_sort(rows.begin(), rows.end(), [&](const std::vector<int> &a, const std::vector<int> &b) {
+            for (size_t i = 0; i < col_ids.size(); i++) {
+                int id = col_ids[i];
+                if (a[id] != b[id]) {
+                    return is_desc[i] ? a[id] > b[id] : a[id] < b[id];
+                }
+            }
+            return false;
+        });
+        return rows;
+    }
+};
+
+/**
+ * @brief 内存中排序：多个排序键分别升序和降序，单个降序键，以及空输入
+ */
+TEST_F(SortExecutorTest, InMemorySortTest) {
+    auto data = make_rows(5000, 4, 10, 1, 3);
+    for (auto &keys : std::vector<std::pair<std::vector<int>, std::vector<bool>>>{
+             {{0, 1, 2}, {false, true, false}}, {{1}, {true}}, {{2, 0}, {true, true}}}) {
+        SortExecutor sort(std::make_unique<MockScanExecutor>("t", 4, data), key_cols(keys.first), keys.second);
+        auto expected = expected_sort(data, keys.first, keys.second);
+        EXPECT_EQ(collect(&sort), expected);
+        EXPECT_EQ(sort.num_runs(), 0u);
+        // 重新开始得到相同的结果
+        EXPECT_EQ(collect(&sort), expected);
+    }
+
+    SortExecutor empty_sort(std::make_unique<MockScanExecutor>("t", 2, std::vector<int>()), key_cols({0}), {false});
+    EXPECT_TRUE(collect(&empty_sort).empty());
+}
+
+/**
+ * @brief 内存限制远小于输入时写出多个有序段再归并，包括有序段多于归并路数时的多趟归并；排序键相同的元组保持输入的顺序
+ */
+TEST_F(SortExecutorTest, ExternalSortTest) {
+    auto data = make_rows(20000, 3, 50, 2, 2);
+    // 每个有序段约1000个元组，共约20个有序段
+    SortExecutor sort(std::make_unique<MockScanExecutor>("t", 3, data), key_cols({0, 1}), {true, false}, 12000);
+    auto expected = expected_sort(data, {0, 1}, {true, false});
+    EXPECT_EQ(collect(&sort), expected);
+    EXPECT_EQ(sort.num_runs(), 2u);  // 多趟归并后只剩2个有序段
+
+    // 只按一个重复很多的键排序，最后一列为输入顺序，检查稳定性
+    SortExecutor stable_sort(std::make_unique<MockScanExecutor>("t", 3, data), key_cols({0}), {false},
+                             SORT_RUN_BUFFER_SIZE * 2);
+    expected = expected_sort(data, {0}, {false});
+    EXPECT_EQ(collect(&stable_sort), expected);
+    EXPECT_EQ(collect(&stable_sort), expected);
+}
+
+/**
+ * @brief 排序1000万个元组，比较内存限制远小于数据量时的外部排序与全部在内存中排序的耗时。
+ * 运行时间较长并占用较多内存，默认不运行，需要时用--gtest_also_run_disabled_tests运行
+ */
+TEST_F(SortExecutorTest, DISABLED_SortBenchmark) {
+    const int num_rows = 10000000;
+    std::vector<int> data = MockScanExecutor::flatten(make_rows(num_rows, 2, num_rows, 3));
+    size_t data_size = data.size() * sizeof(int);
+    for (size_t memory_limit : {size_t{8} << 20, data_size + 1}) {
+        SortExecutor sort(std::make_unique<MockScanExecutor>("t", 2, data), key_cols({0, 1}), {false, true},
+                          memory_limit);
+        auto start = std::chrono::steady_clock::now();
+        size_t count = 0;
+        std::vector<int> prev{-1, 0};
+        bool sorted = true;
+        for (sort.beginTuple(); !sort.is_end(); sort.nextTuple()) {
+            auto rec = sort.Next();
+            auto row = reinterpret_cast<const int *>(rec->data);
+            sorted = sorted && (row[0] > prev[0] || (row[0] == prev[0] && row[1] <= prev[1]));
+            prev = {row[0], row[1]};
+            count++;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        EXPECT_TRUE(sorted);
+        EXPECT_EQ(count, static_cast<size_t>(num_rows));
+        printf("sort %d rows (%zu MB), memory limit %zu MB: %.1f ms, %zu runs merged\n", num_rows, data_size >> 20,
+               memory_limit >> 20, ms, sort.num_runs());
+    }
+}
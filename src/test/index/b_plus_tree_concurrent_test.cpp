@@ -1,3 +1,4 @@
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
@@ -462,4 +463,249 @@ TEST_F(BPlusTreeConcurrentTest, MixScaleTest) {
         scan.next();
     }
     EXPECT_EQ(size, keys.size() - delete_keys.size());
-}
\ No newline at end of file
+}
+/**
+ * @brief 扫描与插入、删除并发进行：预先插入的偶数key不会被删除，每次扫描必须按顺序恰好访问它们一次。
+ * 写线程不断插入再删除奇数key，使叶子分裂、合并，缓冲池较小，叶子页面也会被换出后复用。
+ * 扫描的起点和终点是构造扫描之前算出的位置（Iid），所在叶子被修改后会偏移，因此写线程只修改远离各扫描端点的key
+ */
+TEST_F(BPlusTreeConcurrentTest, ScanDuringModificationTest) {
+    const int num_keys = 10000;
+    const int num_writers = 4;
+    const int order = 16;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+    for (int key = 0; key < num_keys * 2; key += 2) {
+        ih_->insert_entry((const char *)&key, Rid{.page_no = 0, .slot_no = key}, txn_.get());
+    }
+
+    std::atomic<bool> stop{false};
+    auto writer = [&](int thread_itr) {
+        Transaction transaction(thread_itr);
+        std::default_random_engine rng(thread_itr);
+        std::uniform_int_distribution<int> key_dist(num_keys / 8, num_keys * 7 / 8);
+        while (!stop.load()) {
+            std::vector<int> keys;
+            for (int i = 0; i < 200; i++) {
+                keys.push_back(key_dist(rng) * 2 + 1);
+                ih_->insert_entry((const char *)&keys.back(), Rid{.page_no = 1, .slot_no = keys.back()}, &transaction);
+            }
+            for (int key : keys) {
+                ih_->delete_entry((const char *)&key, &transaction);
+            }
+        }
+    };
+    std::vector<std::thread> writers;
+    for (int i = 0; i < num_writers; i++) {
+        writers.emplace_back(writer, i);
+    }
+
+    // 检查一次扫描访问到的key严格单调，偶数key恰好为[first, last]中的全部偶数
+    auto check_scan = [&](IxScan &scan, int first, int last, bool reverse) {
+        int prev = reverse ? last + 1 : first - 1;
+        int num_even = 0;
+        for (; !scan.is_end(); scan.next()) {
+            int key;
+            scan.key((char *)&key);
+            // 写线程仍在运行，失败时不能直接从测试函数返回
+            if (reverse ? key >= prev : key <= prev) {
+                ADD_FAILURE() << "key " << key << " after " << prev;
+                return;
+            }
+            EXPECT_EQ(scan.rid().slot_no, key);
+            prev = key;
+            num_even += key % 2 == 0;
+        }
+        EXPECT_EQ(num_even, (last - first) / 2 + 1);
+    };
+    for (int round = 0; round < 10; round++) {
+        bool reverse = round % 2 == 1;
+        IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get(), reverse);
+        check_scan(scan, 0, num_keys * 2 - 2, reverse);
+        int lower_key = 1000 + round * 100;
+        int upper_key = num_keys * 2 - 1000 - round * 100;
+        IxScan range_scan(ih_.get(), ih_->lower_bound((const char *)&lower_key),
+                          ih_->upper_bound((const char *)&upper_key), buffer_pool_manager_.get(), reverse);
+        check_scan(range_scan, lower_key, upper_key, reverse);
+    }
+    stop.store(true);
+    for (auto &thread : writers) {
+        thread.join();
+    }
+}
+
+/**
+ * @brief 阶很小时多个线程并发插入和删除，分裂与合并同时发生在不同子树中，叶子链表两侧的兄弟结点被交替修改。
+ * 各线程的key交错分布，每轮插入后按随机顺序删除大部分key；结束后检查B+树的结构、叶子链表和内容
+ */
+TEST_F(BPlusTreeConcurrentTest, StructureModificationTest) {
+    const int order = 4;
+    const int thread_num = 8;
+    const int keys_per_thread = 500;
+    const int rounds = 4;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    auto worker = [&](int thread_itr) {
+        Transaction transaction(thread_itr);
+        std::default_random_engine rng(thread_itr);
+        std::vector<int> keys;
+        for (int i = 0; i < keys_per_thread; i++) {
+            keys.push_back(i * thread_num + thread_itr);
+        }
+        for (int round = 0; round < rounds; round++) {
+            std::shuffle(keys.begin(), keys.end(), rng);
+            for (int key : keys) {
+                ih_->insert_entry((const char *)&key, Rid{.page_no = 0, .slot_no = key}, &transaction);
+            }
+            std::shuffle(keys.begin(), keys.end(), rng);
+            for (int key : keys) {
+                // 最后一轮保留被10整除的key
+                if (round < rounds - 1 || key % 10 != 0) {
+                    EXPECT_TRUE(ih_->delete_entry((const char *)&key, &transaction));
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; i++) {
+        threads.emplace_back(worker, i);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    std::multimap<int, Rid> mock;
+    for (int key = 0; key < keys_per_thread * thread_num; key += 10) {
+        mock.insert(std::make_pair(key, Rid{.page_no = 0, .slot_no = key}));
+    }
+    check_all(ih_.get(), mock);
+}
+
+/**
+ * @brief 1~32个线程并发插入、查找和删除时的吞吐量
+ * 每轮共插入keys_per_run个key，各线程的key交错分布以便竞争相同的叶子结点；每个key插入后查找一次，随后删除一半的key。
+ * 阶较小，插入和删除会频繁引起分裂与合并；所有轮次结束后检查B+树的结构和内容
+ */
+TEST_F(BPlusTreeConcurrentTest, ThroughputBenchmark) {
+    const int order = 16;
+    const int keys_per_run = 8000;
+    const std::vector<int> thread_nums = {1, 2, 4, 8, 16, 32};
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    std::multimap<int, Rid> mock;
+    for (size_t run = 0; run < thread_nums.size(); run++) {
+        int thread_num = thread_nums[run];
+        int base = static_cast<int>(run) * keys_per_run;
+        auto worker = [&](int thread_itr) {
+            Transaction transaction(thread_itr);
+            std::vector<Rid> rids;
+            for (int key = base + thread_itr; key < base + keys_per_run; key += thread_num) {
+                Rid rid = {.page_no = 0, .slot_no = key};
+                ih_->insert_entry((const char *)&key, rid, &transaction);
+                rids.clear();
+                ih_->get_value((const char *)&key, &rids, &transaction);
+                EXPECT_EQ(rids.size(), 1);
+            }
+            for (int key = base + thread_itr; key < base + keys_per_run; key += thread_num) {
+                if (key % 2 == 0) {
+                    EXPECT_TRUE(ih_->delete_entry((const char *)&key, &transaction));
+                }
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < thread_num; i++) {
+            threads.emplace_back(worker, i);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        int num_ops = keys_per_run * 2 + keys_per_run / 2;
+        printf("threads=%2d ops=%d time=%.3fs throughput=%.0f ops/s\n", thread_num, num_ops, seconds,
+               num_ops / seconds);
+
+        for (int key = base + 1; key < base + keys_per_run; key += 2) {
+            mock.insert(std::make_pair(key, Rid{.page_no = 0, .slot_no = key}));
+        }
+    }
+    check_all(ih_.get(), mock);
+}
+
+/**
+ * @brief 读多写少负载下1~8个线程的查找吞吐量，比较乐观锁耦合（get_value）与读latch crabbing（find_leaf_page）
+ * 每个线程约95%的操作查找预先插入的key（这些key不会被删除，必须找到），其余操作插入再删除一个新的key，
+ * 使结点不断被修改，乐观读取需要验证版本号并在冲突时重试
+ */
+TEST_F(BPlusTreeConcurrentTest, ReadMostlyScalingBenchmark) {
+    const int num_keys = 20000;
+    const int ops_per_thread = 50000;
+    const int write_percent = 5;
+    const std::vector<int> thread_nums = {1, 2, 4, 8};
+
+    // 预先插入偶数key，写操作使用奇数key
+    for (int key = 0; key < num_keys * 2; key += 2) {
+        ih_->insert_entry((const char *)&key, Rid{.page_no = 0, .slot_no = key}, txn_.get());
+    }
+    auto latched_get = [&](const char *key, std::vector<Rid> *result, Transaction *transaction) {
+        auto leaf = ih_->find_leaf_page<ReadPageGuard>(key, Operation::FIND, transaction).first;
+        Rid *value = nullptr;
+        if (leaf.leaf_lookup(key, &value)) {
+            result->push_back(*value);
+        }
+    };
+    for (bool optimistic : {true, false}) {
+        for (int thread_num : thread_nums) {
+            auto worker = [&](int thread_itr) {
+                Transaction transaction(thread_itr);
+                std::default_random_engine rng(thread_itr);
+                std::uniform_int_distribution<int> key_dist(0, num_keys - 1);
+                std::uniform_int_distribution<int> op_dist(0, 99);
+                std::vector<Rid> rids;
+                for (int i = 0; i < ops_per_thread; i++) {
+                    int key = key_dist(rng) * 2;
+                    if (op_dist(rng) < write_percent) {
+                        key++;
+                        Rid rid = {.page_no = 1, .slot_no = key};
+                        ih_->insert_entry((const char *)&key, rid, &transaction);
+                        ih_->delete_entry((const char *)&key, &transaction);
+                        continue;
+                    }
+                    rids.clear();
+                    if (optimistic) {
+                        ih_->get_value((const char *)&key, &rids, &transaction);
+                    } else {
+                        latched_get((const char *)&key, &rids, &transaction);
+                    }
+                    ASSERT_EQ(rids.size(), 1);
+                    ASSERT_EQ(rids[0].slot_no, key);
+                }
+            };
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (int i = 0; i < thread_num; i++) {
+                threads.emplace_back(worker, i);
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            int num_ops = ops_per_thread * thread_num;
+            printf("%s threads=%d ops=%d time=%.3fs throughput=%.0f ops/s\n",
+                   optimistic ? "optimistic" : "latched   ", thread_num, num_ops, seconds, num_ops / seconds);
+        }
+    }
+
+    std::multimap<int, Rid> mock;
+    for (int key = 0; key < num_keys * 2; key += 2) {
+        mock.insert(std::make_pair(key, Rid{.page_no = 0, .slot_no = key}));
+    }
+    check_all(ih_.get(), mock);
+}
@@ -491,4 +491,140 @@ TEST_F(BPlusTreeTests, LargeScaleTest) {
     }
     std::cout << "Insert keys count: " << add_cnt << '\n' << "Delete keys count: " << del_cnt << '\n';
     check_all(ih_.get(), mock);
-}
\ No newline at end of file
+}
+/**
+ * @brief 插入/删除交替进行时索引文件大小保持稳定：合并释放的结点页面被之后的分裂复用，
+ * 关闭并重新打开索引后空闲页面链表依然有效
+ */
+TEST_F(BPlusTreeTests, SpaceReuseBenchmark) {
+    const int order = 16;
+    const int window = 2000;  // 树中始终保留window~2*window个键
+    const int rounds = 10;
+
+    if (order >= 2 && order <= ih_->file_hdr_->btree_order_) {
+        ih_->file_hdr_->btree_order_ = order;
+    }
+    auto insert_window = [&](int w) {
+        for (int key = w * window; key < (w + 1) * window; key++) {
+            Rid rid = {.page_no = key, .slot_no = key};
+            ih_->insert_entry((const char *)&key, rid, txn_.get());
+        }
+    };
+    auto delete_window = [&](int w) {
+        for (int key = w * window; key < (w + 1) * window; key++) {
+            ASSERT_EQ(ih_->delete_entry((const char *)&key, txn_.get()), true);
+        }
+    };
+
+    insert_window(0);
+    std::vector<int> num_pages;
+    for (int r = 0; r < rounds; r++) {
+        if (r == rounds / 2) {
+            // 中途关闭并重新打开索引，空闲页面链表经由文件头持久化
+            size_t num_free = disk_manager_->get_num_free_pages(ih_->fd_);
+            ix_manager_->close_index(ih_.get());
+            ih_ = ix_manager_->open_index(TEST_FILE_NAME, TEST_COL);
+            EXPECT_EQ(disk_manager_->get_num_free_pages(ih_->fd_), num_free);
+        }
+        insert_window(r + 1);
+        delete_window(r);
+        num_pages.push_back(ih_->file_hdr_->num_pages_);
+        std::cout << "round " << r << ": num_pages = " << ih_->file_hdr_->num_pages_
+                  << ", free pages = " << disk_manager_->get_num_free_pages(ih_->fd_) << '\n';
+    }
+    // 第一轮之后文件不再增长（允许少量因结点分布不同产生的波动）
+    for (int r = 1; r < rounds; r++) {
+        EXPECT_LE(num_pages[r], num_pages[0] + num_pages[0] / 10);
+    }
+
+    // 被删除的键都查不到，剩下的键都能查到
+    std::vector<Rid> rids;
+    for (int key = 0; key < (rounds + 1) * window; key++) {
+        rids.clear();
+        bool found = ih_->get_value((const char *)&key, &rids, txn_.get());
+        ASSERT_EQ(found, key >= rounds * window);
+        if (found) {
+            ASSERT_EQ(rids[0].slot_no, key);
+        }
+    }
+}
+
+/**
+ * @brief 空闲页面链表在每次变化时写入磁盘：不关闭索引，直接用另一个DiskManager读取文件头中的链表头并遍历链表，
+ * 得到与内存中相同数量的空闲页面，模拟进程崩溃后重新打开索引
+ */
+TEST_F(BPlusTreeTests, FreeListPersistenceTest) {
+    const int order = 16;
+    const int scale = 2000;
+
+    if (order >= 2 && order <= ih_->file_hdr_->btree_order_) {
+        ih_->file_hdr_->btree_order_ = order;
+    }
+    auto check_on_disk = [&]() {
+        DiskManager disk_manager;
+        std::string file_name = disk_manager_->get_file_name(ih_->fd_);
+        int fd = disk_manager.open_file(file_name);
+        char buf[PAGE_SIZE];
+        disk_manager.read_page(fd, IX_FILE_HDR_PAGE, buf, PAGE_SIZE);
+        IxFileHdr file_hdr;
+        file_hdr.deserialize(buf);
+        disk_manager.set_fd2pageno(fd, (disk_manager.get_file_size(file_name) + PAGE_SIZE - 1) / PAGE_SIZE);
+        disk_manager.load_free_pages(fd, file_hdr.first_free_page_no_);
+        EXPECT_EQ(disk_manager.get_num_free_pages(fd), disk_manager_->get_num_free_pages(ih_->fd_));
+        disk_manager.close_file(fd);
+    };
+
+    for (int key = 0; key < scale; key++) {
+        Rid rid = {.page_no = key, .slot_no = key};
+        ih_->insert_entry((const char *)&key, rid, txn_.get());
+    }
+    for (int key = 0; key < scale; key += 3) {
+        ASSERT_TRUE(ih_->delete_entry((const char *)&key, txn_.get()));
+    }
+    ASSERT_GT(disk_manager_->get_num_free_pages(ih_->fd_), 0u);
+    check_on_disk();
+    // 之后的分裂复用一部分空闲页面，磁盘上的链表同样更新
+    for (int key = scale; key < scale + scale / 4; key++) {
+        Rid rid = {.page_no = key, .slot_no = key};
+        ih_->insert_entry((const char *)&key, rid, txn_.get());
+    }
+    check_on_disk();
+}
+
+/**
+ * @brief 合并删除的结点仍被其他线程pin住时（如乐观读取），页面暂不释放，放入重试列表，之后的删除再释放，不会泄漏
+ */
+TEST_F(BPlusTreeTests, DeferredPageFreeTest) {
+    const int order = 16;
+    const int scale = 1000;  // 所有结点页面同时pin在缓冲池中
+
+    if (order >= 2 && order <= ih_->file_hdr_->btree_order_) {
+        ih_->file_hdr_->btree_order_ = order;
+    }
+    for (int key = 0; key < scale; key++) {
+        Rid rid = {.page_no = key, .slot_no = key};
+        ih_->insert_entry((const char *)&key, rid, txn_.get());
+    }
+    // 模拟读者pin住所有结点页面
+    std::vector<PageId> pinned;
+    for (page_id_t page_no = IX_INIT_ROOT_PAGE; page_no < disk_manager_->get_fd2pageno(ih_->fd_); page_no++) {
+        PageId page_id = {.fd = ih_->fd_, .page_no = page_no};
+        ASSERT_NE(buffer_pool_manager_->fetch_page(page_id), nullptr);
+        pinned.push_back(page_id);
+    }
+    for (int key = 0; key < scale - 1; key++) {
+        ASSERT_TRUE(ih_->delete_entry((const char *)&key, txn_.get()));
+    }
+    EXPECT_EQ(disk_manager_->get_num_free_pages(ih_->fd_), 0u);
+    size_t num_deferred = ih_->deferred_pages_.size();
+    ASSERT_GT(num_deferred, 0u);
+
+    for (auto &page_id : pinned) {
+        buffer_pool_manager_->unpin_page(page_id, false);
+    }
+    // 之后的删除重试释放之前的页面
+    int key = scale - 1;
+    ASSERT_TRUE(ih_->delete_entry((const char *)&key, txn_.get()));
+    EXPECT_TRUE(ih_->deferred_pages_.empty());
+    EXPECT_GE(disk_manager_->get_num_free_pages(ih_->fd_), num_deferred);
+}
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <random>  // for std::default_random_engine
 
@@ -412,4 +413,564 @@ TEST_F(BPlusTreeTests, LargeScaleTest) {
         scan.next();
     }
     EXPECT_EQ(current_key, keys.size() + 1);
-}
\ No newline at end of file
+}
+/**
+ * @brief 结点内查找的微基准：在根结点中按btree_order的25%/50%/75%/100%填入有序的key，
+ * 分别用无分支二分查找（GENERIC）和打开索引时选定的查找方式做随机的lower_bound/upper_bound，
+ * 检查结果与std::lower_bound/std::upper_bound一致，并输出每次查找的平均耗时
+ */
+TEST_F(BPlusTreeTests, NodeSearchBenchmark) {
+    const int lookups = 200000;
+    const int order = ih_->file_hdr_->btree_order_;
+    const IxSearchMode selected_mode = ih_->file_hdr_->search_mode_;
+    printf("btree_order=%d selected search mode: %s\n", order, ix_search_mode_name(selected_mode));
+
+    std::mt19937 rng(2023);
+    for (int fill : {25, 50, 75, 100}) {
+        int num_key = order * fill / 100;
+        // key为0,2,4,...，查找目标同时覆盖存在和不存在的key
+        std::vector<int> keys(num_key);
+        std::vector<Rid> rids(num_key);
+        for (int i = 0; i < num_key; i++) {
+            keys[i] = i * 2;
+            rids[i] = Rid{.page_no = 0, .slot_no = i};
+        }
+        std::vector<int> targets(lookups);
+        std::uniform_int_distribution<int> dist(-1, num_key * 2);
+        for (auto &target : targets) {
+            target = dist(rng);
+        }
+
+        IxWriteNode node = ih_->fetch_node_write(ih_->file_hdr_->root_page_);
+        ASSERT_EQ(node.get_size(), 0);
+        node.insert_pairs(0, reinterpret_cast<const char *>(keys.data()), rids.data(), num_key);
+
+        for (IxSearchMode mode : {IxSearchMode::GENERIC, selected_mode}) {
+            ih_->file_hdr_->search_mode_ = mode;
+            for (int i = 0; i < 1000; i++) {
+                int target = targets[i];
+                const char *key = reinterpret_cast<const char *>(&target);
+                ASSERT_EQ(node.lower_bound(key), std::lower_bound(keys.begin(), keys.end(), target) - keys.begin());
+                ASSERT_EQ(node.upper_bound(key), std::upper_bound(keys.begin(), keys.end(), target) - keys.begin());
+            }
+            long checksum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int target : targets) {
+                checksum += node.lower_bound(reinterpret_cast<const char *>(&target));
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            printf("fill=%3d%% num_key=%3d mode=%-10s %6.1f ns/lookup (checksum %ld)\n", fill, num_key,
+                   ix_search_mode_name(mode), ns / lookups, checksum);
+            if (selected_mode == IxSearchMode::GENERIC) {
+                break;
+            }
+        }
+        ih_->file_hdr_->search_mode_ = selected_mode;
+        // 恢复为空的根结点
+        node.set_size(0);
+    }
+}
+
+/**
+ * @brief 比较逐条insert_entry与IxBulkLoader批量构建同一组key的耗时（分别在内存中排序和溢出到多个有序段），
+ * 并检查批量构建的B+树：查找结果、叶子链表的正反向遍历、之后的插入和删除
+ */
+TEST_F(BPlusTreeTests, BulkLoadBenchmark) {
+    const int scale = 200000;
+
+    std::vector<int> keys(scale);
+    for (int i = 0; i < scale; i++) {
+        keys[i] = i;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine{});
+    auto rid_of = [](int i) { return Rid{.page_no = i / 100 + 1, .slot_no = i % 100}; };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < scale; i++) {
+        ih_->insert_entry(reinterpret_cast<const char *>(&keys[i]), rid_of(i), txn_.get());
+    }
+    double insert_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("insert_entry: %d keys in %.3fs\n", scale, insert_seconds);
+
+    for (size_t memory_limit : {IX_BULK_LOAD_MEMORY_LIMIT, static_cast<size_t>(256 << 10)}) {
+        std::vector<ColMeta> cols = {ColMeta{.tab_name = TEST_FILE_NAME, .name = "col2", .type = TYPE_INT, .len = 4,
+                                             .offset = 4, .index = false}};
+        // 每轮使用不同的索引文件，避免缓冲池中残留上一轮同名文件的页面
+        std::string file_name = TEST_FILE_NAME + "_bulk" + std::to_string(memory_limit);
+        ix_manager_->create_index(file_name, cols);
+        auto ih = ix_manager_->open_index(file_name, cols);
+
+        start = std::chrono::steady_clock::now();
+        IxBulkLoader loader(ih.get(), IX_BULK_LOAD_FILL_FACTOR, memory_limit);
+        for (int i = 0; i < scale; i++) {
+            loader.add(reinterpret_cast<const char *>(&keys[i]), rid_of(i));
+        }
+        loader.finish();
+        double bulk_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("bulk load (runs=%d): %d keys in %.3fs, %.1fx faster\n", loader.num_runs(), scale, bulk_seconds,
+               insert_seconds / bulk_seconds);
+        if (memory_limit < IX_BULK_LOAD_MEMORY_LIMIT) {
+            EXPECT_GT(loader.num_runs(), 1);
+        }
+
+        for (int i = 0; i < scale; i++) {
+            std::vector<Rid> rids;
+            ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&keys[i]), &rids, txn_.get()));
+            ASSERT_EQ(rids[0], rid_of(i));
+        }
+        // 正向扫描得到有序的全部key
+        int expected = 0;
+        for (IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+             scan.next()) {
+            IxReadNode leaf = ih->fetch_node_read(scan.iid().page_no);
+            ASSERT_EQ(*reinterpret_cast<const int *>(leaf.get_key(scan.iid().slot_no)), expected);
+            expected++;
+        }
+        ASSERT_EQ(expected, scale);
+        // 沿prev_leaf反向遍历叶子链表
+        int num_keys = 0;
+        page_id_t page_no = ih->file_hdr_->last_leaf_;
+        while (page_no != IX_LEAF_HEADER_PAGE) {
+            IxReadNode leaf = ih->fetch_node_read(page_no);
+            num_keys += leaf.get_size();
+            page_no = leaf.get_prev_leaf();
+        }
+        ASSERT_EQ(num_keys, scale);
+
+        // 批量构建后继续插入和删除
+        for (int key = scale; key < scale + 1000; key++) {
+            ih->insert_entry(reinterpret_cast<const char *>(&key), rid_of(key), txn_.get());
+        }
+        for (int key = 0; key < scale + 1000; key += 2) {
+            ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&key), txn_.get()));
+        }
+        for (int key = 0; key < scale + 1000; key++) {
+            std::vector<Rid> rids;
+            ASSERT_EQ(ih->get_value(reinterpret_cast<const char *>(&key), &rids, txn_.get()), key % 2 == 1);
+        }
+
+        ix_manager_->close_index(ih.get());
+        ix_manager_->destroy_index(file_name, cols);
+    }
+}
+
+/**
+ * @brief 表中已有重复的key时不能建立唯一索引：B+树的批量构建和哈希索引的逐条插入都抛出DuplicateKeyError，
+ * 并删除建了一半的索引；没有重复的key时可以建立
+ */
+TEST_F(BPlusTreeTests, CreateUniqueIndexDuplicateKeyTest) {
+    const std::string tab_name = TEST_FILE_NAME + "_dup";
+    sm_->create_table(tab_name, {{"col1", TYPE_INT, 4}, {"col2", TYPE_INT, 4}}, nullptr);
+    LockManager lock_manager;
+    Context context(&lock_manager, nullptr, txn_.get());
+    auto fh = sm_->fhs_.at(tab_name).get();
+    for (int i = 0; i < 1000; i++) {
+        int record[2] = {i, i % 500};  // col2中每个值出现两次
+        fh->insert_record(reinterpret_cast<char *>(record), &context);
+    }
+    for (IndexType type : {INDEX_BTREE, INDEX_HASH}) {
+        EXPECT_THROW(sm_->create_index(tab_name, {"col2"}, &context, true, type), DuplicateKeyError);
+        EXPECT_FALSE(ix_manager_->exists(tab_name, std::vector<std::string>{"col2"}));
+        EXPECT_TRUE(sm_->db_.get_table(tab_name).indexes.empty());
+    }
+    // 非唯一索引和没有重复key的字段上的唯一索引可以建立
+    sm_->create_index(tab_name, {"col2"}, nullptr, false);
+    sm_->create_index(tab_name, {"col1"}, nullptr);
+    EXPECT_EQ(sm_->db_.get_table(tab_name).indexes.size(), 2u);
+}
+
+/**
+ * @brief 多字段索引以编码后的key存放前后的查找耗时对比，并检查编码保持INT/FLOAT的大小顺序、可以还原，
+ * 两种索引的扫描顺序一致
+ */
+TEST_F(BPlusTreeTests, NormalizedKeyBenchmark) {
+    std::mt19937 rng(2023);
+    std::vector<ColType> types = {TYPE_INT, TYPE_FLOAT};
+    std::vector<int> lens = {4, 4};
+    std::uniform_int_distribution<int> int_dist(-1000, 1000);
+    std::uniform_real_distribution<float> float_dist(-100, 100);
+    for (int i = 0; i < 100000; i++) {
+        char a[8], b[8], na[8], nb[8], restored[8];
+        int ia = int_dist(rng), ib = (i % 2 == 0) ? ia : int_dist(rng);
+        float fa = float_dist(rng), fb = (i % 3 == 0) ? -fa : float_dist(rng);
+        memcpy(a, &ia, 4), memcpy(a + 4, &fa, 4);
+        memcpy(b, &ib, 4), memcpy(b + 4, &fb, 4);
+        ix_normalize_key(a, na, types, lens);
+        ix_normalize_key(b, nb, types, lens);
+        int expected = ix_compare(a, b, types, lens);
+        int actual = ix_compare_normalized(na, nb, 8);
+        ASSERT_EQ((actual > 0) - (actual < 0), expected);
+        ASSERT_EQ((memcmp(na, nb, 8) > 0) - (memcmp(na, nb, 8) < 0), expected);
+        ix_denormalize_key(na, restored, types, lens);
+        ASSERT_EQ(memcmp(a, restored, 8), 0);
+    }
+
+    const int scale = 100000;
+    std::vector<std::pair<int, int>> keys;
+    for (int i = 0; i < scale; i++) {
+        keys.emplace_back(i % 500 - 250, i / 500 - 100);
+    }
+    std::shuffle(keys.begin(), keys.end(), rng);
+    std::vector<ColMeta> cols = {
+        ColMeta{.tab_name = TEST_FILE_NAME, .name = "col1", .type = TYPE_INT, .len = 4, .offset = 0, .index = false},
+        ColMeta{.tab_name = TEST_FILE_NAME, .name = "col2", .type = TYPE_INT, .len = 4, .offset = 4, .index = false}};
+
+    std::vector<std::vector<int>> scanned(2);
+    for (bool normalized : {false, true}) {
+        std::string file_name = TEST_FILE_NAME + (normalized ? "_normalized" : "_raw");
+        ix_manager_->create_index(file_name, cols, true, normalized);
+        auto ih = ix_manager_->open_index(file_name, cols);
+        ASSERT_EQ(ih->file_hdr_->normalized_keys_, normalized);
+        for (int i = 0; i < scale; i++) {
+            ih->insert_entry(reinterpret_cast<const char *>(&keys[i]), Rid{.page_no = i, .slot_no = 0}, txn_.get());
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < 5; round++) {
+            for (int i = 0; i < scale; i++) {
+                std::vector<Rid> rids;
+                ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&keys[i]), &rids, txn_.get()));
+                ASSERT_EQ(rids[0].page_no, i);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("normalized_keys=%d: %.1f ns per lookup on a 2-column index\n", normalized,
+               seconds * 1e9 / (5 * scale));
+
+        for (IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+             scan.next()) {
+            IxReadNode leaf = ih->fetch_node_read(scan.iid().page_no);
+            char key[8];
+            if (normalized) {
+                ix_denormalize_key(leaf.get_key(scan.iid().slot_no), key, ih->file_hdr_->col_types_,
+                                   ih->file_hdr_->col_lens_);
+            } else {
+                memcpy(key, leaf.get_key(scan.iid().slot_no), 8);
+            }
+            scanned[normalized].push_back(*reinterpret_cast<int *>(key));
+            scanned[normalized].push_back(*reinterpret_cast<int *>(key + 4));
+        }
+        ASSERT_EQ(scanned[normalized].size(), 2 * scale);
+
+        ix_manager_->close_index(ih.get());
+        ix_manager_->destroy_index(file_name, cols);
+    }
+    ASSERT_EQ(scanned[0], scanned[1]);
+}
+
+/**
+ * @brief CHAR(256)索引使用前缀压缩的结点格式前后的树高、页面数和查找耗时对比，
+ * 并检查压缩格式的索引在插入、删除和批量构建之后的查找和扫描结果
+ */
+TEST_F(BPlusTreeTests, PrefixCompressionBenchmark) {
+    const int scale = 20000;
+    const int key_len = 256;
+    std::mt19937 rng(2024);
+    // 类似URL的key：公共前缀较长，实际长度远小于声明的长度且各不相同
+    std::vector<std::string> keys(scale);
+    for (int i = 0; i < scale; i++) {
+        char buf[key_len];
+        snprintf(buf, sizeof(buf), "https://www.example.com/catalog/%s/item-%07d%s", (i % 3 == 0) ? "books" : "toys",
+                 static_cast<int>(rng() % 10000000), (i % 5 == 0) ? "?ref=homepage" : "");
+        keys[i] = buf + std::string("#") + std::to_string(i);
+        keys[i].resize(key_len, '\0');
+    }
+    std::vector<std::string> sorted_keys = keys;
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+    std::vector<int> order(scale);
+    for (int i = 0; i < scale; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    auto rid_of = [](int i) { return Rid{.page_no = i / 100 + 1, .slot_no = i % 100}; };
+    std::vector<ColMeta> cols = {ColMeta{.tab_name = TEST_FILE_NAME, .name = "url", .type = TYPE_STRING,
+                                         .len = key_len, .offset = 0, .index = false}};
+
+    // 扫描整个索引，返回解码后的key
+    auto scan_keys = [&](IxIndexHandle *ih) {
+        std::vector<std::string> scanned;
+        for (IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get()); !scan.is_end();
+             scan.next()) {
+            IxReadNode leaf = ih->fetch_node_read(scan.iid().page_no);
+            std::string key(key_len, '\0');
+            leaf.copy_key(scan.iid().slot_no, key.data());
+            scanned.push_back(key);
+        }
+        return scanned;
+    };
+
+    int heights[2], pages[2];
+    for (bool compressed : {false, true}) {
+        std::string file_name = TEST_FILE_NAME + (compressed ? "_compressed" : "_plain");
+        ix_manager_->create_index(file_name, cols, true, false, compressed);
+        auto ih = ix_manager_->open_index(file_name, cols);
+        ASSERT_EQ(ih->file_hdr_->compressed_keys_, compressed);
+        for (int i : order) {
+            ih->insert_entry(keys[i].data(), rid_of(i), txn_.get());
+        }
+
+        int height = 1;
+        page_id_t page_no = ih->file_hdr_->root_page_;
+        for (IxReadNode node = ih->fetch_node_read(page_no); !node.is_leaf_page(); height++) {
+            page_no = node.value_at(0);
+            node = ih->fetch_node_read(page_no);
+        }
+        heights[compressed] = height;
+        pages[compressed] = ih->file_hdr_->num_pages_;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < 3; round++) {
+            for (int i = 0; i < scale; i++) {
+                std::vector<Rid> rids;
+                ASSERT_TRUE(ih->get_value(keys[i].data(), &rids, txn_.get()));
+                ASSERT_EQ(rids[0], rid_of(i));
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("compressed_keys=%d: height=%d, pages=%d, %.1f ns per lookup on a CHAR(%d) index\n", compressed,
+               height, pages[compressed], seconds * 1e9 / (3 * scale), key_len);
+        ASSERT_EQ(scan_keys(ih.get()), sorted_keys);
+
+        // 删除一半的key，压缩格式的结点按字节数判断下溢与合并
+        std::vector<std::string> remaining;
+        for (int i = 0; i < scale; i++) {
+            if (i % 2 == 0) {
+                ASSERT_TRUE(ih->delete_entry(keys[i].data(), txn_.get()));
+            } else {
+                remaining.push_back(keys[i]);
+            }
+        }
+        for (int i = 0; i < scale; i++) {
+            std::vector<Rid> rids;
+            ASSERT_EQ(ih->get_value(keys[i].data(), &rids, txn_.get()), i % 2 == 1);
+        }
+        std::sort(remaining.begin(), remaining.end());
+        ASSERT_EQ(scan_keys(ih.get()), remaining);
+
+        ix_manager_->close_index(ih.get());
+        ix_manager_->destroy_index(file_name, cols);
+    }
+    EXPECT_LT(heights[1], heights[0]);
+    EXPECT_LT(pages[1] * 4, pages[0]);
+
+    // 单个字符串字段的索引默认使用压缩格式，批量构建后继续插入和删除
+    std::string file_name = TEST_FILE_NAME + "_compressed_bulk";
+    ix_manager_->create_index(file_name, cols);
+    auto ih = ix_manager_->open_index(file_name, cols);
+    ASSERT_TRUE(ih->file_hdr_->compressed_keys_);
+    IxBulkLoader loader(ih.get());
+    for (int i = 0; i < scale; i += 2) {
+        loader.add(keys[i].data(), rid_of(i));
+    }
+    loader.finish();
+    for (int i = 1; i < scale; i += 2) {
+        ih->insert_entry(keys[i].data(), rid_of(i), txn_.get());
+    }
+    ASSERT_EQ(scan_keys(ih.get()), sorted_keys);
+    for (int i = 0; i < scale; i++) {
+        if (i % 3 == 0) {
+            ASSERT_TRUE(ih->delete_entry(keys[i].data(), txn_.get()));
+        }
+    }
+    for (int i = 0; i < scale; i++) {
+        std::vector<Rid> rids;
+        ASSERT_EQ(ih->get_value(keys[i].data(), &rids, txn_.get()), i % 3 != 0);
+        if (i % 3 != 0) {
+            ASSERT_EQ(rids[0], rid_of(i));
+        }
+    }
+    ix_manager_->close_index(ih.get());
+    ix_manager_->destroy_index(file_name, cols);
+}
+
+/**
+ * @brief 查找不存在的key时，key可能落在两个叶子之间：大于前一个叶子的所有key，小于后一个叶子的第一个key。
+ * 此时lower_bound/upper_bound应当指向后一个叶子的第一个索引项，而不是整个索引的末尾
+ */
+TEST_F(BPlusTreeTests, BoundBetweenLeavesTest) {
+    const int scale = 20000;
+    const int order = 16;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    // 只插入偶数key，奇数key都不存在
+    std::vector<int> keys;
+    for (int key = 0; key < scale; key += 2) {
+        keys.push_back(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine{});
+    for (int key : keys) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 1, .slot_no = key}, txn_.get()));
+    }
+
+    for (int key = -1; key < scale; key += 2) {
+        Iid lower = ih_->lower_bound(reinterpret_cast<const char *>(&key));
+        Iid upper = ih_->upper_bound(reinterpret_cast<const char *>(&key));
+        ASSERT_EQ(lower, upper);
+        if (key + 1 < scale) {
+            ASSERT_EQ(ih_->get_rid(lower).slot_no, key + 1);
+        } else {
+            ASSERT_EQ(lower, ih_->leaf_end());
+        }
+    }
+
+    // 以不存在的key为边界扫描，得到两者之间的全部key
+    int lower_key = 999, upper_key = 2001;
+    int expected = 1000;
+    for (IxScan scan(ih_.get(), ih_->lower_bound(reinterpret_cast<const char *>(&lower_key)),
+                     ih_->upper_bound(reinterpret_cast<const char *>(&upper_key)), buffer_pool_manager_.get());
+         !scan.is_end(); scan.next()) {
+        ASSERT_EQ(scan.rid().slot_no, expected);
+        expected += 2;
+    }
+    ASSERT_EQ(expected, 2002);
+}
+
+/**
+ * @brief 反向扫描：沿prev_leaf从upper向lower扫描，结果与正向扫描的顺序相反，包括边界落在叶子之间和空范围的情况
+ */
+TEST_F(BPlusTreeTests, ReverseScanTest) {
+    const int scale = 20000;
+    const int order = 16;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    std::vector<int> keys;
+    for (int key = 0; key < scale; key += 2) {
+        keys.push_back(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine{});
+    for (int key : keys) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{.page_no = 1, .slot_no = key}, txn_.get()));
+    }
+
+    auto scan_range = [&](const Iid &lower, const Iid &upper, bool reverse) {
+        std::vector<int> scanned;
+        for (IxScan scan(ih_.get(), lower, upper, buffer_pool_manager_.get(), reverse); !scan.is_end(); scan.next()) {
+            scanned.push_back(scan.rid().slot_no);
+        }
+        return scanned;
+    };
+    std::vector<int> forward = scan_range(ih_->leaf_begin(), ih_->leaf_end(), false);
+    std::vector<int> backward = scan_range(ih_->leaf_begin(), ih_->leaf_end(), true);
+    ASSERT_EQ(forward.size(), keys.size());
+    std::reverse(backward.begin(), backward.end());
+    ASSERT_EQ(forward, backward);
+
+    std::mt19937 rng(2024);
+    for (int i = 0; i < 1000; i++) {
+        int lower_key = static_cast<int>(rng() % (scale + 10)) - 5;
+        int upper_key = lower_key + static_cast<int>(rng() % 200) - 20;
+        Iid lower = ih_->lower_bound(reinterpret_cast<const char *>(&lower_key));
+        Iid upper = ih_->upper_bound(reinterpret_cast<const char *>(&upper_key));
+        std::vector<int> expected;
+        for (int key = std::max(lower_key, 0); key <= upper_key && key < scale; key++) {
+            if (key % 2 == 0) {
+                expected.push_back(key);
+            }
+        }
+        if (expected.empty()) {
+            continue;
+        }
+        ASSERT_EQ(scan_range(lower, upper, false), expected);
+        std::reverse(expected.begin(), expected.end());
+        ASSERT_EQ(scan_range(lower, upper, true), expected);
+    }
+    // 空范围
+    int key = 1001;
+    Iid iid = ih_->lower_bound(reinterpret_cast<const char *>(&key));
+    ASSERT_TRUE(scan_range(iid, iid, true).empty());
+}
+
+/**
+ * @brief 非唯一索引：key之后拼接Rid，重复的key各自成为一个索引项。
+ * get_value和[lower_bound, upper_bound)的扫描返回该key的全部Rid，删除时按(key, Rid)删除其中一项
+ */
+TEST_F(BPlusTreeTests, NonUniqueIndexTest) {
+    const int scale = 20000;
+    const int distinct = 97;
+
+    std::vector<ColMeta> cols = {ColMeta{.tab_name = TEST_FILE_NAME, .name = "col2", .type = TYPE_INT, .len = 4,
+                                         .offset = 4, .index = false}};
+    auto rid_of = [](int i) { return Rid{.page_no = i / 100 + 1, .slot_no = i % 100}; };
+    auto key_of = [](int i) { return (i * 7919) % distinct; };
+    std::vector<int> order(scale);
+    for (int i = 0; i < scale; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::default_random_engine{});
+
+    // 逐条插入和批量构建得到相同的索引
+    for (bool bulk_load : {false, true}) {
+        std::string file_name = TEST_FILE_NAME + (bulk_load ? "_non_unique_bulk" : "_non_unique");
+        ix_manager_->create_index(file_name, cols, false);
+        auto ih = ix_manager_->open_index(file_name, cols);
+        ASSERT_FALSE(ih->file_hdr_->unique_);
+        if (bulk_load) {
+            IxBulkLoader loader(ih.get());
+            for (int i : order) {
+                int key = key_of(i);
+                loader.add(reinterpret_cast<const char *>(&key), rid_of(i));
+            }
+            loader.finish();
+        } else {
+            for (int i : order) {
+                int key = key_of(i);
+                ih->insert_entry(reinterpret_cast<const char *>(&key), rid_of(i), txn_.get());
+            }
+        }
+
+        // 每个key的全部Rid，按Rid的顺序排列
+        std::vector<std::vector<Rid>> expected(distinct);
+        for (int i = 0; i < scale; i++) {
+            expected[key_of(i)].push_back(rid_of(i));
+        }
+        for (int key = 0; key < distinct; key++) {
+            std::vector<Rid> rids;
+            ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&key), &rids, txn_.get()));
+            ASSERT_EQ(rids, expected[key]);
+            int count = 0;
+            for (IxScan scan(ih.get(), ih->lower_bound(reinterpret_cast<const char *>(&key)),
+                             ih->upper_bound(reinterpret_cast<const char *>(&key)), buffer_pool_manager_.get(), true);
+                 !scan.is_end(); scan.next()) {
+                int scanned_key;
+                scan.key(reinterpret_cast<char *>(&scanned_key));
+                ASSERT_EQ(scanned_key, key);
+                ASSERT_EQ(scan.rid(), expected[key][expected[key].size() - 1 - count]);
+                count++;
+            }
+            ASSERT_EQ(count, static_cast<int>(expected[key].size()));
+        }
+
+        // 按(key, Rid)删除偶数位置的记录，Rid不匹配时不删除
+        for (int i = 0; i < scale; i += 2) {
+            int key = key_of(i);
+            ASSERT_FALSE(ih->delete_entry(reinterpret_cast<const char *>(&key), rid_of(scale + i), txn_.get()));
+            ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&key), rid_of(i), txn_.get()));
+        }
+        for (int key = 0; key < distinct; key++) {
+            std::vector<Rid> remaining;
+            for (int i = 1; i < scale; i += 2) {
+                if (key_of(i) == key) {
+                    remaining.push_back(rid_of(i));
+                }
+            }
+            std::vector<Rid> rids;
+            ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&key), &rids, txn_.get()));
+            ASSERT_EQ(rids, remaining);
+            // 只给出key时删除Rid最小的一项
+            ASSERT_TRUE(ih->delete_entry(reinterpret_cast<const char *>(&key), txn_.get()));
+            rids.clear();
+            ih->get_value(reinterpret_cast<const char *>(&key), &rids, txn_.get());
+            ASSERT_EQ(rids, std::vector<Rid>(remaining.begin() + 1, remaining.end()));
+        }
+        int missing = distinct;
+        std::vector<Rid> rids;
+        ASSERT_FALSE(ih->get_value(reinterpret_cast<const char *>(&missing), &rids, txn_.get()));
+
+        ix_manager_->close_index(ih.get());
+        ix_manager_->destroy_index(file_name, cols);
+    }
+}
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <random>  // for std::default_random_engine
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "index/ix.h"
+#undef private  // for use private variables in "ix.h"
+
+#include "storage/buffer_pool_manager.h"
+#include "system/sm_meta.h"
+
+const std::string TEST_DB_NAME = "HashIndexTest_db";  // 以数据库名作为根目录
+const std::string TEST_FILE_NAME = "table1";          // 测试文件名的前缀
+const std::vector<ColMeta> TEST_COLS = {
+    ColMeta{.tab_name = TEST_FILE_NAME, .name = "col1", .type = TYPE_INT, .len = 4, .offset = 0, .index = false}};
+
+/** 对于每个测试点，先创建和进入目录TEST_DB_NAME，然后在此目录下创建和打开哈希索引文件"table1_col1.idx" */
+class HashIndexTests : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<IxHashIndexHandle> ih_;
+    std::unique_ptr<Transaction> txn_;
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(200, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        txn_ = std::make_unique<Transaction>(0);
+
+        if (disk_manager_->is_dir(TEST_DB_NAME)) {
+            std::string cmd = "rm -rf " + TEST_DB_NAME;
+            if (system(cmd.c_str()) < 0) {
+                throw UnixError();
+            }
+        }
+        disk_manager_->create_dir(TEST_DB_NAME);
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    void TearDown() override {
+        if (ih_ != nullptr) {
+            ix_manager_->close_hash_index(ih_.get());
+        }
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    void create_and_open(bool unique) {
+        ix_manager_->create_hash_index(TEST_FILE_NAME, TEST_COLS, unique);
+        ih_ = ix_manager_->open_hash_index(TEST_FILE_NAME, TEST_COLS);
+    }
+
+    void reopen() {
+        ix_manager_->close_hash_index(ih_.get());
+        ih_ = ix_manager_->open_hash_index(TEST_FILE_NAME, TEST_COLS);
+    }
+
+    // 检查key对应的Rid集合与expected相同
+    void check_key(int key, std::vector<Rid> expected) {
+        std::vector<Rid> result;
+        bool found = ih_->get_value(reinterpret_cast<const char *>(&key), &result, txn_.get());
+        ASSERT_EQ(found, !expected.empty()) << "key " << key;
+        auto less = [](const Rid &a, const Rid &b) {
+            return a.page_no != b.page_no ? a.page_no < b.page_no : a.slot_no < b.slot_no;
+        };
+        std::sort(result.begin(), result.end(), less);
+        std::sort(expected.begin(), expected.end(), less);
+        ASSERT_EQ(result, expected) << "key " << key;
+    }
+};
+
+/**
+ * @brief 插入足够多的key使桶多次分裂、目录多次加倍，检查查找、删除，以及关闭再打开之后的结果
+ */
+TEST_F(HashIndexTests, InsertDeleteReopenTest) {
+    create_and_open(true);
+    const int num = 20000;
+    std::vector<int> keys(num);
+    for (int i = 0; i < num; i++) {
+        keys[i] = i * 7 - num;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine(2023));
+    for (int key : keys) {
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, key & 0xff}, txn_.get()));
+    }
+    // 唯一索引中重复的key不再插入
+    int dup = keys[0];
+    ASSERT_FALSE(ih_->insert_entry(reinterpret_cast<const char *>(&dup), Rid{0, 0}, txn_.get()));
+    // 20000个key，每个桶最多BUCKET_SIZE个，目录至少2^9项
+    ASSERT_GE(ih_->global_depth(), 9);
+
+    for (int key : keys) {
+        check_key(key, {Rid{key, key & 0xff}});
+    }
+    check_key(1, {});
+    for (int i = 0; i < num / 2; i++) {
+        ASSERT_TRUE(ih_->delete_entry(reinterpret_cast<const char *>(&keys[i]), txn_.get()));
+    }
+    ASSERT_FALSE(ih_->delete_entry(reinterpret_cast<const char *>(&keys[0]), txn_.get()));
+
+    reopen();
+    for (int i = 0; i < num; i++) {
+        check_key(keys[i], i < num / 2 ? std::vector<Rid>{} : std::vector<Rid>{Rid{keys[i], keys[i] & 0xff}});
+    }
+}
+
+/**
+ * @brief 非唯一索引：同一个key的大量键值对无法通过分裂分开，放入溢出页面；按(key, Rid)删除只删除对应的键值对
+ */
+TEST_F(HashIndexTests, DuplicateKeyOverflowTest) {
+    create_and_open(false);
+    const int dup_key = 42;
+    const int num_dup = BUCKET_SIZE * 5;
+    std::vector<Rid> rids;
+    for (int i = 0; i < num_dup; i++) {
+        rids.push_back(Rid{i / 10, i % 10});
+        ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&dup_key), rids.back(), txn_.get()));
+    }
+    // 溢出页面不影响其他key的插入和分裂
+    for (int key = 0; key < 1000; key++) {
+        if (key != dup_key) {
+            ASSERT_TRUE(ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, 0}, txn_.get()));
+        }
+    }
+    check_key(dup_key, rids);
+    for (int key = 0; key < 1000; key++) {
+        if (key != dup_key) {
+            check_key(key, {Rid{key, 0}});
+        }
+    }
+
+    for (int i = 0; i < num_dup; i += 2) {
+        ASSERT_TRUE(ih_->delete_entry(reinterpret_cast<const char *>(&dup_key), rids[i], txn_.get()));
+    }
+    ASSERT_FALSE(ih_->delete_entry(reinterpret_cast<const char *>(&dup_key), rids[0], txn_.get()));
+    std::vector<Rid> rest;
+    for (int i = 1; i < num_dup; i += 2) {
+        rest.push_back(rids[i]);
+    }
+    reopen();
+    check_key(dup_key, rest);
+}
+
+/**
+ * @brief 多个线程同时插入不同的key，再同时查找和删除
+ */
+TEST_F(HashIndexTests, ConcurrentInsertTest) {
+    create_and_open(true);
+    const int num_threads = 4;
+    const int num_per_thread = 5000;
+    auto insert_task = [&](int tid) {
+        for (int i = 0; i < num_per_thread; i++) {
+            int key = i * num_threads + tid;
+            ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, 0}, txn_.get());
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+        threads.emplace_back(insert_task, tid);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+    for (int key = 0; key < num_threads * num_per_thread; key++) {
+        check_key(key, {Rid{key, 0}});
+    }
+
+    auto delete_task = [&](int tid) {
+        for (int i = 0; i < num_per_thread; i += 2) {
+            int key = i * num_threads + tid;
+            ih_->delete_entry(reinterpret_cast<const char *>(&key), txn_.get());
+        }
+    };
+    for (int tid = 0; tid < num_threads; tid++) {
+        threads.emplace_back(delete_task, tid);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int key = 0; key < num_threads * num_per_thread; key++) {
+        check_key(key, (key / num_threads) % 2 == 0 ? std::vector<Rid>{} : std::vector<Rid>{Rid{key, 0}});
+    }
+}
+
+/**
+ * @brief 索引元数据写入存取方法字段之后仍能读取旧的db.meta：旧格式中没有该字段的索引视为B+树索引
+ */
+TEST_F(HashIndexTests, IndexMetaCompatibilityTest) {
+    // 旧格式：表名、字段、索引数量，每个索引一行表名、字段长度总和、字段数量，之后每行一个字段
+    std::istringstream old_meta(
+        "t 2\nt a 0 4 0 1\nt b 0 4 4 1\n2\nt 4 1\nt a 0 4 0 1\nt 8 2\nt a 0 4 0 1\nt b 0 4 4 1\n");
+    TabMeta tab;
+    old_meta >> tab;
+    ASSERT_EQ(tab.indexes.size(), 2u);
+    for (auto &index : tab.indexes) {
+        EXPECT_EQ(index.type, INDEX_BTREE);
+    }
+    EXPECT_EQ(tab.indexes[1].col_num, 2);
+    EXPECT_EQ(tab.indexes[1].cols[1].name, "b");
+
+    // 新格式写出后读回，保留存取方法
+    tab.indexes[0].type = INDEX_HASH;
+    std::stringstream new_meta;
+    new_meta << tab;
+    TabMeta read_tab;
+    new_meta >> read_tab;
+    ASSERT_EQ(read_tab.indexes.size(), 2u);
+    EXPECT_EQ(read_tab.indexes[0].type, INDEX_HASH);
+    EXPECT_EQ(read_tab.indexes[1].type, INDEX_BTREE);
+    EXPECT_EQ(read_tab.indexes[1].cols[1].name, "b");
+}
+
+/**
+ * @brief 比较哈希索引和B+树索引的点查询耗时
+ */
+TEST_F(HashIndexTests, PointLookupBenchmark) {
+    // 缓冲池容纳两个索引的全部页面，只比较查找本身的开销
+    buffer_pool_manager_ = std::make_unique<BufferPoolManager>(4096, disk_manager_.get());
+    ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+    create_and_open(true);
+    ix_manager_->create_index(TEST_FILE_NAME + "_bt", TEST_COLS);
+    auto bt = ix_manager_->open_index(TEST_FILE_NAME + "_bt", TEST_COLS);
+    const int num = 50000;
+    std::vector<int> keys(num);
+    for (int i = 0; i < num; i++) {
+        keys[i] = i;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine(7));
+    for (int key : keys) {
+        ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, 0}, txn_.get());
+        bt->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, 0}, txn_.get());
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine(11));
+
+    auto time_lookups = [&](auto &&lookup) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Rid> result;
+        for (int key : keys) {
+            result.clear();
+            lookup(reinterpret_cast<const char *>(&key), &result);
+            assert(result.size() == 1);
+        }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    double hash_ms = time_lookups([&](const char *key, std::vector<Rid> *result) {
+        ih_->get_value(key, result, txn_.get());
+    });
+    double btree_ms = time_lookups([&](const char *key, std::vector<Rid> *result) {
+        bt->get_value(key, result, txn_.get());
+    });
+    std::cout << num << " point lookups: hash index " << hash_ms << " ms, b+ tree index " << btree_ms << " ms\n";
+    ix_manager_->close_index(bt.get());
+}
@@ -1,8 +1,16 @@
 #include "storage/buffer_pool_manager.h"
 
+#include <atomic>
 #include <cassert>
 #include <cstring>
+#include <chrono>
+#include <condition_variable>
 #include <ctime>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <random>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -427,3 +435,684 @@ TEST_F(BufferPoolManagerTest, ConcurrencyTest) {
 
     disk_manager_->close_file(fd);
 }
+
+/**
+ * @brief 分区缓冲池与单锁缓冲池的多线程争用对比（单文件）
+ * @note 生成测试文件sharded_contention_test
+ * @note 每个线程随机fetch/unpin工作集中的页面，工作集不超过缓冲池容量，耗时主要来自latch争用
+ */
+TEST_F(BufferPoolManagerTest, ShardedContentionBenchmark) {
+    const std::string filename = "sharded_contention_test";
+    const int buffer_pool_size = 1024;
+    const int num_pages = 512;
+    const int ops_per_thread = 200000;
+    const std::vector<size_t> shard_counts = {1, 16};
+    const std::vector<int> thread_counts = {1, 4, 8, 16};
+
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    // 先用一个缓冲池把页面写到磁盘上，页面内容为其page_no
+    {
+        BufferPoolManager bpm(buffer_pool_size, disk_manager);
+        for (int i = 0; i < num_pages; i++) {
+            PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+            Page *page = bpm.new_page(&page_id);
+            ASSERT_NE(nullptr, page);
+            ASSERT_EQ(i, page_id.page_no);
+            memcpy(page->get_data(), &i, sizeof(int));
+            ASSERT_TRUE(bpm.unpin_page(page_id, true));
+            ASSERT_TRUE(bpm.flush_page(page_id));
+        }
+    }
+
+    for (size_t num_shards : shard_counts) {
+        for (int num_threads : thread_counts) {
+            BufferPoolManager bpm(buffer_pool_size, disk_manager, num_shards);
+            ASSERT_EQ(num_shards, bpm.get_num_shards());
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (int tid = 0; tid < num_threads; tid++) {
+                threads.emplace_back([&bpm, fd, tid]() {
+                    std::mt19937 rng(tid);
+                    for (int k = 0; k < ops_per_thread; k++) {
+                        PageId page_id = {.fd = fd, .page_no = static_cast<page_id_t>(rng() % num_pages)};
+                        Page *page = bpm.fetch_page(page_id);
+                        ASSERT_NE(nullptr, page);
+                        ASSERT_EQ(page_id.page_no, *reinterpret_cast<int *>(page->get_data()));
+                        ASSERT_TRUE(bpm.unpin_page(page_id, false));
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "shards=" << num_shards << " threads=" << num_threads << " time=" << secs << "s"
+                      << " throughput=" << static_cast<double>(num_threads) * ops_per_thread / secs / 1e6
+                      << " Mops/s" << std::endl;
+        }
+    }
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 后台刷脏线程测试（单文件）
+ * @note 生成测试文件background_flusher_test
+ * @note 最久未使用的min_clean_frames个脏页应该被写回磁盘，最近使用的脏页保持不变
+ */
+TEST_F(BufferPoolManagerTest, BackgroundFlusherTest) {
+    const std::string filename = "background_flusher_test";
+    const int buffer_pool_size = 64;
+    const int min_clean_frames = 32;
+
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+
+    // 先把所有页面以全0写到磁盘上，再在缓冲池中修改它们
+    for (int i = 0; i < buffer_pool_size; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        Page *page = bpm->new_page(&page_id);
+        ASSERT_NE(nullptr, page);
+        ASSERT_TRUE(bpm->flush_page(page_id));
+        snprintf(page->get_data(), PAGE_SIZE, "page%d", page_id.page_no);
+        ASSERT_TRUE(bpm->unpin_page(page_id, true));
+    }
+
+    bpm->start_flusher(min_clean_frames, std::chrono::milliseconds(5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    bpm->stop_flusher();
+
+    char buf[PAGE_SIZE];
+    for (int i = 0; i < buffer_pool_size; i++) {
+        disk_manager_->read_page(fd, i, buf, PAGE_SIZE);
+        if (i < min_clean_frames) {
+            EXPECT_EQ(0, strcmp(buf, ("page" + std::to_string(i)).c_str()));
+        } else {
+            EXPECT_EQ(0, buf[0]);
+        }
+    }
+
+    // flush_all_pages写回剩余的脏页
+    bpm->flush_all_pages(fd);
+    for (int i = 0; i < buffer_pool_size; i++) {
+        disk_manager_->read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(0, strcmp(buf, ("page" + std::to_string(i)).c_str()));
+    }
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 预读测试（单文件）
+ * @note 生成测试文件prefetch_test
+ * @note 预读的页面在读取完成前被fetch时应等待读取完成，预读完成后页面处于unpinned状态
+ */
+TEST_F(BufferPoolManagerTest, PrefetchTest) {
+    const std::string filename = "prefetch_test";
+    const int buffer_pool_size = 64;
+    const int num_pages = 48;
+
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    {
+        BufferPoolManager bpm(buffer_pool_size, disk_manager);
+        for (int i = 0; i < num_pages; i++) {
+            PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+            Page *page = bpm.new_page(&page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->get_data(), PAGE_SIZE, "page%d", page_id.page_no);
+            ASSERT_TRUE(bpm.unpin_page(page_id, true));
+        }
+        bpm.flush_all_pages(fd);
+    }
+
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager, 4);
+    // 预读范围超出文件已分配的页面时，多出的部分被忽略
+    bpm->prefetch(fd, 0, num_pages + 16);
+    // 不等待预读完成，直接访问
+    for (int i = 0; i < num_pages; i++) {
+        Page *page = bpm->fetch_page(PageId{fd, i});
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(0, strcmp(page->get_data(), ("page" + std::to_string(i)).c_str()));
+        EXPECT_TRUE(bpm->unpin_page(PageId{fd, i}, false));
+    }
+    bpm->wait_prefetch();
+
+    // 预读完成的页面都可以被删除，即没有残留的pin
+    for (int i = 0; i < num_pages; i++) {
+        EXPECT_TRUE(bpm->delete_page(PageId{fd, i}));
+    }
+    // 离散页面的预读
+    bpm->prefetch(fd, std::vector<page_id_t>{1, 2, 3, 10, 20, 21});
+    bpm->wait_prefetch();
+    for (page_id_t page_no : {1, 2, 3, 10, 20, 21}) {
+        Page *page = bpm->fetch_page(PageId{fd, page_no});
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(0, strcmp(page->get_data(), ("page" + std::to_string(page_no)).c_str()));
+        EXPECT_TRUE(bpm->unpin_page(PageId{fd, page_no}, false));
+    }
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 页面guard离开作用域时自动unpin：反复访问远多于缓冲池帧数的页面不会耗尽缓冲池，
+ * WritePageGuard的修改在页面被淘汰后依然保留，移动后只有新的guard持有pin
+ */
+TEST_F(BufferPoolManagerTest, PageGuardTest) {
+    const std::string filename = "page_guard_test";
+    const int buffer_pool_size = 8;
+    const int num_pages = 32;
+
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager_.get());
+
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        WritePageGuard guard = bpm->new_page_guarded(&page_id);
+        ASSERT_TRUE(guard.is_valid());
+        snprintf(guard.get_data(), PAGE_SIZE, "page%d", page_id.page_no);
+    }
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < num_pages; i++) {
+            ReadPageGuard guard = bpm->fetch_page_read(PageId{fd, i});
+            ASSERT_TRUE(guard.is_valid());
+            EXPECT_EQ(0, strcmp(guard.get_data(), ("page" + std::to_string(i)).c_str()));
+        }
+    }
+
+    // 移动构造与移动赋值
+    ReadPageGuard guard0 = bpm->fetch_page_read(PageId{fd, 0});
+    ReadPageGuard moved(std::move(guard0));
+    EXPECT_FALSE(guard0.is_valid());
+    EXPECT_EQ(0, moved.get_page_id().page_no);
+    moved = bpm->fetch_page_read(PageId{fd, 1});  // 赋值时释放页面0
+    EXPECT_TRUE(bpm->delete_page(PageId{fd, 0}));
+    EXPECT_FALSE(bpm->delete_page(PageId{fd, 1}));
+    moved.drop();
+    EXPECT_TRUE(bpm->delete_page(PageId{fd, 1}));
+
+    // 所有帧都被guard持有时fetch失败，得到空的guard
+    std::vector<ReadPageGuard> guards;
+    for (int i = 2; i < 2 + buffer_pool_size; i++) {
+        guards.push_back(bpm->fetch_page_read(PageId{fd, i}));
+        ASSERT_TRUE(guards.back().is_valid());
+    }
+    EXPECT_FALSE(bpm->fetch_page_read(PageId{fd, 2 + buffer_pool_size}).is_valid());
+    guards.clear();
+    EXPECT_TRUE(bpm->fetch_page_read(PageId{fd, 2 + buffer_pool_size}).is_valid());
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 多个线程同时读写同一个页面，写guard持有写latch时读guard不能看到修改了一半的页面
+ */
+TEST_F(BufferPoolManagerTest, PageLatchTest) {
+    const std::string filename = "page_latch_test";
+    const int num_writers = 4;
+    const int num_readers = 4;
+    const int num_updates = 500;
+    const int num_words = 256;  // 每次修改页面开头的num_words个int，它们必须始终相等
+
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    auto bpm = std::make_unique<BufferPoolManager>(8, disk_manager_.get());
+    PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    {
+        WritePageGuard guard = bpm->new_page_guarded(&page_id);
+        ASSERT_TRUE(guard.is_valid());
+        memset(guard.get_data(), 0, PAGE_SIZE);
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<int> torn_reads{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_writers; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < num_updates; i++) {
+                WritePageGuard guard = bpm->fetch_page_write(page_id);
+                int *words = reinterpret_cast<int *>(guard.get_data());
+                for (int j = 0; j < num_words; j++) {
+                    words[j]++;
+                    if (j % 64 == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+                // 持有写latch的线程可以再次获取同一页面
+                ReadPageGuard nested = bpm->fetch_page_read(page_id);
+                EXPECT_EQ(words[0], reinterpret_cast<const int *>(nested.get_data())[num_words - 1]);
+            }
+        });
+    }
+    for (int t = 0; t < num_readers; t++) {
+        threads.emplace_back([&]() {
+            while (!done) {
+                ReadPageGuard guard = bpm->fetch_page_read(page_id);
+                const int *words = reinterpret_cast<const int *>(guard.get_data());
+                for (int j = 1; j < num_words; j++) {
+                    if (words[j] != words[0]) {
+                        torn_reads++;
+                        break;
+                    }
+                }
+                guard.drop();
+                std::this_thread::yield();
+            }
+        });
+    }
+    for (int t = 0; t < num_writers; t++) {
+        threads[t].join();
+    }
+    done = true;
+    for (int t = num_writers; t < num_writers + num_readers; t++) {
+        threads[t].join();
+    }
+
+    EXPECT_EQ(0, torn_reads.load());
+    ReadPageGuard guard = bpm->fetch_page_read(page_id);
+    EXPECT_EQ(num_writers * num_updates, reinterpret_cast<const int *>(guard.get_data())[num_words - 1]);
+    guard.drop();
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief flush_all_pages与修改页面的线程并发执行：写回的总是完整修改后的页面，写盘期间其他线程可以继续访问缓冲池
+ */
+TEST_F(BufferPoolManagerTest, ConcurrentFlushAllPagesTest) {
+    const std::string filename = "concurrent_flush_test";
+    const int num_pages = 4;
+    const int num_writers = 4;
+    const int num_updates = 500;
+    const int num_words = 256;  // 每次修改页面开头的num_words个int，它们必须始终相等
+
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    auto bpm = std::make_unique<BufferPoolManager>(16, disk_manager_.get(), 4);
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        WritePageGuard guard = bpm->new_page_guarded(&page_id);
+        ASSERT_TRUE(guard.is_valid());
+        memset(guard.get_data(), 0, PAGE_SIZE);
+    }
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < num_writers; t++) {
+        writers.emplace_back([&, t]() {
+            for (int i = 0; i < num_updates; i++) {
+                WritePageGuard guard = bpm->fetch_page_write(PageId{fd, (t + i) % num_pages});
+                int *words = reinterpret_cast<int *>(guard.get_data());
+                for (int j = 0; j < num_words; j++) {
+                    words[j]++;
+                    if (j % 64 == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        });
+    }
+    int torn_pages = 0;
+    char buf[PAGE_SIZE];
+    auto check_disk = [&]() {
+        for (int i = 0; i < num_pages; i++) {
+            disk_manager_->read_page(fd, i, buf, PAGE_SIZE);
+            const int *words = reinterpret_cast<const int *>(buf);
+            for (int j = 1; j < num_words; j++) {
+                if (words[j] != words[0]) {
+                    torn_pages++;
+                    break;
+                }
+            }
+        }
+    };
+    std::thread flusher([&]() {
+        while (!done) {
+            bpm->flush_all_pages(fd);
+            check_disk();
+        }
+    });
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    done = true;
+    flusher.join();
+
+    // 最后一次写回之后磁盘上是所有修改完成后的内容，且页面都已unpin
+    bpm->flush_all_pages(fd);
+    check_disk();
+    EXPECT_EQ(0, torn_pages);
+    int total = 0;
+    for (int i = 0; i < num_pages; i++) {
+        disk_manager_->read_page(fd, i, buf, PAGE_SIZE);
+        total += reinterpret_cast<const int *>(buf)[num_words - 1];
+        EXPECT_TRUE(bpm->delete_page(PageId{fd, i}));
+    }
+    EXPECT_EQ(num_writers * num_updates, total);
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 淘汰脏页时，接下来将被淘汰的脏页与它一起按页面顺序写回，之后淘汰它们时不需要再写盘
+ */
+TEST_F(BufferPoolManagerTest, EvictionWriteBackTest) {
+    const std::string filename = "eviction_write_back_test";
+    const int buffer_pool_size = 2 * EVICTION_WRITE_BATCH;
+
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager_.get());
+    for (int i = 0; i < buffer_pool_size; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        Page *page = bpm->new_page(&page_id);
+        ASSERT_NE(nullptr, page);
+        snprintf(page->get_data(), PAGE_SIZE, "page%d", page_id.page_no);
+        ASSERT_TRUE(bpm->unpin_page(page_id, true));
+    }
+
+    // 缓冲池已满，新建页面淘汰最久未使用的页面0，页面0到EVICTION_WRITE_BATCH - 1被一起写回
+    PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    ASSERT_NE(nullptr, bpm->new_page(&page_id));
+    ASSERT_TRUE(bpm->unpin_page(page_id, false));
+    // 其余的脏页尚未写回，文件中只有这些页面
+    EXPECT_EQ(EVICTION_WRITE_BATCH * PAGE_SIZE, disk_manager_->get_file_size(filename));
+    char buf[PAGE_SIZE];
+    for (int i = 0; i < EVICTION_WRITE_BATCH; i++) {
+        disk_manager_->read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(0, strcmp(buf, ("page" + std::to_string(i)).c_str()));
+    }
+
+    // 被一起写回的页面不再是脏页，修改它们之后再次写回的内容以最新的为准
+    Page *page = bpm->fetch_page(PageId{fd, 1});
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->get_data(), "page1"));
+    snprintf(page->get_data(), PAGE_SIZE, "updated");
+    ASSERT_TRUE(bpm->unpin_page(PageId{fd, 1}, true));
+    bpm->flush_all_pages(fd);
+    disk_manager_->read_page(fd, 1, buf, PAGE_SIZE);
+    EXPECT_EQ(0, strcmp(buf, "updated"));
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试用的IO引擎：关闭时提交的请求被挡住，直到open()时才在调用者线程中执行
+ */
+class GatedIoEngine : public IoEngine {
+   public:
+    ~GatedIoEngine() { open(); }
+
+    void submit(IoBatch &batch) override {
+        batch.on_submit();
+        std::unique_lock<std::mutex> lock(latch_);
+        for (auto &request : batch.requests()) {
+            queue_.push_back(&request);
+        }
+        held_cv_.notify_all();
+        if (open_) {
+            run_queued(lock);
+        }
+    }
+
+    const char *name() const override { return "gated"; }
+
+    void close() {
+        std::lock_guard<std::mutex> guard(latch_);
+        open_ = false;
+    }
+
+    void open() {
+        std::unique_lock<std::mutex> lock(latch_);
+        open_ = true;
+        run_queued(lock);
+    }
+
+    /** 等待至少num个请求被挡住 */
+    void wait_held(size_t num) {
+        std::unique_lock<std::mutex> lock(latch_);
+        held_cv_.wait(lock, [&] { return queue_.size() >= num; });
+    }
+
+   private:
+    void run_queued(std::unique_lock<std::mutex> &lock) {
+        while (!queue_.empty()) {
+            IoRequest *request = queue_.front();
+            queue_.pop_front();
+            lock.unlock();
+            ssize_t result = request->type_ == IoRequest::READ
+                                 ? preadv(request->fd_, request->iov_.data(), request->iov_.size(), request->offset())
+                                 : pwritev(request->fd_, request->iov_.data(), request->iov_.size(), request->offset());
+            request->batch_->on_complete(request, result);
+            lock.lock();
+        }
+    }
+
+    std::deque<IoRequest *> queue_;
+    std::mutex latch_;
+    std::condition_variable held_cv_;
+    bool open_ = true;
+};
+
+/**
+ * @brief 多个线程同时fetch同一个不在缓冲池中的页面：只有第一个线程读盘，读取完成之前其他线程在is_loading_上等待，
+ * 之后都得到同一帧；所有线程unpin之后页面可以被删除，即pin_count正确
+ */
+TEST_F(BufferPoolManagerTest, ConcurrentFetchSamePageTest) {
+    const std::string filename = "concurrent_fetch_test";
+    const int num_pages = 8;
+    const int num_threads = 4;
+
+    auto engine = std::make_unique<GatedIoEngine>();
+    GatedIoEngine *gate = engine.get();
+    DiskManager disk_manager(std::move(engine));
+    disk_manager.create_file(filename);
+    int fd = disk_manager.open_file(filename);
+    {
+        BufferPoolManager bpm(num_pages, &disk_manager);
+        for (int i = 0; i < num_pages; i++) {
+            PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+            Page *page = bpm.new_page(&page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->get_data(), PAGE_SIZE, "page%d", page_id.page_no);
+            ASSERT_TRUE(bpm.unpin_page(page_id, true));
+        }
+        bpm.flush_all_pages(fd);
+    }
+
+    auto bpm = std::make_unique<BufferPoolManager>(num_pages, &disk_manager);
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = i};
+        std::vector<Page *> fetched(num_threads);
+        auto fetch = [&](int t) { fetched[t] = bpm->fetch_page(page_id); };
+        // 第一个线程的读请求被挡住，页面停留在is_loading_状态
+        gate->close();
+        std::vector<std::thread> threads;
+        threads.emplace_back(fetch, 0);
+        gate->wait_held(1);
+        for (int t = 1; t < num_threads; t++) {
+            threads.emplace_back(fetch, t);
+        }
+        // 让其他线程进入等待，再放行读请求
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        gate->open();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        ASSERT_NE(nullptr, fetched[0]);
+        EXPECT_EQ(0, strcmp(fetched[0]->get_data(), ("page" + std::to_string(i)).c_str()));
+        for (int t = 1; t < num_threads; t++) {
+            EXPECT_EQ(fetched[0], fetched[t]);
+        }
+        for (int t = 0; t < num_threads; t++) {
+            EXPECT_TRUE(bpm->unpin_page(page_id, false));
+        }
+        EXPECT_FALSE(bpm->unpin_page(page_id, false));
+        EXPECT_TRUE(bpm->delete_page(page_id));
+    }
+
+    // 读取失败时所有等待的线程都得到nullptr，帧被归还，页面不留在页表中
+    PageId missing = {.fd = fd, .page_no = num_pages + 100};
+    std::vector<Page *> fetched(num_threads);
+    std::vector<bool> threw(num_threads, false);
+    auto fetch = [&](int t) {
+        try {
+            fetched[t] = bpm->fetch_page(missing);
+        } catch (InternalError &) {
+            threw[t] = true;
+        }
+    };
+    gate->close();
+    std::vector<std::thread> threads;
+    threads.emplace_back(fetch, 0);
+    gate->wait_held(1);
+    for (int t = 1; t < num_threads; t++) {
+        threads.emplace_back(fetch, t);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    gate->open();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_TRUE(threw[0]);
+    for (int t = 1; t < num_threads; t++) {
+        EXPECT_TRUE(threw[t] || fetched[t] == nullptr);
+    }
+    EXPECT_FALSE(bpm->unpin_page(missing, false));
+    // 所有帧都已归还，仍然可以同时容纳num_pages个页面
+    for (int i = 0; i < num_pages; i++) {
+        EXPECT_NE(nullptr, bpm->fetch_page(PageId{fd, i}));
+    }
+
+    bpm.reset();
+    disk_manager.close_file(fd);
+}
+
+/**
+ * @brief 预读的读请求尚未完成时（其完成回调需要获取分区latch），同一分区淘汰脏页写回不能等待IO引擎，
+ * 否则持有分区latch等待排在预读之后的写请求，与执行预读回调的IO线程互相等待
+ */
+TEST_F(BufferPoolManagerTest, EvictionDuringPrefetchTest) {
+    const std::string filename = "eviction_during_prefetch_test";
+    const int num_frames = 4;
+
+    auto engine = std::make_unique<GatedIoEngine>();
+    GatedIoEngine *gate = engine.get();
+    DiskManager disk_manager(std::move(engine));
+    disk_manager.create_file(filename);
+    int fd = disk_manager.open_file(filename);
+    {
+        BufferPoolManager bpm(num_frames, &disk_manager);
+        for (int i = 0; i < num_frames; i++) {
+            PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+            ASSERT_NE(nullptr, bpm.new_page(&page_id));
+            ASSERT_TRUE(bpm.unpin_page(page_id, true));
+        }
+        bpm.flush_all_pages(fd);
+    }
+
+    BufferPoolManager bpm(num_frames, &disk_manager);
+    PageId dirty_id = {.fd = fd, .page_no = 0};
+    Page *dirty = bpm.fetch_page(dirty_id);
+    ASSERT_NE(nullptr, dirty);
+    snprintf(dirty->get_data(), PAGE_SIZE, "dirty page");
+    ASSERT_TRUE(bpm.unpin_page(dirty_id, true));
+
+    // 预读页面1、2，读请求被挡住，两帧保持pin
+    gate->close();
+    bpm.prefetch(fd, 1, 2);
+    gate->wait_held(1);
+    // 占用最后一个空闲帧，之后再新建页面只能淘汰脏页0
+    PageId new_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    ASSERT_NE(nullptr, bpm.new_page(&new_id));
+    auto evict = std::async(std::launch::async, [&] {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        Page *page = bpm.new_page(&page_id);
+        return page == nullptr ? INVALID_PAGE_ID : page_id.page_no;
+    });
+    bool evicted = evict.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+    gate->open();
+    ASSERT_TRUE(evicted);
+    page_id_t evict_page_no = evict.get();
+    ASSERT_NE(INVALID_PAGE_ID, evict_page_no);
+    bpm.wait_prefetch();
+
+    // 脏页0已经写回，重新读入时内容不变
+    ASSERT_TRUE(bpm.unpin_page(new_id, false));
+    ASSERT_TRUE(bpm.unpin_page(PageId{fd, evict_page_no}, false));
+    dirty = bpm.fetch_page(dirty_id);
+    ASSERT_NE(nullptr, dirty);
+    EXPECT_STREQ("dirty page", dirty->get_data());
+    EXPECT_TRUE(bpm.unpin_page(dirty_id, false));
+    bpm.flush_all_pages(fd);
+    disk_manager.close_file(fd);
+}
+
+/**
+ * @brief 后台刷脏线程写盘期间不持有分区latch：写请求被挡住时，同一分区仍然可以fetch页面和淘汰页面，
+ * 正在写回的页面不会被淘汰；写回完成后所有修改都在磁盘上
+ */
+TEST_F(BufferPoolManagerTest, FlusherWithoutLatchTest) {
+    const std::string filename = "flusher_without_latch_test";
+    const int num_frames = 4;
+    const int min_clean_frames = 2;
+
+    auto engine = std::make_unique<GatedIoEngine>();
+    GatedIoEngine *gate = engine.get();
+    DiskManager disk_manager(std::move(engine));
+    disk_manager.create_file(filename);
+    int fd = disk_manager.open_file(filename);
+    auto bpm = std::make_unique<BufferPoolManager>(num_frames, &disk_manager);
+    for (int i = 0; i < num_frames; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        Page *page = bpm->new_page(&page_id);
+        ASSERT_NE(nullptr, page);
+        snprintf(page->get_data(), PAGE_SIZE, "page%d", page_id.page_no);
+        ASSERT_TRUE(bpm->unpin_page(page_id, true));
+    }
+
+    // 刷脏线程写回最久未使用的页面0、1，写请求被挡住
+    gate->close();
+    bpm->start_flusher(min_clean_frames, std::chrono::milliseconds(1));
+    gate->wait_held(1);
+    auto work = std::async(std::launch::async, [&] {
+        PageId hit_id = {.fd = fd, .page_no = 3};
+        Page *hit = bpm->fetch_page(hit_id);
+        bool ok = hit != nullptr && strcmp(hit->get_data(), "page3") == 0 && bpm->unpin_page(hit_id, false);
+        // 页面0、1正在写回，只能淘汰脏页2
+        PageId new_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        Page *page = bpm->new_page(&new_id);
+        if (page == nullptr) {
+            return false;
+        }
+        snprintf(page->get_data(), PAGE_SIZE, "page%d", new_id.page_no);
+        return ok && bpm->unpin_page(new_id, true);
+    });
+    bool done = work.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+    gate->open();
+    ASSERT_TRUE(done);
+    EXPECT_TRUE(work.get());
+    bpm->stop_flusher();
+
+    char buf[PAGE_SIZE];
+    disk_manager.read_page(fd, 2, buf, PAGE_SIZE);
+    EXPECT_STREQ("page2", buf);
+    bpm->flush_all_pages(fd);
+    for (int i = 0; i <= num_frames; i++) {
+        disk_manager.read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_STREQ(("page" + std::to_string(i)).c_str(), buf);
+    }
+
+    bpm.reset();
+    disk_manager.close_file(fd);
+}
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <cstring>
+#include <iostream>
 #include <unordered_map>
 #include <vector>
 
@@ -147,3 +148,155 @@ TEST_F(DiskManagerTest, PageOperation) {
     disk_manager_->destroy_file(filename);
     EXPECT_EQ(disk_manager_->is_file(filename), false);
 }
+
+/**
+ * @brief 测试批量写入连续页面 write_pages
+ */
+TEST_F(DiskManagerTest, WritePagesOperation) {
+    const std::string filename = "WritePagesTestFile";
+    if (disk_manager_->is_file(filename)) {
+        disk_manager_->destroy_file(filename);
+    }
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    // 一次写入MAX_PAGES个连续页面，再从中间开始覆盖写一段
+    std::vector<std::vector<char>> data(MAX_PAGES, std::vector<char>(PAGE_SIZE));
+    std::vector<const char *> pages(MAX_PAGES);
+    for (int i = 0; i < MAX_PAGES; i++) {
+        rand_buf(data[i].data(), PAGE_SIZE);
+        data[i][0] = static_cast<char>(i);
+        pages[i] = data[i].data();
+    }
+    disk_manager_->write_pages(fd, 0, pages.data(), MAX_PAGES);
+    for (int i = MAX_PAGES / 2; i < MAX_PAGES; i++) {
+        data[i][1] = static_cast<char>(~data[i][1]);
+    }
+    disk_manager_->write_pages(fd, MAX_PAGES / 2, pages.data() + MAX_PAGES / 2, MAX_PAGES - MAX_PAGES / 2);
+
+    char buf[PAGE_SIZE];
+    for (int page_no = 0; page_no < MAX_PAGES; page_no++) {
+        disk_manager_->read_page(fd, page_no, buf, PAGE_SIZE);
+        EXPECT_EQ(std::memcmp(buf, data[page_no].data(), PAGE_SIZE), 0);
+    }
+
+    disk_manager_->close_file(fd);
+    disk_manager_->destroy_file(filename);
+}
+
+/**
+ * @brief 测试通过异步IO引擎批量提交读写请求 submit_io
+ */
+TEST_F(DiskManagerTest, AsyncIoOperation) {
+    const std::string filename = "AsyncIoTestFile";
+    if (disk_manager_->is_file(filename)) {
+        disk_manager_->destroy_file(filename);
+    }
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    std::cout << "io engine: " << disk_manager_->io_engine_name() << std::endl;
+
+    // 每个请求写4个连续页面，一批提交全部请求
+    const int run_len = 4;
+    std::vector<std::vector<char>> data(MAX_PAGES, std::vector<char>(PAGE_SIZE));
+    std::vector<const char *> pages(MAX_PAGES);
+    for (int i = 0; i < MAX_PAGES; i++) {
+        rand_buf(data[i].data(), PAGE_SIZE);
+        data[i][0] = static_cast<char>(i);
+        pages[i] = data[i].data();
+    }
+    {
+        IoBatch batch;
+        for (int i = 0; i < MAX_PAGES; i += run_len) {
+            batch.add_write(fd, i, pages.data() + i, run_len);
+        }
+        disk_manager_->submit_io(batch);
+        batch.wait();
+    }
+
+    // 每个请求读一个页面
+    std::vector<std::vector<char>> bufs(MAX_PAGES, std::vector<char>(PAGE_SIZE));
+    {
+        IoBatch batch;
+        for (int i = 0; i < MAX_PAGES; i++) {
+            char *buf = bufs[i].data();
+            batch.add_read(fd, i, &buf, 1);
+        }
+        disk_manager_->submit_io(batch);
+        batch.wait();
+    }
+    for (int i = 0; i < MAX_PAGES; i++) {
+        EXPECT_EQ(std::memcmp(bufs[i].data(), data[i].data(), PAGE_SIZE), 0);
+    }
+
+    // 读取文件末尾之外的页面，读取不完整时wait()抛出异常
+    {
+        IoBatch batch;
+        char *buf = bufs[0].data();
+        batch.add_read(fd, MAX_PAGES, &buf, 1);
+        disk_manager_->submit_io(batch);
+        EXPECT_THROW(batch.wait(), InternalError);
+    }
+
+    disk_manager_->close_file(fd);
+    disk_manager_->destroy_file(filename);
+}
+
+/**
+ * @brief 连续页面超过IoRequest::MAX_PAGES个时，IoBatch把它拆成多个preadv/pwritev请求，
+ * 同步的write_pages也分多次pwritev写入
+ */
+TEST_F(DiskManagerTest, AsyncIoLongRunOperation) {
+    const std::string filename = "AsyncIoLongRunTestFile";
+    if (disk_manager_->is_file(filename)) {
+        disk_manager_->destroy_file(filename);
+    }
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    const int num_pages = 2 * IoRequest::MAX_PAGES + 3;
+    std::vector<char> data(static_cast<size_t>(num_pages) * PAGE_SIZE);
+    std::vector<char *> pages(num_pages);
+    for (int i = 0; i < num_pages; i++) {
+        pages[i] = data.data() + static_cast<size_t>(i) * PAGE_SIZE;
+        memset(pages[i], 0, PAGE_SIZE);
+        memcpy(pages[i], &i, sizeof(i));
+    }
+    {
+        IoBatch batch;
+        batch.add_write(fd, 0, pages.data(), num_pages);
+        EXPECT_EQ(3, batch.requests().size());
+        disk_manager_->submit_io(batch);
+        batch.wait();
+    }
+    EXPECT_EQ(num_pages * PAGE_SIZE, disk_manager_->get_file_size(filename));
+
+    std::vector<char> read_data(data.size());
+    for (int i = 0; i < num_pages; i++) {
+        pages[i] = read_data.data() + static_cast<size_t>(i) * PAGE_SIZE;
+    }
+    {
+        IoBatch batch;
+        batch.add_read(fd, 0, pages.data(), num_pages);
+        disk_manager_->submit_io(batch);
+        batch.wait();
+    }
+    EXPECT_EQ(0, std::memcmp(read_data.data(), data.data(), data.size()));
+
+    std::vector<const char *> write_pages(num_pages);
+    for (int i = 0; i < num_pages; i++) {
+        data[static_cast<size_t>(i) * PAGE_SIZE + sizeof(i)] = 'w';
+        write_pages[i] = data.data() + static_cast<size_t>(i) * PAGE_SIZE;
+    }
+    disk_manager_->write_pages(fd, 0, write_pages.data(), num_pages);
+    {
+        IoBatch batch;
+        batch.add_read(fd, 0, pages.data(), num_pages);
+        disk_manager_->submit_io(batch);
+        batch.wait();
+    }
+    EXPECT_EQ(0, std::memcmp(read_data.data(), data.data(), data.size()));
+
+    disk_manager_->close_file(fd);
+    disk_manager_->destroy_file(filename);
+}
@@ -1,13 +1,19 @@
 #include "replacer/lru_replacer.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <iostream>
 #include <memory>
 #include <random>
 #include <set>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "replacer/clock_replacer.h"
+#include "replacer/two_queue_replacer.h"
+
 #include "gtest/gtest.h"
 
 /**
@@ -155,3 +161,187 @@ TEST(LRUReplacerTest, ConcurrencyTest) {
         EXPECT_EQ(0, lru_replacer->victim(&result));
     }
 }
+
+/**
+ * @brief 按照LRUReplacerTest.SimpleTest的场景测试其他替换策略，三者在该场景下的淘汰顺序一致
+ */
+template <typename ReplacerT>
+static void replacer_simple_test() {
+    ReplacerT replacer(7);
+
+    replacer.unpin(1);
+    replacer.unpin(2);
+    replacer.unpin(3);
+    replacer.unpin(4);
+    replacer.unpin(5);
+    replacer.unpin(6);
+    replacer.unpin(1);
+    EXPECT_EQ(6, replacer.Size());
+
+    int value;
+    EXPECT_TRUE(replacer.victim(&value));
+    EXPECT_EQ(1, value);
+    EXPECT_TRUE(replacer.victim(&value));
+    EXPECT_EQ(2, value);
+    EXPECT_TRUE(replacer.victim(&value));
+    EXPECT_EQ(3, value);
+
+    replacer.pin(3);
+    replacer.pin(4);
+    EXPECT_EQ(2, replacer.Size());
+
+    replacer.unpin(4);
+
+    EXPECT_TRUE(replacer.victim(&value));
+    EXPECT_EQ(5, value);
+    EXPECT_TRUE(replacer.victim(&value));
+    EXPECT_EQ(6, value);
+    EXPECT_TRUE(replacer.victim(&value));
+    EXPECT_EQ(4, value);
+    EXPECT_FALSE(replacer.victim(&value));
+    EXPECT_EQ(0, replacer.Size());
+}
+
+TEST(ClockReplacerTest, SimpleTest) { replacer_simple_test<ClockReplacer>(); }
+
+TEST(TwoQueueReplacerTest, SimpleTest) { replacer_simple_test<TwoQueueReplacer>(); }
+
+/**
+ * @brief 2Q中多次访问的frame应该比只访问过一次的frame更晚被淘汰
+ */
+TEST(TwoQueueReplacerTest, ScanResistanceTest) {
+    const int num_frames = 8;  // kin = 2
+    TwoQueueReplacer replacer(num_frames);
+    // frame 0是热点页面：载入后经过kin次其他载入再被访问，提升到Am
+    replacer.pin(0);
+    replacer.unpin(0);
+    for (int i = 1; i < num_frames; i++) {
+        replacer.pin(i);
+        replacer.unpin(i);
+    }
+    replacer.pin(0);
+    replacer.unpin(0);
+    // 扫描页面的相关访问（连续多次访问）不会被提升
+    replacer.pin(num_frames - 1);
+    replacer.unpin(num_frames - 1);
+    // 虽然frame 0最早载入，但A1中的扫描页面先被淘汰，直到A1小于kin
+    int value;
+    for (int i = 1; i < num_frames - 1; i++) {
+        EXPECT_TRUE(replacer.victim(&value));
+        EXPECT_EQ(i, value);
+    }
+    EXPECT_TRUE(replacer.victim(&value));
+    EXPECT_EQ(0, value);
+    EXPECT_TRUE(replacer.victim(&value));
+    EXPECT_EQ(num_frames - 1, value);
+}
+
+/**
+ * @brief 页面被删除时从2Q中移除frame不算一次访问，帧被复用后装入的新页面重新从A1开始
+ */
+TEST(TwoQueueReplacerTest, RemoveTest) {
+    const int num_frames = 8;  // kin = 2
+    TwoQueueReplacer replacer(num_frames);
+    for (int i = 0; i < 4; i++) {
+        replacer.pin(i);
+        replacer.unpin(i);
+    }
+    // frame 0已在A1中老化，若移除被当作一次访问，它会被提升到Am
+    replacer.remove(0);
+    EXPECT_EQ(3, replacer.Size());
+    replacer.pin(0);
+    replacer.unpin(0);
+    int value;
+    for (int expected : {1, 2, 3, 0}) {
+        EXPECT_TRUE(replacer.victim(&value));
+        EXPECT_EQ(expected, value);
+    }
+    EXPECT_FALSE(replacer.victim(&value));
+}
+
+/**
+ * @brief 用replacer模拟一个容量为pool_size的缓冲池，返回访问序列trace中每次访问是否命中
+ */
+static std::vector<bool> simulate(Replacer *replacer, size_t pool_size, const std::vector<int> &trace) {
+    std::unordered_map<int, frame_id_t> page2frame;
+    std::vector<int> frame2page(pool_size, -1);
+    std::vector<bool> hits;
+    hits.reserve(trace.size());
+    size_t used = 0;
+    for (int page : trace) {
+        frame_id_t frame_id;
+        auto iter = page2frame.find(page);
+        hits.push_back(iter != page2frame.end());
+        if (iter != page2frame.end()) {
+            frame_id = iter->second;
+        } else {
+            if (used < pool_size) {
+                frame_id = static_cast<frame_id_t>(used++);
+            } else {
+                EXPECT_TRUE(replacer->victim(&frame_id));
+                page2frame.erase(frame2page[frame_id]);
+            }
+            page2frame[page] = frame_id;
+            frame2page[frame_id] = page;
+        }
+        replacer->pin(frame_id);
+        replacer->unpin(frame_id);
+    }
+    return hits;
+}
+
+/**
+ * @brief 对比LRU、CLOCK和2Q在"点查询+顺序扫描"混合负载下的命中率与耗时
+ * @note 热点页面集合小于缓冲池，每轮点查询之后穿插一次大于缓冲池的全表扫描，扫描中每个页面被连续访问多次
+ */
+TEST(ReplacerComparisonTest, ScanPlusPointLookupBenchmark) {
+    const size_t pool_size = 256;
+    const int hot_pages = 128;
+    const int scan_pages = 1024;
+    const int records_per_page = 4;
+    const int lookups_per_round = 2000;
+    const int rounds = 50;
+
+    std::vector<int> trace;
+    std::mt19937 rng(0);
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < lookups_per_round; i++) {
+            trace.push_back(static_cast<int>(rng() % hot_pages));
+        }
+        for (int p = 0; p < scan_pages; p++) {
+            for (int k = 0; k < records_per_page; k++) {
+                trace.push_back(hot_pages + p);
+            }
+        }
+    }
+
+    // 返回点查询的命中率；扫描页面无论哪种策略都必然缺失，只输出总体命中率作参考
+    auto run = [&](const char *name, Replacer *replacer) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<bool> hits = simulate(replacer, pool_size, trace);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t total_hits = 0, lookups = 0, lookup_hits = 0;
+        for (size_t i = 0; i < trace.size(); i++) {
+            total_hits += hits[i];
+            if (trace[i] < hot_pages) {
+                lookups++;
+                lookup_hits += hits[i];
+            }
+        }
+        double lookup_hit_rate = static_cast<double>(lookup_hits) / lookups;
+        std::cout << name << ": hit rate=" << static_cast<double>(total_hits) / trace.size()
+                  << " lookup hit rate=" << lookup_hit_rate << " time=" << secs << "s" << std::endl;
+        return lookup_hit_rate;
+    };
+
+    LRUReplacer lru(pool_size);
+    ClockReplacer clock(pool_size);
+    TwoQueueReplacer two_queue(pool_size);
+    double lru_hit = run("LRU", &lru);
+    double clock_hit = run("CLOCK", &clock);
+    double two_queue_hit = run("2Q", &two_queue);
+
+    // 扫描会冲掉LRU中的热点页面，2Q应当保留它们
+    EXPECT_GT(two_queue_hit, lru_hit);
+    EXPECT_GT(two_queue_hit, clock_hit);
+}
@@ -64,6 +64,17 @@ void TransactionManager::commit(Transaction *txn, LogManager *log_manager) {
     txn->set_state(TransactionState::COMMITTED);
 }
 
+// 按索引字段的顺序从记录中拼接出索引的key
+static std::vector<char> index_key(const IndexMeta &index, const char *rec) {
+    std::vector<char> key(index.col_tot_len);
+    int offset = 0;
+    for (auto &col : index.cols) {
+        memcpy(key.data() + offset, rec + col.offset, col.len);
+        offset += col.len;
+    }
+    return key;
+}
+
 /**
  * @description: 事务的终止（回滚）方法
  * @param {Transaction *} txn 需要回滚的事务
@@ -91,56 +102,44 @@ void TransactionManager::abort(Transaction *txn, LogManager *log_manager) {
         switch (type) 
         {
             case WType::INSERT_TUPLE:
+            {
+                // 插入操作的写记录中没有保存记录本身，索引的key取自删除前的记录
+                auto inserted_rec = fh->get_record(rid, context);
                 fh->delete_record(rid, context); 
-                // break;
                 //删除索引
                 for (auto &index : tab.indexes)
                 {
-                    auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
-                    char *key = new char[index.col_tot_len];
-                    int offset = 0;
-                    for (size_t j = 0; j < index.col_num; ++j)
-                    {
-                        memcpy(key + offset, buf + index.cols[j].offset, index.cols[j].len);
-                        offset += index.cols[j].len;
-                    }
-                    ih->delete_entry(key, context->txn_);
+                    sm_manager_->delete_index_entry(tab_name_, index, index_key(index, inserted_rec->data).data(), rid, context->txn_);
                 }
                 break;
+            }
             case WType::DELETE_TUPLE:
-                fh->insert_record(buf, context); 
-                // break;
+            {
+                // 把记录恢复到删除前的位置：事务仍持有该记录的排他锁，槽位不会被其他事务占用。
+                // 写集合中更早的操作（例如先更新再删除同一条记录）按原来的rid回滚
+                fh->insert_record(rid, buf);
                 //插入索引
                 for (auto &index : tab.indexes)
                 {
-                    auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
-                    char *key = new char[index.col_tot_len];
-                    int offset = 0;
-                    for (size_t j = 0; j < index.col_num; ++j)
-                    {
-                        memcpy(key + offset, buf + index.cols[j].offset, index.cols[j].len);
-                        offset += index.cols[j].len;
-                    }
-                    ih->insert_entry(key, rid, context->txn_);
+                    sm_manager_->insert_index_entry(tab_name_, index, index_key(index, buf).data(), rid, context->txn_);
                 }
                 break;
+            }
             case WType::UPDATE_TUPLE:
+            {
+                // 删除更新后的记录的索引项，再插入更新前的记录的索引项
+                auto curr_rec = fh->get_record(rid, context);
+                for (auto &index : tab.indexes)
+                {
+                    sm_manager_->delete_index_entry(tab_name_, index, index_key(index, curr_rec->data).data(), rid, context->txn_);
+                }
                 fh->update_record(rid, buf, context); 
-                // break;
-                //删除索引
                 for (auto &index : tab.indexes)
                 {
-                    auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
-                    char *key = new char[index.col_tot_len];
-                    int offset = 0;
-                    for (size_t j = 0; j < index.col_num; ++j)
-                    {
-                        memcpy(key + offset, buf + index.cols[j].offset, index.cols[j].len);
-                        offset += index.cols[j].len;
-                    }
-                    ih->delete_entry(key, context->txn_);
+                    sm_manager_->insert_index_entry(tab_name_, index, index_key(index, buf).data(), rid, context->txn_);
                 }
                 break;
+            }
         }
     }
     write_set->clear();